@@ -25,11 +25,23 @@ limitations under the License.
 ************************************************************************************/
 
 #include "OVR_Allocator.h"
+#include "OVR_Atomic.h"
+#include "OVR_Alg.h"
 #ifdef OVR_OS_MAC
  #include <stdlib.h>
 #else
  #include <malloc.h>
 #endif
+#include <string.h>
+#if !defined(OVR_OS_WIN32)
+ #include <pthread.h>
+#endif
+
+#if defined(OVR_CC_MSVC)
+ #define OVR_THREAD_LOCAL __declspec(thread)
+#else
+ #define OVR_THREAD_LOCAL __thread
+#endif
 
 namespace OVR {
 
@@ -100,4 +112,530 @@ DefaultAllocator* DefaultAllocator::InitSystemSingleton()
 }
 
 
+//------------------------------------------------------------------------
+// ***** AllocatorStats
+
+AllocatorStats* volatile AllocatorStats::pFirst = NULL;
+
+AllocatorStats::AllocatorStats(const char* tag) :
+    Tag(tag),
+    Bytes(0),
+    PeakBytes(0),
+    AllocCount(0),
+    FreeCount(0),
+    FallbackCount(0),
+    pNext(NULL)
+{
+    // Tags are usually function statics, so they can be created on any thread.
+    for (;;)
+    {
+        AllocatorStats* first = AtomicOps<AllocatorStats*>::Load_Acquire(&pFirst);
+        pNext = first;
+        if (AtomicOps<AllocatorStats*>::CompareAndSet_Sync(&pFirst, first, this))
+        {
+            break;
+        }
+    }
+}
+
+AllocatorStats* AllocatorStats::GetFirst()
+{
+    return AtomicOps<AllocatorStats*>::Load_Acquire(&pFirst);
+}
+
+void AllocatorStats::OnAlloc(size_t size)
+{
+    const size_t bytes = AtomicOps<size_t>::ExchangeAdd_NoSync(&Bytes, size) + size;
+    AtomicOps<size_t>::ExchangeAdd_NoSync(&AllocCount, 1);
+    // The high-water mark may miss a concurrent update; it is only reported.
+    if (bytes > PeakBytes)
+    {
+        PeakBytes = bytes;
+    }
+}
+
+void AllocatorStats::OnFree(size_t size)
+{
+    AtomicOps<size_t>::ExchangeAdd_NoSync(&Bytes, (size_t)0 - size);
+    AtomicOps<size_t>::ExchangeAdd_NoSync(&FreeCount, 1);
+}
+
+void AllocatorStats::OnFallback()
+{
+    AtomicOps<size_t>::ExchangeAdd_NoSync(&FallbackCount, 1);
+}
+
+
+//------------------------------------------------------------------------
+// ***** FrameAllocator
+
+// Every block starts with a header holding the requested size. Two words keep
+// the returned memory at the alignment malloc() guarantees.
+static const size_t FrameHeaderSize = 2 * sizeof(size_t);
+
+struct FrameArena
+{
+    uint8_t*    pBuffer;
+    size_t      HalfSize;
+    size_t      Used[2];        // bytes used in each half
+    size_t      LastOffset;     // offset of the most recent block in the current half
+    uint32_t    FrameIndex;
+};
+
+static FrameArena                   TheFrameArena;
+static OVR_THREAD_LOCAL bool        IsFrameThread = false;
+
+static inline size_t FrameBlockSize(size_t size)
+{
+    return FrameHeaderSize + ((size + FrameHeaderSize - 1) & ~(FrameHeaderSize - 1));
+}
+
+AllocatorStats& FrameAllocator::GetArenaStats()
+{
+    static AllocatorStats stats("FrameArena");
+    return stats;
+}
+
+void FrameAllocator::Init(size_t capacity)
+{
+    OVR_ASSERT(TheFrameArena.pBuffer == NULL);
+    const size_t halfSize = (capacity / 2) & ~(FrameHeaderSize - 1);
+    TheFrameArena.pBuffer = (uint8_t*)OVR_ALLOC(halfSize * 2);
+    TheFrameArena.HalfSize = (TheFrameArena.pBuffer != NULL) ? halfSize : 0;
+    TheFrameArena.Used[0] = 0;
+    TheFrameArena.Used[1] = 0;
+    TheFrameArena.LastOffset = 0;
+    TheFrameArena.FrameIndex = 0;
+    IsFrameThread = (TheFrameArena.pBuffer != NULL);
+}
+
+void FrameAllocator::Shutdown()
+{
+    OVR_ASSERT(IsFrameThread || TheFrameArena.pBuffer == NULL);
+    if (TheFrameArena.FrameIndex > 0)
+    {
+        GetArenaStats().OnFree(TheFrameArena.Used[(TheFrameArena.FrameIndex - 1) & 1]);
+    }
+    OVR_FREE(TheFrameArena.pBuffer);
+    memset(&TheFrameArena, 0, sizeof(TheFrameArena));
+    IsFrameThread = false;
+}
+
+void FrameAllocator::BeginFrame()
+{
+    if (!IsFrameThread)
+    {
+        return;
+    }
+    // The arena is only touched by this thread, so its usage is accounted once
+    // per frame instead of per block: the half of the finished frame is added
+    // and the half that is about to be reused is removed.
+    GetArenaStats().OnAlloc(TheFrameArena.Used[TheFrameArena.FrameIndex & 1]);
+    TheFrameArena.FrameIndex++;
+    const int half = TheFrameArena.FrameIndex & 1;
+    if (TheFrameArena.FrameIndex > 1)
+    {
+        GetArenaStats().OnFree(TheFrameArena.Used[half]);
+    }
+    TheFrameArena.Used[half] = 0;
+    TheFrameArena.LastOffset = 0;
+}
+
+bool FrameAllocator::Owns(const void* p)
+{
+    const uint8_t* bp = (const uint8_t*)p;
+    return bp >= TheFrameArena.pBuffer && bp < TheFrameArena.pBuffer + TheFrameArena.HalfSize * 2;
+}
+
+uint32_t FrameAllocator::GetFrameIndex()
+{
+    return TheFrameArena.FrameIndex;
+}
+
+void* FrameAllocator::Alloc(size_t size, AllocatorStats& stats)
+{
+    const size_t blockSize = FrameBlockSize(size);
+    uint8_t* block = NULL;
+
+    if (IsFrameThread)
+    {
+        const int half = TheFrameArena.FrameIndex & 1;
+        if (TheFrameArena.Used[half] + blockSize <= TheFrameArena.HalfSize)
+        {
+            block = TheFrameArena.pBuffer + half * TheFrameArena.HalfSize + TheFrameArena.Used[half];
+            TheFrameArena.LastOffset = TheFrameArena.Used[half];
+            TheFrameArena.Used[half] += blockSize;
+        }
+        else
+        {
+            GetArenaStats().OnFallback();
+        }
+    }
+    if (block == NULL)
+    {
+        block = (uint8_t*)OVR_ALLOC(FrameHeaderSize + size);
+        if (block == NULL)
+        {
+            return NULL;
+        }
+        stats.OnFallback();
+    }
+
+    *(size_t*)block = size;
+    stats.OnAlloc(size);
+    return block + FrameHeaderSize;
+}
+
+// Returns true if p is the most recent allocation in the current half and
+// can be resized or rolled back.
+static inline bool IsLastFrameBlock(const uint8_t* block)
+{
+    const int half = TheFrameArena.FrameIndex & 1;
+    return IsFrameThread && TheFrameArena.Used[half] != 0 &&
+            block == TheFrameArena.pBuffer + half * TheFrameArena.HalfSize + TheFrameArena.LastOffset;
+}
+
+void* FrameAllocator::Realloc(void* p, size_t newSize, AllocatorStats& stats)
+{
+    if (p == NULL)
+    {
+        return Alloc(newSize, stats);
+    }
+
+    uint8_t* block = (uint8_t*)p - FrameHeaderSize;
+    const size_t oldSize = *(size_t*)block;
+
+    if (Owns(block))
+    {
+        if (IsLastFrameBlock(block))
+        {
+            const int half = TheFrameArena.FrameIndex & 1;
+            const size_t newBlockSize = FrameBlockSize(newSize);
+            if (TheFrameArena.LastOffset + newBlockSize <= TheFrameArena.HalfSize)
+            {
+                TheFrameArena.Used[half] = TheFrameArena.LastOffset + newBlockSize;
+                *(size_t*)block = newSize;
+                stats.OnFree(oldSize);
+                stats.OnAlloc(newSize);
+                return p;
+            }
+        }
+        else if (newSize <= oldSize)
+        {
+            return p;
+        }
+    }
+    else if (!IsFrameThread)
+    {
+        uint8_t* newBlock = (uint8_t*)OVR_REALLOC(block, FrameHeaderSize + newSize);
+        if (newBlock == NULL)
+        {
+            return NULL;
+        }
+        *(size_t*)newBlock = newSize;
+        stats.OnFree(oldSize);
+        stats.OnAlloc(newSize);
+        return newBlock + FrameHeaderSize;
+    }
+
+    void* newp = Alloc(newSize, stats);
+    if (newp != NULL)
+    {
+        memcpy(newp, p, Alg::Min(oldSize, newSize));
+        Free(p, stats);
+    }
+    return newp;
+}
+
+void FrameAllocator::Free(void* p, AllocatorStats& stats)
+{
+    if (p == NULL)
+    {
+        return;
+    }
+
+    uint8_t* block = (uint8_t*)p - FrameHeaderSize;
+    const size_t size = *(size_t*)block;
+    stats.OnFree(size);
+
+    if (!Owns(block))
+    {
+        OVR_FREE(block);
+    }
+    else if (IsLastFrameBlock(block))
+    {
+        const int half = TheFrameArena.FrameIndex & 1;
+        TheFrameArena.Used[half] = TheFrameArena.LastOffset;
+    }
+}
+
+
+//------------------------------------------------------------------------
+// ***** PoolAllocator
+
+// The header holds the size class and the requested size.
+static const size_t PoolHeaderSize      = 2 * sizeof(size_t);
+static const int    PoolMinClassShift   = 5;                    // 32 byte blocks
+static const int    PoolNumClasses      = 8;                    // up to 4096 byte blocks
+static const size_t PoolLargeClass      = PoolNumClasses;       // block comes from the heap
+static const size_t PoolChunkSize       = 64 * 1024;
+
+struct PoolBlock
+{
+    PoolBlock*  pNext;
+};
+
+struct ThreadPool
+{
+    PoolBlock*  FreeBlocks[PoolNumClasses];
+    ThreadPool* pNextUnused;    // link in the list of pools of exited threads
+};
+
+static OVR_THREAD_LOCAL ThreadPool*     pCurrentThreadPool = NULL;
+static ThreadPool*                      pUnusedPools = NULL;
+
+static Lock& GetPoolLock()
+{
+    static Lock lock;
+    return lock;
+}
+
+// Called on thread exit; the pool keeps its blocks for the next thread.
+static void ReleaseThreadPool(void* pool)
+{
+    // Anything the exiting thread frees after this goes to a new pool.
+    pCurrentThreadPool = NULL;
+
+    Lock::Locker locker(&GetPoolLock());
+    ((ThreadPool*)pool)->pNextUnused = pUnusedPools;
+    pUnusedPools = (ThreadPool*)pool;
+}
+
+#if defined(OVR_OS_WIN32)
+// Fiber local storage is used for its destructor callback, which runs on thread exit.
+static DWORD            PoolThreadFlsIndex = FLS_OUT_OF_INDEXES;
+static INIT_ONCE        PoolThreadFlsOnce = INIT_ONCE_STATIC_INIT;
+
+static VOID WINAPI ReleaseThreadPoolFls(PVOID pool)
+{
+    if (pool != NULL)
+    {
+        ReleaseThreadPool(pool);
+    }
+}
+
+static BOOL CALLBACK CreatePoolThreadFls(PINIT_ONCE, PVOID, PVOID*)
+{
+    PoolThreadFlsIndex = FlsAlloc(ReleaseThreadPoolFls);
+    return TRUE;
+}
+#else
+static pthread_key_t    PoolThreadKey;
+static pthread_once_t   PoolThreadKeyOnce = PTHREAD_ONCE_INIT;
+
+static void CreatePoolThreadKey()
+{
+    pthread_key_create(&PoolThreadKey, ReleaseThreadPool);
+}
+#endif
+
+static ThreadPool* AcquireThreadPool()
+{
+    ThreadPool* pool = NULL;
+    {
+        Lock::Locker locker(&GetPoolLock());
+        pool = pUnusedPools;
+        if (pool != NULL)
+        {
+            pUnusedPools = pool->pNextUnused;
+        }
+    }
+    if (pool == NULL)
+    {
+        pool = (ThreadPool*)OVR_ALLOC(sizeof(ThreadPool));
+        if (pool == NULL)
+        {
+            return NULL;
+        }
+        memset(pool, 0, sizeof(ThreadPool));
+    }
+#if defined(OVR_OS_WIN32)
+    InitOnceExecuteOnce(&PoolThreadFlsOnce, CreatePoolThreadFls, NULL, NULL);
+    if (PoolThreadFlsIndex != FLS_OUT_OF_INDEXES)
+    {
+        FlsSetValue(PoolThreadFlsIndex, pool);
+    }
+#else
+    pthread_once(&PoolThreadKeyOnce, CreatePoolThreadKey);
+    pthread_setspecific(PoolThreadKey, pool);
+#endif
+    pCurrentThreadPool = pool;
+    return pool;
+}
+
+static inline size_t PoolSizeClass(size_t size)
+{
+    const size_t blockSize = size + PoolHeaderSize;
+    if (blockSize > ((size_t)1 << (PoolMinClassShift + PoolNumClasses - 1)))
+    {
+        return PoolLargeClass;
+    }
+    if (blockSize <= ((size_t)1 << PoolMinClassShift))
+    {
+        return 0;
+    }
+    return Alg::UpperBit(blockSize - 1) + 1 - PoolMinClassShift;
+}
+
+static inline size_t PoolClassCapacity(size_t sizeClass)
+{
+    return ((size_t)1 << (sizeClass + PoolMinClassShift)) - PoolHeaderSize;
+}
+
+AllocatorStats& PoolAllocator::GetChunkStats()
+{
+    static AllocatorStats stats("PoolChunks");
+    return stats;
+}
+
+// Carves a new chunk into blocks of the given class.
+static PoolBlock* RefillPool(size_t sizeClass)
+{
+    uint8_t* chunk = (uint8_t*)OVR_ALLOC(PoolChunkSize);
+    if (chunk == NULL)
+    {
+        return NULL;
+    }
+    PoolAllocator::GetChunkStats().OnAlloc(PoolChunkSize);
+
+    const size_t blockSize = (size_t)1 << (sizeClass + PoolMinClassShift);
+    PoolBlock* first = NULL;
+    for (size_t offset = PoolChunkSize - blockSize; ; offset -= blockSize)
+    {
+        PoolBlock* block = (PoolBlock*)(chunk + offset);
+        block->pNext = first;
+        first = block;
+        if (offset == 0)
+        {
+            break;
+        }
+    }
+    return first;
+}
+
+void* PoolAllocator::Alloc(size_t size, AllocatorStats& stats)
+{
+    size_t sizeClass = PoolSizeClass(size);
+    size_t* header = NULL;
+
+    if (sizeClass != PoolLargeClass)
+    {
+        ThreadPool* pool = pCurrentThreadPool;
+        if (pool == NULL)
+        {
+            pool = AcquireThreadPool();
+        }
+        if (pool != NULL)
+        {
+            PoolBlock* block = pool->FreeBlocks[sizeClass];
+            if (block == NULL)
+            {
+                block = RefillPool(sizeClass);
+            }
+            if (block != NULL)
+            {
+                pool->FreeBlocks[sizeClass] = block->pNext;
+                header = (size_t*)block;
+            }
+        }
+    }
+    if (header == NULL)
+    {
+        header = (size_t*)OVR_ALLOC(PoolHeaderSize + size);
+        if (header == NULL)
+        {
+            return NULL;
+        }
+        sizeClass = PoolLargeClass;
+        stats.OnFallback();
+    }
+
+    header[0] = sizeClass;
+    header[1] = size;
+    stats.OnAlloc(size);
+    return (uint8_t*)header + PoolHeaderSize;
+}
+
+void* PoolAllocator::Realloc(void* p, size_t newSize, AllocatorStats& stats)
+{
+    if (p == NULL)
+    {
+        return Alloc(newSize, stats);
+    }
+
+    size_t* header = (size_t*)((uint8_t*)p - PoolHeaderSize);
+    const size_t sizeClass = header[0];
+    const size_t oldSize = header[1];
+
+    if (sizeClass != PoolLargeClass && newSize <= PoolClassCapacity(sizeClass))
+    {
+        header[1] = newSize;
+        stats.OnFree(oldSize);
+        stats.OnAlloc(newSize);
+        return p;
+    }
+    if (sizeClass == PoolLargeClass && PoolSizeClass(newSize) == PoolLargeClass)
+    {
+        header = (size_t*)OVR_REALLOC(header, PoolHeaderSize + newSize);
+        if (header == NULL)
+        {
+            return NULL;
+        }
+        header[1] = newSize;
+        stats.OnFree(oldSize);
+        stats.OnAlloc(newSize);
+        return (uint8_t*)header + PoolHeaderSize;
+    }
+
+    void* newp = Alloc(newSize, stats);
+    if (newp != NULL)
+    {
+        memcpy(newp, p, Alg::Min(oldSize, newSize));
+        Free(p, stats);
+    }
+    return newp;
+}
+
+void PoolAllocator::Free(void* p, AllocatorStats& stats)
+{
+    if (p == NULL)
+    {
+        return;
+    }
+
+    size_t* header = (size_t*)((uint8_t*)p - PoolHeaderSize);
+    const size_t sizeClass = header[0];
+    stats.OnFree(header[1]);
+
+    if (sizeClass == PoolLargeClass)
+    {
+        OVR_FREE(header);
+        return;
+    }
+
+    ThreadPool* pool = pCurrentThreadPool;
+    if (pool == NULL)
+    {
+        pool = AcquireThreadPool();
+        if (pool == NULL)
+        {
+            return;     // The block is lost, which only happens when out of memory.
+        }
+    }
+    PoolBlock* block = (PoolBlock*)header;
+    block->pNext = pool->FreeBlocks[sizeClass];
+    pool->FreeBlocks[sizeClass] = block;
+}
+
+
 } // namespace OVR
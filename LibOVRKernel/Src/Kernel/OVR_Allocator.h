@@ -267,6 +267,134 @@ public:
 
 
 
+//------------------------------------------------------------------------
+// ***** AllocatorStats
+
+// Allocation counters for one tag. Every AllocatorStats adds itself to a global
+// list on construction, so the counters of all tags can be walked with
+// GetFirst() / GetNext(), for example to print them from a console command.
+// Instances must have static storage duration; use OVR_ALLOCATOR_TAG to
+// declare one.
+
+class AllocatorStats
+{
+public:
+    explicit AllocatorStats(const char* tag);
+
+    void    OnAlloc(size_t size);
+    void    OnFree(size_t size);
+    // Counts an allocation that could not be served by the arena or pool
+    // and went to the general heap instead.
+    void    OnFallback();
+
+    const char*     GetTag() const          { return Tag; }
+    size_t          GetBytes() const        { return Bytes; }           // bytes currently allocated
+    size_t          GetPeakBytes() const    { return PeakBytes; }       // high-water mark of GetBytes()
+    size_t          GetAllocCount() const   { return AllocCount; }
+    size_t          GetFreeCount() const    { return FreeCount; }
+    size_t          GetFallbackCount() const { return FallbackCount; }
+
+    void            ResetPeak()             { PeakBytes = Bytes; }
+
+    static AllocatorStats*  GetFirst();
+    AllocatorStats*         GetNext() const { return pNext; }
+
+private:
+    const char*         Tag;
+    volatile size_t     Bytes;
+    volatile size_t     PeakBytes;
+    volatile size_t     AllocCount;
+    volatile size_t     FreeCount;
+    volatile size_t     FallbackCount;
+    AllocatorStats*     pNext;
+
+    static AllocatorStats* volatile pFirst;
+
+    // Not copyable.
+    AllocatorStats(const AllocatorStats&);
+    void operator = (const AllocatorStats&);
+};
+
+// Declares a tag type that owns an AllocatorStats instance, to be passed to
+// ContainerAllocator_Frame / ContainerAllocator_Pool and friends:
+//
+//     OVR_ALLOCATOR_TAG(MenuSortTag, "MenuSort");
+//     Array<SortKey, ArrayDefaultPolicy, ContainerAllocator_Pool<SortKey, MenuSortTag> > SortKeys;
+//
+#define OVR_ALLOCATOR_TAG(tag_type, tag_name)                                           \
+    struct tag_type                                                                     \
+    {                                                                                   \
+        static OVR::AllocatorStats& GetStats()                                          \
+        { static OVR::AllocatorStats stats(tag_name); return stats; }                   \
+    }
+
+
+//------------------------------------------------------------------------
+// ***** FrameAllocator
+
+// Linear allocator for data that only lives for a frame. The arena is a single
+// block split in two halves; BeginFrame() switches to the other half and
+// discards everything that was allocated in it, so memory allocated during a
+// frame stays valid until the end of the following frame.
+//
+// Only the thread that called Init() allocates from the arena. Allocations on
+// other threads, before Init() or after the current half is full fall back to
+// the general heap, so callers never have to check where memory came from.
+// Free() can be called from any thread. Freeing arena memory only updates the
+// statistics, except for the most recent allocation which is rolled back.
+//
+// Realloc() grows the most recent allocation in place, which makes arrays
+// that are filled one after another cheap.
+
+class FrameAllocator
+{
+public:
+    // Reserves the arena and makes the calling thread the frame thread.
+    static void     Init(size_t capacity);
+    // Releases the arena. No frame memory may be in use anymore.
+    static void     Shutdown();
+
+    // Called by the frame thread at the start of each frame.
+    static void     BeginFrame();
+
+    static void*    Alloc(size_t size, AllocatorStats& stats);
+    static void*    Realloc(void* p, size_t newSize, AllocatorStats& stats);
+    static void     Free(void* p, AllocatorStats& stats);
+
+    // True if the memory is in the arena, as opposed to the heap.
+    static bool     Owns(const void* p);
+    // Number of BeginFrame() calls since Init().
+    static uint32_t GetFrameIndex();
+
+    // Arena usage, updated by BeginFrame: bytes used by the last finished frame,
+    // the most any frame has used, and the number of frames.
+    static AllocatorStats& GetArenaStats();
+};
+
+
+//------------------------------------------------------------------------
+// ***** PoolAllocator
+
+// Size class allocator with a free list per size class and thread. Blocks from
+// 32 to 4096 bytes (including an 8 or 16 byte header) are carved out of 64 KB
+// chunks taken from the general heap, larger blocks go to the heap directly.
+// Alloc and Free touch no locks: a block freed on another thread is simply
+// added to that thread's free lists. Chunks are never returned to the heap;
+// the pools of exited threads are handed to new threads.
+
+class PoolAllocator
+{
+public:
+    static void*    Alloc(size_t size, AllocatorStats& stats);
+    static void*    Realloc(void* p, size_t newSize, AllocatorStats& stats);
+    static void     Free(void* p, AllocatorStats& stats);
+
+    // Chunk memory taken from the heap by all pools.
+    static AllocatorStats& GetChunkStats();
+};
+
+
+
 //------------------------------------------------------------------------
 // ***** Memory Allocation Macros
 //
@@ -782,15 +782,15 @@ protected:
 //
 // General purpose array for movable objects that require explicit 
 // construction/destruction.
-template<class T, class SizePolicy=ArrayDefaultPolicy>
-class Array : public ArrayBase<ArrayData<T, ContainerAllocator<T>, SizePolicy> >
+template<class T, class SizePolicy=ArrayDefaultPolicy, class Allocator=ContainerAllocator<T> >
+class Array : public ArrayBase<ArrayData<T, Allocator, SizePolicy> >
 {
 public:
-    typedef T                                                           ValueType;
-    typedef ContainerAllocator<T>                                       AllocatorType;
-    typedef SizePolicy                                                  SizePolicyType;
-    typedef Array<T, SizePolicy>                                        SelfType;
-    typedef ArrayBase<ArrayData<T, ContainerAllocator<T>, SizePolicy> > BaseType;
+    typedef T                                                               ValueType;
+    typedef Allocator                                                       AllocatorType;
+    typedef SizePolicy                                                      SizePolicyType;
+    typedef Array<T, SizePolicy, Allocator>                                 SelfType;
+    typedef ArrayBase<ArrayData<T, Allocator, SizePolicy> >                 BaseType;
 
     Array() : BaseType() {}
     explicit Array(size_t size) : BaseType(size) {}
@@ -804,15 +804,15 @@ public:
 // General purpose array for movable objects that DOES NOT require  
 // construction/destruction. Constructors and destructors are not called! 
 // Global heap is in use.
-template<class T, class SizePolicy=ArrayDefaultPolicy>
-class ArrayPOD : public ArrayBase<ArrayData<T, ContainerAllocator_POD<T>, SizePolicy> >
+template<class T, class SizePolicy=ArrayDefaultPolicy, class Allocator=ContainerAllocator_POD<T> >
+class ArrayPOD : public ArrayBase<ArrayData<T, Allocator, SizePolicy> >
 {
 public:
     typedef T                                                               ValueType;
-    typedef ContainerAllocator_POD<T>                                       AllocatorType;
+    typedef Allocator                                                       AllocatorType;
     typedef SizePolicy                                                      SizePolicyType;
-    typedef ArrayPOD<T, SizePolicy>                                         SelfType;
-    typedef ArrayBase<ArrayData<T, ContainerAllocator_POD<T>, SizePolicy> > BaseType;
+    typedef ArrayPOD<T, SizePolicy, Allocator>                              SelfType;
+    typedef ArrayBase<ArrayData<T, Allocator, SizePolicy> >                 BaseType;
 
     ArrayPOD() : BaseType() {}
     explicit ArrayPOD(size_t size) : BaseType(size) {}
@@ -826,15 +826,15 @@ public:
 //
 // General purpose, fully C++ compliant array. Can be used with non-movable data.
 // Global heap is in use.
-template<class T, class SizePolicy=ArrayDefaultPolicy>
-class ArrayCPP : public ArrayBase<ArrayData<T, ContainerAllocator_CPP<T>, SizePolicy> >
+template<class T, class SizePolicy=ArrayDefaultPolicy, class Allocator=ContainerAllocator_CPP<T> >
+class ArrayCPP : public ArrayBase<ArrayData<T, Allocator, SizePolicy> >
 {
 public:
     typedef T                                                               ValueType;
-    typedef ContainerAllocator_CPP<T>                                       AllocatorType;
+    typedef Allocator                                                       AllocatorType;
     typedef SizePolicy                                                      SizePolicyType;
-    typedef ArrayCPP<T, SizePolicy>                                         SelfType;
-    typedef ArrayBase<ArrayData<T, ContainerAllocator_CPP<T>, SizePolicy> > BaseType;
+    typedef ArrayCPP<T, SizePolicy, Allocator>                              SelfType;
+    typedef ArrayBase<ArrayData<T, Allocator, SizePolicy> >                 BaseType;
 
     ArrayCPP() : BaseType() {}
     explicit ArrayCPP(size_t size) : BaseType(size) {}
@@ -850,15 +850,15 @@ public:
 // construct the elements. The constructors and destructors are 
 // properly called, the objects must be movable.
 
-template<class T, class SizePolicy=ArrayDefaultPolicy>
-class ArrayCC : public ArrayBase<ArrayDataCC<T, ContainerAllocator<T>, SizePolicy> >
+template<class T, class SizePolicy=ArrayDefaultPolicy, class Allocator=ContainerAllocator<T> >
+class ArrayCC : public ArrayBase<ArrayDataCC<T, Allocator, SizePolicy> >
 {
 public:
     typedef T                                                               ValueType;
-    typedef ContainerAllocator<T>                                           AllocatorType;
+    typedef Allocator                                                       AllocatorType;
     typedef SizePolicy                                                      SizePolicyType;
-    typedef ArrayCC<T, SizePolicy>                                          SelfType;
-    typedef ArrayBase<ArrayDataCC<T, ContainerAllocator<T>, SizePolicy> >   BaseType;
+    typedef ArrayCC<T, SizePolicy, Allocator>                               SelfType;
+    typedef ArrayBase<ArrayDataCC<T, Allocator, SizePolicy> >               BaseType;
 
     ArrayCC(const ValueType& defval) : BaseType(defval) {}
     ArrayCC(const ValueType& defval, size_t size) : BaseType(defval, size) {}
@@ -272,6 +272,56 @@ template<class T> struct ContainerAllocator     : ContainerAllocatorBase, Constr
 template<class T> struct ContainerAllocator_CPP : ContainerAllocatorBase, ConstructorCPP<T> {};
 
 
+//-----------------------------------------------------------------------------------
+// ***** Frame and Pool Container Allocators
+//
+// Containers opt in to the frame arena or the thread pools by using these
+// allocators, for example:
+//
+//     Array< ovrDrawSurface, ArrayDefaultPolicy, ContainerAllocator_Frame< ovrDrawSurface > >
+//     Hash< int, String, FixedSizeHash< int >, ContainerAllocator_Pool< int > >
+//
+// Memory of a frame container must be released by the end of the frame after
+// the one it was allocated in. The Tag argument selects the AllocatorStats that
+// the allocations are counted in; see OVR_ALLOCATOR_TAG.
+
+OVR_ALLOCATOR_TAG(AllocatorTag_Frame, "Frame");
+OVR_ALLOCATOR_TAG(AllocatorTag_Pool, "Pool");
+
+template<class Tag>
+class ContainerAllocatorBase_Frame
+{
+public:
+    static void* Alloc(size_t size)
+    { return FrameAllocator::Alloc(size, Tag::GetStats()); }
+
+    static void* Realloc(void* p, size_t newSize)
+    { return FrameAllocator::Realloc(p, newSize, Tag::GetStats()); }
+
+    static void  Free(void *p)
+    { FrameAllocator::Free(p, Tag::GetStats()); }
+};
+
+template<class Tag>
+class ContainerAllocatorBase_Pool
+{
+public:
+    static void* Alloc(size_t size)
+    { return PoolAllocator::Alloc(size, Tag::GetStats()); }
+
+    static void* Realloc(void* p, size_t newSize)
+    { return PoolAllocator::Realloc(p, newSize, Tag::GetStats()); }
+
+    static void  Free(void *p)
+    { PoolAllocator::Free(p, Tag::GetStats()); }
+};
+
+template<class T, class Tag = AllocatorTag_Frame> struct ContainerAllocator_Frame     : ContainerAllocatorBase_Frame<Tag>, ConstructorMov<T> {};
+template<class T, class Tag = AllocatorTag_Frame> struct ContainerAllocator_FramePOD  : ContainerAllocatorBase_Frame<Tag>, ConstructorPOD<T> {};
+template<class T, class Tag = AllocatorTag_Pool>  struct ContainerAllocator_Pool      : ContainerAllocatorBase_Pool<Tag>,  ConstructorMov<T> {};
+template<class T, class Tag = AllocatorTag_Pool>  struct ContainerAllocator_PoolPOD   : ContainerAllocatorBase_Pool<Tag>,  ConstructorPOD<T> {};
+
+
 } // OVR
 
 
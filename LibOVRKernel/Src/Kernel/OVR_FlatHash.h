@@ -0,0 +1,551 @@
+/************************************************************************************
+
+PublicHeader:   None
+Filename    :   OVR_FlatHash.h
+Content     :   Open addressing hash table with control bytes
+Created     :   October 17, 2026
+Notes       :
+
+Copyright   :   Copyright 2014-2016 Oculus VR, LLC All Rights reserved.
+
+Licensed under the Oculus VR Rift SDK License Version 3.3 (the "License");
+you may not use the Oculus VR Rift SDK except in compliance with the License,
+which is provided at the time of installation or download, or which
+otherwise accompanies this software in either electronic or hard copy form.
+
+You may obtain a copy of the License at
+
+http://www.oculusvr.com/licenses/LICENSE-3.3
+
+Unless required by applicable law or agreed to in writing, the Oculus VR SDK
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+
+************************************************************************************/
+
+#ifndef OVR_FlatHash_h
+#define OVR_FlatHash_h
+
+#include "OVR_Hash.h"
+
+// 'new' operator is redefined/used in this file.
+#undef new
+
+namespace OVR {
+
+//-----------------------------------------------------------------------------------
+// ***** FlatHash
+
+// Hash table with the same interface as Hash, implemented with open addressing.
+//
+// Next to the slot array the table keeps one control byte per slot. A control
+// byte is either empty, deleted, or holds 7 bits of the hash of the key in the
+// slot. Lookups compare the control bytes of a group of 8 slots at once, using
+// plain 64-bit integer operations, and only compare keys whose 7 hash bits
+// match. Groups are probed quadratically. The slots hold HashNode elements, so
+// iterators give access to First and Second just like with Hash.
+//
+// Differences from Hash:
+//
+//   1. The hash function should produce well distributed bits. The result is
+//      mixed once more, so IdentityHash on integers is fine.
+//
+//   2. Removing an element never moves other elements. Iterator::Remove()
+//      leaves the iterator valid, and pointers to other values stay valid
+//      until the table grows.
+//
+//   3. Hash values are not cached in the slots. They are recomputed only when
+//      the table grows.
+
+namespace FlatHashGroup
+{
+    enum { Width = 8 };
+
+    // Control byte values. Full slots hold 0 to 127.
+    enum
+    {
+        Empty   = 0x80,
+        Deleted = 0xFE
+    };
+
+    static const uint64_t Lsbs = 0x0101010101010101ULL;
+    static const uint64_t Msbs = 0x8080808080808080ULL;
+
+    inline uint64_t Load(const uint8_t* ctrl)
+    {
+        uint64_t group;
+        memcpy(&group, ctrl, sizeof(group));
+#if (OVR_BYTE_ORDER == OVR_BIG_ENDIAN)
+        group = ((group & 0x00000000FFFFFFFFULL) << 32) | ((group & 0xFFFFFFFF00000000ULL) >> 32);
+        group = ((group & 0x0000FFFF0000FFFFULL) << 16) | ((group & 0xFFFF0000FFFF0000ULL) >> 16);
+        group = ((group & 0x00FF00FF00FF00FFULL) << 8)  | ((group & 0xFF00FF00FF00FF00ULL) >> 8);
+#endif
+        return group;
+    }
+
+    // The masks below have the high bit set in each matching byte. MatchByte
+    // can report a false match next to a real one, which is harmless because
+    // the keys are compared anyway.
+    inline uint64_t MatchByte(uint64_t group, uint8_t h2)
+    {
+        const uint64_t x = group ^ (Lsbs * h2);
+        return (x - Lsbs) & ~x & Msbs;
+    }
+    inline uint64_t MatchEmpty(uint64_t group)
+    {
+        return group & ~(group << 6) & Msbs;
+    }
+    inline uint64_t MatchEmptyOrDeleted(uint64_t group)
+    {
+        return group & ~(group << 7) & Msbs;
+    }
+
+    // Index of the first and number of the trailing non-matching bytes of a
+    // non-zero mask.
+    inline size_t LowestByte(uint64_t mask)
+    {
+#if defined(OVR_CC_GNU)
+        return (size_t)__builtin_ctzll(mask) >> 3;
+#else
+        const uint32_t lo = (uint32_t)mask;
+        return (lo != 0) ? (Alg::LowerBit(lo) >> 3) : ((Alg::LowerBit((uint32_t)(mask >> 32)) + 32) >> 3);
+#endif
+    }
+    inline size_t LeadingBytes(uint64_t mask)
+    {
+#if defined(OVR_CC_GNU)
+        return (size_t)__builtin_clzll(mask) >> 3;
+#else
+        const uint32_t hi = (uint32_t)(mask >> 32);
+        return (hi != 0) ? ((31 - Alg::UpperBit(hi)) >> 3) : ((63 - Alg::UpperBit((uint32_t)mask)) >> 3);
+#endif
+    }
+
+    // Control bytes of a table without slots, so lookups need no NULL check.
+    inline uint8_t* EmptyTable()
+    {
+        static uint8_t emptyTable[Width] = { Empty, Empty, Empty, Empty, Empty, Empty, Empty, Empty };
+        return emptyTable;
+    }
+}
+
+template<class C, class U,
+         class HashF = FixedSizeHash<C>,
+         class Allocator = ContainerAllocator<C> >
+class FlatHash
+{
+public:
+    OVR_MEMORY_REDEFINE_NEW(FlatHash)
+
+    typedef U                                   ValueType;
+    typedef HashNode<C, U, HashF>               NodeType;
+    typedef FlatHash<C, U, HashF, Allocator>    SelfType;
+
+    FlatHash() : Ctrl(FlatHashGroup::EmptyTable()), Slots(NULL), SizeMask(0), Size(0), GrowthLeft(0)   { }
+    FlatHash(int sizeHint) : Ctrl(FlatHashGroup::EmptyTable()), Slots(NULL), SizeMask(0), Size(0), GrowthLeft(0)
+    {
+        SetCapacity(sizeHint);
+    }
+    FlatHash(const SelfType& src) : Ctrl(FlatHashGroup::EmptyTable()), Slots(NULL), SizeMask(0), Size(0), GrowthLeft(0)
+    {
+        Assign(src);
+    }
+    ~FlatHash()                                 { Clear(); }
+
+    void    operator = (const SelfType& src)    { if (&src != this) Assign(src); }
+
+    void Assign(const SelfType& src)
+    {
+        Clear();
+        SetCapacity(src.GetSize());
+        for (ConstIterator it = src.Begin(); it != src.End(); ++it)
+        {
+            Add(it->First, it->Second);
+        }
+    }
+
+    // Remove all entries from the table and release its memory.
+    void Clear()
+    {
+        if (Slots != NULL)
+        {
+            destroySlots();
+            Allocator::Free(Ctrl);
+        }
+        Ctrl = FlatHashGroup::EmptyTable();
+        Slots = NULL;
+        SizeMask = 0;
+        Size = 0;
+        GrowthLeft = 0;
+    }
+
+    bool    IsEmpty() const                     { return Size == 0; }
+    size_t  GetSize() const                     { return Size; }
+    int     GetSizeI() const                    { return (int)Size; }
+
+    // Set a new or existing value under the key.
+    void Set(const C& key, const U& value)
+    {
+        const size_t hashValue = mixHash(HashF()(key));
+        const intptr_t index = findIndex(key, hashValue);
+        if (index >= 0)
+        {
+            Slots[index].Second = value;
+        }
+        else
+        {
+            add(typename NodeType::NodeRef(key, value), hashValue);
+        }
+    }
+
+    // Add a value under a key that is not in the table yet.
+    void Add(const C& key, const U& value)
+    {
+        const size_t hashValue = mixHash(HashF()(key));
+        OVR_ASSERT(findIndex(key, hashValue) < 0);
+        add(typename NodeType::NodeRef(key, value), hashValue);
+    }
+
+    void Remove(const C& key)                   { RemoveAlt(key); }
+
+    template<class K>
+    void RemoveAlt(const K& key)
+    {
+        const intptr_t index = findIndex(key, mixHash(HashF()(key)));
+        if (index >= 0)
+        {
+            eraseAt((size_t)index);
+        }
+    }
+
+    // Retrieve the value under the given key.
+    //  - If there's no value under the key, then return false and leave *pvalue alone.
+    //  - If there is a value, return true, and set *pvalue to the value.
+    //  - If pvalue == NULL, return true or false according to the presence of the key.
+    bool Get(const C& key, U* pvalue) const     { return GetAlt(key, pvalue); }
+
+    template<class K>
+    bool GetAlt(const K& key, U* pvalue) const
+    {
+        const intptr_t index = findIndex(key, mixHash(HashF()(key)));
+        if (index < 0)
+        {
+            return false;
+        }
+        if (pvalue)
+        {
+            *pvalue = Slots[index].Second;
+        }
+        return true;
+    }
+
+    // Retrieve the pointer to a value under the given key, or NULL.
+    U*       Get(const C& key)                  { return GetAlt(key); }
+    const U* Get(const C& key) const            { return GetAlt(key); }
+
+    template<class K>
+    U* GetAlt(const K& key)
+    {
+        const intptr_t index = findIndex(key, mixHash(HashF()(key)));
+        return (index >= 0) ? &Slots[index].Second : NULL;
+    }
+    template<class K>
+    const U* GetAlt(const K& key) const
+    {
+        return const_cast<SelfType*>(this)->GetAlt(key);
+    }
+
+    // Hint the slot count to hold n elements.
+    void Resize(size_t n)                       { SetCapacity(n); }
+
+    // Size the table so that it can contain the given number of elements
+    // without growing.
+    void SetCapacity(size_t newSize)
+    {
+        if (newSize < Size)
+        {
+            newSize = Size;
+        }
+        size_t capacity = FlatHashGroup::Width;
+        while (maxLoad(capacity) < newSize)
+        {
+            capacity *= 2;
+        }
+        if (capacity > SizeMask + 1 || Slots == NULL)
+        {
+            if (newSize > 0)
+            {
+                resize(capacity);
+            }
+        }
+    }
+
+    // Iterator API, like Hash.
+    struct ConstIterator
+    {
+        const NodeType& operator * () const
+        {
+            OVR_ASSERT(!IsEnd() && pHash->isFull((size_t)Index));
+            return pHash->Slots[Index];
+        }
+        const NodeType* operator -> () const    { return &(operator*()); }
+
+        void operator ++ ()
+        {
+            if (!IsEnd())
+            {
+                Index++;
+                while ((size_t)Index <= pHash->SizeMask && !pHash->isFull((size_t)Index))
+                {
+                    Index++;
+                }
+            }
+        }
+
+        bool operator == (const ConstIterator& it) const
+        {
+            if (IsEnd() && it.IsEnd())
+            {
+                return true;
+            }
+            return (pHash == it.pHash) && (Index == it.Index);
+        }
+        bool operator != (const ConstIterator& it) const { return !(*this == it); }
+
+        bool IsEnd() const
+        {
+            return (pHash == NULL) || (pHash->Slots == NULL) || ((size_t)Index > pHash->SizeMask);
+        }
+
+        ConstIterator() : pHash(NULL), Index(0)    { }
+        ConstIterator(const SelfType* h, intptr_t index) : pHash(h), Index(index)   { }
+
+        const SelfType* GetContainer() const    { return pHash; }
+        intptr_t        GetIndex() const        { return Index; }
+
+    protected:
+        const SelfType* pHash;
+        intptr_t        Index;
+    };
+
+    struct Iterator : public ConstIterator
+    {
+        NodeType& operator * () const
+        {
+            OVR_ASSERT(!ConstIterator::IsEnd() && ConstIterator::pHash->isFull((size_t)ConstIterator::Index));
+            return const_cast<SelfType*>(ConstIterator::pHash)->Slots[ConstIterator::Index];
+        }
+        NodeType* operator -> () const          { return &(operator*()); }
+
+        Iterator() : ConstIterator(NULL, 0)     { }
+        Iterator(SelfType* h, intptr_t index) : ConstIterator(h, index)    { }
+
+        // Removes the current element. The iterator stays valid and ++ moves
+        // on to the next element.
+        void Remove()
+        {
+            const_cast<SelfType*>(ConstIterator::pHash)->eraseAt((size_t)ConstIterator::Index);
+        }
+    };
+
+    friend struct ConstIterator;
+    friend struct Iterator;
+
+    Iterator Begin()
+    {
+        if (Slots == NULL)
+        {
+            return Iterator(NULL, 0);
+        }
+        size_t i = 0;
+        while (i <= SizeMask && !isFull(i))
+        {
+            i++;
+        }
+        return Iterator(this, (intptr_t)i);
+    }
+    Iterator        End()                       { return Iterator(NULL, 0); }
+    ConstIterator   Begin() const               { return const_cast<SelfType*>(this)->Begin(); }
+    ConstIterator   End() const                 { return ConstIterator(NULL, 0); }
+
+    Iterator        Find(const C& key)          { return FindAlt(key); }
+    ConstIterator   Find(const C& key) const    { return FindAlt(key); }
+
+    template<class K>
+    Iterator FindAlt(const K& key)
+    {
+        const intptr_t index = findIndex(key, mixHash(HashF()(key)));
+        return (index >= 0) ? Iterator(this, index) : Iterator(NULL, 0);
+    }
+    template<class K>
+    ConstIterator FindAlt(const K& key) const   { return const_cast<SelfType*>(this)->FindAlt(key); }
+
+private:
+    uint8_t*    Ctrl;       // SizeMask + 1 + Width control bytes. The last Width mirror the first.
+    NodeType*   Slots;
+    size_t      SizeMask;
+    size_t      Size;
+    size_t      GrowthLeft; // Empty slots that can still be filled before growing.
+
+    // Spread the hash over all bits. The low 7 bits become the control byte,
+    // the rest pick the first group to probe.
+    static size_t mixHash(size_t h)
+    {
+#ifdef OVR_64BIT_POINTERS
+        h *= 0x9E3779B97F4A7C15ULL;
+        return h ^ (h >> 32);
+#else
+        h *= 0x9E3779B9U;
+        return h ^ (h >> 16);
+#endif
+    }
+
+    // At most 7/8 of the slots are in use.
+    static size_t maxLoad(size_t capacity)      { return capacity - capacity / 8; }
+
+    bool isFull(size_t index) const             { return Ctrl[index] < FlatHashGroup::Empty; }
+
+    void setCtrl(size_t index, uint8_t h)
+    {
+        Ctrl[index] = h;
+        Ctrl[((index - FlatHashGroup::Width) & SizeMask) + FlatHashGroup::Width] = h;
+    }
+
+    template<class K>
+    intptr_t findIndex(const K& key, size_t hashValue) const
+    {
+        const uint8_t h2 = (uint8_t)(hashValue & 0x7F);
+        size_t pos = (hashValue >> 7) & SizeMask;
+        for (size_t stride = FlatHashGroup::Width; ; stride += FlatHashGroup::Width)
+        {
+            const uint64_t group = FlatHashGroup::Load(Ctrl + pos);
+            for (uint64_t match = FlatHashGroup::MatchByte(group, h2); match != 0; match &= match - 1)
+            {
+                const size_t index = (pos + FlatHashGroup::LowestByte(match)) & SizeMask;
+                if (Slots[index] == key)
+                {
+                    return (intptr_t)index;
+                }
+            }
+            if (FlatHashGroup::MatchEmpty(group) != 0)
+            {
+                return -1;
+            }
+            pos = (pos + stride) & SizeMask;
+        }
+    }
+
+    // First empty or deleted slot in the probe sequence of the hash.
+    size_t findInsertIndex(size_t hashValue) const
+    {
+        size_t pos = (hashValue >> 7) & SizeMask;
+        for (size_t stride = FlatHashGroup::Width; ; stride += FlatHashGroup::Width)
+        {
+            const uint64_t match = FlatHashGroup::MatchEmptyOrDeleted(FlatHashGroup::Load(Ctrl + pos));
+            if (match != 0)
+            {
+                return (pos + FlatHashGroup::LowestByte(match)) & SizeMask;
+            }
+            pos = (pos + stride) & SizeMask;
+        }
+    }
+
+    template<class CRef>
+    void add(const CRef& ref, size_t hashValue)
+    {
+        size_t index = findInsertIndex(hashValue);
+        if (GrowthLeft == 0 && Ctrl[index] == FlatHashGroup::Empty)
+        {
+            // Reclaim deleted slots if they make up much of the table, otherwise grow.
+            const size_t capacity = (Slots == NULL) ? 0 : SizeMask + 1;
+            resize((Size * 2 < maxLoad(capacity)) ? capacity : Alg::Max<size_t>(capacity * 2, FlatHashGroup::Width));
+            index = findInsertIndex(hashValue);
+        }
+        if (Ctrl[index] == FlatHashGroup::Empty)
+        {
+            GrowthLeft--;
+        }
+        setCtrl(index, (uint8_t)(hashValue & 0x7F));
+        ::new (&Slots[index]) NodeType(ref);
+        Size++;
+    }
+
+    void eraseAt(size_t index)
+    {
+        OVR_ASSERT(isFull(index));
+        Slots[index].~NodeType();
+        Size--;
+
+        // If the groups around the slot have had an empty slot all along, no
+        // probe sequence ever continued past it and it can become empty again.
+        const size_t indexBefore = (index - FlatHashGroup::Width) & SizeMask;
+        const uint64_t emptyAfter = FlatHashGroup::MatchEmpty(FlatHashGroup::Load(Ctrl + index));
+        const uint64_t emptyBefore = FlatHashGroup::MatchEmpty(FlatHashGroup::Load(Ctrl + indexBefore));
+        const bool wasNeverFull = emptyBefore != 0 && emptyAfter != 0 &&
+                FlatHashGroup::LowestByte(emptyAfter) + FlatHashGroup::LeadingBytes(emptyBefore) < FlatHashGroup::Width;
+        setCtrl(index, wasNeverFull ? (uint8_t)FlatHashGroup::Empty : (uint8_t)FlatHashGroup::Deleted);
+        if (wasNeverFull)
+        {
+            GrowthLeft++;
+        }
+    }
+
+    void destroySlots()
+    {
+        for (size_t i = 0; i <= SizeMask; i++)
+        {
+            if (isFull(i))
+            {
+                Slots[i].~NodeType();
+            }
+        }
+    }
+
+    // Rebuild the table with the given power of two number of slots.
+    void resize(size_t capacity)
+    {
+        OVR_ASSERT(capacity >= FlatHashGroup::Width && (capacity & (capacity - 1)) == 0);
+
+        uint8_t*    oldCtrl = Ctrl;
+        NodeType*   oldSlots = Slots;
+        const size_t oldCapacity = (Slots == NULL) ? 0 : SizeMask + 1;
+
+        // Slots start at a 16 byte boundary after the control bytes.
+        const size_t ctrlSize = (capacity + FlatHashGroup::Width + 15) & ~(size_t)15;
+        Ctrl = (uint8_t*)Allocator::Alloc(ctrlSize + capacity * sizeof(NodeType));
+        OVR_ASSERT(Ctrl != NULL);
+        Slots = (NodeType*)(Ctrl + ctrlSize);
+        SizeMask = capacity - 1;
+        GrowthLeft = maxLoad(capacity) - Size;
+        memset(Ctrl, FlatHashGroup::Empty, capacity + FlatHashGroup::Width);
+
+        for (size_t i = 0; i < oldCapacity; i++)
+        {
+            if (oldCtrl[i] < FlatHashGroup::Empty)
+            {
+                NodeType& node = oldSlots[i];
+                const size_t hashValue = mixHash(HashF()(node.First));
+                const size_t index = findInsertIndex(hashValue);
+                setCtrl(index, (uint8_t)(hashValue & 0x7F));
+                ::new (&Slots[index]) NodeType(node);
+                node.~NodeType();
+            }
+        }
+
+        if (oldSlots != NULL)
+        {
+            Allocator::Free(oldCtrl);
+        }
+    }
+};
+
+} // OVR
+
+
+#ifdef OVR_DEFINE_NEW
+#define new OVR_DEFINE_NEW
+#endif
+
+#endif
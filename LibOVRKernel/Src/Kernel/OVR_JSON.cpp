@@ -127,16 +127,92 @@ const char* AssignError(const char** perror, const char *errorMessage)
     return 0;
 }
 
+//-----------------------------------------------------------------------------
+// Bump allocator that owns every node and string of a tree created with
+// JSON::ParseInArena(). Memory is only returned when the arena is destroyed.
+class JsonArena
+{
+public:
+    explicit JsonArena(size_t firstBlockSize) :
+        Blocks(0), NextBlockSize(firstBlockSize)
+    {
+    }
+
+    ~JsonArena()
+    {
+        while (Blocks)
+        {
+            Block* next = Blocks->Next;
+            OVR_FREE(Blocks);
+            Blocks = next;
+        }
+    }
+
+    void* Alloc(size_t size)
+    {
+        // Keep everything 8 byte aligned for the doubles in the nodes.
+        size = (size + 7) & ~(size_t)7;
+        if (!Blocks || Blocks->Size - Blocks->Used < size)
+        {
+            if (!allocBlock(size))
+                return 0;
+        }
+        void* p = (uint8_t*)(Blocks + 1) + Blocks->Used;
+        Blocks->Used += size;
+        return p;
+    }
+
+private:
+    // Four words, so the data that follows stays 8 byte aligned.
+    struct Block
+    {
+        Block*  Next;
+        size_t  Size;
+        size_t  Used;
+        size_t  Pad;
+    };
+
+    bool allocBlock(size_t minSize)
+    {
+        size_t size = (NextBlockSize > minSize) ? NextBlockSize : minSize;
+        Block* block = (Block*)OVR_ALLOC(sizeof(Block) + size);
+        if (!block)
+            return false;
+        block->Next = Blocks;
+        block->Size = size;
+        block->Used = 0;
+        Blocks = block;
+        NextBlockSize = size * 2;
+        return true;
+    }
+
+    Block*  Blocks;
+    size_t  NextBlockSize;
+};
+
 //-----------------------------------------------------------------------------
 // ***** JSON Node class
 
 JSON::JSON(JSONItemType itemType) :
+    Arena(0), InArena(false), NameText(0), ValueText(0), NameHash(0),
+    ItemCount(0), Items(0), ItemSlots(0), ItemSlotMask(0),
     Type(itemType), dValue(0.0)
 {
 }
 
 JSON::~JSON()
 {
+    if (Arena)
+    {
+        destroyArenaItems();
+        delete Arena;
+        return;
+    }
+    if (InArena)
+    {
+        return;    // Freed along with the arena by the root.
+    }
+
     JSON* child = Children.GetFirst();
     while (!Children.IsNull(child))
     {
@@ -147,11 +223,10 @@ JSON::~JSON()
 }
 
 //-----------------------------------------------------------------------------
-// Parse the input text to generate a number, and populate the result into item
+// Parse the input text to generate a number.
 // Returns the text position after the parsed number
-const char* JSON::parseNumber(const char *num)
+static const char* ParseNumberText(const char *num, double* value)
 {
-    const char* num_start = num;
     double      n=0, sign=1, scale=0;
     int         subscale     = 0,
                 signsubscale = 1;
@@ -206,14 +281,23 @@ const char* JSON::parseNumber(const char *num)
     }
 
     // Number = +/- number.fraction * 10^+/- exponent
-    n = sign*n*pow(10.0, (scale + subscale*signsubscale));
+    *value = sign*n*pow(10.0, (scale + subscale*signsubscale));
+
+    return num;
+}
+
+//-----------------------------------------------------------------------------
+// Parse the input text to generate a number, and populate the result into item
+// Returns the text position after the parsed number
+const char* JSON::parseNumber(const char *num)
+{
+    const char* num_end = ParseNumberText(num, &dValue);
 
     // Assign parsed value.
     Type = JSON_Number;
-    dValue = n;
-    Value.AssignString(num_start, num - num_start);
+    Value.AssignString(num, num_end - num);
 
-    return num;
+    return num_end;
 }
 
 // Parses a hex string up to the specified number of digits.
@@ -242,34 +326,16 @@ const char* ParseHex(unsigned* val, unsigned digits, const char* str)
 }
 
 //-----------------------------------------------------------------------------
-// Parses the input text into a string item and returns the text position after
-// the parsed string
-const char* JSON::parseString(const char* str, const char** perror)
+// Un-escapes the body of a string that starts after the opening quote into out
+// and sets *outEnd to the end of the output. The output is never longer than
+// the input, so out may point at the input itself. Returns the position of the
+// closing quote, or of the terminating null if the string is unterminated.
+static const char* UnescapeString(const char* ptr, char* out, char** outEnd)
 {
-    const char* ptr = str+1;
     const char* p;
-    char*       ptr2;
-    char*       out;
-    int         len=0;
+    char*       ptr2 = out;
+    int         len;
     unsigned    uc, uc2;
-    
-    if (*str!='\"')
-    {
-        return AssignError(perror, "Syntax Error: Missing quote");
-    }
-    
-    while (*ptr!='\"' && *ptr && ++len)
-    {   
-        if (*ptr++ == '\\') ptr++;    // Skip escaped quotes.
-    }
-    
-    // This is how long we need for the string, roughly.
-    out=(char*)OVR_ALLOC(len+1);
-    if (!out)
-        return 0;
-    
-    ptr = str+1;
-    ptr2= out;
 
     while (*ptr!='\"' && *ptr)
     {
@@ -280,6 +346,9 @@ const char* JSON::parseString(const char* str, const char** perror)
         else
         {
             ptr++;
+            if (!*ptr)
+                break;    // Dangling escape at the end of the input.
+
             switch (*ptr)
             {
                 case 'b': *ptr2++ = '\b';    break;
@@ -348,7 +417,37 @@ const char* JSON::parseString(const char* str, const char** perror)
         }
     }
 
-    *ptr2 = 0;
+    *outEnd = ptr2;
+    return ptr;
+}
+
+//-----------------------------------------------------------------------------
+// Parses the input text into a string item and returns the text position after
+// the parsed string
+const char* JSON::parseString(const char* str, const char** perror)
+{
+    const char* ptr = str+1;
+    char*       out;
+    int         len=0;
+    
+    if (*str!='\"')
+    {
+        return AssignError(perror, "Syntax Error: Missing quote");
+    }
+    
+    while (*ptr!='\"' && *ptr && ++len)
+    {   
+        if (*ptr++ == '\\' && *ptr) ptr++;    // Skip escaped quotes.
+    }
+    
+    // This is how long we need for the string, roughly.
+    out=(char*)OVR_ALLOC(len+1);
+    if (!out)
+        return 0;
+    
+    char* outEnd;
+    ptr = UnescapeString(str+1, out, &outEnd);
+    *outEnd = 0;
     if (*ptr=='\"')
         ptr++;
     
@@ -519,7 +618,7 @@ char* JSON::PrintValue(int depth, bool fmt) const
                 out = JSON_strdup("true");
             break;
         case JSON_Number:    out = PrintNumber(dValue); break;
-        case JSON_String:    out = PrintString(Value.ToCStr()); break;
+        case JSON_String:    out = PrintString(getValueText()); break;
         case JSON_Array:    out = PrintArray(depth, fmt); break;
         case JSON_Object:    out = PrintObject(depth, fmt); break;
         case JSON_None: OVR_ASSERT_LOG(false, ("Bad JSON type.")); break;
@@ -775,7 +874,7 @@ char* JSON::PrintObject(int depth, bool fmt) const
     const JSON* child = Children.GetFirst();
     while (!Children.IsNull(child))
     {
-        names[i]     = str = PrintString(child->Name.ToCStr());
+        names[i]     = str = PrintString(child->GetName());
         entries[i++] = ret = child->PrintValue(depth, fmt);
 
         if (str && ret)
@@ -876,10 +975,351 @@ char* JSON::PrintObject(int depth, bool fmt) const
 
 
 
+//-----------------------------------------------------------------------------
+// ***** Arena parsing
+
+// Objects with fewer members than this are searched linearly by name hash.
+static const uint32_t JSON_ARENA_MIN_HASHED_ITEMS = 8;
+
+static uint32_t HashName(const char* name, size_t length)
+{
+    return (uint32_t)String::BernsteinHashFunction(name, length);
+}
+
+static char* skip(char* in)
+{
+    return const_cast<char*>(skip(const_cast<const char*>(in)));
+}
+
+// Builds a tree in a JsonArena. This follows the same grammar as the JSON
+// parsing helpers, but strings are unescaped in place in the arena's copy
+// of the text and every container gets an index of its children.
+class JsonArenaParser
+{
+public:
+    JsonArenaParser(JsonArena& arena, const char** perror) :
+        Arena(arena), pError(perror)
+    {
+    }
+
+    char* parseValue(char* buff, JSON* item);
+
+private:
+    JSON*   newItem();
+    char*   parseString(char* str, const char** text, size_t* length);
+    char*   parseArray(char* buff, JSON* item);
+    char*   parseObject(char* buff, JSON* item);
+    bool    indexItems(JSON* item, uint32_t count, bool hashNames);
+
+    char*   fail(const char* errorMessage)
+    {
+        AssignError(pError, errorMessage);
+        return 0;
+    }
+
+    JsonArena&      Arena;
+    const char**    pError;
+};
+
+JSON* JsonArenaParser::newItem()
+{
+    void* mem = Arena.Alloc(sizeof(JSON));
+    if (!mem)
+        return 0;
+
+    JSON* item = ::new(mem) JSON(JSON_None);
+    item->InArena = true;
+    item->NameText = "";
+    item->ValueText = "";
+    return item;
+}
+
+char* JsonArenaParser::parseString(char* str, const char** text, size_t* length)
+{
+    if (*str!='\"')
+    {
+        return fail("Syntax Error: Missing quote");
+    }
+
+    // Check for the closing quote before the terminator can overwrite it.
+    char* end;
+    char* ptr = const_cast<char*>(UnescapeString(str+1, str+1, &end));
+    if (*ptr=='\"')
+        ptr++;
+
+    *end = 0;
+    *text = str+1;
+    *length = end - (str+1);
+    return ptr;
+}
+
+char* JsonArenaParser::parseValue(char* buff, JSON* item)
+{
+    if (!strncmp(buff, "null", 4))
+    {
+        item->Type = JSON_Null;
+        return buff + 4;
+    }
+    if (!strncmp(buff, "false", 5))
+    {
+        item->Type      = JSON_Bool;
+        item->ValueText = "false";
+        item->dValue    = 0.0;
+        return buff + 5;
+    }
+    if (!strncmp(buff, "true", 4))
+    {
+        item->Type      = JSON_Bool;
+        item->ValueText = "true";
+        item->dValue    = 1.0;
+        return buff + 4;
+    }
+    if (*buff=='\"')
+    {
+        size_t length;
+        item->Type = JSON_String;
+        return parseString(buff, &item->ValueText, &length);
+    }
+    if (*buff=='-' || (*buff>='0' && *buff<='9'))
+    {
+        item->Type = JSON_Number;
+        return const_cast<char*>(ParseNumberText(buff, &item->dValue));
+    }
+    if (*buff=='[')
+    {
+        return parseArray(buff, item);
+    }
+    if (*buff=='{')
+    {
+        return parseObject(buff, item);
+    }
+
+    return fail("Syntax Error: Invalid syntax");
+}
+
+char* JsonArenaParser::parseArray(char* buff, JSON* item)
+{
+    uint32_t count = 0;
+
+    item->Type = JSON_Array;
+    buff = skip(buff+1);
+
+    if (*buff!=']')
+    {
+        for (;;)
+        {
+            JSON* child = newItem();
+            if (!child)
+                return fail("Error: Failed to allocate memory");
+            item->Children.PushBack(child);
+            count++;
+
+            buff = parseValue(buff, child);
+            if (!buff)
+                return 0;
+
+            buff = skip(buff);
+            if (*buff!=',')
+                break;
+            buff = skip(buff+1);
+        }
+
+        if (*buff!=']')
+            return fail("Syntax Error: Missing ending bracket");
+    }
+
+    if (!indexItems(item, count, false))
+        return fail("Error: Failed to allocate memory");
+
+    return buff+1;
+}
+
+char* JsonArenaParser::parseObject(char* buff, JSON* item)
+{
+    uint32_t count = 0;
+
+    item->Type = JSON_Object;
+    buff = skip(buff+1);
+
+    if (*buff!='}')
+    {
+        for (;;)
+        {
+            JSON* child = newItem();
+            if (!child)
+                return fail("Error: Failed to allocate memory");
+            item->Children.PushBack(child);
+            count++;
+
+            size_t nameLength;
+            buff = parseString(buff, &child->NameText, &nameLength);
+            if (!buff)
+                return 0;
+            child->NameHash = HashName(child->NameText, nameLength);
+
+            buff = skip(buff);
+            if (*buff!=':')
+                return fail("Syntax Error: Missing colon");
+
+            buff = parseValue(skip(buff+1), child);
+            if (!buff)
+                return 0;
+
+            buff = skip(buff);
+            if (*buff!=',')
+                break;
+            buff = skip(buff+1);
+        }
+
+        if (*buff!='}')
+            return fail("Syntax Error: Missing closing brace");
+    }
+
+    if (!indexItems(item, count, true))
+        return fail("Error: Failed to allocate memory");
+
+    return buff+1;
+}
+
+// Stores the children of a container in an array and, for larger objects,
+// builds an open addressed table of them keyed by name hash.
+bool JsonArenaParser::indexItems(JSON* item, uint32_t count, bool hashNames)
+{
+    item->ItemCount = count;
+    if (count == 0)
+        return true;
+
+    item->Items = (JSON**)Arena.Alloc(count * sizeof(JSON*));
+    if (!item->Items)
+        return false;
+
+    uint32_t index = 0;
+    for (JSON* child = item->Children.GetFirst(); !item->Children.IsNull(child); child = child->pNext)
+    {
+        item->Items[index++] = child;
+    }
+
+    if (!hashNames || count < JSON_ARENA_MIN_HASHED_ITEMS)
+        return true;
+
+    // Keep the table at most half full.
+    uint32_t slotCount = 16;
+    while (slotCount < count * 2)
+        slotCount *= 2;
+
+    item->ItemSlots = (uint32_t*)Arena.Alloc(slotCount * sizeof(uint32_t));
+    if (!item->ItemSlots)
+        return false;
+    memset(item->ItemSlots, 0, slotCount * sizeof(uint32_t));
+    item->ItemSlotMask = slotCount - 1;
+
+    for (index = 0; index < count; index++)
+    {
+        const JSON* child = item->Items[index];
+        uint32_t slot = child->NameHash & item->ItemSlotMask;
+        bool duplicate = false;
+
+        while (item->ItemSlots[slot] != 0)
+        {
+            const JSON* other = item->Items[item->ItemSlots[slot] - 1];
+            if (other->NameHash == child->NameHash && OVR_strcmp(other->NameText, child->NameText) == 0)
+            {
+                // Lookups return the first member with a name, like the linear search.
+                duplicate = true;
+                break;
+            }
+            slot = (slot + 1) & item->ItemSlotMask;
+        }
+
+        if (!duplicate)
+            item->ItemSlots[slot] = index + 1;
+    }
+
+    return true;
+}
+
+//-----------------------------------------------------------------------------
+// Parses the supplied buffer of JSON text into a read-only tree held in a
+// single arena. The returned object must be Released after use
+JSON* JSON::ParseInArena(const char* buff, size_t length, const char** perror)
+{
+    AssignError(perror, 0);
+
+    // Nodes are much larger than the text they come from, so start with a
+    // generous block; later blocks double in size.
+    JsonArena* arena = new JsonArena(length * 4 + 4096);
+    char* text = (char*)arena->Alloc(length + 1);
+    if (!text)
+    {
+        delete arena;
+        AssignError(perror, "Error: Failed to allocate memory");
+        return 0;
+    }
+    memcpy(text, buff, length);
+    text[length] = 0;
+
+    JSON* json = new JSON(JSON_None);
+    json->Arena = arena;
+    json->InArena = true;
+    json->NameText = "";
+    json->ValueText = "";
+
+    JsonArenaParser parser(*arena, perror);
+    if (!parser.parseValue(skip(text), json))
+    {
+        json->Release();
+        return NULL;
+    }
+
+    return json;
+}
+
+// Runs the destructors of the nodes below an arena root. Their memory is
+// released with the arena.
+void JSON::destroyArenaItems()
+{
+    JSON* child = Children.GetFirst();
+    while (!Children.IsNull(child))
+    {
+        JSON* next = child->pNext;
+        child->destroyArenaItems();
+        child->~JSON();
+        child = next;
+    }
+    Children.Clear();
+}
+
+// Returns the child of an arena node with the given name or NULL if not found
+const JSON* JSON::findArenaItem(const char* name) const
+{
+    const uint32_t hash = HashName(name, OVR_strlen(name));
+
+    if (ItemSlots)
+    {
+        for (uint32_t slot = hash & ItemSlotMask; ItemSlots[slot] != 0; slot = (slot + 1) & ItemSlotMask)
+        {
+            const JSON* item = Items[ItemSlots[slot] - 1];
+            if (item->NameHash == hash && OVR_strcmp(item->NameText, name) == 0)
+                return item;
+        }
+        return 0;
+    }
+
+    for (uint32_t i = 0; i < ItemCount; i++)
+    {
+        if (Items[i]->NameHash == hash && OVR_strcmp(Items[i]->NameText, name) == 0)
+            return Items[i];
+    }
+    return 0;
+}
+
 // Returns the number of child items in the object
 // Counts the number of items in the object.
 unsigned JSON::GetItemCount() const
 {
+    if (InArena)
+        return ItemCount;
+
     unsigned count = 0;
     for (const JSON* child = Children.GetFirst(); !Children.IsNull( child ); child = child->pNext )
     {
@@ -890,6 +1330,9 @@ unsigned JSON::GetItemCount() const
 
 JSON* JSON::GetItemByIndex(unsigned index)
 {
+    if (InArena)
+        return (index < ItemCount) ? Items[index] : 0;
+
     for ( JSON * child = Children.GetFirst(); !Children.IsNull( child ); child = child->pNext )
 	{
 		if ( index-- == 0 )
@@ -902,6 +1345,9 @@ JSON* JSON::GetItemByIndex(unsigned index)
 
 const JSON* JSON::GetItemByIndex(unsigned index) const
 {
+    if (InArena)
+        return (index < ItemCount) ? Items[index] : 0;
+
     for ( const JSON * child = Children.GetFirst(); !Children.IsNull( child ); child = child->pNext )
 	{
 		if ( index-- == 0 )
@@ -915,6 +1361,9 @@ const JSON* JSON::GetItemByIndex(unsigned index) const
 // Returns the child item with the given name or NULL if not found
 JSON* JSON::GetItemByName(const char* name)
 {
+    if (InArena)
+        return const_cast<JSON*>(findArenaItem(name));
+
     for ( JSON * child = Children.GetFirst(); !Children.IsNull( child ); child = child->pNext )
 	{
 		if ( OVR_strcmp( child->Name.ToCStr(), name ) == 0 )
@@ -928,6 +1377,9 @@ JSON* JSON::GetItemByName(const char* name)
 // Returns the child item with the given name or NULL if not found
 const JSON* JSON::GetItemByName(const char* name) const
 {
+    if (InArena)
+        return findArenaItem(name);
+
     for ( const JSON * child = Children.GetFirst(); !Children.IsNull( child ); child = child->pNext )
 	{
 		if ( OVR_strcmp( child->Name.ToCStr(), name ) == 0 )
@@ -944,11 +1396,18 @@ void JSON::AddItem(const char *string, JSON *item)
 {
     if (!item)
         return;
+    OVR_ASSERT(!InArena && !item->InArena);    // Arena trees are read-only.
  
     item->Name = string;
     Children.PushBack(item);
 }
 
+void JSON::SetName(const char* name)
+{
+    OVR_ASSERT(!InArena);    // Arena trees are read-only.
+    Name = name;
+}
+
 // Helper function to simplify creation of a typed object
 JSON* JSON::createHelper(JSONItemType itemType, double dval, const char* strVal)
 {
@@ -999,10 +1458,10 @@ double JSON::GetDoubleValue() const
     return dValue;
 }
 
-const String & JSON::GetStringValue() const
+String JSON::GetStringValue() const
 {
     OVR_ASSERT( Type == JSON_String || Type == JSON_Null ); // May be JSON_Null if the value od a string field was actually the word "null"
-    return Value;
+    return InArena ? String( ValueText ) : Value;
 }
 
 
@@ -1014,6 +1473,7 @@ void JSON::AddArrayElement(JSON *item)
     {
         return;
     }
+    OVR_ASSERT(!InArena && !item->InArena);    // Arena trees are read-only.
 
     Children.PushBack(item);
 }
@@ -1049,7 +1509,7 @@ const char* JSON::GetArrayString(int index) const
     if (Type == JSON_Array)
     {
         const JSON* number = GetItemByIndex(index);
-        return number ? number->Value.ToCStr() : 0;
+        return number ? number->getValueText() : 0;
     }
     else
     {
@@ -1123,13 +1583,23 @@ const JSON * JsonReader::GetChildByName( const char * childName ) const
 	// Check if the the cached child pointer is valid.
 	if ( !Parent->Children.IsNull( Child ) )
 	{
-		if ( OVR_strcmp( Child->Name.ToCStr(), childName ) == 0 )
+		if ( OVR_strcmp( Child->GetName(), childName ) == 0 )
 		{
 			const JSON * c = Child;
 			Child = c->pNext;	// Cache the next child.
 			return c;
 		}
 	}
+	// Arena trees can look the child up directly.
+	if ( Parent->InArena )
+	{
+		const JSON * c = Parent->findArenaItem( childName );
+		if ( c != NULL )
+		{
+			Child = c->pNext;	// Cache the next child.
+		}
+		return c;
+	}
 	// Itereate over all children.
     for ( const JSON * c = Parent->Children.GetFirst(); !Parent->Children.IsNull( c ); c = c->pNext )
 	{
@@ -1175,6 +1645,11 @@ double JsonReader::GetChildDoubleByName( const char * childName, const double de
 const String JsonReader::GetChildStringByName( const char * childName, const String & defaultValue ) const
 {
 	const JSON * c = GetChildByName( childName );
+	if ( c != NULL && c->Type != JSON_Null && c->InArena )
+	{
+		OVR_ASSERT( c->Type == JSON_String );
+		return String( c->ValueText );
+	}
 	return String( ( c != NULL && c->Type != JSON_Null ) ? c->GetStringValue() : defaultValue );
 }
 
@@ -1225,7 +1700,457 @@ double JsonReader::GetNextArrayDouble( const double defaultValue ) const
 const String JsonReader::GetNextArrayString( const String & defaultValue ) const
 {
 	const JSON * c = GetNextArrayElement();
+	if ( c != NULL && c->InArena )
+	{
+		OVR_ASSERT( c->Type == JSON_String || c->Type == JSON_Null );
+		return String( c->ValueText );
+	}
 	return String( ( c != NULL ) ? c->GetStringValue() : defaultValue );
 }
 
+//-----------------------------------------------------------------------------
+// ***** JsonPullParser
+
+JsonPullParser::JsonPullParser( const void * buffer, size_t length ) :
+    Source( NULL ),
+    Window( NULL ),
+    WindowSize( 0 ),
+    Data( static_cast< const char * >( buffer ) ),
+    Cur( Data ),
+    End( Data + length ),
+    DataOffset( 0 ),
+    Token( JsonToken_None ),
+    Depth( 0 ),
+    NeedComma( false ),
+    ExpectValue( false ),
+    Done( false ),
+    Skipping( false ),
+    Scratch( NULL ),
+    ScratchSize( 0 ),
+    StringLength( 0 ),
+    NumberValue( 0.0 )
+{
+    ErrorText[0] = '\0';
+    reserveScratch( 256 );
+}
+
+JsonPullParser::JsonPullParser( JsonPullSource * source, size_t windowSize ) :
+    Source( source ),
+    Window( (char*)OVR_ALLOC( windowSize ) ),
+    WindowSize( windowSize ),
+    Data( Window ),
+    Cur( Window ),
+    End( Window ),
+    DataOffset( 0 ),
+    Token( JsonToken_None ),
+    Depth( 0 ),
+    NeedComma( false ),
+    ExpectValue( false ),
+    Done( false ),
+    Skipping( false ),
+    Scratch( NULL ),
+    ScratchSize( 0 ),
+    StringLength( 0 ),
+    NumberValue( 0.0 )
+{
+    ErrorText[0] = '\0';
+    reserveScratch( 256 );
+}
+
+JsonPullParser::~JsonPullParser()
+{
+    OVR_FREE( Window );
+    OVR_FREE( Scratch );
+}
+
+// Reads the next chunk of a source into the window. Returns false at the end
+// of the input.
+bool JsonPullParser::fill()
+{
+    if ( Source == NULL || Window == NULL )
+    {
+        return false;
+    }
+    DataOffset += End - Data;
+    const size_t bytes = Source->Read( Window, WindowSize );
+    Cur = Window;
+    End = Window + bytes;
+    return bytes > 0;
+}
+
+// Returns the next input character without consuming it, or -1 at the end of
+// the input. A null character also ends the input, like it does for Parse().
+inline int JsonPullParser::peek()
+{
+    if ( Cur == End && !fill() )
+    {
+        return -1;
+    }
+    const int c = (unsigned char)*Cur;
+    return ( c != 0 ) ? c : -1;
+}
+
+inline int JsonPullParser::skipWhitespace()
+{
+    for ( ; ; )
+    {
+        while ( Cur < End && (unsigned char)*Cur <= 32 && *Cur != '\0' )
+        {
+            Cur++;
+        }
+        if ( Cur < End || !fill() )
+        {
+            return peek();
+        }
+    }
+}
+
+bool JsonPullParser::reserveScratch( size_t size )
+{
+    if ( size <= ScratchSize )
+    {
+        return true;
+    }
+    size_t newSize = ( ScratchSize > 0 ) ? ScratchSize : 256;
+    while ( newSize < size )
+    {
+        newSize *= 2;
+    }
+    char * newScratch = (char*)OVR_REALLOC( Scratch, newSize );
+    if ( newScratch == NULL )
+    {
+        return false;
+    }
+    Scratch = newScratch;
+    ScratchSize = newSize;
+    return true;
+}
+
+JsonToken JsonPullParser::setError( const char * message )
+{
+    if ( Token != JsonToken_Error )
+    {
+        OVR_sprintf( ErrorText, sizeof( ErrorText ), "%s at offset %u", message,
+                ( unsigned )( DataOffset + ( Cur - Data ) ) );
+        Token = JsonToken_Error;
+    }
+    return Token;
+}
+
+// Parses the string that starts at the current quote into the scratch buffer.
+// The raw text is gathered first, so the escapes are decoded by the same code
+// Parse() uses, even when the string straddles two windows.
+bool JsonPullParser::parseString( bool keep )
+{
+    Cur++;    // Skip the opening quote.
+    size_t length = 0;
+    bool escaped = false;
+    for ( ; ; )
+    {
+        const char * run = Cur;
+        while ( Cur < End && *Cur != '\"' && *Cur != '\\' && *Cur != '\0' )
+        {
+            Cur++;
+        }
+        if ( keep && Cur > run )
+        {
+            if ( !reserveScratch( length + ( Cur - run ) + 3 ) )
+            {
+                setError( "Error: Failed to allocate memory" );
+                return false;
+            }
+            memcpy( Scratch + length, run, Cur - run );
+            length += Cur - run;
+        }
+
+        const int c = peek();
+        if ( c == '\"' )
+        {
+            Cur++;
+            break;
+        }
+        if ( c == '\\' )
+        {
+            Cur++;
+            const int e = peek();
+            if ( e < 0 )
+            {
+                break;
+            }
+            Cur++;
+            if ( keep )
+            {
+                if ( !reserveScratch( length + 3 ) )
+                {
+                    setError( "Error: Failed to allocate memory" );
+                    return false;
+                }
+                Scratch[length++] = '\\';
+                Scratch[length++] = (char)e;
+            }
+            escaped = true;
+        }
+        else if ( c < 0 )
+        {
+            break;    // Like Parse(), an unterminated string ends with the input.
+        }
+    }
+    if ( !keep )
+    {
+        StringLength = 0;
+        Scratch[0] = '\0';
+        return true;
+    }
+    Scratch[length] = '\0';
+    if ( escaped )
+    {
+        char * end = NULL;
+        UnescapeString( Scratch, Scratch, &end );
+        *end = '\0';
+        length = end - Scratch;
+    }
+    StringLength = length;
+    return true;
+}
+
+// Parses the number at the current position into NumberValue.
+bool JsonPullParser::parseNumber()
+{
+    char text[128];
+    size_t length = 0;
+    for ( int c = peek(); ( c >= '0' && c <= '9' ) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'; c = peek() )
+    {
+        if ( length == sizeof( text ) - 1 )
+        {
+            setError( "Syntax Error: Number too long" );
+            return false;
+        }
+        text[length++] = (char)c;
+        Cur++;
+    }
+    text[length] = '\0';
+    // Anything after the root value is ignored, as in Parse().
+    if ( ParseNumberText( text, &NumberValue ) != text + length && Depth > 0 )
+    {
+        setError( "Syntax Error: Invalid number" );
+        return false;
+    }
+    return true;
+}
+
+inline void JsonPullParser::valueDone()
+{
+    NeedComma = true;
+    if ( Depth == 0 )
+    {
+        Done = true;
+    }
+}
+
+JsonToken JsonPullParser::parseValue( int c )
+{
+    switch ( c )
+    {
+        case '{':
+        case '[':
+            if ( Depth == MAX_DEPTH )
+            {
+                return setError( "Error: Nested too deeply" );
+            }
+            Containers[Depth++] = (char)c;
+            Cur++;
+            NeedComma = false;
+            return Token = ( c == '{' ) ? JsonToken_BeginObject : JsonToken_BeginArray;
+
+        case '\"':
+            if ( !parseString( !Skipping ) )
+            {
+                return Token;
+            }
+            valueDone();
+            return Token = JsonToken_String;
+
+        case 't':
+        case 'f':
+        case 'n':
+        {
+            const char * literal = ( c == 't' ) ? "true" : ( c == 'f' ) ? "false" : "null";
+            for ( ; *literal != '\0'; literal++ )
+            {
+                if ( peek() != *literal )
+                {
+                    return setError( "Syntax Error: Invalid value" );
+                }
+                Cur++;
+            }
+            NumberValue = ( c == 't' ) ? 1.0 : 0.0;
+            valueDone();
+            return Token = ( c == 'n' ) ? JsonToken_Null : JsonToken_Bool;
+        }
+
+        case -1:
+            return setError( "Syntax Error: Unexpected end of input" );
+
+        default:
+            if ( c != '-' && ( c < '0' || c > '9' ) )
+            {
+                return setError( "Syntax Error: Invalid value" );
+            }
+            if ( !parseNumber() )
+            {
+                return Token;
+            }
+            valueDone();
+            return Token = JsonToken_Number;
+    }
+}
+
+JsonToken JsonPullParser::Next()
+{
+    if ( Token == JsonToken_Error || Token == JsonToken_End )
+    {
+        return Token;
+    }
+
+    int c = skipWhitespace();
+    if ( ExpectValue )
+    {
+        ExpectValue = false;
+        return parseValue( c );
+    }
+    if ( Depth == 0 )
+    {
+        // Like Parse(), anything after the root value is ignored.
+        return Done ? ( Token = JsonToken_End ) : parseValue( c );
+    }
+    if ( c < 0 )
+    {
+        return setError( "Syntax Error: Unexpected end of input" );
+    }
+
+    const bool inObject = ( Containers[Depth - 1] == '{' );
+    if ( c == ( inObject ? '}' : ']' ) )
+    {
+        Cur++;
+        Depth--;
+        valueDone();
+        return Token = inObject ? JsonToken_EndObject : JsonToken_EndArray;
+    }
+    if ( NeedComma )
+    {
+        if ( c != ',' )
+        {
+            return setError( inObject ? "Syntax Error: Missing closing brace" : "Syntax Error: Missing ending bracket" );
+        }
+        Cur++;
+        c = skipWhitespace();
+    }
+    if ( !inObject )
+    {
+        return parseValue( c );
+    }
+
+    if ( c != '\"' )
+    {
+        return setError( "Syntax Error: Missing quote" );
+    }
+    if ( !parseString( !Skipping ) )
+    {
+        return Token;
+    }
+    if ( skipWhitespace() != ':' )
+    {
+        return setError( "Syntax Error: Missing colon" );
+    }
+    Cur++;
+    ExpectValue = true;
+    return Token = JsonToken_Name;
+}
+
+bool JsonPullParser::IsName( const char * name ) const
+{
+    return Token == JsonToken_Name && OVR_strcmp( Scratch, name ) == 0;
+}
+
+bool JsonPullParser::SkipValue()
+{
+    Skipping = true;
+    if ( Token == JsonToken_Name )
+    {
+        Next();
+    }
+    if ( Token == JsonToken_BeginObject || Token == JsonToken_BeginArray )
+    {
+        const int depth = Depth - 1;
+        while ( Depth > depth && Next() != JsonToken_Error )
+        {
+        }
+    }
+    Skipping = false;
+    return Token != JsonToken_Error;
+}
+
+template< typename T >
+int JsonPullParser::readNumberArray( T * out, int maxCount )
+{
+    if ( Token != JsonToken_BeginArray && Next() != JsonToken_BeginArray )
+    {
+        setError( "Syntax Error: Missing opening bracket" );
+        return -1;
+    }
+
+    // Elements are parsed here directly instead of going through Next().
+    int count = 0;
+    for ( int c = skipWhitespace(); ; c = skipWhitespace() )
+    {
+        if ( c == ']' )
+        {
+            Cur++;
+            Depth--;
+            valueDone();
+            Token = JsonToken_EndArray;
+            return count;
+        }
+        if ( count > 0 )
+        {
+            if ( c != ',' )
+            {
+                setError( "Syntax Error: Missing ending bracket" );
+                return -1;
+            }
+            Cur++;
+            c = skipWhitespace();
+        }
+        if ( c != '-' && ( c < '0' || c > '9' ) )
+        {
+            setError( "Syntax Error: Expected a number" );
+            return -1;
+        }
+        if ( !parseNumber() )
+        {
+            return -1;
+        }
+        if ( count < maxCount )
+        {
+            out[count] = static_cast< T >( NumberValue );
+        }
+        count++;
+    }
+}
+
+int JsonPullParser::ReadFloatArray( float * out, int maxCount )
+{
+    return readNumberArray( out, maxCount );
+}
+
+int JsonPullParser::ReadDoubleArray( double * out, int maxCount )
+{
+    return readNumberArray( out, maxCount );
+}
+
+int JsonPullParser::ReadInt32Array( int32_t * out, int maxCount )
+{
+    return readNumberArray( out, maxCount );
+}
+
 } // namespace OVR
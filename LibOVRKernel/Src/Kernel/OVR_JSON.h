@@ -48,22 +48,43 @@ enum JSONItemType
     JSON_Object    = 6
 };
 
+class JsonArena;
+
 //-----------------------------------------------------------------------------
 // ***** JSON
 
 // JSON object represents a JSON node that can be either a root of the JSON tree
 // or a child item. Every node has a type that describes what it is.
 // New JSON trees are typically loaded with JSON::Load or created with JSON::Parse.
+//
+// Read-only trees can instead be created with JSON::ParseInArena. All nodes and
+// strings of such a tree live in a single arena owned by the root, strings are
+// unescaped in place instead of being copied into a String, and containers keep
+// their children in an array so lookups by index are constant time and larger
+// objects find members by name through a hash table.
 
 class JSON : public RefCountBase<JSON>, public ListNode<JSON>
 {
 protected:
     List<JSON>      Children;
 
-public:
-    JSONItemType    Type;       // Type of this JSON node.
+    // Only used by trees created with ParseInArena().
+    JsonArena *     Arena;          // Set on the root, which owns the arena.
+    bool            InArena;
+    const char *    NameText;       // Null-terminated name and string value in the arena.
+    const char *    ValueText;
+    uint32_t        NameHash;
+    uint32_t        ItemCount;
+    JSON **         Items;          // Children in order.
+    uint32_t *      ItemSlots;      // Open addressed by NameHash, holding Items index + 1.
+    uint32_t        ItemSlotMask;
+
+    // Only used by trees that are not in an arena; use the accessors instead.
     String          Name;       // Name part of the {Name, Value} pair in a parent object.
     String          Value;
+
+public:
+    JSONItemType    Type;       // Type of this JSON node.
     double          dValue;
 
 public:
@@ -82,6 +103,13 @@ public:
     // Returns a null pointer and fills in *perror in case of parse error.
     static JSON*    Parse(const char* buff, const char** perror = 0);
 
+    // Creates a new read-only JSON tree in a single arena from the first length
+    // bytes of the given string, which does not have to be null-terminated.
+    // The whole tree is freed by releasing the root; child nodes can not be
+    // retained past that, and nodes can not be added to the tree.
+    // Returns a null pointer and fills in *perror in case of parse error.
+    static JSON*    ParseInArena(const char* buff, size_t length, const char** perror = 0);
+
     // Loads and parses a JSON object from a file.
     // Returns a null pointer and fills in *perror in case of parse error.
     static JSON*    Load(const char* path, const char** perror = 0);
@@ -95,6 +123,11 @@ public:
     void            AddNumberItem(const char* name, double n)        { AddItem(name, CreateNumber(n)); }
     void            AddStringItem(const char* name, const char* s)   { AddItem(name, CreateString(s)); }
 
+    // Returns the name part of the {Name, Value} pair in a parent object.
+    const char*     GetName() const          { return InArena ? NameText : Name.ToCStr(); }
+    // Names an item that is added to a parent with AddArrayElement().
+    void            SetName(const char* name);
+
     // *** Object Member Access
 
     // These provide access to child items of the list.
@@ -105,7 +138,8 @@ public:
     JSON*           GetLastItem()            { return (!Children.IsEmpty()) ? Children.GetLast() : 0; }
 	const JSON*     GetLastItem() const      { return (!Children.IsEmpty()) ? Children.GetLast() : 0; }
 
-    // Counts the number of items in the object; these methods are inefficient.
+    // Counts the number of items in the object; these methods are inefficient
+    // unless the tree was created with ParseInArena().
     unsigned        GetItemCount() const;
     JSON*           GetItemByIndex(unsigned i);
 	const JSON*     GetItemByIndex(unsigned i) const;
@@ -125,7 +159,9 @@ public:
 	int64_t			GetInt64Value() const;
 	float			GetFloatValue() const;
 	double			GetDoubleValue() const;
-	const String &	GetStringValue() const;
+	String			GetStringValue() const;
+	// Same as GetStringValue() without copying; valid as long as the node is.
+	const char *	GetStringValueCStr() const		{ return getValueText(); }
 
     // *** Array Element Access
 
@@ -146,6 +182,10 @@ public:
 protected:
     JSON(JSONItemType itemType = JSON_Object);
 
+    const char*     getValueText() const     { return InArena ? ValueText : Value.ToCStr(); }
+    const JSON*     findArenaItem(const char* name) const;
+    void            destroyArenaItems();
+
     static JSON*    createHelper(JSONItemType itemType, double dval, const char* strVal = 0);
 
     // JSON Parsing helper functions.
@@ -159,6 +199,7 @@ protected:
     char*           PrintArray(int depth, bool fmt) const;
 
 	friend class JsonReader;
+	friend class JsonArenaParser;
 };
 
 //-----------------------------------------------------------------------------
@@ -256,6 +297,164 @@ private:
 	mutable const JSON *	Child;		// cached child pointer
 };
 
+//-----------------------------------------------------------------------------
+// ***** JsonPullParser
+
+// Event-driven JSON reader that walks a document one token at a time without
+// building a tree, so peak memory stays at the input plus a small window.
+//
+// The input is either a buffer that holds the whole document, such as the
+// front of a MappedView, or a JsonPullSource that is read through a fixed
+// window. Nothing is allocated per value: names and strings are unescaped
+// into one scratch buffer that is reused for every token, and numbers can be
+// parsed straight into caller-provided typed arrays.
+//
+// Each call to Next() returns the next token. A Name token is always followed
+// by the tokens of its value. Values that are not needed can be skipped with
+// SkipValue(), which does not copy the strings it passes over.
+//
+// This is an example of how this class can be used to read a glyph table:
+//
+//	JsonPullParser json( view.GetFront(), view.GetLength() );
+//	if ( json.Next() == JsonToken_BeginObject )
+//	{
+//		while ( json.Next() == JsonToken_Name )
+//		{
+//			if ( json.IsName( "NumGlyphs" ) && json.Next() == JsonToken_Number )
+//			{
+//				const int numGlyphs = json.GetInt32();
+//			}
+//			else if ( json.IsName( "Bounds" ) )
+//			{
+//				float bounds[4];
+//				const int count = json.ReadFloatArray( bounds, 4 );
+//			}
+//			else if ( !json.SkipValue() )
+//			{
+//				break;
+//			}
+//		}
+//	}
+//	if ( json.GetToken() == JsonToken_Error )
+//	{
+//		LOG( "%s", json.GetError() );
+//	}
+
+enum JsonToken
+{
+    JsonToken_None,         // Next() has not been called yet.
+    JsonToken_Error,
+    JsonToken_End,          // End of the document.
+    JsonToken_BeginObject,
+    JsonToken_EndObject,
+    JsonToken_BeginArray,
+    JsonToken_EndArray,
+    JsonToken_Name,         // Member name, the value follows.
+    JsonToken_String,
+    JsonToken_Number,
+    JsonToken_Bool,
+    JsonToken_Null
+};
+
+// Supplies the input of a JsonPullParser in chunks.
+class JsonPullSource
+{
+public:
+    virtual         ~JsonPullSource() {}
+
+    // Reads up to 'bytes' bytes into buffer and returns the number of bytes
+    // read. Returns 0 at the end of the input.
+    virtual size_t  Read( void * buffer, size_t bytes ) = 0;
+};
+
+class JsonPullParser
+{
+public:
+    enum { MAX_DEPTH = 64 };
+
+    // Reads a document that is entirely in memory. The buffer does not have to
+    // be null terminated and must stay valid while the parser is used.
+                    JsonPullParser( const void * buffer, size_t length );
+    // Reads a document from source through a window of windowSize bytes.
+                    JsonPullParser( JsonPullSource * source, size_t windowSize = 64 * 1024 );
+                    ~JsonPullParser();
+
+    // Advances to the next token and returns it. After an error or the end of
+    // the document the same token is returned again.
+    JsonToken       Next();
+    JsonToken       GetToken() const        { return Token; }
+    // Number of objects and arrays the parser is currently inside of.
+    int             GetDepth() const        { return Depth; }
+
+    // Text of the current Name or String token. Valid until the next call that
+    // advances the parser.
+    const char *    GetString() const       { return Scratch; }
+    size_t          GetStringLength() const { return StringLength; }
+    bool            IsName( const char * name ) const;
+
+    // Value of the current Number or Bool token.
+    double          GetNumber() const       { return NumberValue; }
+    float           GetFloat() const        { return (float)NumberValue; }
+    int32_t         GetInt32() const        { return (int32_t)NumberValue; }
+    bool            GetBool() const         { return NumberValue != 0.0; }
+
+    // Skips the value that the current token starts. After a Name token this
+    // skips the member's value. Returns false on a syntax error.
+    bool            SkipValue();
+
+    // Reads an array of numbers into out. The array is either the value that
+    // follows the current Name token or the one the current BeginArray token
+    // opened. Elements past maxCount are parsed but not stored. Returns the
+    // number of elements in the array, or -1 on an error, including elements
+    // that are not numbers.
+    int             ReadFloatArray( float * out, int maxCount );
+    int             ReadDoubleArray( double * out, int maxCount );
+    int             ReadInt32Array( int32_t * out, int maxCount );
+
+    // Description of the first error, including the input offset.
+    const char *    GetError() const        { return ErrorText; }
+
+private:
+    JsonPullSource *    Source;
+    char *              Window;         // Owned when reading from a source.
+    size_t              WindowSize;
+    const char *        Data;           // Start of the buffered input.
+    const char *        Cur;
+    const char *        End;
+    size_t              DataOffset;     // Input offset of Data.
+
+    JsonToken           Token;
+    int                 Depth;
+    bool                NeedComma;
+    bool                ExpectValue;
+    bool                Done;
+    bool                Skipping;
+    char                Containers[MAX_DEPTH];
+
+    char *              Scratch;
+    size_t              ScratchSize;
+    size_t              StringLength;
+    double              NumberValue;
+    char                ErrorText[128];
+
+    bool                fill();
+    int                 peek();
+    int                 skipWhitespace();
+    bool                reserveScratch( size_t size );
+    bool                parseString( bool keep );
+    bool                parseNumber();
+    JsonToken           parseValue( int c );
+    void                valueDone();
+    JsonToken           setError( const char * message );
+
+    template< typename T >
+    int                 readNumberArray( T * out, int maxCount );
+
+    // Private copy and assignment to prevent copying.
+                        JsonPullParser( const JsonPullParser & );
+    JsonPullParser &    operator = ( const JsonPullParser & );
+};
+
 }
 
 #endif // OVR_JSON_h
@@ -20,13 +20,940 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include <string.h>
 #include <assert.h>
 
+#if defined( OVR_OS_ANDROID )
+#include <pthread.h>
+#include <unistd.h>
+
+//==============================================================
+// Asynchronous logging
+//
+// Every thread that logs gets a single producer / single consumer ring buffer.
+// A message is queued as a record holding the tag and format pointers followed
+// by the raw argument values; %s strings are copied into the record. The
+// background thread walks the format again to turn the record into text.
+//
+// Parsing a format to find the argument types is the expensive part, so it is
+// done once per call site: each thread keeps a small table keyed by the format
+// pointer that holds the argument types and the rate limit state of the site.
+
+static const int		ASYNC_LOG_MAX_ARGS = 16;
+static const int		ASYNC_LOG_MAX_SITES = 64;		// per thread, power of two
+static const int		ASYNC_LOG_SITE_PROBES = 4;
+static const int		ASYNC_LOG_MAX_SPEC = 32;		// longest conversion specification
+static const uint32_t	ASYNC_LOG_MIN_RING_SIZE = 4096;
+static const uint32_t	ASYNC_LOG_MIN_SLEEP = 1000;		// microseconds
+static const uint32_t	ASYNC_LOG_MAX_SLEEP = 16000;	// when idle
+static const uint32_t	ASYNC_LOG_FLUSH_TIMEOUT = 100;	// milliseconds
+static const uint32_t	ASYNC_LOG_NULL_STRING = 0xFFFFFFFF;
+static const int		ASYNC_LOG_CACHE_LINE = 64;
+
+enum
+{
+	ASYNC_LOG_FILE_TAG	= 1,		// the tag is a source file path
+	ASYNC_LOG_PADDING	= 2			// skip to the start of the ring
+};
+
+enum logArgType_t
+{
+	LOG_ARG_INT,
+	LOG_ARG_LONG,
+	LOG_ARG_LONG_LONG,
+	LOG_ARG_INTMAX,
+	LOG_ARG_SIZE,
+	LOG_ARG_PTRDIFF,
+	LOG_ARG_DOUBLE,
+	LOG_ARG_LONG_DOUBLE,
+	LOG_ARG_POINTER,
+	LOG_ARG_STRING,
+	LOG_ARG_NONE,					// %%
+	LOG_ARG_UNSUPPORTED				// %n, %ls, positional arguments...
+};
+
+struct logConversion_t
+{
+	const char *	End;			// one past the conversion character
+	logArgType_t	Type;
+	int				NumStars;		// width and precision passed as int arguments
+	int				Precision;		// literal precision or -1
+	bool			StarPrecision;
+};
+
+struct asyncLogArg_t
+{
+	logArgType_t	Type;
+	int				MaxLength;		// %s precision: -1 if none, -2 if passed as an argument
+};
+
+struct asyncLogSite_t
+{
+	const char *	Format;			// NULL if the entry is unused
+	int				NumArgs;		// -1 if the format cannot be queued
+	uint32_t		Second;			// current rate limit window
+	uint32_t		Count;			// messages logged in the window
+	uint32_t		Suppressed;		// messages suppressed since the last one that was logged
+	asyncLogArg_t	Args[ASYNC_LOG_MAX_ARGS];
+};
+
+struct asyncLogRecord_t
+{
+	uint32_t		Size;			// including the header, the arguments and padding
+	uint16_t		Prio;
+	uint16_t		Flags;
+	uint32_t		Suppressed;
+	const char *	Tag;
+	const char *	Format;
+};
+
+static const uint32_t ASYNC_LOG_RECORD_SIZE = ( sizeof( asyncLogRecord_t ) + 7 ) & ~7;
+
+// Head and Tail are kept on separate cache lines, so the producer and the
+// background thread do not keep stealing the line from each other.
+struct asyncLogRing_t
+{
+	asyncLogRing_t *	Next;			// rings are never freed
+	uint8_t *			Buffer;
+	uint32_t			Size;
+	volatile uint32_t	Abandoned;		// the producer has exited and the ring can be reused
+
+	// Only written by the producer.
+	uint8_t				HeadPad[ASYNC_LOG_CACHE_LINE];
+	volatile uint32_t	Head;
+	uint32_t			CachedTail;		// last Tail seen by the producer
+	volatile uint32_t	Queued;
+	volatile uint32_t	RateLimited;
+	volatile uint32_t	RingFull;
+	asyncLogSite_t		Sites[ASYNC_LOG_MAX_SITES];
+
+	// Only written by the background thread.
+	uint8_t				TailPad[ASYNC_LOG_CACHE_LINE];
+	volatile uint32_t	Tail;
+	uint32_t			ReportedRingFull;
+};
+
+struct asyncLogState_t
+{
+	asyncLogRing_t * volatile	Rings;
+	volatile uint32_t	Running;
+	volatile uint32_t	Producers;		// threads in LogAsync() that may still queue a message
+	volatile uint32_t	Stopping;
+	volatile uint32_t	FlushRequested;
+	volatile uint32_t	Second;			// coarse clock for rate limiting, set by the background thread
+	volatile uint32_t	Written;
+	volatile uint32_t	Synchronous;
+	uint32_t			RingSize;
+	uint32_t			MaxPerSecond;
+	pthread_t			Thread;
+};
+
+static asyncLogState_t				AsyncLog;
+static __thread asyncLogRing_t *	ThreadLogRing = NULL;
+static pthread_key_t				AsyncLogRingKey;
+static pthread_once_t				AsyncLogRingKeyOnce = PTHREAD_ONCE_INIT;
+
+static inline uint32_t AlignLogSize( const uint32_t size )
+{
+	return ( size + 7 ) & ~7;
+}
+
+// The records are plain memory published through the ring indices, so the indices need
+// acquire / release ordering for the compiler as well as for the CPU. OVR::AtomicOps only
+// provides the latter on some targets, so the compiler builtins are used here.
+template< typename _type_ >
+static inline _type_ LoadAcquire( const volatile _type_ * p )
+{
+	return __atomic_load_n( p, __ATOMIC_ACQUIRE );
+}
+
+template< typename _type_ >
+static inline void StoreRelease( volatile _type_ * p, const _type_ value )
+{
+	__atomic_store_n( p, value, __ATOMIC_RELEASE );
+}
+
+template< typename _type_ >
+static inline bool CompareAndSet( volatile _type_ * p, _type_ expected, const _type_ value )
+{
+	return __atomic_compare_exchange_n( p, &expected, value, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+}
+
+// Counters are written by one thread and read by others.
+static inline void IncrementLogCounter( volatile uint32_t * counter )
+{
+	__atomic_store_n( counter, __atomic_load_n( counter, __ATOMIC_RELAXED ) + 1, __ATOMIC_RELAXED );
+}
+
+static inline uint32_t ReadLogCounter( const volatile uint32_t * counter )
+{
+	return __atomic_load_n( counter, __ATOMIC_RELAXED );
+}
+
+static uint32_t GetLogSecond()
+{
+	struct timespec now;
+	clock_gettime( CLOCK_MONOTONIC, &now );
+	return static_cast< uint32_t >( now.tv_sec );
+}
+
+// Parses the conversion specification that starts at fmt[0] == '%'.
+static void ParseLogConversion( const char * fmt, logConversion_t & conv )
+{
+	conv.Type = LOG_ARG_UNSUPPORTED;
+	conv.NumStars = 0;
+	conv.Precision = -1;
+	conv.StarPrecision = false;
+
+	const char * p = fmt + 1;
+	while ( *p == '-' || *p == '+' || *p == ' ' || *p == '#' || *p == '0' )
+	{
+		p++;
+	}
+	if ( *p == '*' )
+	{
+		conv.NumStars++;
+		p++;
+	}
+	while ( *p >= '0' && *p <= '9' )
+	{
+		p++;
+	}
+	if ( *p == '.' )
+	{
+		p++;
+		if ( *p == '*' )
+		{
+			conv.NumStars++;
+			conv.StarPrecision = true;
+			p++;
+		}
+		else
+		{
+			conv.Precision = 0;
+			while ( *p >= '0' && *p <= '9' )
+			{
+				conv.Precision = conv.Precision * 10 + ( *p - '0' );
+				p++;
+			}
+		}
+	}
+	int longs = 0;
+	char length = 0;
+	for ( ; ; p++ )
+	{
+		if ( *p == 'l' )
+		{
+			longs++;
+		}
+		else if ( *p == 'q' )
+		{
+			longs = 2;
+		}
+		else if ( *p == 'j' || *p == 'z' || *p == 't' || *p == 'L' )
+		{
+			length = *p;
+		}
+		else if ( *p != 'h' )
+		{
+			break;
+		}
+	}
+	conv.End = ( *p != '\0' ) ? p + 1 : p;
+	if ( conv.End - fmt >= ASYNC_LOG_MAX_SPEC )
+	{
+		return;
+	}
+
+	switch ( *p )
+	{
+		case '%':
+			conv.Type = ( p == fmt + 1 ) ? LOG_ARG_NONE : LOG_ARG_UNSUPPORTED;
+			break;
+		case 'd': case 'i': case 'u': case 'o': case 'x': case 'X':
+			conv.Type = ( length == 'j' ) ? LOG_ARG_INTMAX :
+						( length == 'z' ) ? LOG_ARG_SIZE :
+						( length == 't' ) ? LOG_ARG_PTRDIFF :
+						( longs == 0 ) ? LOG_ARG_INT :
+						( longs == 1 ) ? LOG_ARG_LONG : LOG_ARG_LONG_LONG;
+			break;
+		case 'c':
+			conv.Type = ( longs == 0 && length == 0 ) ? LOG_ARG_INT : LOG_ARG_UNSUPPORTED;
+			break;
+		case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+			conv.Type = ( length == 'L' ) ? LOG_ARG_LONG_DOUBLE : LOG_ARG_DOUBLE;
+			break;
+		case 'p':
+			conv.Type = LOG_ARG_POINTER;
+			break;
+		case 's':
+			conv.Type = ( longs == 0 ) ? LOG_ARG_STRING : LOG_ARG_UNSUPPORTED;
+			break;
+		default:
+			break;
+	}
+}
+
+static void InitAsyncLogSite( asyncLogSite_t & site, const char * fmt )
+{
+	site.Format = fmt;
+	site.NumArgs = 0;
+	site.Second = 0;
+	site.Count = 0;
+	site.Suppressed = 0;
+
+	for ( const char * p = fmt; *p != '\0'; )
+	{
+		if ( *p != '%' )
+		{
+			p++;
+			continue;
+		}
+		logConversion_t conv;
+		ParseLogConversion( p, conv );
+		p = conv.End;
+		if ( conv.Type == LOG_ARG_NONE )
+		{
+			continue;
+		}
+		if ( conv.Type == LOG_ARG_UNSUPPORTED || site.NumArgs + conv.NumStars + 1 > ASYNC_LOG_MAX_ARGS )
+		{
+			site.NumArgs = -1;
+			return;
+		}
+		for ( int i = 0; i < conv.NumStars; i++ )
+		{
+			site.Args[site.NumArgs].Type = LOG_ARG_INT;
+			site.Args[site.NumArgs].MaxLength = -1;
+			site.NumArgs++;
+		}
+		site.Args[site.NumArgs].Type = conv.Type;
+		site.Args[site.NumArgs].MaxLength = conv.StarPrecision ? -2 : conv.Precision;
+		site.NumArgs++;
+	}
+}
+
+static asyncLogSite_t & FindAsyncLogSite( asyncLogRing_t * ring, const char * fmt )
+{
+	const uintptr_t hash = ( reinterpret_cast< uintptr_t >( fmt ) >> 3 ) ^ ( reinterpret_cast< uintptr_t >( fmt ) >> 11 );
+	for ( int i = 0; i < ASYNC_LOG_SITE_PROBES; i++ )
+	{
+		asyncLogSite_t & site = ring->Sites[( hash + i ) & ( ASYNC_LOG_MAX_SITES - 1 )];
+		if ( site.Format == fmt )
+		{
+			return site;
+		}
+		if ( site.Format == NULL )
+		{
+			InitAsyncLogSite( site, fmt );
+			return site;
+		}
+	}
+	// The table is crowded; the call site replaces the one in its first slot.
+	asyncLogSite_t & site = ring->Sites[hash & ( ASYNC_LOG_MAX_SITES - 1 )];
+	InitAsyncLogSite( site, fmt );
+	return site;
+}
+
+// Called on thread exit; the ring is reused by the next thread that logs.
+static void ReleaseAsyncLogRing( void * ring )
+{
+	ThreadLogRing = NULL;
+	StoreRelease< uint32_t >( &static_cast< asyncLogRing_t * >( ring )->Abandoned, 1 );
+}
+
+static void CreateAsyncLogRingKey()
+{
+	pthread_key_create( &AsyncLogRingKey, ReleaseAsyncLogRing );
+}
+
+static asyncLogRing_t * AcquireAsyncLogRing()
+{
+	pthread_once( &AsyncLogRingKeyOnce, CreateAsyncLogRingKey );
+
+	asyncLogRing_t * ring = NULL;
+	for ( asyncLogRing_t * r = LoadAcquire( &AsyncLog.Rings ); r != NULL; r = r->Next )
+	{
+		if ( LoadAcquire( &r->Abandoned ) != 0 && CompareAndSet< uint32_t >( &r->Abandoned, 1, 0 ) )
+		{
+			ring = r;
+			break;
+		}
+	}
+	if ( ring == NULL )
+	{
+		ring = static_cast< asyncLogRing_t * >( calloc( 1, sizeof( asyncLogRing_t ) ) );
+		if ( ring == NULL )
+		{
+			return NULL;
+		}
+		ring->Size = AsyncLog.RingSize;
+		ring->Buffer = static_cast< uint8_t * >( malloc( ring->Size ) );
+		if ( ring->Buffer == NULL )
+		{
+			free( ring );
+			return NULL;
+		}
+		for ( ; ; )
+		{
+			ring->Next = LoadAcquire( &AsyncLog.Rings );
+			if ( CompareAndSet< asyncLogRing_t * >( &AsyncLog.Rings, ring->Next, ring ) )
+			{
+				break;
+			}
+		}
+	}
+	ring->CachedTail = LoadAcquire( &ring->Tail );
+	memset( ring->Sites, 0, sizeof( ring->Sites ) );
+	pthread_setspecific( AsyncLogRingKey, ring );
+	ThreadLogRing = ring;
+	return ring;
+}
+
+union asyncLogValue_t
+{
+	int				Int;
+	long			Long;
+	long long		LongLong;
+	intmax_t		IntMax;
+	size_t			Size;
+	ptrdiff_t		PtrDiff;
+	double			Double;
+	long double		LongDouble;
+	const void *	Pointer;
+	const char *	String;
+};
+
+static uint32_t LogArgSize( const logArgType_t type )
+{
+	switch ( type )
+	{
+		case LOG_ARG_INT:			return AlignLogSize( sizeof( int ) );
+		case LOG_ARG_LONG:			return AlignLogSize( sizeof( long ) );
+		case LOG_ARG_LONG_LONG:		return AlignLogSize( sizeof( long long ) );
+		case LOG_ARG_INTMAX:		return AlignLogSize( sizeof( intmax_t ) );
+		case LOG_ARG_SIZE:			return AlignLogSize( sizeof( size_t ) );
+		case LOG_ARG_PTRDIFF:		return AlignLogSize( sizeof( ptrdiff_t ) );
+		case LOG_ARG_DOUBLE:		return AlignLogSize( sizeof( double ) );
+		case LOG_ARG_LONG_DOUBLE:	return AlignLogSize( sizeof( long double ) );
+		case LOG_ARG_POINTER:		return AlignLogSize( sizeof( void * ) );
+		default:					return 0;
+	}
+}
+
+// Copies a message into the ring of the calling thread. Returns false if the
+// message has to be written synchronously instead; ap is consumed either way.
+static bool QueueAsyncLog( const int prio, const char * tag, const uint16_t flags, const char * fmt, va_list ap )
+{
+	asyncLogRing_t * ring = ThreadLogRing;
+	if ( ring == NULL )
+	{
+		ring = AcquireAsyncLogRing();
+		if ( ring == NULL )
+		{
+			return false;
+		}
+	}
+
+	asyncLogSite_t & site = FindAsyncLogSite( ring, fmt );
+	if ( site.NumArgs < 0 )
+	{
+		return false;
+	}
+
+	if ( AsyncLog.MaxPerSecond != 0 )
+	{
+		const uint32_t second = ReadLogCounter( &AsyncLog.Second );
+		if ( site.Second != second )
+		{
+			site.Second = second;
+			site.Count = 0;
+		}
+		if ( ++site.Count > AsyncLog.MaxPerSecond )
+		{
+			site.Suppressed++;
+			IncrementLogCounter( &ring->RateLimited );
+			return true;
+		}
+	}
+
+	// Fetch the arguments first so the record can be reserved in one piece.
+	asyncLogValue_t values[ASYNC_LOG_MAX_ARGS];
+	uint32_t stringLengths[ASYNC_LOG_MAX_ARGS];
+	uint32_t size = ASYNC_LOG_RECORD_SIZE;
+	for ( int i = 0; i < site.NumArgs; i++ )
+	{
+		const logArgType_t type = site.Args[i].Type;
+		switch ( type )
+		{
+			case LOG_ARG_INT:			values[i].Int = va_arg( ap, int ); break;
+			case LOG_ARG_LONG:			values[i].Long = va_arg( ap, long ); break;
+			case LOG_ARG_LONG_LONG:		values[i].LongLong = va_arg( ap, long long ); break;
+			case LOG_ARG_INTMAX:		values[i].IntMax = va_arg( ap, intmax_t ); break;
+			case LOG_ARG_SIZE:			values[i].Size = va_arg( ap, size_t ); break;
+			case LOG_ARG_PTRDIFF:		values[i].PtrDiff = va_arg( ap, ptrdiff_t ); break;
+			case LOG_ARG_DOUBLE:		values[i].Double = va_arg( ap, double ); break;
+			case LOG_ARG_LONG_DOUBLE:	values[i].LongDouble = va_arg( ap, long double ); break;
+			case LOG_ARG_POINTER:		values[i].Pointer = va_arg( ap, const void * ); break;
+			case LOG_ARG_STRING:
+			{
+				const char * string = va_arg( ap, const char * );
+				const int maxLength = ( site.Args[i].MaxLength == -2 ) ? values[i - 1].Int : site.Args[i].MaxLength;
+				values[i].String = string;
+				stringLengths[i] = ( string == NULL ) ? 0 : static_cast< uint32_t >(
+						( maxLength >= 0 ) ? strnlen( string, maxLength ) : strlen( string ) );
+				size += AlignLogSize( sizeof( uint32_t ) + stringLengths[i] + 1 );
+				continue;
+			}
+			default:
+				break;
+		}
+		size += LogArgSize( type );
+	}
+	if ( size > ring->Size / 4 )
+	{
+		return false;
+	}
+
+	const uint32_t head = ring->Head;
+	uint32_t offset = head & ( ring->Size - 1 );
+	const uint32_t padding = ( offset + size > ring->Size ) ? ring->Size - offset : 0;
+	if ( head - ring->CachedTail + padding + size > ring->Size )
+	{
+		// Only look at the tail of the background thread when the space seen last time runs out.
+		ring->CachedTail = LoadAcquire( &ring->Tail );
+		if ( head - ring->CachedTail + padding + size > ring->Size )
+		{
+			IncrementLogCounter( &ring->RingFull );
+			return true;
+		}
+	}
+	if ( padding != 0 )
+	{
+		asyncLogRecord_t * record = reinterpret_cast< asyncLogRecord_t * >( ring->Buffer + offset );
+		record->Size = padding;
+		record->Flags = ASYNC_LOG_PADDING;
+		offset = 0;
+	}
+
+	asyncLogRecord_t * record = reinterpret_cast< asyncLogRecord_t * >( ring->Buffer + offset );
+	record->Size = size;
+	record->Prio = static_cast< uint16_t >( prio );
+	record->Flags = flags;
+	record->Suppressed = site.Suppressed;
+	record->Tag = tag;
+	record->Format = fmt;
+
+	uint8_t * data = ring->Buffer + offset + ASYNC_LOG_RECORD_SIZE;
+	for ( int i = 0; i < site.NumArgs; i++ )
+	{
+		const logArgType_t type = site.Args[i].Type;
+		if ( type == LOG_ARG_STRING )
+		{
+			const uint32_t length = ( values[i].String == NULL ) ? ASYNC_LOG_NULL_STRING : stringLengths[i];
+			memcpy( data, &length, sizeof( length ) );
+			if ( values[i].String != NULL )
+			{
+				memcpy( data + sizeof( length ), values[i].String, length );
+				data[sizeof( length ) + length] = '\0';
+			}
+			data += AlignLogSize( sizeof( uint32_t ) + stringLengths[i] + 1 );
+			continue;
+		}
+		const uint32_t argSize = LogArgSize( type );
+		memcpy( data, &values[i], argSize < sizeof( values[i] ) ? argSize : sizeof( values[i] ) );
+		data += argSize;
+	}
+
+	StoreRelease< uint32_t >( &ring->Head, head + padding + size );
+	site.Suppressed = 0;
+	IncrementLogCounter( &ring->Queued );
+	return true;
+}
+
+// Waits until the background thread has consumed the ring up to head.
+static bool WaitForAsyncLogRing( asyncLogRing_t * ring, const uint32_t head, const struct timespec & start )
+{
+	while ( static_cast< int32_t >( head - LoadAcquire( &ring->Tail ) ) > 0 )
+	{
+		struct timespec now;
+		clock_gettime( CLOCK_MONOTONIC, &now );
+		if ( ( now.tv_sec - start.tv_sec ) * 1000 + ( now.tv_nsec - start.tv_nsec ) / 1000000 > ASYNC_LOG_FLUSH_TIMEOUT )
+		{
+			return false;
+		}
+		__atomic_store_n( &AsyncLog.FlushRequested, 1, __ATOMIC_RELAXED );
+		usleep( 100 );
+	}
+	return true;
+}
+
+static bool LogAsyncRunning( const int prio, const char * tag, const uint16_t flags, const char * fmt, va_list ap )
+{
+	if ( prio >= ANDROID_LOG_ERROR )
+	{
+		// Errors usually come right before an abort, so write everything that came before them.
+		FlushAsyncLogging();
+		__atomic_fetch_add( &AsyncLog.Synchronous, 1, __ATOMIC_RELAXED );
+		return false;
+	}
+	va_list copy;
+	va_copy( copy, ap );
+	const bool queued = QueueAsyncLog( prio, tag, flags, fmt, copy );
+	va_end( copy );
+	if ( !queued )
+	{
+		// Keep the messages of this thread in order.
+		if ( ThreadLogRing != NULL )
+		{
+			struct timespec start;
+			clock_gettime( CLOCK_MONOTONIC, &start );
+			WaitForAsyncLogRing( ThreadLogRing, ThreadLogRing->Head, start );
+		}
+		__atomic_fetch_add( &AsyncLog.Synchronous, 1, __ATOMIC_RELAXED );
+	}
+	return queued;
+}
+
+// Tries to queue a message. Returns false if the message has to be written on the calling thread.
+static bool LogAsync( const int prio, const char * tag, const uint16_t flags, const char * fmt, va_list ap )
+{
+	// Announce the producer before checking Running, so StopAsyncLogging() either sees
+	// this thread in flight or this thread sees logging stopped.
+	__atomic_fetch_add( &AsyncLog.Producers, 1, __ATOMIC_SEQ_CST );
+	const bool queued = ( __atomic_load_n( &AsyncLog.Running, __ATOMIC_SEQ_CST ) != 0 ) && LogAsyncRunning( prio, tag, flags, fmt, ap );
+	__atomic_fetch_sub( &AsyncLog.Producers, 1, __ATOMIC_RELEASE );
+	return queued;
+}
+
+struct logMessage_t
+{
+	char *	Text;
+	size_t	Length;
+	size_t	Capacity;
+};
+
+static bool GrowLogMessage( logMessage_t & msg, const size_t capacity )
+{
+	char * text = static_cast< char * >( realloc( msg.Text, capacity ) );
+	if ( text == NULL )
+	{
+		return false;
+	}
+	msg.Text = text;
+	msg.Capacity = capacity;
+	return true;
+}
+
+static void AppendLogText( logMessage_t & msg, const char * text, const size_t length )
+{
+	if ( msg.Length + length + 1 > msg.Capacity && !GrowLogMessage( msg, msg.Length + length + 256 ) )
+	{
+		return;
+	}
+	memcpy( msg.Text + msg.Length, text, length );
+	msg.Length += length;
+	msg.Text[msg.Length] = '\0';
+}
+
+template< typename _type_ >
+static void AppendLogArg( logMessage_t & msg, const char * spec, const int * stars, const int numStars, const _type_ value )
+{
+	for ( ; ; )
+	{
+		char * dest = msg.Text + msg.Length;
+		const size_t available = msg.Capacity - msg.Length;
+		const int length = ( numStars == 0 ) ? snprintf( dest, available, spec, value ) :
+							( numStars == 1 ) ? snprintf( dest, available, spec, stars[0], value ) :
+												snprintf( dest, available, spec, stars[0], stars[1], value );
+		if ( length < 0 )
+		{
+			msg.Text[msg.Length] = '\0';
+			return;
+		}
+		if ( static_cast< size_t >( length ) < available )
+		{
+			msg.Length += length;
+			return;
+		}
+		if ( !GrowLogMessage( msg, msg.Length + length + 256 ) )
+		{
+			msg.Text[msg.Length] = '\0';
+			return;
+		}
+	}
+}
+
+template< typename _type_ >
+static _type_ ReadLogArg( const uint8_t * & data )
+{
+	_type_ value;
+	memcpy( &value, data, sizeof( value ) );
+	data += AlignLogSize( sizeof( value ) );
+	return value;
+}
+
+static void FormatAsyncLogRecord( const asyncLogRecord_t * record, logMessage_t & msg )
+{
+	const uint8_t * data = reinterpret_cast< const uint8_t * >( record ) + ASYNC_LOG_RECORD_SIZE;
+	msg.Length = 0;
+	msg.Text[0] = '\0';
+
+	const char * fmt = record->Format;
+	for ( ; ; )
+	{
+		const char * percent = strchr( fmt, '%' );
+		if ( percent == NULL )
+		{
+			AppendLogText( msg, fmt, strlen( fmt ) );
+			break;
+		}
+		AppendLogText( msg, fmt, percent - fmt );
+
+		logConversion_t conv;
+		ParseLogConversion( percent, conv );
+		fmt = conv.End;
+		if ( conv.Type == LOG_ARG_NONE )
+		{
+			AppendLogText( msg, "%", 1 );
+			continue;
+		}
+
+		char spec[ASYNC_LOG_MAX_SPEC];
+		memcpy( spec, percent, conv.End - percent );
+		spec[conv.End - percent] = '\0';
+
+		int stars[2] = { 0, 0 };
+		for ( int i = 0; i < conv.NumStars; i++ )
+		{
+			stars[i] = ReadLogArg< int >( data );
+		}
+
+		switch ( conv.Type )
+		{
+			case LOG_ARG_INT:			AppendLogArg( msg, spec, stars, conv.NumStars, ReadLogArg< int >( data ) ); break;
+			case LOG_ARG_LONG:			AppendLogArg( msg, spec, stars, conv.NumStars, ReadLogArg< long >( data ) ); break;
+			case LOG_ARG_LONG_LONG:		AppendLogArg( msg, spec, stars, conv.NumStars, ReadLogArg< long long >( data ) ); break;
+			case LOG_ARG_INTMAX:		AppendLogArg( msg, spec, stars, conv.NumStars, ReadLogArg< intmax_t >( data ) ); break;
+			case LOG_ARG_SIZE:			AppendLogArg( msg, spec, stars, conv.NumStars, ReadLogArg< size_t >( data ) ); break;
+			case LOG_ARG_PTRDIFF:		AppendLogArg( msg, spec, stars, conv.NumStars, ReadLogArg< ptrdiff_t >( data ) ); break;
+			case LOG_ARG_DOUBLE:		AppendLogArg( msg, spec, stars, conv.NumStars, ReadLogArg< double >( data ) ); break;
+			case LOG_ARG_LONG_DOUBLE:	AppendLogArg( msg, spec, stars, conv.NumStars, ReadLogArg< long double >( data ) ); break;
+			case LOG_ARG_POINTER:		AppendLogArg( msg, spec, stars, conv.NumStars, ReadLogArg< const void * >( data ) ); break;
+			case LOG_ARG_STRING:
+			{
+				uint32_t length;
+				memcpy( &length, data, sizeof( length ) );
+				const char * string = ( length == ASYNC_LOG_NULL_STRING ) ? NULL : reinterpret_cast< const char * >( data + sizeof( length ) );
+				AppendLogArg( msg, spec, stars, conv.NumStars, string );
+				data += AlignLogSize( sizeof( length ) + ( string != NULL ? length : 0 ) + 1 );
+				break;
+			}
+			default:
+				break;
+		}
+	}
+
+	if ( record->Suppressed != 0 )
+	{
+		const int stars[2] = { 0, 0 };
+		AppendLogArg( msg, " (%u similar messages suppressed)", stars, 0, record->Suppressed );
+	}
+}
+
+static uint32_t DrainAsyncLogRing( asyncLogRing_t * ring, logMessage_t & msg )
+{
+	uint32_t written = 0;
+	const uint32_t head = LoadAcquire( &ring->Head );
+	uint32_t tail = ring->Tail;
+	while ( tail != head )
+	{
+		const asyncLogRecord_t * record = reinterpret_cast< const asyncLogRecord_t * >( ring->Buffer + ( tail & ( ring->Size - 1 ) ) );
+		if ( ( record->Flags & ASYNC_LOG_PADDING ) == 0 )
+		{
+			FormatAsyncLogRecord( record, msg );
+			if ( ( record->Flags & ASYNC_LOG_FILE_TAG ) != 0 )
+			{
+				char strippedTag[128];
+				FilePathToTag( record->Tag, strippedTag, sizeof( strippedTag ) );
+				__android_log_write( record->Prio, strippedTag, msg.Text );
+			}
+			else
+			{
+				__android_log_write( record->Prio, record->Tag, msg.Text );
+			}
+			written++;
+		}
+		tail += record->Size;
+	}
+	if ( tail != ring->Tail )
+	{
+		StoreRelease< uint32_t >( &ring->Tail, tail );
+	}
+
+	const uint32_t ringFull = ReadLogCounter( &ring->RingFull );
+	if ( ringFull != ring->ReportedRingFull )
+	{
+		__android_log_print( ANDROID_LOG_WARN, "AsyncLog", "%u messages dropped, the log ring buffer of a thread was full",
+				ringFull - ring->ReportedRingFull );
+		ring->ReportedRingFull = ringFull;
+	}
+	return written;
+}
+
+static void * AsyncLogThreadFunction( void * param )
+{
+	OVR_UNUSED( param );
+	pthread_setname_np( pthread_self(), "OVR::AsyncLog" );
+
+	logMessage_t msg = { NULL, 0, 0 };
+	if ( !GrowLogMessage( msg, 1024 ) )
+	{
+		return NULL;
+	}
+
+	// Poll the rings instead of having the producers signal. Keep draining while
+	// messages come in and back off while nothing is logged.
+	uint32_t sleepMicroseconds = ASYNC_LOG_MIN_SLEEP;
+	for ( ; ; )
+	{
+		const bool stopping = LoadAcquire( &AsyncLog.Stopping ) != 0;
+		__atomic_store_n( &AsyncLog.Second, GetLogSecond(), __ATOMIC_RELAXED );
+
+		uint32_t written = 0;
+		for ( asyncLogRing_t * ring = LoadAcquire( &AsyncLog.Rings ); ring != NULL; ring = ring->Next )
+		{
+			written += DrainAsyncLogRing( ring, msg );
+		}
+		__atomic_store_n( &AsyncLog.Written, AsyncLog.Written + written, __ATOMIC_RELAXED );
+
+		if ( written != 0 )
+		{
+			sleepMicroseconds = ASYNC_LOG_MIN_SLEEP;
+			continue;
+		}
+		if ( __atomic_exchange_n( &AsyncLog.FlushRequested, 0, __ATOMIC_RELAXED ) != 0 )
+		{
+			sleepMicroseconds = ASYNC_LOG_MIN_SLEEP;
+		}
+		else if ( stopping )
+		{
+			break;
+		}
+		else if ( sleepMicroseconds < ASYNC_LOG_MAX_SLEEP )
+		{
+			sleepMicroseconds *= 2;
+		}
+		usleep( sleepMicroseconds );
+	}
+
+	free( msg.Text );
+	return NULL;
+}
+
+bool StartAsyncLogging( const int ringSize, const int maxPerSecond )
+{
+	if ( LoadAcquire( &AsyncLog.Running ) != 0 )
+	{
+		return true;
+	}
+	// Rings that already exist keep their size.
+	uint32_t size = ASYNC_LOG_MIN_RING_SIZE;
+	while ( size < static_cast< uint32_t >( ringSize ) && size < 0x40000000 )
+	{
+		size <<= 1;
+	}
+	AsyncLog.RingSize = size;
+	AsyncLog.MaxPerSecond = ( maxPerSecond > 0 ) ? maxPerSecond : 0;
+	AsyncLog.Second = GetLogSecond();
+	AsyncLog.Stopping = 0;
+	if ( pthread_create( &AsyncLog.Thread, NULL, AsyncLogThreadFunction, NULL ) != 0 )
+	{
+		__android_log_print( ANDROID_LOG_WARN, "AsyncLog", "failed to create the log thread" );
+		return false;
+	}
+	StoreRelease< uint32_t >( &AsyncLog.Running, 1 );
+	return true;
+}
+
+void StopAsyncLogging()
+{
+	if ( LoadAcquire( &AsyncLog.Running ) == 0 )
+	{
+		return;
+	}
+	// New messages are written synchronously while the thread drains the rings. Messages
+	// that passed the Running check are queued before the thread is told to stop.
+	__atomic_store_n( &AsyncLog.Running, 0, __ATOMIC_SEQ_CST );
+	while ( __atomic_load_n( &AsyncLog.Producers, __ATOMIC_SEQ_CST ) != 0 )
+	{
+		usleep( 100 );
+	}
+	StoreRelease< uint32_t >( &AsyncLog.Stopping, 1 );
+	pthread_join( AsyncLog.Thread, NULL );
+}
+
+void FlushAsyncLogging()
+{
+	if ( LoadAcquire( &AsyncLog.Running ) == 0 )
+	{
+		return;
+	}
+	struct timespec start;
+	clock_gettime( CLOCK_MONOTONIC, &start );
+	for ( asyncLogRing_t * ring = LoadAcquire( &AsyncLog.Rings ); ring != NULL; ring = ring->Next )
+	{
+		if ( !WaitForAsyncLogRing( ring, LoadAcquire( &ring->Head ), start ) )
+		{
+			return;
+		}
+	}
+}
+
+void GetAsyncLogStats( asyncLogStats_t & stats )
+{
+	memset( &stats, 0, sizeof( stats ) );
+	for ( asyncLogRing_t * ring = LoadAcquire( &AsyncLog.Rings ); ring != NULL; ring = ring->Next )
+	{
+		stats.Queued += ReadLogCounter( &ring->Queued );
+		stats.RateLimited += ReadLogCounter( &ring->RateLimited );
+		stats.RingFull += ReadLogCounter( &ring->RingFull );
+	}
+	stats.Written = ReadLogCounter( &AsyncLog.Written );
+	stats.Synchronous = ReadLogCounter( &AsyncLog.Synchronous );
+}
+
+#else
+
+bool StartAsyncLogging( const int ringSize, const int maxPerSecond )
+{
+	OVR_UNUSED( ringSize );
+	OVR_UNUSED( maxPerSecond );
+	return false;
+}
+
+void StopAsyncLogging()
+{
+}
+
+void FlushAsyncLogging()
+{
+}
+
+void GetAsyncLogStats( asyncLogStats_t & stats )
+{
+	memset( &stats, 0, sizeof( stats ) );
+}
+
+#endif // OVR_OS_ANDROID
+
 // Log with an explicit tag
 void LogWithTag( const int prio, const char * tag, const char * fmt, ... )
 {
 #if defined( OVR_OS_ANDROID )
 	va_list ap;
 	va_start( ap, fmt );
-	__android_log_vprint( prio, tag, fmt, ap );
+	if ( !LogAsync( prio, tag, 0, fmt, ap ) )
+	{
+		__android_log_vprint( prio, tag, fmt, ap );
+	}
 	va_end( ap );
 #elif defined( OVR_OS_WIN32 )
 	OVR_UNUSED( tag );
@@ -76,14 +1003,20 @@ void LogWithFileTag( const int prio, const char * fileTag, const char * fmt, ...
 #if defined( OVR_OS_ANDROID )
 	va_list ap, ap2;
 
+	va_start( ap, fmt );
+
+	if ( LogAsync( prio, fileTag, ASYNC_LOG_FILE_TAG, fmt, ap ) )
+	{
+		va_end( ap );
+		return;
+	}
+
 	// fileTag will be something like "jni/App.cpp", which we
 	// want to strip down to just "App"
 	char strippedTag[128];
 
 	FilePathToTag( fileTag, strippedTag, sizeof( strippedTag ) );
 
-	va_start( ap, fmt );
-
 	// Calculate the length of the log message... if its too long __android_log_vprint() will clip it!
 	va_copy( ap2, ap );
 	const int loglen = vsnprintf( NULL, 0, fmt, ap2 );
@@ -22,6 +22,37 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 
 void FilePathToTag( const char * filePath, char * strippedTag, size_t const strippedTagSize );
 
+// Asynchronous logging.
+// While started, LogWithTag() and LogWithFileTag() only copy the format pointer and the
+// raw arguments into a lock-free ring buffer owned by the calling thread, and a background
+// thread formats and writes the messages. The format and tag strings are not copied, so
+// they must be string literals, as they are for all the LOG macros. %s arguments are copied.
+// Messages are written in order for each thread, but not across threads. Errors are
+// written on the calling thread once the queued messages have been flushed, and so are
+// messages with conversions that cannot be queued, like %n, and messages that do not fit
+// in the ring buffer. For those the calling thread sleeps until the background thread has
+// written its queued messages, for at most 100 milliseconds.
+// maxPerSecond limits how many messages a call site (format string) can log per second on
+// each thread. The number of suppressed messages is appended to the next message from
+// that call site. Zero disables the limit.
+// ringSize is the size of the ring buffer of each thread, and is rounded up to a power of two.
+bool StartAsyncLogging( const int ringSize, const int maxPerSecond );
+void StopAsyncLogging();
+
+// Waits until the messages queued so far have been written.
+void FlushAsyncLogging();
+
+struct asyncLogStats_t
+{
+	uint32_t	Queued;			// messages copied into a ring buffer
+	uint32_t	Written;		// messages written by the background thread
+	uint32_t	RateLimited;	// messages suppressed by the per call site limit
+	uint32_t	RingFull;		// messages dropped because the ring buffer of the thread was full
+	uint32_t	Synchronous;	// messages written on the calling thread while started
+};
+
+void GetAsyncLogStats( asyncLogStats_t & stats );
+
 #if defined( OVR_OS_WIN32 )		// allow this file to be included in PC projects
 
 // stub common functions for non-Android platforms
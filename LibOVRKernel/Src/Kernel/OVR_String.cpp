@@ -543,6 +543,34 @@ size_t String::BernsteinHashFunctionCIS(const void* pdataIn, size_t size, size_t
     return h;
 }
 
+// Hash function, one 64-bit word at a time
+size_t String::WordHashFunction(const void* pdataIn, size_t size, size_t seed)
+{
+    const uint8_t*  pdata   = (const uint8_t*) pdataIn;
+    const uint64_t  k       = 0x9E3779B97F4A7C15ULL;
+    uint64_t        h       = (uint64_t)seed ^ ((uint64_t)size * k);
+    uint64_t        w;
+
+    while (size >= sizeof(w))
+    {
+        memcpy(&w, pdata, sizeof(w));
+        h = (((h << 5) | (h >> 59)) ^ w) * k;
+        pdata += sizeof(w);
+        size  -= sizeof(w);
+    }
+    if (size > 0)
+    {
+        w = 0;
+        memcpy(&w, pdata, size);
+        h = (((h << 5) | (h >> 59)) ^ w) * k;
+    }
+
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    return (size_t)h;
+}
+
 
 
 // ***** String Buffer used for Building Strings
@@ -248,6 +248,10 @@ public:
     // Hash function, case-sensitive
     static size_t OVR_STDCALL BernsteinHashFunction(const void* pdataIn, size_t size, size_t seed = 5381);
 
+    // Hash function, case-sensitive, reads 8 bytes per step. Faster than
+    // BernsteinHashFunction on long keys such as paths and URIs.
+    static size_t OVR_STDCALL WordHashFunction(const void* pdataIn, size_t size, size_t seed = 5381);
+
     // Static factor for printf formats
     static String Format(const char* format, ...);
 
@@ -672,6 +672,15 @@ ThreadId GetCurrentThreadId()
 /* static */
 int Thread::GetCPUCount()
 {
+#if defined(_SC_NPROCESSORS_CONF)
+    // Count configured cores rather than online ones, since big.LITTLE
+    // devices take cores offline when idle
+    long count = sysconf(_SC_NPROCESSORS_CONF);
+    if (count > 0)
+    {
+        return (int)count;
+    }
+#endif
     return 1;
 }
 
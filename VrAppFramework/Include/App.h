@@ -97,6 +97,8 @@ struct ovrSettings
 	ovrTrackingTransform TrackingTransform;			// Default is VRAPI_TRACKING_TRANSFORM_SYSTEM_CENTER_FLOOR_LEVEL
 	ovrEyeBufferParms	EyeBufferParms;
 	ovrRenderMode		RenderMode;					// Default is RENDERMODE_STEREO.
+	bool				UseAsyncLogging;			// Queue LOG() output and write it on a background thread. Default is false.
+	int					AsyncLogMaxPerSecond;		// Messages per second each format string can log on a thread with async logging, 0 for no limit. Default is 0.
 #if defined( OVR_OS_WIN32 )
 	ovrWindowCreationParms	WindowParms;
 #endif
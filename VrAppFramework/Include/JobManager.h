@@ -16,11 +16,27 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include "Kernel/OVR_Array.h"
 #include "Kernel/OVR_Threads.h"
 
+#include <atomic>
+
 namespace OVR
 {
 
 class ovrJobManager;
+class ovrJobManagerImpl;
 class ovrJobThread;
+class ovrJobCompletionQueue;
+
+//==============================================================
+// ovrJobPriority
+// Workers always run the highest priority job available. Jobs of the same
+// priority run roughly in the order they were enqueued.
+enum ovrJobPriority
+{
+	JOB_PRIORITY_INTERACTIVE,	// the user is waiting on the result, e.g. the poster in view
+	JOB_PRIORITY_NORMAL,
+	JOB_PRIORITY_BACKGROUND,	// prefetching and other work nobody is waiting on yet
+	JOB_PRIORITY_MAX
+};
 
 //==============================================================
 // ovrJobThreadContext
@@ -50,21 +66,42 @@ class ovrJob
 {
 public:
 	friend class ovrJobThread;
+	friend class ovrJobManagerImpl;
+	friend class ovrJobCompletionQueue;
 
-	ovrJob( char const * name );
+	ovrJob( char const * name, ovrJobPriority const priority = JOB_PRIORITY_NORMAL );
 	virtual ~ovrJob() { }
 
 	threadReturn_t			DoWork( ovrJobThreadContext const & jtc );
 
 	char const *			GetName() const { return &Name[0]; }
+	ovrJobPriority			GetPriority() const { return Priority; }
 
 	virtual	uint32_t		GetTypeId() const = 0;
 
+	// Keeps this job from running until the prerequisite job has completed, whether or not
+	// it succeeded. This must be called before either job is enqueued. Once all of its
+	// prerequisites have completed, this job is scheduled on the worker that finished the
+	// last one.
+	void					AddDependency( ovrJob * prerequisite );
+
 private:
 	virtual threadReturn_t	DoWork_Impl( ovrJobThreadContext const & jtc ) = 0;
 
 private:
+	// link in the job manager's completed job queue
+	struct ovrCompletionLink
+	{
+		std::atomic< ovrCompletionLink * >	Next;
+		ovrJob *							Job;
+		bool								Succeeded;
+	};
+
 	char					Name[128];
+	ovrJobPriority			Priority;
+	std::atomic< int >		PendingDependencies;	// incomplete prerequisites, plus one until enqueued
+	OVR::Array< ovrJob * >	Dependents;				// jobs waiting on this one
+	ovrCompletionLink		CompletionLink;
 };
 
 //==============================================================
@@ -78,8 +115,8 @@ template< uint32_t TypeId >
 class ovrJobT : public ovrJob
 {
 public:
-	ovrJobT( char const * name ) 
-		: ovrJob( name )
+	ovrJobT( char const * name, ovrJobPriority const priority = JOB_PRIORITY_NORMAL )
+		: ovrJob( name, priority )
 	{
 	}
 
@@ -107,6 +144,32 @@ public:
 	bool		Succeeded;
 };
 
+//==============================================================
+// ovrJobManagerStats
+// Counters for the completed job queue and ServiceJobs().
+class ovrJobManagerStats
+{
+public:
+	ovrJobManagerStats()
+		: CompletedQueueDepth( 0 )
+		, PeakCompletedQueueDepth( 0 )
+		, ServiceCalls( 0 )
+		, BudgetLimitedCalls( 0 )
+		, JobsServiced( 0 )
+		, TotalServiceSeconds( 0.0 )
+		, MaxServiceSeconds( 0.0 )
+	{
+	}
+
+	int			CompletedQueueDepth;		// jobs completed but not yet returned by ServiceJobs()
+	int			PeakCompletedQueueDepth;
+	int64_t		ServiceCalls;
+	int64_t		BudgetLimitedCalls;			// calls that left completed jobs for the next call
+	int64_t		JobsServiced;
+	double		TotalServiceSeconds;		// only measured while a time budget is set
+	double		MaxServiceSeconds;
+};
+
 //==============================================================
 // ovrJobManager
 class ovrJobManager
@@ -122,8 +185,17 @@ public:
 
 	virtual void	EnqueueJob( ovrJob * job ) = 0;
 
+	// Appends jobs that have completed since the last call. This never blocks on a job thread.
 	virtual void	ServiceJobs( OVR::Array< ovrJobResult > & finishedJobs ) = 0;
 
+	// Limits the work done by each ServiceJobs() call so a burst of completions can't stall
+	// a frame. Jobs over the budget are returned by the next call. Zero means no limit for
+	// either value, which is the default.
+	virtual void	SetServiceBudget( int const maxJobs, double const maxSeconds ) = 0;
+
+	// Must be called from the thread that calls ServiceJobs().
+	virtual void	GetStats( ovrJobManagerStats & stats ) const = 0;
+
 	virtual bool 	IsExiting() const = 0;
 };
 
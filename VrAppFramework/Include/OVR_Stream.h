@@ -14,6 +14,7 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 
 #include "Kernel/OVR_String.h"
 #include "Kernel/OVR_MemBuffer.h"
+#include "Kernel/OVR_JSON.h"
 
 namespace OVR {
 
@@ -97,6 +98,26 @@ private:
 	ovrStream &				operator = ( ovrStream & rhs );
 };
 
+//==============================================================
+// ovrStreamJsonSource
+// Feeds an open ovrStream to a JsonPullParser in chunks. Streams that cannot
+// read part of a file, such as apk streams, have to be read with ReadFile()
+// and parsed from memory instead.
+class ovrStreamJsonSource : public JsonPullSource
+{
+public:
+	explicit				ovrStreamJsonSource( ovrStream & stream ) : Stream( stream ) {}
+
+	virtual size_t			Read( void * buffer, size_t bytes );
+
+private:
+	ovrStream &				Stream;
+	MemBufferT< uint8_t >	Chunk;
+
+	// Private assignment operator to prevent copying.
+	ovrStreamJsonSource &	operator = ( ovrStreamJsonSource & rhs );
+};
+
 } // namespace OVR
 
 #endif // OVR_FILE_H
@@ -252,6 +252,10 @@ AppLocal::AppLocal( JNIEnv & jni_, jobject activityObject_, VrAppInterface & int
 	VrSettings.TrackingTransform = VRAPI_TRACKING_TRANSFORM_SYSTEM_CENTER_FLOOR_LEVEL;
 	VrSettings.RenderMode = RENDERMODE_STEREO;
 
+	// Default logging settings.
+	VrSettings.UseAsyncLogging = false;
+	VrSettings.AsyncLogMaxPerSecond = 0;
+
 	// Default ovrModeParms
 	VrSettings.ModeParms = vrapi_DefaultModeParms( &Java );
 	VrSettings.ModeParms.Flags |= VRAPI_MODE_FLAG_ALLOW_POWER_SAVE;
@@ -888,6 +892,9 @@ void AppLocal::LeaveVrMode()
 	OvrMobile = NULL;
 }
 
+// With ovrSettings::UseAsyncLogging, each thread that logs gets a ring buffer of this size.
+static const int ASYNC_LOG_RING_SIZE = 64 * 1024;
+
 void AppLocal::Configure()
 {
 	LOG( "AppLocal::Configure()" );
@@ -910,6 +917,16 @@ void AppLocal::Configure()
 	// Make sure the app didn't mess up the Java pointers.
 	VrSettings.ModeParms.Java = Java;
 
+	// Keep log formatting and writing off the VR thread if the app asked for it.
+	if ( VrSettings.UseAsyncLogging )
+	{
+		StartAsyncLogging( ASYNC_LOG_RING_SIZE, VrSettings.AsyncLogMaxPerSecond );
+	}
+	else
+	{
+		StopAsyncLogging();
+	}
+
 	// FIXME: have apps set these flags directly.
 
 	if ( VrSettings.UseProtectedFramebuffer )
@@ -1107,6 +1124,44 @@ static void GetInputEvents( ovrInputEvents & inputEvents )
 }
 #endif
 
+// Size of the frame allocator arena used by the VR thread; half of it is
+// available to each frame.
+static const size_t FRAME_ALLOCATOR_SIZE = 1024 * 1024;
+
+
+/*
+ * PrintAllocatorStats
+ *
+ * Console command that logs the counters of every allocator tag.
+ */
+static void PrintAllocatorStats( void * appPtr, const char * cmd )
+{
+	OVR_UNUSED( appPtr );
+	OVR_UNUSED( cmd );
+	LOG( "frame %u", FrameAllocator::GetFrameIndex() );
+	for ( const AllocatorStats * stats = AllocatorStats::GetFirst(); stats != NULL; stats = stats->GetNext() )
+	{
+		LOG( "%-20s bytes %9zu peak %9zu allocs %9zu frees %9zu fallbacks %7zu",
+				stats->GetTag(), stats->GetBytes(), stats->GetPeakBytes(),
+				stats->GetAllocCount(), stats->GetFreeCount(), stats->GetFallbackCount() );
+	}
+}
+
+/*
+ * PrintLogStats
+ *
+ * Console command that logs the counters of the asynchronous logging.
+ */
+static void PrintLogStats( void * appPtr, const char * cmd )
+{
+	OVR_UNUSED( appPtr );
+	OVR_UNUSED( cmd );
+	asyncLogStats_t stats;
+	GetAsyncLogStats( stats );
+	LOG( "queued %u written %u rate limited %u ring full %u synchronous %u",
+			stats.Queued, stats.Written, stats.RateLimited, stats.RingFull, stats.Synchronous );
+}
+
 /*
  * VrThreadFunction
  *
@@ -1168,6 +1223,11 @@ void * AppLocal::VrThreadFunction()
 		// Init the adb 'console' and register console functions
 		InitConsole( Java );
 		RegisterConsoleFunction( "print", OVR::DebugPrint );
+		RegisterConsoleFunction( "allocStats", PrintAllocatorStats );
+		RegisterConsoleFunction( "logStats", PrintLogStats );
+
+		// Transient per-frame data such as font vertex blocks is allocated from the frame allocator.
+		FrameAllocator::Init( FRAME_ALLOCATOR_SIZE );
 	}
 
 	while( !( VrThreadSynced && ReadyToExit ) )
@@ -1226,6 +1286,9 @@ void * AppLocal::VrThreadFunction()
 		}
 #endif
 
+		// Release the frame memory of two frames ago.
+		FrameAllocator::BeginFrame();
+
 		{
 			OVR_PERF_TIMER( VrThreadFunction_Loop_AdvanceVrFrame );
 			// Update ovrFrameInput.
@@ -1306,6 +1369,9 @@ void * AppLocal::VrThreadFunction()
 
 		ShutdownGlObjects();
 
+		// All frame memory has been released with the app and its GUI.
+		FrameAllocator::Shutdown();
+
 		ShutdownConsole( Java );
 
 		ShutdownInput();
@@ -1330,6 +1396,9 @@ void * AppLocal::VrThreadFunction()
 		Java.Env = NULL;
 
 		LOG( "AppLocal::VrThreadFunction - exit" );
+
+		// Write out everything that is still queued; other threads log synchronously from here on.
+		StopAsyncLogging();
 	}
 
 	return &ExitCode;
@@ -397,10 +397,15 @@ static bool CheckForFormatEscape( char const **buffer, uint32_t & color, uint32_
 }
 
 
+OVR_ALLOCATOR_TAG( FontVertexTag, "FontVertices" );
+OVR_ALLOCATOR_TAG( FontVertexBlockTag, "FontVertexBlocks" );
+
 // The vertices in a vertex block are in local space and pre-scaled.  They are transformed into
 // world space and stuffed into the VBO before rendering (once the current MVP is known).
 // The vertices can be pivoted around the Pivot point to face the camera, then an additional
 // rotation applied.
+// The vertices are allocated from the frame allocator, so a vertex block must be consumed
+// by BitmapFontSurface::Finish() no later than on the frame after it was drawn.
 class VertexBlockType
 {
 public:
@@ -408,6 +413,7 @@ public:
 		Font( NULL ),
 		Verts( NULL ),
 		NumVerts( 0 ),
+		FrameIndex( 0 ),
 		Pivot( 0.0f ),
 		Rotation(),
 		Billboard( true ),
@@ -419,6 +425,7 @@ public:
 		Font( NULL ),
 		Verts( NULL ),
 		NumVerts( 0 ),
+		FrameIndex( 0 ),
 		Pivot( 0.0f ),
 		Rotation(),
 		Billboard( true ),
@@ -439,10 +446,11 @@ public:
 		{
 			return;
 		}
-		delete [] Verts;
+		Free();
 		Font		= other.Font;
 		Verts		= other.Verts;
 		NumVerts	= other.NumVerts;
+		FrameIndex	= other.FrameIndex;
 		Pivot		= other.Pivot;
 		Rotation	= other.Rotation;
 		Billboard	= other.Billboard;
@@ -457,12 +465,14 @@ public:
 			Quatf const & rot, bool const billboard, bool const trackRoll ) :
 		Font( &font ),
 		NumVerts( numVerts ),
+		FrameIndex( FrameAllocator::GetFrameIndex() ),
 		Pivot( pivot ),
 		Rotation( rot ),
 		Billboard( billboard ),
 		TrackRoll( trackRoll )
 	{
-		Verts = new fontVertex_t[numVerts];
+		Verts = static_cast< fontVertex_t * >( FrameAllocator::Alloc( numVerts * sizeof( fontVertex_t ), FontVertexTag::GetStats() ) );
+		ConstructArray< fontVertex_t >( Verts, numVerts );
 	}
 
 	~VertexBlockType()
@@ -472,15 +482,30 @@ public:
 
 	void Free()
 	{
+		if ( Verts != NULL && !IsExpired() )
+		{
+			FrameAllocator::Free( Verts, FontVertexTag::GetStats() );
+		}
+		else if ( Verts != NULL )
+		{
+			// Frame memory of a block that was kept for too long has been reused already,
+			// so only the stats are settled.
+			FontVertexTag::GetStats().OnFree( NumVerts * sizeof( fontVertex_t ) );
+		}
 		Font = NULL;
-		delete [] Verts;
 		Verts = NULL;
 		NumVerts = 0;
 	}
 
+	bool IsExpired() const
+	{
+		return FrameAllocator::Owns( Verts ) && FrameAllocator::GetFrameIndex() - FrameIndex > 1;
+	}
+
 	mutable BitmapFont const *	Font;		// the font used to render text into this vertex block
 	mutable fontVertex_t *		Verts;		// the vertices
 	mutable int					NumVerts;	// the number of vertices in the block
+	mutable uint32_t			FrameIndex;	// frame allocator frame the vertices were allocated in
 	Vector3f					Pivot;		// postion this vertex block can be rotated around
 	Quatf						Rotation;	// additional rotation to apply
 	bool						Billboard;	// true to always face the camera
@@ -910,7 +935,8 @@ private:
 	int             CurIndex;   // reset every Render()
 	bool			Initialized;
 
-	Array< VertexBlockType >	    VertexBlocks;	// each pointer in the array points to an allocated block ov
+	Array< VertexBlockType, ArrayDefaultPolicy,
+			ContainerAllocator_Pool< VertexBlockType, FontVertexBlockTag > >	VertexBlocks;	// each pointer in the array points to an allocated block ov
 };
 
 //==================================================================================================
@@ -937,15 +963,100 @@ bool FontInfoType::Load( ovrFileSys & fileSys, char const * uri )
 	return result;
 }
 
+//==============================
+// ReadFontNumber
+// Reads the value of the current JSON member as a number. Other values are
+// skipped and read as defaultValue.
+static double ReadFontNumber( JsonPullParser & json, double const defaultValue = 0.0 )
+{
+	json.Next();
+	if ( json.GetToken() == JsonToken_Number )
+	{
+		return json.GetNumber();
+	}
+	json.SkipValue();
+	return defaultValue;
+}
+
+//==============================
+// ReadFontString
+static String ReadFontString( JsonPullParser & json )
+{
+	json.Next();
+	if ( json.GetToken() == JsonToken_String )
+	{
+		return String( json.GetString(), json.GetStringLength() );
+	}
+	json.SkipValue();
+	return String( "" );
+}
+
+//==============================
+// ReadFontGlyph
+// Reads the unscaled metrics of one element of the glyph table.
+static void ReadFontGlyph( JsonPullParser & json, FontGlyphType & g )
+{
+	if ( json.GetToken() != JsonToken_BeginObject )
+	{
+		json.SkipValue();
+		return;
+	}
+	while ( json.Next() == JsonToken_Name )
+	{
+		if ( json.IsName( "CharCode" ) )
+		{
+			g.CharCode = static_cast< int32_t >( ReadFontNumber( json ) );
+		}
+		else if ( json.IsName( "X" ) )
+		{
+			g.X = static_cast< float >( ReadFontNumber( json ) );
+		}
+		else if ( json.IsName( "Y" ) )
+		{
+			g.Y = static_cast< float >( ReadFontNumber( json ) );
+		}
+		else if ( json.IsName( "Width" ) )
+		{
+			g.Width = static_cast< float >( ReadFontNumber( json ) );
+		}
+		else if ( json.IsName( "Height" ) )
+		{
+			g.Height = static_cast< float >( ReadFontNumber( json ) );
+		}
+		else if ( json.IsName( "AdvanceX" ) )
+		{
+			g.AdvanceX = static_cast< float >( ReadFontNumber( json ) );
+		}
+		else if ( json.IsName( "AdvanceY" ) )
+		{
+			g.AdvanceY = static_cast< float >( ReadFontNumber( json ) );
+		}
+		else if ( json.IsName( "BearingX" ) )
+		{
+			g.BearingX = static_cast< float >( ReadFontNumber( json ) );
+		}
+		else if ( json.IsName( "BearingY" ) )
+		{
+			g.BearingY = static_cast< float >( ReadFontNumber( json ) );
+		}
+		else
+		{
+			json.SkipValue();
+		}
+	}
+}
+
 //==============================
 // FontInfoType::LoadFromBuffer
+// The font is read with a pull parser so the glyph table is never held as a
+// JSON tree. Members may appear in any order, so the glyphs are scaled after
+// the whole file has been read.
 bool FontInfoType::LoadFromBuffer( void const * buffer, size_t const bufferSize )
 {
-	char const * errorMsg = NULL;
-	OVR::JSON * jsonRoot = OVR::JSON::Parse( reinterpret_cast< char const * >( buffer ), &errorMsg );
-	if ( jsonRoot == NULL )
+	JsonPullParser json( buffer, bufferSize );
+	if ( json.Next() != JsonToken_BeginObject )
 	{
-		WARN( "JSON Error: %s", ( errorMsg != NULL ) ? errorMsg : "<NULL>" );
+		WARN( "JSON Error: %s", ( json.GetToken() == JsonToken_Error ) ? json.GetError() : "font is not an object" );
 		return false;
 	}
 
@@ -956,46 +1067,146 @@ bool FontInfoType::LoadFromBuffer( void const * buffer, size_t const bufferSize
 	// the first 65K and hashes for the other, less-frequently-used characters.
 	static const int MAX_GLYPHS = 0xffff;
 
-	// load the glyphs
-	const JsonReader jsonGlyphs( jsonRoot );
-	if ( !jsonGlyphs.IsObject() )
+	// JSON doesn't have ints so cast from float to an int
+	int Version = 0;
+	int numGlyphs = 0;
+	FontName = "";
+	CommandLine = "";
+	ImageFileName = "";
+	NaturalWidth = 0.0f;
+	NaturalHeight = 0.0f;
+	HorizontalPad = 0.0f;
+	VerticalPad = 0.0f;
+	FontHeight = 0.0f;
+	CenterOffset = 0.0f;
+	TweakScale = 1.0f;
+	EdgeWidth = 32.0f;
+
+	while ( json.Next() == JsonToken_Name )
+	{
+		if ( json.IsName( "Version" ) )
+		{
+			Version = static_cast< int >( ReadFontNumber( json ) );
+		}
+		else if ( json.IsName( "FontName" ) )
+		{
+			FontName = ReadFontString( json );
+		}
+		else if ( json.IsName( "CommandLine" ) )
+		{
+			CommandLine = ReadFontString( json );
+		}
+		else if ( json.IsName( "ImageFileName" ) )
+		{
+			ImageFileName = ReadFontString( json );
+		}
+		else if ( json.IsName( "NumGlyphs" ) )
+		{
+			numGlyphs = static_cast< int >( ReadFontNumber( json ) );
+			if ( numGlyphs > 0 && numGlyphs <= MAX_GLYPHS )
+			{
+				Glyphs.Reserve( numGlyphs );
+			}
+		}
+		else if ( json.IsName( "NaturalWidth" ) )
+		{
+			NaturalWidth = static_cast< float >( ReadFontNumber( json ) );
+		}
+		else if ( json.IsName( "NaturalHeight" ) )
+		{
+			NaturalHeight = static_cast< float >( ReadFontNumber( json ) );
+		}
+		else if ( json.IsName( "HorizontalPad" ) )
+		{
+			HorizontalPad = static_cast< float >( ReadFontNumber( json ) );
+		}
+		else if ( json.IsName( "VerticalPad" ) )
+		{
+			VerticalPad = static_cast< float >( ReadFontNumber( json ) );
+		}
+		else if ( json.IsName( "FontHeight" ) )
+		{
+			FontHeight = static_cast< float >( ReadFontNumber( json ) );
+		}
+		else if ( json.IsName( "CenterOffset" ) )
+		{
+			CenterOffset = static_cast< float >( ReadFontNumber( json ) );
+		}
+		else if ( json.IsName( "TweakScale" ) )
+		{
+			TweakScale = static_cast< float >( ReadFontNumber( json, 1.0 ) );
+		}
+		else if ( json.IsName( "EdgeWidth" ) )
+		{
+			EdgeWidth = static_cast< float >( ReadFontNumber( json, 32.0 ) );
+		}
+		else if ( json.IsName( "Weights" ) && json.Next() == JsonToken_BeginArray )
+		{
+			while ( json.Next() != JsonToken_EndArray && json.GetToken() != JsonToken_Error )
+			{
+				if ( json.GetToken() != JsonToken_BeginObject )
+				{
+					json.SkipValue();
+					continue;
+				}
+				ovrFontWeight w;
+				while ( json.Next() == JsonToken_Name )
+				{
+					if ( json.IsName( "AlphaCenterOffset" ) )
+					{
+						w.AlphaCenterOffset = static_cast< float >( ReadFontNumber( json ) );
+					}
+					else if ( json.IsName( "ColorCenterOffset" ) )
+					{
+						w.ColorCenterOffset = static_cast< float >( ReadFontNumber( json ) );
+					}
+					else
+					{
+						json.SkipValue();
+					}
+				}
+				FontWeights.PushBack( w );
+			}
+		}
+		else if ( json.IsName( "Glyphs" ) && json.Next() == JsonToken_BeginArray )
+		{
+			while ( json.Next() != JsonToken_EndArray && json.GetToken() != JsonToken_Error )
+			{
+				FontGlyphType g;
+				ReadFontGlyph( json, g );
+				Glyphs.PushBack( g );
+			}
+		}
+		else
+		{
+			json.SkipValue();
+		}
+	}
+
+	if ( json.GetToken() != JsonToken_EndObject )
 	{
-		jsonRoot->Release();
+		WARN( "JSON Error: %s", ( json.GetToken() == JsonToken_Error ) ? json.GetError() : "<NULL>" );
 		return false;
 	}
 
-	// JSON doesn't have ints so cast from float to an int
-	int Version = static_cast<int>( jsonGlyphs.GetChildFloatByName( "Version" ) );
 	if ( Version != FNT_FILE_VERSION )
 	{
-		jsonRoot->Release();
 		return false;
 	}
 
-	FontName = jsonGlyphs.GetChildStringByName( "FontName" );
-	CommandLine = jsonGlyphs.GetChildStringByName( "CommandLine" );
-	ImageFileName = jsonGlyphs.GetChildStringByName( "ImageFileName" );
-	const int numGlyphs = jsonGlyphs.GetChildInt32ByName( "NumGlyphs" );
 	if ( numGlyphs < 0 || numGlyphs > MAX_GLYPHS )
 	{
 		OVR_ASSERT( numGlyphs > 0 && numGlyphs <= MAX_GLYPHS );
-		jsonRoot->Release();
 		return false;
 	}
 
-	NaturalWidth = jsonGlyphs.GetChildFloatByName( "NaturalWidth" );
-	NaturalHeight = jsonGlyphs.GetChildFloatByName( "NaturalHeight" );
-
 	// we scale everything after loading integer values from the JSON file because the OVR JSON writer loses precision on floats
 	float nwScale = 1.0f / NaturalWidth;
 	float nhScale = 1.0f / NaturalHeight;
 
-	HorizontalPad = jsonGlyphs.GetChildFloatByName( "HorizontalPad" ) * nwScale;
-	VerticalPad = jsonGlyphs.GetChildFloatByName( "VerticalPad" ) * nhScale;
-	FontHeight = jsonGlyphs.GetChildFloatByName( "FontHeight" ) * nhScale;
-	CenterOffset = jsonGlyphs.GetChildFloatByName( "CenterOffset" );
-	TweakScale = jsonGlyphs.GetChildFloatByName( "TweakScale", 1.0f );
-	EdgeWidth = jsonGlyphs.GetChildFloatByName( "EdgeWidth", 32.0f );
+	HorizontalPad *= nwScale;
+	VerticalPad *= nhScale;
+	FontHeight *= nhScale;
 
 #if defined( OVR_BUILD_DEBUG )
 	LOG( "FontName = %s", FontName.ToCStr() );
@@ -1019,75 +1230,44 @@ bool FontInfoType::LoadFromBuffer( void const * buffer, size_t const bufferSize
 	}
 /// HACK: end hack
 
-	const JsonReader jsonWeightArray( jsonGlyphs.GetChildByName( "Weights" ) );
-	if ( jsonWeightArray.IsValid() )
-	{
-		for ( int i = 0; !jsonWeightArray.IsEndOfArray(); ++i )
-		{
-			const JsonReader jsonWeight( jsonWeightArray.GetNextArrayElement() );
-			if ( jsonWeight.IsObject() )
-			{
-				ovrFontWeight w;
-				w.AlphaCenterOffset = jsonWeight.GetChildFloatByName( "AlphaCenterOffset" );
-				w.ColorCenterOffset = jsonWeight.GetChildFloatByName( "ColorCenterOffset" );
-				FontWeights.PushBack( w );
-			}
-		}
-	}
-
+	// Only the first NumGlyphs entries of the glyph table are used.
+	const int numRead = Glyphs.GetSizeI();
 	Glyphs.Resize( numGlyphs );
-	const JsonReader jsonGlyphArray( jsonGlyphs.GetChildByName( "Glyphs" ) );
 
 	double oWidth = 0.0;
 	double oHeight = 0.0;
 
-	if ( jsonGlyphArray.IsArray() )
+	for ( int i = 0; i < Glyphs.GetSizeI() && i < numRead; i++ )
 	{
-		for ( int i = 0; i < Glyphs.GetSizeI() && !jsonGlyphArray.IsEndOfArray(); i++ )
-		{
-			const JsonReader jsonGlyph( jsonGlyphArray.GetNextArrayElement() );
-			if ( jsonGlyph.IsObject() )
-			{
-				FontGlyphType & g = Glyphs[i];
-				g.CharCode	= jsonGlyph.GetChildInt32ByName( "CharCode" );
-				g.X			= jsonGlyph.GetChildFloatByName( "X" );
-				g.Y			= jsonGlyph.GetChildFloatByName( "Y" );
-				g.Width		= jsonGlyph.GetChildFloatByName( "Width" );
-				g.Height	= jsonGlyph.GetChildFloatByName( "Height" );
-				g.AdvanceX	= jsonGlyph.GetChildFloatByName( "AdvanceX" );
-				g.AdvanceY	= jsonGlyph.GetChildFloatByName( "AdvanceY" );
-				g.BearingX	= jsonGlyph.GetChildFloatByName( "BearingX" );
-				g.BearingY	= jsonGlyph.GetChildFloatByName( "BearingY" );
-
-				if ( g.CharCode == 'O' )
-				{
-					oWidth = g.Width;
-					oHeight = g.Height;
-				}
+		FontGlyphType & g = Glyphs[i];
 
-				g.X *= nwScale;
-				g.Y *= nhScale;
-				g.Width *= nwScale;
-				g.Height *= nhScale;
-				g.AdvanceX *= nwScale;
-				g.AdvanceY *= nhScale;
-				g.BearingX *= nwScale;
-				g.BearingY *= nhScale;
-
-				float const ascent = g.BearingY;
-				float const descent = g.Height - g.BearingY;
-				if ( ascent > MaxAscent )
-				{
-					MaxAscent = ascent;
-				}
-				if ( descent > MaxDescent )
-				{
-					MaxDescent = descent;
-				}
+		if ( g.CharCode == 'O' )
+		{
+			oWidth = g.Width;
+			oHeight = g.Height;
+		}
 
-				maxCharCode = Alg::Max( maxCharCode, g.CharCode );
-			}
+		g.X *= nwScale;
+		g.Y *= nhScale;
+		g.Width *= nwScale;
+		g.Height *= nhScale;
+		g.AdvanceX *= nwScale;
+		g.AdvanceY *= nhScale;
+		g.BearingX *= nwScale;
+		g.BearingY *= nhScale;
+
+		float const ascent = g.BearingY;
+		float const descent = g.Height - g.BearingY;
+		if ( ascent > MaxAscent )
+		{
+			MaxAscent = ascent;
+		}
+		if ( descent > MaxDescent )
+		{
+			MaxDescent = descent;
 		}
+
+		maxCharCode = Alg::Max( maxCharCode, g.CharCode );
 	}
 
 	float const DEFAULT_TEXT_SCALE = 0.0025f;
@@ -1126,8 +1306,6 @@ bool FontInfoType::LoadFromBuffer( void const * buffer, size_t const bufferSize
 		CharCodeMap[g.CharCode] = i;
 	}
 
-	jsonRoot->Release();
-
 	return true;
 }
 
@@ -2105,6 +2283,12 @@ void BitmapFontSurfaceLocal::Finish( Matrix4f const & viewMatrix )
 	for ( int i = 0; i < VertexBlocks.GetSizeI(); ++i )
 	{
 		VertexBlockType & vb = VertexBlocks[vbSort[i].VertexBlockIndex];
+		if ( vb.IsExpired() )
+		{
+			WARN( "BitmapFontSurfaceLocal::Finish: dropping text drawn more than one frame ago" );
+			vb.Free();
+			continue;
+		}
 		Matrix4f transform;
 		if ( vb.Billboard )
 		{
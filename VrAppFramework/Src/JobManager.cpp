@@ -12,110 +12,333 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include "JobManager.h"
 
 #include "Android/JniUtils.h"
+#include "Kernel/OVR_Alg.h"
 #include "Kernel/OVR_LogUtils.h"
 #include "Kernel/OVR_Signal.h"
 #include <ctime>
 #include "ScopedMutex.h"
+#include "SystemClock.h"
+#include "OVR_PerfTimer.h"
 
 namespace OVR {
 
+OVR_PERF_ACCUMULATOR( ovrJobManager_ServiceJobs );
+
 //==============================================================================================
-// ovrMPMCArray
+// ovrJobCompletionQueue
 //==============================================================================================
 
 //==============================================================
-// ovrMPMCArray
+// ovrJobCompletionQueue
 //
-// Multiple-producer, multiple-consumer array.
-// Currently implemented with a mutex.
-
-template< typename T >
-class ovrMPMCArray
+// Multiple-producer, single-consumer queue of completed jobs (Vyukov's
+// intrusive MPSC queue), linked through the jobs themselves so completing a
+// job never allocates. Pushing is a single exchange. Popping never waits: if
+// a job thread is midway through a push, Pop() just returns nothing until
+// the next call.
+class ovrJobCompletionQueue
 {
 public:
-	ovrMPMCArray() { }
-	~ovrMPMCArray() { }
-
-	T 			Pop();
-	void		PushBack( T const & value );
-	void		RemoveAt( size_t const index );
-	void		RemoveAtUnordered( size_t const index );
-	T const 	operator[] ( int const index ) const;
-	T 			operator[] ( int const index );
-	void		Clear();
-	void		MoveArray( OVR::Array< T > & a );
+	ovrJobCompletionQueue()
+		: Head( &Stub )
+		, Depth( 0 )
+		, PeakDepth( 0 )
+		, Tail( &Stub )
+	{
+		Stub.Next.store( nullptr, std::memory_order_relaxed );
+		Stub.Job = nullptr;
+		Stub.Succeeded = false;
+	}
+
+	// any thread
+	void		Push( ovrJob * job, bool const succeeded );
+
+	// consumer thread only
+	ovrJob *	Pop( bool & succeeded );
+
+	int			GetDepth() const { return Depth.load( std::memory_order_relaxed ); }
+	int			GetPeakDepth() const { return PeakDepth.load( std::memory_order_relaxed ); }
 
 private:
-	OVR::Array< T >	A;
-	OVR::Mutex		ThisMutex;
+	typedef ovrJob::ovrCompletionLink	ovrLink;
+
+	void		PushLink( ovrLink * link );
+
+	std::atomic< ovrLink * >	Head;		// most recently pushed
+	std::atomic< int >			Depth;
+	std::atomic< int >			PeakDepth;
+	char						Pad[64];	// keep producers off the consumer's cache line
+	ovrLink *					Tail;		// owned by the consumer, oldest
+	ovrLink						Stub;
 };
 
-template< typename T >
-T ovrMPMCArray< T >::Pop()
+void ovrJobCompletionQueue::PushLink( ovrLink * link )
 {
-	ovrScopedMutex mutex( ThisMutex );
-	if ( A.GetSizeI() <= 0 )
+	link->Next.store( nullptr, std::memory_order_relaxed );
+	ovrLink * prev = Head.exchange( link, std::memory_order_acq_rel );
+	prev->Next.store( link, std::memory_order_release );
+}
+
+void ovrJobCompletionQueue::Push( ovrJob * job, bool const succeeded )
+{
+	ovrLink * link = &job->CompletionLink;
+	link->Succeeded = succeeded;
+	PushLink( link );
+
+	int const depth = Depth.fetch_add( 1, std::memory_order_relaxed ) + 1;
+	int peak = PeakDepth.load( std::memory_order_relaxed );
+	while ( depth > peak && !PeakDepth.compare_exchange_weak( peak, depth, std::memory_order_relaxed ) )
 	{
-		return nullptr;
 	}
-	return A.Pop();
 }
 
-template< typename T >
-void ovrMPMCArray< T >::PushBack( T const & value )
+ovrJob * ovrJobCompletionQueue::Pop( bool & succeeded )
 {
-	ovrScopedMutex mutex( ThisMutex );
-	A.PushBack( value );
+	ovrLink * tail = Tail;
+	ovrLink * next = tail->Next.load( std::memory_order_acquire );
+	if ( tail == &Stub )
+	{
+		if ( next == nullptr )
+		{
+			return nullptr;
+		}
+		Tail = next;
+		tail = next;
+		next = next->Next.load( std::memory_order_acquire );
+	}
+
+	if ( next == nullptr )
+	{
+		if ( tail != Head.load( std::memory_order_acquire ) )
+		{
+			// a push is in progress
+			return nullptr;
+		}
+		// the stub goes back in behind the last job so the last job can be taken
+		PushLink( &Stub );
+		next = tail->Next.load( std::memory_order_acquire );
+		if ( next == nullptr )
+		{
+			return nullptr;
+		}
+	}
+
+	Tail = next;
+	Depth.fetch_sub( 1, std::memory_order_relaxed );
+	succeeded = tail->Succeeded;
+	return tail->Job;
 }
 
-template< typename T >
-void ovrMPMCArray< T >::RemoveAt( size_t const index )
+//==============================================================================================
+// ovrWorkStealingDeque
+//==============================================================================================
+
+//==============================================================
+// ovrWorkStealingDeque
+//
+// Chase-Lev work-stealing deque. Only the owning thread may Push() and Pop(),
+// which work on the bottom end so the owner runs its newest job first while
+// the cache is still warm. Any thread may Steal() the oldest job from the top.
+// The ring grows when full; replaced rings are kept until destruction because
+// a thief may still be reading from one.
+class ovrWorkStealingDeque
+{
+public:
+	ovrWorkStealingDeque();
+	~ovrWorkStealingDeque();
+
+	void		Push( ovrJob * job );
+	ovrJob *	Pop();
+	ovrJob *	Steal();
+	bool		IsEmpty() const;
+
+private:
+	static const int64_t	INITIAL_CAPACITY = 256;
+
+	struct ovrRing
+	{
+		ovrRing( int64_t const capacity )
+			: Mask( capacity - 1 )
+			, Slots( new std::atomic< ovrJob * >[capacity] )
+		{
+		}
+		~ovrRing() { delete [] Slots; }
+
+		ovrJob *	Get( int64_t const i ) const { return Slots[i & Mask].load( std::memory_order_relaxed ); }
+		void		Put( int64_t const i, ovrJob * job ) { Slots[i & Mask].store( job, std::memory_order_relaxed ); }
+
+		int64_t						Mask;
+		std::atomic< ovrJob * > *	Slots;
+	};
+
+	ovrWorkStealingDeque( ovrWorkStealingDeque const & ) = delete;
+	ovrWorkStealingDeque & operator = ( ovrWorkStealingDeque const & ) = delete;
+
+	std::atomic< int64_t >		Top;
+	char						Pad[64 - sizeof( std::atomic< int64_t > )];	// keep thieves off the owner's cache line
+	std::atomic< int64_t >		Bottom;
+	std::atomic< ovrRing * >	Ring;
+	OVR::Array< ovrRing * >		RetiredRings;
+};
+
+ovrWorkStealingDeque::ovrWorkStealingDeque()
+	: Top( 0 )
+	, Bottom( 0 )
+	, Ring( new ovrRing( INITIAL_CAPACITY ) )
 {
-	ovrScopedMutex mutex( ThisMutex );
-	return A.RemoveAt( index );
 }
 
-template< typename T >
-void ovrMPMCArray< T >::RemoveAtUnordered( size_t const index )
+ovrWorkStealingDeque::~ovrWorkStealingDeque()
 {
-	ovrScopedMutex mutex( ThisMutex );
-	return A.RemoveAtUnordered( index );
+	delete Ring.load( std::memory_order_relaxed );
+	for ( int i = 0; i < RetiredRings.GetSizeI(); ++i )
+	{
+		delete RetiredRings[i];
+	}
+}
+
+void ovrWorkStealingDeque::Push( ovrJob * job )
+{
+	int64_t const b = Bottom.load( std::memory_order_relaxed );
+	int64_t const t = Top.load( std::memory_order_acquire );
+	ovrRing * ring = Ring.load( std::memory_order_relaxed );
+
+	if ( b - t > ring->Mask )
+	{
+		ovrRing * newRing = new ovrRing( ( ring->Mask + 1 ) * 2 );
+		for ( int64_t i = t; i < b; ++i )
+		{
+			newRing->Put( i, ring->Get( i ) );
+		}
+		RetiredRings.PushBack( ring );
+		Ring.store( newRing, std::memory_order_release );
+		ring = newRing;
+	}
+
+	ring->Put( b, job );
+	std::atomic_thread_fence( std::memory_order_release );
+	Bottom.store( b + 1, std::memory_order_relaxed );
 }
-	
-template< typename T >
-T const ovrMPMCArray< T >::operator[] ( int const index ) const
+
+ovrJob * ovrWorkStealingDeque::Pop()
 {
-	ovrScopedMutex mutex( ThisMutex );
-	return A[index];
+	int64_t const b = Bottom.load( std::memory_order_relaxed ) - 1;
+	ovrRing * ring = Ring.load( std::memory_order_relaxed );
+	Bottom.store( b, std::memory_order_relaxed );
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	int64_t t = Top.load( std::memory_order_relaxed );
+
+	if ( t > b )
+	{
+		// empty
+		Bottom.store( b + 1, std::memory_order_relaxed );
+		return nullptr;
+	}
+
+	ovrJob * job = ring->Get( b );
+	if ( t == b )
+	{
+		// last job, so race any thieves for it
+		if ( !Top.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) )
+		{
+			job = nullptr;
+		}
+		Bottom.store( b + 1, std::memory_order_relaxed );
+	}
+	return job;
 }
 
-template< typename T >
-T ovrMPMCArray< T >::operator[] ( int const index )
+ovrJob * ovrWorkStealingDeque::Steal()
 {
-	ovrScopedMutex mutex( ThisMutex );
-	return A[index];
+	int64_t t = Top.load( std::memory_order_acquire );
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	int64_t const b = Bottom.load( std::memory_order_acquire );
+
+	if ( t >= b )
+	{
+		return nullptr;
+	}
+
+	ovrRing * ring = Ring.load( std::memory_order_acquire );
+	ovrJob * job = ring->Get( t );
+	if ( !Top.compare_exchange_strong( t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed ) )
+	{
+		// lost the race to the owner or another thief
+		return nullptr;
+	}
+	return job;
 }
 
-template< typename T >
-void ovrMPMCArray< T >::Clear()
+bool ovrWorkStealingDeque::IsEmpty() const
 {
-	ovrScopedMutex mutex( ThisMutex );
-	A.Clear();
+	return Top.load( std::memory_order_relaxed ) >= Bottom.load( std::memory_order_relaxed );
 }
 
-template< typename T >
-void ovrMPMCArray< T >::MoveArray( OVR::Array< T > & a )
+//==============================================================
+// ovrJobQueue
+//
+// FIFO for jobs enqueued from threads that aren't job threads. Workers
+// check the count before taking the lock so idle polling doesn't contend.
+class ovrJobQueue
+{
+public:
+	ovrJobQueue()
+		: Head( 0 )
+		, Tail( 0 )
+		, Count( 0 )
+	{
+		Slots.Resize( 64 );
+	}
+
+	void		Push( ovrJob * job );
+	ovrJob *	Pop();
+	bool		IsEmpty() const { return Count.load( std::memory_order_relaxed ) == 0; }
+
+private:
+	OVR::Mutex				ThisMutex;
+	OVR::Array< ovrJob * >	Slots;	// size is always a power of 2
+	uint32_t				Head;
+	uint32_t				Tail;
+	std::atomic< int >		Count;
+};
+
+void ovrJobQueue::Push( ovrJob * job )
 {
 	ovrScopedMutex mutex( ThisMutex );
-	for ( int i = 0; i < A.GetSizeI(); ++i )
+	uint32_t const capacity = static_cast< uint32_t >( Slots.GetSize() );
+	if ( Tail - Head == capacity )
 	{
-		a.PushBack( A[i] );
+		// double the ring and move the wrapped-around jobs past the old end
+		uint32_t const head = Head & ( capacity - 1 );
+		Slots.Resize( capacity * 2 );
+		for ( uint32_t i = 0; i < head; ++i )
+		{
+			Slots[capacity + i] = Slots[i];
+		}
+		Head = head;
+		Tail = head + capacity;
 	}
-	A.Clear();
+	Slots[Tail & ( Slots.GetSize() - 1 )] = job;
+	Tail++;
+	Count.fetch_add( 1, std::memory_order_release );
 }
 
-
-class ovrJobManagerImpl;
+ovrJob * ovrJobQueue::Pop()
+{
+	if ( IsEmpty() )
+	{
+		return nullptr;
+	}
+	ovrScopedMutex mutex( ThisMutex );
+	if ( Head == Tail )
+	{
+		return nullptr;
+	}
+	ovrJob * job = Slots[Head & ( Slots.GetSize() - 1 )];
+	Head++;
+	Count.fetch_sub( 1, std::memory_order_relaxed );
+	return job;
+}
 
 //==============================================================
 // ovrJobThread
@@ -129,6 +352,7 @@ public:
 		, MyThread( nullptr )
 		, Jni( nullptr )
 		, Attached( false )
+		, ThreadNum( 0 )
 	{
 		OVR_strcpy( ThreadName, sizeof( ThreadName ), threadName );
 	}
@@ -148,14 +372,19 @@ public:
 	ovrJobManagerImpl *	GetJobManager() { return JobManager; }
 	JNIEnv *			GetJni() { return Jni; }
 	char const *		GetThreadName() const { return ThreadName; }
-	bool				IsAttached() const { return Attached; }
+	bool				IsAttached() const { return Attached.load( std::memory_order_acquire ); }
+	int					GetThreadNum() const { return ThreadNum; }
+
+	// jobs this thread scheduled, one deque per priority
+	ovrWorkStealingDeque	LocalJobs[JOB_PRIORITY_MAX];
 
 private:
 	ovrJobManagerImpl *	JobManager;	// manager that owns us
 	Thread *			MyThread;	// our thread context
 	JNIEnv *			Jni;		// Java environment for this thread
 	char				ThreadName[16];
-	bool				Attached;
+	std::atomic< bool >	Attached;
+	int					ThreadNum;
 
 private:
 	void	AttachToCurrentThread();
@@ -169,7 +398,8 @@ class ovrJobManagerImpl : public ovrJobManager
 public:
 	friend class ovrJobThread;
 
-	static const int	MAX_THREADS = 5;
+	static const int	MIN_THREADS = 2;
+	static const int	MAX_THREADS = 8;
 
 	ovrJobManagerImpl();
 	virtual ~ovrJobManagerImpl();
@@ -180,8 +410,10 @@ public:
 	void	EnqueueJob( ovrJob * job ) OVR_OVERRIDE;
 
 	void	ServiceJobs( OVR::Array< ovrJobResult > & finishedJobs ) OVR_OVERRIDE;
+	void	SetServiceBudget( int const maxJobs, double const maxSeconds ) OVR_OVERRIDE;
+	void	GetStats( ovrJobManagerStats & stats ) const OVR_OVERRIDE;
 
-	bool	IsExiting() const OVR_OVERRIDE { return Exiting; }
+	bool	IsExiting() const OVR_OVERRIDE { return Exiting.load( std::memory_order_acquire ); }
 
 	JavaVM *GetJvm() { return Jvm; }
 
@@ -189,22 +421,29 @@ private:
 	//--------------------------
 	// thread function interface
 	//--------------------------
-	void		JobCompleted( ovrJob * job, bool const succeeded );
-	ovrJob *	GetPendingJob();
-	ovrSignal *	GetNewJobSignal() { return NewJobSignal; }
+	void		JobCompleted( ovrJobThread * jobThread, ovrJob * job, bool const succeeded );
+	ovrJob *	GetPendingJob( ovrJobThread * jobThread );
+	ovrJob *	TakeJob( ovrJobThread * jobThread );
+	bool		HasPendingJobs() const;
+	void		WaitForJob( ovrJobThread * jobThread );
 
 private:
-	OVR::Array< ovrJobThread * >	Threads;
+	OVR::Array< ovrJobThread * >	Threads;	// fixed once Init() starts the first thread
 
-	ovrMPMCArray< ovrJob* >			PendingJobs;	// jobs that haven't executed yet
-	ovrMPMCArray< ovrJob* >			RunningJobs;	// jobs that are currently executing
+	ovrJobQueue						PendingJobs[JOB_PRIORITY_MAX];	// jobs enqueued by other threads
+	std::atomic< int >				SleepingThreads;
 
-	ovrMPMCArray< ovrJobResult >	CompletedJobs;	// jobs that have completed
+	ovrJobCompletionQueue			CompletedJobs;	// jobs that have completed
+
+	// only touched by the thread calling ServiceJobs()
+	int								ServiceMaxJobs;
+	double							ServiceMaxSeconds;
+	ovrJobManagerStats				Stats;
 
 	ovrSignal *						NewJobSignal;
 
 	bool							Initialized;
-	volatile bool					Exiting;
+	std::atomic< bool >				Exiting;
 
 	JavaVM *						Jvm;
 
@@ -213,14 +452,33 @@ private:
 	bool	StartJob( ovrJob * job );
 	void	AttachToCurrentThread();
 	void	DetachFromCurrentThread();
+	void	ScheduleJob( ovrJob * job );
+	void	WakeThread();
 };
 
+// job thread running on the current thread, if any
+static thread_local ovrJobThread * CurrentJobThread = nullptr;
+
 //==============================================================================================
 // ovrJob
 //==============================================================================================
-ovrJob::ovrJob( char const * name )
+ovrJob::ovrJob( char const * name, ovrJobPriority const priority )
+	: Priority( priority )
+	, PendingDependencies( 1 )
 {
+	OVR_ASSERT( priority >= 0 && priority < JOB_PRIORITY_MAX );
 	OVR_strcpy( Name, sizeof( Name ), name );
+
+	CompletionLink.Next.store( nullptr, std::memory_order_relaxed );
+	CompletionLink.Job = this;
+	CompletionLink.Succeeded = false;
+}
+
+void ovrJob::AddDependency( ovrJob * prerequisite )
+{
+	OVR_ASSERT( prerequisite != nullptr && prerequisite != this );
+	PendingDependencies.fetch_add( 1, std::memory_order_relaxed );
+	prerequisite->Dependents.PushBack( this );
 }
 
 threadReturn_t ovrJob::DoWork( ovrJobThreadContext const & jtc )
@@ -248,22 +506,24 @@ threadReturn_t ovrJobThread::Fn( Thread * thread, void * data )
 	thread->SetThreadName( jt->GetThreadName() );
 
 	jt->AttachToCurrentThread();
+	CurrentJobThread = jt;
 
 	while ( !jm->IsExiting() )
 	{
-		ovrJob * job = jm->GetPendingJob();
+		ovrJob * job = jm->GetPendingJob( jt );
 		if ( job != nullptr )
 		{
 			ovrJobThreadContext context( jm->GetJvm(), jt->GetJni() );
 			threadReturn_t r = job->DoWork( context );
-			jm->JobCompleted( job, r != nullptr );
+			jm->JobCompleted( jt, job, r != nullptr );
 		}
 		else
 		{
-			jm->GetNewJobSignal()->Wait( -1 );
+			jm->WaitForJob( jt );
 		}
 	}
 
+	CurrentJobThread = nullptr;
 	jt->DetachFromCurrentThread();
 
 	return (void*)0;
@@ -277,8 +537,10 @@ ovrJobThread * ovrJobThread::Create( ovrJobManagerImpl * jobManager, int const t
 	{
 		return nullptr;
 	}
-	
-	jobThread->Init( threadNum );
+
+	// the thread is started by Init() once every job thread exists, since
+	// job threads steal from each other as soon as they start
+	jobThread->ThreadNum = threadNum;
 	return jobThread;
 }
 
@@ -294,6 +556,8 @@ void ovrJobThread::Init( int const threadNum )
 {
 	OVR_ASSERT( JobManager != nullptr );
 	OVR_ASSERT( MyThread == nullptr );
+	OVR_ASSERT( threadNum == ThreadNum );
+	OVR_UNUSED( threadNum );
 
 	size_t const stackSize = 128 * 1024;
 	int const processorAffinity = -1;
@@ -327,32 +591,148 @@ void ovrJobThread::Shutdown()
 void ovrJobThread::AttachToCurrentThread()
 {
 	ovr_AttachCurrentThread( JobManager->GetJvm(), &Jni, nullptr );
-	Attached = true;
+	Attached.store( true, std::memory_order_release );
 }
 
 void ovrJobThread::DetachFromCurrentThread()
 {
 	ovr_DetachCurrentThread( JobManager->GetJvm() );
 	Jni = nullptr;
-	Attached = false;
+	Attached.store( false, std::memory_order_release );
 }
 
 //==============================================================================================
 // ovrJobManagerImpl
 //==============================================================================================
-ovrJob * ovrJobManagerImpl::GetPendingJob()
+ovrJob * ovrJobManagerImpl::GetPendingJob( ovrJobThread * jobThread )
 {
-	ovrJob * pendingJob = PendingJobs.Pop();
-	return pendingJob;
+	ovrJob * job = TakeJob( jobThread );
+
+	// The signal only releases one thread at a time, so if there's more work
+	// than this thread can take, pass the wakeup on.
+	if ( job != nullptr && SleepingThreads.load( std::memory_order_relaxed ) > 0 && HasPendingJobs() )
+	{
+		NewJobSignal->Raise();
+	}
+	return job;
 }
 
-void ovrJobManagerImpl::JobCompleted( ovrJob * job, bool const succeeded )
+// Takes the highest priority job available to this thread. Within a priority, the
+// thread's own jobs come first, then jobs from other threads, then stolen jobs.
+ovrJob * ovrJobManagerImpl::TakeJob( ovrJobThread * jobThread )
 {
-	CompletedJobs.PushBack( ovrJobResult( job, succeeded ) );
+	int const numThreads = Threads.GetSizeI();
+	for ( int priority = 0; priority < JOB_PRIORITY_MAX; ++priority )
+	{
+		ovrJob * job = jobThread->LocalJobs[priority].Pop();
+		if ( job != nullptr )
+		{
+			return job;
+		}
+		job = PendingJobs[priority].Pop();
+		if ( job != nullptr )
+		{
+			return job;
+		}
+		// start with our neighbor so thieves spread out over the victims
+		for ( int i = 1; i < numThreads; ++i )
+		{
+			ovrJobThread * victim = Threads[( jobThread->GetThreadNum() + i ) % numThreads];
+			job = victim->LocalJobs[priority].Steal();
+			if ( job != nullptr )
+			{
+				return job;
+			}
+		}
+	}
+	return nullptr;
+}
+
+bool ovrJobManagerImpl::HasPendingJobs() const
+{
+	for ( int priority = 0; priority < JOB_PRIORITY_MAX; ++priority )
+	{
+		if ( !PendingJobs[priority].IsEmpty() )
+		{
+			return true;
+		}
+		for ( int i = 0; i < Threads.GetSizeI(); ++i )
+		{
+			if ( !Threads[i]->LocalJobs[priority].IsEmpty() )
+			{
+				return true;
+			}
+		}
+	}
+	return false;
+}
+
+void ovrJobManagerImpl::WaitForJob( ovrJobThread * jobThread )
+{
+	OVR_UNUSED( jobThread );
+
+	// Announce that we're about to sleep, then look again. Either a thread
+	// scheduling a job sees us sleeping and raises the signal, or we see its job.
+	SleepingThreads.fetch_add( 1, std::memory_order_seq_cst );
+	if ( !HasPendingJobs() && !IsExiting() )
+	{
+		NewJobSignal->Wait( -1 );
+	}
+	SleepingThreads.fetch_sub( 1, std::memory_order_seq_cst );
+}
+
+void ovrJobManagerImpl::WakeThread()
+{
+	std::atomic_thread_fence( std::memory_order_seq_cst );
+	if ( SleepingThreads.load( std::memory_order_relaxed ) > 0 )
+	{
+		NewJobSignal->Raise();
+	}
+}
+
+// Job threads keep the jobs they schedule, so continuations run where their
+// prerequisite's results are still in cache. Other threads' jobs go on a shared queue.
+void ovrJobManagerImpl::ScheduleJob( ovrJob * job )
+{
+	ovrJobThread * jt = CurrentJobThread;
+	if ( jt != nullptr && jt->GetJobManager() == this )
+	{
+		jt->LocalJobs[job->GetPriority()].Push( job );
+	}
+	else
+	{
+		PendingJobs[job->GetPriority()].Push( job );
+	}
+	WakeThread();
+}
+
+void ovrJobManagerImpl::JobCompleted( ovrJobThread * jobThread, ovrJob * job, bool const succeeded )
+{
+	OVR_UNUSED( jobThread );
+
+	// Release dependents before reporting completion, since the job may be
+	// freed as soon as ServiceJobs() hands it back.
+	for ( int i = 0; i < job->Dependents.GetSizeI(); ++i )
+	{
+		ovrJob * dependent = job->Dependents[i];
+		if ( dependent->PendingDependencies.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+		{
+			ScheduleJob( dependent );
+		}
+	}
+	job->Dependents.Clear();
+
+	// allow the job to be enqueued again
+	job->PendingDependencies.store( 1, std::memory_order_relaxed );
+
+	CompletedJobs.Push( job, succeeded );
 }
 
 ovrJobManagerImpl::ovrJobManagerImpl()
-	: NewJobSignal( nullptr )
+	: SleepingThreads( 0 )
+	, ServiceMaxJobs( 0 )
+	, ServiceMaxSeconds( 0.0 )
+	, NewJobSignal( nullptr )
 	, Initialized( false )
 	, Exiting( false )
 	, Jvm( nullptr )
@@ -371,8 +751,14 @@ void ovrJobManagerImpl::Init( JavaVM & javaVM )
 	// signal must be created before any job threads are created
 	NewJobSignal = ovrSignal::Create( true );
 
-	// create all threads... they will end up waiting on a new job signal
-	for ( int i = 0; i < MAX_THREADS; ++i )
+	// leave a core for the main and render threads, but keep at least two
+	// workers so one long job can't hold up everything else
+	int const numThreads = Alg::Clamp( Thread::GetCPUCount() - 1, static_cast< int >( MIN_THREADS ),
+			static_cast< int >( MAX_THREADS ) );
+	LOG( "ovrJobManagerImpl::Init - %i job threads", numThreads );
+
+	// create all threads before starting any... they will end up waiting on a new job signal
+	for ( int i = 0; i < numThreads; ++i )
 	{
 		char threadName[16];
 		OVR_sprintf( threadName, sizeof( threadName ), "ovrJobThread_%i", i );
@@ -380,39 +766,50 @@ void ovrJobManagerImpl::Init( JavaVM & javaVM )
 		ovrJobThread * jt = ovrJobThread::Create( this, i, threadName );
 		Threads.PushBack( jt );
 	}
+	for ( int i = 0; i < numThreads; ++i )
+	{
+		Threads[i]->Init( i );
+	}
 
 	Initialized = true;
 }
 
 void ovrJobManagerImpl::Shutdown()
 {
+	// the destructor shuts down again after an explicit Shutdown()
+	if ( !Initialized )
+	{
+		return;
+	}
+
 	LOG( "ovrJobManagerImpl::Shutdown" );
 
-	Exiting = true;
+	Exiting.store( true, std::memory_order_release );
 
 	// allow all threads to complete their current job
 	// waiting threads must timeout waiting for NewJobSignal
-	while( Threads.GetSizeI() > 0 )
+	// no thread can be destroyed until all have exited, since they steal from each other
+	for ( ; ; )
 	{
 		NewJobSignal->Raise(); // raise signal to release any waiting thread
 
-		// loop through threads until we find one that's seen the Exiting flag and detatched
-		int threadIndex = 0;
-		for ( ; ; )
+		int numAttached = 0;
+		for ( int i = 0; i < Threads.GetSizeI(); ++i )
 		{
-			if ( !Threads[threadIndex]->IsAttached() )
-			{
-				LOG( "Exited thread '%s'", Threads[threadIndex]->GetThreadName() );
-				ovrJobThread::Destroy( Threads[threadIndex] );
-				Threads.RemoveAtUnordered( threadIndex );
-				break;
-			}
-			threadIndex++;
-			if ( threadIndex >= Threads.GetSizeI() )
-			{
-				threadIndex = 0;
-			}
+			numAttached += Threads[i]->IsAttached() ? 1 : 0;
 		}
+		if ( numAttached == 0 )
+		{
+			break;
+		}
+		Thread::MSleep( 1 );
+	}
+
+	while ( Threads.GetSizeI() > 0 )
+	{
+		LOG( "Exited thread '%s'", Threads.Back()->GetThreadName() );
+		ovrJobThread::Destroy( Threads.Back() );
+		Threads.PopBack();
 	}
 
 	ovrSignal::Destroy( NewJobSignal );
@@ -425,13 +822,75 @@ void ovrJobManagerImpl::Shutdown()
 void ovrJobManagerImpl::EnqueueJob( ovrJob * job )
 {
 	//LOG( "ovrJobManagerImpl::EnqueueJob" );
-	PendingJobs.PushBack( job );
-	NewJobSignal->Raise();	// signal a waiting job
+	// held back until its last prerequisite completes
+	if ( job->PendingDependencies.fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+	{
+		ScheduleJob( job );
+	}
 }
 
 void ovrJobManagerImpl::ServiceJobs( OVR::Array< ovrJobResult > & completedJobs )
 {
-	CompletedJobs.MoveArray( completedJobs );
+	OVR_PERF_ACCUMULATE( ovrJobManager_ServiceJobs );
+
+	// only read the clock when there's a time budget to enforce
+	bool const timed = ServiceMaxSeconds > 0.0;
+	double const startTime = timed ? SystemClock::GetTimeInSeconds() : 0.0;
+
+	int numServiced = 0;
+	bool overBudget = false;
+	for ( ; ; )
+	{
+		if ( ServiceMaxJobs > 0 && numServiced >= ServiceMaxJobs )
+		{
+			overBudget = true;
+			break;
+		}
+		if ( timed && numServiced > 0 )
+		{
+			if ( SystemClock::GetTimeInSeconds() - startTime >= ServiceMaxSeconds )
+			{
+				overBudget = true;
+				break;
+			}
+		}
+
+		bool succeeded = false;
+		ovrJob * job = CompletedJobs.Pop( succeeded );
+		if ( job == nullptr )
+		{
+			break;
+		}
+		completedJobs.PushBack( ovrJobResult( job, succeeded ) );
+		numServiced++;
+	}
+
+	if ( overBudget && CompletedJobs.GetDepth() > 0 )
+	{
+		Stats.BudgetLimitedCalls++;
+	}
+
+	Stats.ServiceCalls++;
+	Stats.JobsServiced += numServiced;
+	if ( timed )
+	{
+		double const serviceSeconds = SystemClock::GetTimeInSeconds() - startTime;
+		Stats.TotalServiceSeconds += serviceSeconds;
+		Stats.MaxServiceSeconds = Alg::Max( Stats.MaxServiceSeconds, serviceSeconds );
+	}
+}
+
+void ovrJobManagerImpl::SetServiceBudget( int const maxJobs, double const maxSeconds )
+{
+	ServiceMaxJobs = maxJobs;
+	ServiceMaxSeconds = maxSeconds;
+}
+
+void ovrJobManagerImpl::GetStats( ovrJobManagerStats & stats ) const
+{
+	stats = Stats;
+	stats.CompletedQueueDepth = CompletedJobs.GetDepth();
+	stats.PeakCompletedQueueDepth = CompletedJobs.GetPeakDepth();
 }
 
 ovrJobManager *	ovrJobManager::Create( JavaVM & javaVm )
@@ -241,6 +241,34 @@ bool ovrStream::IsOpen() const
 	return Mode != OVR_STREAM_MODE_MAX;
 }
 
+//==============================================================================================
+// ovrStreamJsonSource
+//==============================================================================================
+
+//==============================
+// ovrStreamJsonSource::Read
+size_t ovrStreamJsonSource::Read( void * buffer, size_t bytes )
+{
+	// ovrStream::Read fails on a short read, so never ask for more than what is left.
+	size_t const remaining = Stream.Length() - Stream.Tell();
+	size_t const bytesToRead = ( bytes < remaining ) ? bytes : remaining;
+	if ( bytesToRead == 0 )
+	{
+		return 0;
+	}
+	if ( Chunk.GetSize() < bytesToRead )
+	{
+		Chunk.Realloc( bytes );
+	}
+	size_t bytesRead = 0;
+	if ( !Stream.Read( Chunk, bytesToRead, bytesRead ) )
+	{
+		return 0;
+	}
+	memcpy( buffer, Chunk, bytesRead );
+	return bytesRead;
+}
+
 //==============================================================================================
 // ovrUriScheme_File
 //==============================================================================================
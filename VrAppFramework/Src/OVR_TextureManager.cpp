@@ -18,7 +18,7 @@ Copyright   :   Copyright 2014 Oculus VR, LLC. All Rights reserved.
 #include "Kernel/OVR_String.h"
 #include "Kernel/OVR_Array.h"
 #include "Kernel/OVR_LogUtils.h"
-#include "Kernel/OVR_Hash.h"
+#include "Kernel/OVR_FlatHash.h"
 
 #include "OVR_FileSys.h"
 #include "PackageFiles.h"
@@ -49,20 +49,6 @@ void ovrManagedTexture::Free()
 // ovrTextureManagerImpl
 //==============================================================================================
 
-// DJB2 string hash function
-static unsigned long DJB2Hash( char const * str )
-{
-    unsigned long hash = 5381;
-    int c;
-
-	for ( c = *str; c != 0; str++, c = *str )
-    //while ( c = *str++ )
-	{
-        hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
-	}
-    return hash;
-}
-
 //==============================================================
 // Hash functor for OVR::String
 
@@ -72,7 +58,7 @@ class ovrUriHash
 public:
 	UPInt operator()( const C & data ) const 
 	{
-		return DJB2Hash( data.ToCStr() );
+		return String::WordHashFunction( data.ToCStr(), data.GetSize() );
 	}
 };
 
@@ -117,7 +103,7 @@ private:
 	bool						Initialized;
 
 #if defined( USE_HASH )
-	OVR::Hash< String, int, ovrUriHash< String > >	UriHash;
+	OVR::FlatHash< String, int, ovrUriHash< String > >	UriHash;
 #endif
 
 	mutable int					NumUriLoads;
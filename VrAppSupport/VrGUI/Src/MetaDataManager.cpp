@@ -973,7 +973,7 @@ TagAction OvrMetaData::ToggleTag( OvrMetaDatum * metaDatum, const String & newTa
 	JSON * newTagsObject = JSON::CreateArray();
 	OVR_ASSERT( newTagsObject );
 
-	newTagsObject->Name = TAGS;
+	newTagsObject->SetName( TAGS );
 
 	for ( int t = 0; t < metaDatum->Tags.GetSizeI(); ++t )
 	{
@@ -20,7 +20,7 @@ of patent rights can be found in the PATENTS file in the same directory.
 #include "tinyxml2.h"
 #include "Kernel/OVR_Types.h"
 #include "Kernel/OVR_Array.h"
-#include "Kernel/OVR_Hash.h"
+#include "Kernel/OVR_FlatHash.h"
 #include "Kernel/OVR_MemBuffer.h"
 #include "Kernel/OVR_JSON.h"
 #include "Kernel/OVR_LogUtils.h"
@@ -32,20 +32,6 @@ namespace OVR {
 char const *	ovrLocale::LOCALIZED_KEY_PREFIX = "@string/";
 size_t const	ovrLocale::LOCALIZED_KEY_PREFIX_LEN = OVR_strlen( LOCALIZED_KEY_PREFIX );
 
-// DJB2 string hash function
-static unsigned long DJB2Hash( char const * str )
-{
-    unsigned long hash = 5381;
-    int c;
-
-	for ( c = *str; c != 0; str++, c = *str )
-    //while ( c = *str++ )
-	{
-        hash = ((hash << 5) + hash) + c; /* hash * 33 + c */
-	}
-    return hash;
-}
-
 //==============================================================
 // Hash functor for OVR::String
 
@@ -55,7 +41,7 @@ class OvrStringHash
 public:
 	UPInt operator()( const C & data ) const
 	{
-		return DJB2Hash( data.ToCStr() );
+		return String::WordHashFunction( data.ToCStr(), data.GetSize() );
 	}
 };
 
@@ -99,7 +85,7 @@ private:
 
 	String									Name;			// user-specified locale name
 	String									LanguageCode;	// system-specific locale name
-	OVR::Hash< String, int, HashFunctor >	StringHash;
+	OVR::FlatHash< String, int, HashFunctor >	StringHash;
 	Array< String	>						Strings;
 
 private:
@@ -194,7 +194,7 @@ bool ReadSurfaceDataFromAccessor( Array< _type_ > & out, ModelFile & modelFile,
 }
 
 // Requires the buffers and images to already be loaded in the model
-bool LoadModelFile_glTF_Json( ModelFile & modelFile, const char * modelsJson, 
+bool LoadModelFile_glTF_Json( ModelFile & modelFile, const char * modelsJson, const size_t modelsJsonLength,
 	const ModelGlPrograms & programs, const MaterialParms & materialParms,
 	ModelGeo * outModelGeo )
 {
@@ -205,7 +205,7 @@ bool LoadModelFile_glTF_Json( ModelFile & modelFile, const char * modelsJson,
 	bool loaded = true;
 
 	const char * error = nullptr;
-	JSON * json = JSON::Parse( modelsJson, &error );
+	JSON * json = JSON::ParseInArena( modelsJson, modelsJsonLength, &error );
 	if ( json == nullptr )
 	{
 		WARN( "LoadModelFile_glTF_Json: Error loading %s : %s", modelFile.FileName.ToCStr(), error );
@@ -1669,7 +1669,7 @@ bool LoadModelFile_glTF_OvrScene( ModelFile * modelFilePtr, unzFile zfp, const c
 	bool loaded = true;
 
 	const char * error = nullptr;
-	JSON * json = JSON::Parse( gltfJson, &error );
+	JSON * json = JSON::ParseInArena( gltfJson, gltfJsonLength, &error );
 	if ( json == nullptr )
 	{
 		WARN( "LoadModelFile_glTF_OvrScene: Error loading %s : %s", modelFilePtr->FileName.ToCStr(), error );
@@ -1850,7 +1850,7 @@ bool LoadModelFile_glTF_OvrScene( ModelFile * modelFilePtr, unzFile zfp, const c
 
 		if ( loaded )
 		{
-			loaded = LoadModelFile_glTF_Json( modelFile, gltfJson, programs, materialParms, outModelGeo );
+			loaded = LoadModelFile_glTF_Json( modelFile, gltfJson, gltfJsonLength, programs, materialParms, outModelGeo );
 		}
 	}
 
@@ -1929,6 +1929,11 @@ ModelFile * LoadModelFile_glB( const char * fileName,
 			WARN( "Error: glb first chunk not JSON" );
 			loaded = false;
 		}
+		else if ( chunkLength > fileDataRemainingLength )
+		{
+			WARN( "Error: glb JSON chunk length exceeds the file" );
+			loaded = false;
+		}
 
 		JSON * json = nullptr;
 		const char * gltfJson = nullptr;
@@ -1936,7 +1941,7 @@ ModelFile * LoadModelFile_glB( const char * fileName,
 		{
 			const char * error = nullptr;
 			gltfJson = &fileData[fileDataIndex];
-			json = JSON::Parse( gltfJson, &error );
+			json = JSON::ParseInArena( gltfJson, chunkLength, &error );
 			fileDataIndex += chunkLength;
 			fileDataRemainingLength -= chunkLength;
 
@@ -2147,7 +2152,7 @@ ModelFile * LoadModelFile_glB( const char * fileName,
 
 		if ( loaded )
 		{
-			loaded = LoadModelFile_glTF_Json( modelFile, gltfJson, programs, materialParms, outModelGeo );
+			loaded = LoadModelFile_glTF_Json( modelFile, gltfJson, chunkLength, programs, materialParms, outModelGeo );
 		}
 	}
 
@@ -137,19 +137,20 @@ void ovrSoundAssetMapping::LoadSoundAssetsFromJsonObject( const String & url, JS
 		OVR_ASSERT( sound );
 
 		String fullPath( url );
-		fullPath.AppendString( sound->GetStringValue().ToCStr() );
+		fullPath.AppendString( sound->GetStringValueCStr() );
 
 		// Do we already have this sound?
-		StringHash< String >::ConstIterator soundMapping = SoundMap.Find( sound->Name );
+		const String soundName( sound->GetName() );
+		StringHash< String >::ConstIterator soundMapping = SoundMap.Find( soundName );
 		if ( soundMapping != SoundMap.End() )
 		{
-			LOG( "SoundManger - adding Duplicate sound %s with asset %s", sound->Name.ToCStr(), fullPath.ToCStr() );
-			SoundMap.Set( sound->Name, fullPath );
+			LOG( "SoundManger - adding Duplicate sound %s with asset %s", soundName.ToCStr(), fullPath.ToCStr() );
+			SoundMap.Set( soundName, fullPath );
 		}
 		else // add new sound
 		{
-			LOG( "SoundManger read in: %s -> %s", sound->Name.ToCStr(), fullPath.ToCStr() );
-			SoundMap.Add( sound->Name, fullPath );
+			LOG( "SoundManger read in: %s -> %s", soundName.ToCStr(), fullPath.ToCStr() );
+			SoundMap.Add( soundName, fullPath );
 		}
 	}
 
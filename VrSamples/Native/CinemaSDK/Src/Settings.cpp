@@ -93,7 +93,7 @@ public:
 	virtual JSON* Serialize()
 	{
 		JSON* newJSON = JSON::CreateNumber((double)(*varPtr));
-		newJSON->Name = name;
+		newJSON->SetName(name);
 		json = NULL; // can't be sure we'll be pointing to the right thing soon
 		return newJSON;
 	}
@@ -146,7 +146,7 @@ public:
 	virtual JSON* Serialize()
 	{
 		JSON* newJSON = JSON::CreateString(*varPtr);
-		newJSON->Name = name;
+		newJSON->SetName(name);
 		json = NULL; // can't be sure we'll be pointing to the right thing soon
 		return newJSON;
 	}
@@ -196,7 +196,7 @@ public:
 	virtual JSON* Serialize()
 	{
 		JSON* newJSON = JSON::CreateString(varPtr->ToCStr());
-		newJSON->Name = name;
+		newJSON->SetName(name);
 		json = NULL; // can't be sure we'll be pointing to the right thing soon
 		return newJSON;
 	}
@@ -226,7 +226,7 @@ template<> void JSONToTypeHelper(JSON* json, bool* toSet)
 }
 template<> void JSONToTypeHelper(JSON* json, char** toSet)
 {
-	*toSet = strdup(json->GetStringValue().ToCStr());
+	*toSet = strdup(json->GetStringValueCStr());
 }
 template<> void JSONToTypeHelper(JSON* json, String* toSet)
 {
@@ -412,7 +412,7 @@ void Settings::Load()
 				var->LoadNumber(varJSON->GetDoubleValue());
 				break;
 			case JSON_String:
-				var->LoadCStr(varJSON->GetStringValue().ToCStr());
+				var->LoadCStr(varJSON->GetStringValueCStr());
 				break;
 			default:
 				break;
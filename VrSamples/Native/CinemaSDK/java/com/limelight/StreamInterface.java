@@ -1189,6 +1189,11 @@ public class StreamInterface implements SurfaceHolder.Callback,
     public void stageComplete(String stage) {
     }
 
+    @Override
+    public void stageTiming(String stage, long elapsedUs) {
+        LimeLog.info(stage+" took "+(elapsedUs / 1000)+" ms");
+    }
+
     private void stopConnection() {
         if (connecting || connected) {
             connecting = connected = false;
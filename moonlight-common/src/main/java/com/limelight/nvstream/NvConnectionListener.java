@@ -4,6 +4,8 @@ public interface NvConnectionListener {
 	void stageStarting(String stage);
 	void stageComplete(String stage);
 	void stageFailed(String stage, long errorCode);
+	// Time in microseconds that a completed stage spent working
+	void stageTiming(String stage, long elapsedUs);
 	
 	void connectionStarted();
 	void connectionTerminated(long errorCode);
@@ -132,6 +132,12 @@ public class MoonBridge {
         }
     }
 
+    public static void bridgeClStageTiming(int stage, long elapsedUs) {
+        if (connectionListener != null) {
+            connectionListener.stageTiming(getStageName(stage), elapsedUs);
+        }
+    }
+
     public static void bridgeClConnectionStarted() {
         if (connectionListener != null) {
             connectionListener.connectionStarted();
@@ -13,18 +13,24 @@ LOCAL_SRC_FILES := moonlight-common-c/src/AudioStream.c \
                    moonlight-common-c/src/Connection.c \
                    moonlight-common-c/src/ControlStream.c \
                    moonlight-common-c/src/FakeCallbacks.c \
+                   moonlight-common-c/src/FrameTelemetry.c \
                    moonlight-common-c/src/InputStream.c \
                    moonlight-common-c/src/LinkedBlockingQueue.c \
                    moonlight-common-c/src/Misc.c \
+                   moonlight-common-c/src/NalScanner.c \
+                   moonlight-common-c/src/PacketPool.c \
                    moonlight-common-c/src/Platform.c \
                    moonlight-common-c/src/PlatformSockets.c \
+                   moonlight-common-c/src/RtpCapture.c \
                    moonlight-common-c/src/RtpFecQueue.c \
                    moonlight-common-c/src/RtpReorderQueue.c \
                    moonlight-common-c/src/RtspConnection.c \
                    moonlight-common-c/src/RtspParser.c \
                    moonlight-common-c/src/SdpGenerator.c \
                    moonlight-common-c/src/SimpleStun.c \
+                   moonlight-common-c/src/SpscRingQueue.c \
                    moonlight-common-c/src/VideoDepacketizer.c \
+                   moonlight-common-c/src/VideoReplay.c \
                    moonlight-common-c/src/VideoStream.c \
                    moonlight-common-c/reedsolomon/rs.c \
                    moonlight-common-c/enet/callbacks.c \
@@ -30,6 +30,7 @@ static jmethodID BridgeArPlaySampleMethod;
 static jmethodID BridgeClStageStartingMethod;
 static jmethodID BridgeClStageCompleteMethod;
 static jmethodID BridgeClStageFailedMethod;
+static jmethodID BridgeClStageTimingMethod;
 static jmethodID BridgeClConnectionStartedMethod;
 static jmethodID BridgeClConnectionTerminatedMethod;
 static jmethodID BridgeClDisplayMessageMethod;
@@ -90,6 +91,7 @@ Java_com_limelight_nvstream_jni_MoonBridge_init(JNIEnv *env, jclass clazz) {
     BridgeClStageStartingMethod = (*env)->GetStaticMethodID(env, clazz, "bridgeClStageStarting", "(I)V");
     BridgeClStageCompleteMethod = (*env)->GetStaticMethodID(env, clazz, "bridgeClStageComplete", "(I)V");
     BridgeClStageFailedMethod = (*env)->GetStaticMethodID(env, clazz, "bridgeClStageFailed", "(IJ)V");
+    BridgeClStageTimingMethod = (*env)->GetStaticMethodID(env, clazz, "bridgeClStageTiming", "(IJ)V");
     BridgeClConnectionStartedMethod = (*env)->GetStaticMethodID(env, clazz, "bridgeClConnectionStarted", "()V");
     BridgeClConnectionTerminatedMethod = (*env)->GetStaticMethodID(env, clazz, "bridgeClConnectionTerminated", "(J)V");
     BridgeClDisplayMessageMethod = (*env)->GetStaticMethodID(env, clazz, "bridgeClDisplayMessage", "(Ljava/lang/String;)V");
@@ -323,6 +325,16 @@ void BridgeClStageFailed(int stage, long errorCode) {
     (*env)->CallStaticVoidMethod(env, GlobalBridgeClass, BridgeClStageFailedMethod, stage, errorCode);
 }
 
+void BridgeClStageTiming(int stage, uint64_t elapsedUs) {
+    JNIEnv* env = GetThreadEnv();
+
+    if ((*env)->ExceptionCheck(env)) {
+        return;
+    }
+
+    (*env)->CallStaticVoidMethod(env, GlobalBridgeClass, BridgeClStageTimingMethod, stage, (jlong)elapsedUs);
+}
+
 void BridgeClConnectionStarted(void) {
     JNIEnv* env = GetThreadEnv();
 
@@ -395,6 +407,7 @@ static CONNECTION_LISTENER_CALLBACKS BridgeConnListenerCallbacks = {
         .displayMessage = BridgeClDisplayMessage,
         .displayTransientMessage = BridgeClDisplayTransientMessage,
         .logMessage = BridgeClLogMessage,
+        .stageTiming = BridgeClStageTiming,
 };
 
 JNIEXPORT jint JNICALL
@@ -46,6 +46,20 @@
 #define alloca(x) _alloca(x)
 #endif
 
+/*
+ * Vectorized GF(2^8) kernels use the split-nibble technique: the product
+ * c*x is looked up as lo[x & 0xF] ^ hi[x >> 4] using 16-entry tables and a
+ * byte shuffle (PSHUFB on x86, TBL on ARM). Define RS_NO_SIMD to force the
+ * scalar table lookups.
+ */
+#if !defined(RS_NO_SIMD) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define RS_SIMD_X86
+#include <immintrin.h>
+#elif !defined(RS_NO_SIMD) && defined(__GNUC__) && (defined(__aarch64__) || defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define RS_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
 typedef unsigned char gf;
 
 #define GF_BITS  8
@@ -93,7 +107,7 @@ static inline gf modnn(int x) {
     return x;
 }
 
-static void addmul(gf *dst1, gf *src1, gf c, int sz) {
+static void addmul_scalar(gf *dst1, gf *src1, gf c, int sz) {
     USE_GF_MULC;
     if (c != 0) {
         register gf *dst = dst1, *src = src1;
@@ -105,7 +119,7 @@ static void addmul(gf *dst1, gf *src1, gf c, int sz) {
     }
 }
 
-static void mul(gf *dst1, gf *src1, gf c, int sz) {
+static void mul_scalar(gf *dst1, gf *src1, gf c, int sz) {
     USE_GF_MULC;
     if (c != 0) {
         register gf *dst = dst1, *src = src1;
@@ -114,7 +128,195 @@ static void mul(gf *dst1, gf *src1, gf c, int sz) {
         for (; dst < lim; dst++, src++)
             GF_MULC(*dst , *src);
     } else
-        memset(dst1, 0, c);
+        memset(dst1, 0, sz);
+}
+
+#if defined(RS_SIMD_X86) || defined(RS_SIMD_NEON)
+/*
+ * Build the low and high nibble product tables for constant c
+ */
+static inline void gf_nibble_tables(gf c, gf *lo, gf *hi) {
+    gf *mt = &gf_mul_table[c << 8];
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        lo[i] = mt[i];
+        hi[i] = mt[i << 4];
+    }
+}
+#endif
+
+#ifdef RS_SIMD_X86
+__attribute__((target("ssse3")))
+static void mul_region_ssse3(gf *dst, gf *src, gf c, int sz, int accumulate) {
+    gf lo[16], hi[16];
+    __m128i tlo, thi, mask;
+    int i = 0;
+
+    gf_nibble_tables(c, lo, hi);
+    tlo = _mm_loadu_si128((const __m128i*)lo);
+    thi = _mm_loadu_si128((const __m128i*)hi);
+    mask = _mm_set1_epi8(0x0F);
+
+    for (; i + 16 <= sz; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)&src[i]);
+        __m128i p = _mm_xor_si128(_mm_shuffle_epi8(tlo, _mm_and_si128(x, mask)),
+                                  _mm_shuffle_epi8(thi, _mm_and_si128(_mm_srli_epi64(x, 4), mask)));
+        if (accumulate)
+            p = _mm_xor_si128(p, _mm_loadu_si128((const __m128i*)&dst[i]));
+        _mm_storeu_si128((__m128i*)&dst[i], p);
+    }
+
+    if (accumulate)
+        addmul_scalar(&dst[i], &src[i], c, sz - i);
+    else
+        mul_scalar(&dst[i], &src[i], c, sz - i);
+}
+
+__attribute__((target("avx2")))
+static void mul_region_avx2(gf *dst, gf *src, gf c, int sz, int accumulate) {
+    gf lo[16], hi[16];
+    __m256i tlo, thi, mask;
+    int i = 0;
+
+    gf_nibble_tables(c, lo, hi);
+    tlo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)lo));
+    thi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)hi));
+    mask = _mm256_set1_epi8(0x0F);
+
+    for (; i + 32 <= sz; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)&src[i]);
+        __m256i p = _mm256_xor_si256(_mm256_shuffle_epi8(tlo, _mm256_and_si256(x, mask)),
+                                     _mm256_shuffle_epi8(thi, _mm256_and_si256(_mm256_srli_epi64(x, 4), mask)));
+        if (accumulate)
+            p = _mm256_xor_si256(p, _mm256_loadu_si256((const __m256i*)&dst[i]));
+        _mm256_storeu_si256((__m256i*)&dst[i], p);
+    }
+
+    if (accumulate)
+        addmul_scalar(&dst[i], &src[i], c, sz - i);
+    else
+        mul_scalar(&dst[i], &src[i], c, sz - i);
+}
+
+static void addmul_ssse3(gf *dst, gf *src, gf c, int sz) {
+    if (c != 0)
+        mul_region_ssse3(dst, src, c, sz, 1);
+}
+
+static void mul_ssse3(gf *dst, gf *src, gf c, int sz) {
+    if (c != 0)
+        mul_region_ssse3(dst, src, c, sz, 0);
+    else
+        memset(dst, 0, sz);
+}
+
+static void addmul_avx2(gf *dst, gf *src, gf c, int sz) {
+    if (c != 0)
+        mul_region_avx2(dst, src, c, sz, 1);
+}
+
+static void mul_avx2(gf *dst, gf *src, gf c, int sz) {
+    if (c != 0)
+        mul_region_avx2(dst, src, c, sz, 0);
+    else
+        memset(dst, 0, sz);
+}
+#endif
+
+#ifdef RS_SIMD_NEON
+static void mul_region_neon(gf *dst, gf *src, gf c, int sz, int accumulate) {
+    gf lo[16], hi[16];
+    uint8x16_t mask = vdupq_n_u8(0x0F);
+    int i = 0;
+#ifdef __aarch64__
+    uint8x16_t tlo, thi;
+#else
+    uint8x8x2_t tlo, thi;
+#endif
+
+    gf_nibble_tables(c, lo, hi);
+#ifdef __aarch64__
+    tlo = vld1q_u8(lo);
+    thi = vld1q_u8(hi);
+#else
+    tlo.val[0] = vld1_u8(lo);
+    tlo.val[1] = vld1_u8(lo + 8);
+    thi.val[0] = vld1_u8(hi);
+    thi.val[1] = vld1_u8(hi + 8);
+#endif
+
+    for (; i + 16 <= sz; i += 16) {
+        uint8x16_t x = vld1q_u8(&src[i]);
+        uint8x16_t l = vandq_u8(x, mask);
+        uint8x16_t h = vshrq_n_u8(x, 4);
+        uint8x16_t p;
+#ifdef __aarch64__
+        p = veorq_u8(vqtbl1q_u8(tlo, l), vqtbl1q_u8(thi, h));
+#else
+        p = vcombine_u8(veor_u8(vtbl2_u8(tlo, vget_low_u8(l)), vtbl2_u8(thi, vget_low_u8(h))),
+                        veor_u8(vtbl2_u8(tlo, vget_high_u8(l)), vtbl2_u8(thi, vget_high_u8(h))));
+#endif
+        if (accumulate)
+            p = veorq_u8(p, vld1q_u8(&dst[i]));
+        vst1q_u8(&dst[i], p);
+    }
+
+    if (accumulate)
+        addmul_scalar(&dst[i], &src[i], c, sz - i);
+    else
+        mul_scalar(&dst[i], &src[i], c, sz - i);
+}
+
+static void addmul_neon(gf *dst, gf *src, gf c, int sz) {
+    if (c != 0)
+        mul_region_neon(dst, src, c, sz, 1);
+}
+
+static void mul_neon(gf *dst, gf *src, gf c, int sz) {
+    if (c != 0)
+        mul_region_neon(dst, src, c, sz, 0);
+    else
+        memset(dst, 0, sz);
+}
+#endif
+
+/*
+ * The kernels are selected at runtime by reed_solomon_init()
+ */
+typedef void (*gf_region_fn)(gf *dst, gf *src, gf c, int sz);
+static gf_region_fn addmul_fn = addmul_scalar;
+static gf_region_fn mul_fn = mul_scalar;
+
+static void select_gf_kernels(void) {
+#if defined(RS_SIMD_X86)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        addmul_fn = addmul_avx2;
+        mul_fn = mul_avx2;
+        return;
+    }
+    if (__builtin_cpu_supports("ssse3")) {
+        addmul_fn = addmul_ssse3;
+        mul_fn = mul_ssse3;
+        return;
+    }
+#elif defined(RS_SIMD_NEON)
+    addmul_fn = addmul_neon;
+    mul_fn = mul_neon;
+    return;
+#endif
+
+    addmul_fn = addmul_scalar;
+    mul_fn = mul_scalar;
+}
+
+static inline void addmul(gf *dst, gf *src, gf c, int sz) {
+    addmul_fn(dst, src, c, sz);
+}
+
+static inline void mul(gf *dst, gf *src, gf c, int sz) {
+    mul_fn(dst, src, c, sz);
 }
 
 /* y = a.dot(b) */
@@ -380,6 +582,7 @@ static inline int code_some_shards(gf* matrixRows, gf** inputs, gf** outputs, in
 void reed_solomon_init(void) {
     generate_gf();
     init_mul_table();
+    select_gf_kernels();
 }
 
 reed_solomon* reed_solomon_new(int data_shards, int parity_shards) {
@@ -398,6 +601,10 @@ reed_solomon* reed_solomon_new(int data_shards, int parity_shards) {
         rs->shards = (data_shards + parity_shards);
         rs->m = NULL;
         rs->parity = NULL;
+        memset(rs->decode_cache, 0, sizeof(rs->decode_cache));
+        rs->decode_cache_clock = 0;
+        rs->decode_cache_hits = 0;
+        rs->decode_cache_misses = 0;
 
         if (rs->shards > DATA_SHARDS_MAX || data_shards <= 0 || parity_shards <= 0) {
             err = 1;
@@ -472,7 +679,14 @@ reed_solomon* reed_solomon_new(int data_shards, int parity_shards) {
 }
 
 void reed_solomon_release(reed_solomon* rs) {
+    int i;
+
     if (NULL != rs) {
+        for (i = 0; i < RS_DECODE_CACHE_SIZE; i++) {
+            if (NULL != rs->decode_cache[i].matrix)
+                free(rs->decode_cache[i].matrix);
+        }
+
         if (NULL != rs->m)
             free(rs->m);
 
@@ -483,6 +697,51 @@ void reed_solomon_release(reed_solomon* rs) {
     }
 }
 
+/*
+ * Find a cached decode matrix for this erasure pattern
+ * */
+static reed_solomon_decode_entry* decode_cache_lookup(reed_solomon* rs, unsigned int* shard_bitmap, int nr_fec_blocks) {
+    reed_solomon_decode_entry* entry;
+    int i;
+
+    for (i = 0; i < RS_DECODE_CACHE_SIZE; i++) {
+        entry = &rs->decode_cache[i];
+        if (NULL != entry->matrix && entry->nr_fec_blocks == nr_fec_blocks &&
+            0 == memcmp(entry->shard_bitmap, shard_bitmap, sizeof(entry->shard_bitmap))) {
+            entry->last_used = ++rs->decode_cache_clock;
+            return entry;
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Remember the first nr_fec_blocks rows of matrix, evicting the least recently used entry
+ * */
+static void decode_cache_insert(reed_solomon* rs, unsigned int* shard_bitmap, int nr_fec_blocks, gf* matrix) {
+    reed_solomon_decode_entry* entry = &rs->decode_cache[0];
+    int size = nr_fec_blocks * rs->data_shards;
+    int i;
+
+    for (i = 1; i < RS_DECODE_CACHE_SIZE && NULL != entry->matrix; i++) {
+        if (NULL == rs->decode_cache[i].matrix || rs->decode_cache[i].last_used < entry->last_used)
+            entry = &rs->decode_cache[i];
+    }
+
+    if (NULL != entry->matrix)
+        free(entry->matrix);
+
+    entry->matrix = (gf*)malloc(size);
+    if (NULL == entry->matrix)
+        return;
+
+    memcpy(entry->matrix, matrix, size);
+    memcpy(entry->shard_bitmap, shard_bitmap, sizeof(entry->shard_bitmap));
+    entry->nr_fec_blocks = nr_fec_blocks;
+    entry->last_used = ++rs->decode_cache_clock;
+}
+
 /**
  * decode one shard
  * input:
@@ -498,8 +757,10 @@ static int reed_solomon_decode(reed_solomon* rs, unsigned char **data_blocks, in
     gf dataDecodeMatrix[DATA_SHARDS_MAX*DATA_SHARDS_MAX];
     unsigned char* subShards[DATA_SHARDS_MAX];
     unsigned char* outputs[DATA_SHARDS_MAX];
+    unsigned int shard_bitmap[RS_SHARD_BITMAP_WORDS];
+    reed_solomon_decode_entry* entry;
     gf* m = rs->m;
-    int i, j, c, swap, subMatrixRow, dataShards, nos, nshards;
+    int i, j, c, swap, subMatrixRow, dataShards;
 
     /* the erased_blocks should always sorted
      * if sorted, nr_fec_blocks times to check it
@@ -521,18 +782,31 @@ static int reed_solomon_decode(reed_solomon* rs, unsigned char **data_blocks, in
             break;
     }
 
+    dataShards = rs->data_shards;
+
+    /* the erased data shards and the parity shards standing in for
+     * them fully determine the decode matrix */
+    memset(shard_bitmap, 0, sizeof(shard_bitmap));
+    for (i = 0; i < nr_fec_blocks; i++) {
+        j = erased_blocks[i];
+        shard_bitmap[j / 32] |= 1U << (j % 32);
+        j = dataShards + fec_block_nos[i];
+        shard_bitmap[j / 32] |= 1U << (j % 32);
+    }
+
+    entry = decode_cache_lookup(rs, shard_bitmap, nr_fec_blocks);
+
     j = 0;
     subMatrixRow = 0;
-    nos = 0;
-    nshards = 0;
-    dataShards = rs->data_shards;
     for (i = 0; i < dataShards; i++) {
         if (j < nr_fec_blocks && i == erased_blocks[j])
             j++;
         else {
             /* this row is ok */
-            for (c = 0; c < dataShards; c++)
-                dataDecodeMatrix[subMatrixRow*dataShards + c] = m[i*dataShards + c];
+            if (NULL == entry) {
+                for (c = 0; c < dataShards; c++)
+                    dataDecodeMatrix[subMatrixRow*dataShards + c] = m[i*dataShards + c];
+            }
 
             subShards[subMatrixRow] = data_blocks[i];
             subMatrixRow++;
@@ -541,9 +815,11 @@ static int reed_solomon_decode(reed_solomon* rs, unsigned char **data_blocks, in
 
     for (i = 0; i < nr_fec_blocks && subMatrixRow < dataShards; i++) {
         subShards[subMatrixRow] = dec_fec_blocks[i];
-        j = dataShards + fec_block_nos[i];
-        for (c = 0; c < dataShards; c++)
-            dataDecodeMatrix[subMatrixRow*dataShards + c] = m[j*dataShards + c];
+        if (NULL == entry) {
+            j = dataShards + fec_block_nos[i];
+            for (c = 0; c < dataShards; c++)
+                dataDecodeMatrix[subMatrixRow*dataShards + c] = m[j*dataShards + c];
+        }
 
         subMatrixRow++;
     }
@@ -551,14 +827,26 @@ static int reed_solomon_decode(reed_solomon* rs, unsigned char **data_blocks, in
     if (subMatrixRow < dataShards)
         return -1;
 
-    invert_mat(dataDecodeMatrix, dataShards);
+    for (i = 0; i < nr_fec_blocks; i++)
+        outputs[i] = data_blocks[erased_blocks[i]];
+
+    if (NULL != entry) {
+        rs->decode_cache_hits++;
+        return code_some_shards(entry->matrix, subShards, outputs, dataShards, nr_fec_blocks, block_size);
+    }
+
+    rs->decode_cache_misses++;
+
+    if (0 != invert_mat(dataDecodeMatrix, dataShards))
+        return -1;
 
     for (i = 0; i < nr_fec_blocks; i++) {
         j = erased_blocks[i];
-        outputs[i] = data_blocks[j];
         memmove(dataDecodeMatrix+i*dataShards, dataDecodeMatrix+j*dataShards, dataShards);
     }
 
+    decode_cache_insert(rs, shard_bitmap, nr_fec_blocks, dataDecodeMatrix);
+
     return code_some_shards(dataDecodeMatrix, subShards, outputs, dataShards, nr_fec_blocks, block_size);
 }
 
@@ -627,7 +915,8 @@ int reed_solomon_reconstruct(reed_solomon* rs, unsigned char** shards, unsigned
             }
 
             if (dn == pn) {
-                reed_solomon_decode(rs, data_blocks, block_size, dec_fec_blocks, fec_block_nos, erased_blocks, dn);
+                if (reed_solomon_decode(rs, data_blocks, block_size, dec_fec_blocks, fec_block_nos, erased_blocks, dn) != 0)
+                    err = -1;
             } else
                 err = -1;
         }
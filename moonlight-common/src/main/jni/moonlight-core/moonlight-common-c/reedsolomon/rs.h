@@ -4,12 +4,30 @@
 /* use small value to save memory */
 #define DATA_SHARDS_MAX 255
 
+/* number of inverted decode matrices remembered per context */
+#define RS_DECODE_CACHE_SIZE 8
+#define RS_SHARD_BITMAP_WORDS ((DATA_SHARDS_MAX + 31) / 32)
+
+typedef struct _reed_solomon_decode_entry {
+    /* erased data shards and parity shards used, one bit per shard */
+    unsigned int shard_bitmap[RS_SHARD_BITMAP_WORDS];
+    int nr_fec_blocks;
+    unsigned int last_used;
+    /* rows of the inverted matrix for the erased shards */
+    unsigned char* matrix;
+} reed_solomon_decode_entry;
+
 typedef struct _reed_solomon {
     int data_shards;
     int parity_shards;
     int shards;
     unsigned char* m;
     unsigned char* parity;
+
+    reed_solomon_decode_entry decode_cache[RS_DECODE_CACHE_SIZE];
+    unsigned int decode_cache_clock;
+    unsigned int decode_cache_hits;
+    unsigned int decode_cache_misses;
 } reed_solomon;
 
 /**
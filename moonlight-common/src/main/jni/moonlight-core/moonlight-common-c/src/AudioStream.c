@@ -1,13 +1,18 @@
 #include "Limelight-internal.h"
 #include "PlatformSockets.h"
 #include "PlatformThreads.h"
-#include "LinkedBlockingQueue.h"
+#include "SpscRingQueue.h"
 #include "RtpReorderQueue.h"
+#include "PacketPool.h"
+#include "PlatformAtomics.h"
 
 static SOCKET rtpSocket = INVALID_SOCKET;
 
-static LINKED_BLOCKING_QUEUE packetQueue;
+static SPSC_RING_QUEUE packetQueue;
 static RTP_REORDER_QUEUE rtpReorderQueue;
+static PACKET_POOL packetPool;
+// Guards the pool and the jitter stats against LiGet*Stats() during teardown
+static int audioStatsGuard;
 
 static PLT_THREAD udpPingThread;
 static PLT_THREAD receiveThread;
@@ -19,6 +24,37 @@ static unsigned short lastSeq;
 
 #define MAX_PACKET_SIZE 1400
 
+// Each audio packet carries 5 ms of samples
+#define AUDIO_PACKET_DURATION_MS 5
+
+// Bounds on how long the jitter buffer waits for a missing packet before
+// concealing it. The target within these is a multiple of the measured
+// jitter plus one packet.
+#define JITTER_BUFFER_MIN_DELAY_MS (2 * AUDIO_PACKET_DURATION_MS)
+#define JITTER_BUFFER_MAX_DELAY_MS 80
+#define JITTER_DELAY_MULTIPLIER 3
+
+// A late packet raises the target by a packet's worth, which then decays
+// by 1 ms for each interval without another late packet
+#define LATE_PACKET_DECAY_INTERVAL_MS 1000
+
+// Enough packets to cover the longest wait for a missing packet
+#define JITTER_BUFFER_MAX_PACKETS (JITTER_BUFFER_MAX_DELAY_MS / AUDIO_PACKET_DURATION_MS + 2)
+
+// Longer gaps are a resync or an outage, which concealment can't paper over,
+// so they aren't concealed at all
+#define MAX_CONCEALED_PACKETS (JITTER_BUFFER_MAX_DELAY_MS / AUDIO_PACKET_DURATION_MS)
+
+#define AUDIO_PACKET_QUEUE_BOUND 30
+
+// Number of datagrams pulled from the socket per receive call when
+// the platform supports batched receive
+#define AUDIO_RECV_BATCH_SIZE 8
+
+// Every packet that can be queued for the decoder, held by the jitter buffer,
+// posted for receive or being decoded
+#define AUDIO_PACKET_POOL_SIZE (AUDIO_PACKET_QUEUE_BOUND + JITTER_BUFFER_MAX_PACKETS + AUDIO_RECV_BATCH_SIZE + 1)
+
 // This is much larger than we should typically have buffered, but
 // it needs to be. We need a cushion in case our thread gets blocked
 // for longer than normal.
@@ -55,40 +91,203 @@ typedef struct _QUEUED_AUDIO_PACKET {
     char data[MAX_PACKET_SIZE];
 
     int size;
-    union {
-        RTP_QUEUE_ENTRY rentry;
-        LINKED_BLOCKING_QUEUE_ENTRY lentry;
-    } q;
+    RTP_QUEUE_ENTRY rentry;
 } QUEUED_AUDIO_PACKET, *PQUEUED_AUDIO_PACKET;
 
+// The jitter estimate is owned by the receive thread
+static int haveLastArrival;
+static unsigned short lastArrivalSeq;
+static uint64_t lastArrivalTimeMs;
+static uint32_t jitterUs;
+static int targetDelayMs;
+static int lateBoostMs;
+static uint64_t lastLateBoostDecayMs;
+
+// Sequence numbers that arrived, relative to the highest one (bit 0), so a
+// duplicate isn't mistaken for a late packet. Owned by the receive thread.
+static int haveHighestArrival;
+static unsigned short highestArrivalSeq;
+static uint64_t arrivalBitmap;
+
+// Counters for LiGetAudioJitterStats(). The concealment counters are updated
+// by the decoder thread and the rest by the receive thread, so they're only
+// accessed atomically.
+static struct {
+    int targetDelayMs;
+    unsigned int jitterUs;
+    int bufferedPackets;
+    int maxBufferedPackets;
+    unsigned int packetsReceived;
+    unsigned int packetsConcealed;
+    unsigned int concealmentEvents;
+    unsigned int latePackets;
+} jitterStats;
+
+static void freeAudioPacket(void* packet) {
+    PpFreePacket(&packetPool, packet);
+}
+
 // Initialize the audio stream
-void initializeAudioStream(void) {
+int initializeAudioStream(void) {
+    int err;
+
+    err = PpInitializePacketPool(&packetPool, sizeof(QUEUED_AUDIO_PACKET), AUDIO_PACKET_POOL_SIZE);
+    if (err != 0) {
+        return err;
+    }
+
     if ((AudioCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
-        LbqInitializeLinkedBlockingQueue(&packetQueue, 30);
+        err = SrqInitializeRingQueue(&packetQueue, AUDIO_PACKET_QUEUE_BOUND);
+        if (err != 0) {
+            PpCleanupPacketPool(&packetPool);
+            return err;
+        }
     }
-    RtpqInitializeQueue(&rtpReorderQueue, RTPQ_DEFAULT_MAX_SIZE, RTPQ_DEFAULT_QUEUE_TIME);
+    RtpqInitializeQueue(&rtpReorderQueue, JITTER_BUFFER_MAX_PACKETS, JITTER_BUFFER_MIN_DELAY_MS, &packetPool);
     lastSeq = 0;
-}
 
-static void freePacketList(PLINKED_BLOCKING_QUEUE_ENTRY entry) {
-    PLINKED_BLOCKING_QUEUE_ENTRY nextEntry;
+    haveLastArrival = 0;
+    jitterUs = 0;
+    targetDelayMs = JITTER_BUFFER_MIN_DELAY_MS;
+    lateBoostMs = 0;
+    lastLateBoostDecayMs = 0;
+    haveHighestArrival = 0;
 
-    while (entry != NULL) {
-        nextEntry = entry->flink;
+    // LiGetAudioJitterStats() can't get in until the guard is opened below
+    memset(&jitterStats, 0, sizeof(jitterStats));
+    jitterStats.targetDelayMs = targetDelayMs;
 
-        // The entry is stored within the data allocation
-        free(entry->data);
-
-        entry = nextEntry;
-    }
+    statsGuardOpen(&audioStatsGuard);
+    return 0;
 }
 
 // Tear down the audio stream once we're done with it
 void destroyAudioStream(void) {
+    statsGuardClose(&audioStatsGuard);
+
     if ((AudioCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
-        freePacketList(LbqDestroyLinkedBlockingQueue(&packetQueue));
+        SrqDestroyRingQueue(&packetQueue, freeAudioPacket);
     }
     RtpqCleanupQueue(&rtpReorderQueue);
+    PpCleanupPacketPool(&packetPool);
+}
+
+int getAudioPacketPoolStats(PPACKET_POOL_STATS stats) {
+    if (!statsGuardEnter(&audioStatsGuard)) {
+        return -1;
+    }
+
+    PpGetPacketPoolStats(&packetPool, stats);
+    statsGuardLeave(&audioStatsGuard);
+    return 0;
+}
+
+int LiGetAudioJitterStats(PAUDIO_JITTER_STATS stats) {
+    if (!statsGuardEnter(&audioStatsGuard)) {
+        return -1;
+    }
+
+    stats->targetDelayMs = PLT_ATOMIC_LOAD(&jitterStats.targetDelayMs);
+    stats->jitterUs = PLT_ATOMIC_LOAD(&jitterStats.jitterUs);
+    stats->bufferedPackets = PLT_ATOMIC_LOAD(&jitterStats.bufferedPackets);
+    stats->maxBufferedPackets = PLT_ATOMIC_LOAD(&jitterStats.maxBufferedPackets);
+    stats->packetsReceived = PLT_ATOMIC_LOAD(&jitterStats.packetsReceived);
+    stats->packetsConcealed = PLT_ATOMIC_LOAD(&jitterStats.packetsConcealed);
+    stats->concealmentEvents = PLT_ATOMIC_LOAD(&jitterStats.concealmentEvents);
+    stats->latePackets = PLT_ATOMIC_LOAD(&jitterStats.latePackets);
+    statsGuardLeave(&audioStatsGuard);
+    return 0;
+}
+
+// Picks how long to wait on a missing packet from the jitter estimate and
+// any recent late packets
+static void updateTargetDelay(uint64_t nowMs) {
+    int targetMs;
+
+    if (lateBoostMs > 0 && nowMs - lastLateBoostDecayMs >= LATE_PACKET_DECAY_INTERVAL_MS) {
+        lateBoostMs--;
+        lastLateBoostDecayMs = nowMs;
+    }
+
+    targetMs = (int)((JITTER_DELAY_MULTIPLIER * jitterUs) / 1000) + AUDIO_PACKET_DURATION_MS + lateBoostMs;
+    if (targetMs < JITTER_BUFFER_MIN_DELAY_MS) {
+        targetMs = JITTER_BUFFER_MIN_DELAY_MS;
+    }
+    else if (targetMs > JITTER_BUFFER_MAX_DELAY_MS) {
+        targetMs = JITTER_BUFFER_MAX_DELAY_MS;
+    }
+
+    if (targetMs != targetDelayMs) {
+        RtpqSetMaxQueueTime(&rtpReorderQueue, targetMs);
+        targetDelayMs = targetMs;
+        PLT_ATOMIC_STORE(&jitterStats.targetDelayMs, targetMs);
+    }
+}
+
+// RFC 3550 inter-arrival jitter, using the sequence number as the send clock
+// since every packet covers the same duration
+static void updateJitterEstimate(unsigned short sequenceNumber, uint64_t receiveTimeMs) {
+    if (haveLastArrival) {
+        short seqDelta = (short)(sequenceNumber - lastArrivalSeq);
+
+        // Skip the sample across a sequence discontinuity
+        if (seqDelta > -RTPQ_WINDOW_SIZE && seqDelta < RTPQ_WINDOW_SIZE) {
+            int64_t transitDeltaUs = ((int64_t)receiveTimeMs - (int64_t)lastArrivalTimeMs) * 1000 -
+                                     (int64_t)seqDelta * AUDIO_PACKET_DURATION_MS * 1000;
+            if (transitDeltaUs < 0) {
+                transitDeltaUs = -transitDeltaUs;
+            }
+
+            jitterUs += (int32_t)((transitDeltaUs - (int64_t)jitterUs) / 16);
+            PLT_ATOMIC_STORE(&jitterStats.jitterUs, jitterUs);
+        }
+    }
+
+    haveLastArrival = 1;
+    lastArrivalSeq = sequenceNumber;
+    lastArrivalTimeMs = receiveTimeMs;
+}
+
+// Returns 1 if this sequence number already arrived
+static int isDuplicateArrival(unsigned short sequenceNumber) {
+    short seqDelta;
+    uint64_t bit;
+
+    if (!haveHighestArrival) {
+        haveHighestArrival = 1;
+        highestArrivalSeq = sequenceNumber;
+        arrivalBitmap = 1;
+        return 0;
+    }
+
+    seqDelta = (short)(sequenceNumber - highestArrivalSeq);
+    if (seqDelta > 0) {
+        arrivalBitmap = seqDelta < 64 ? (arrivalBitmap << seqDelta) | 1 : 1;
+        highestArrivalSeq = sequenceNumber;
+        return 0;
+    }
+    else if (seqDelta <= -64) {
+        // Too old to tell
+        return 0;
+    }
+
+    bit = 1ULL << -seqDelta;
+    if (arrivalBitmap & bit) {
+        return 1;
+    }
+    arrivalBitmap |= bit;
+    return 0;
+}
+
+// A packet showed up after we gave up on it, so wait longer from now on
+static void handleLatePacket(uint64_t nowMs) {
+    PLT_ATOMIC_INCREMENT(&jitterStats.latePackets);
+
+    lateBoostMs += AUDIO_PACKET_DURATION_MS;
+    if (lateBoostMs > JITTER_BUFFER_MAX_DELAY_MS) {
+        lateBoostMs = JITTER_BUFFER_MAX_DELAY_MS;
+    }
+    lastLateBoostDecayMs = nowMs;
 }
 
 static void UdpPingThreadProc(void* context) {
@@ -113,19 +312,19 @@ static void UdpPingThreadProc(void* context) {
     }
 }
 
-static int queuePacketToLbq(PQUEUED_AUDIO_PACKET* packet) {
+static int queuePacketToRing(PQUEUED_AUDIO_PACKET* packet) {
     int err;
 
-    err = LbqOfferQueueItem(&packetQueue, *packet, &(*packet)->q.lentry);
-    if (err == LBQ_SUCCESS) {
-        // The LBQ owns the buffer now
+    err = SrqOfferQueueItem(&packetQueue, *packet);
+    if (err == SRQ_SUCCESS) {
+        // The ring owns the buffer now
         *packet = NULL;
     }
-    else if (err == LBQ_BOUND_EXCEEDED) {
+    else if (err == SRQ_BOUND_EXCEEDED) {
         Limelog("Audio packet queue overflow\n");
-        freePacketList(LbqFlushQueueItems(&packetQueue));
+        SrqFlushQueueItems(&packetQueue, freeAudioPacket);
     }
-    else if (err == LBQ_INTERRUPTED) {
+    else if (err == SRQ_INTERRUPTED) {
         return 0;
     }
 
@@ -137,9 +336,20 @@ static void decodeInputData(PQUEUED_AUDIO_PACKET packet) {
 
     rtp = (PRTP_PACKET)&packet->data[0];
     if (lastSeq != 0 && (unsigned short)(lastSeq + 1) != rtp->sequenceNumber) {
+        int missing = (unsigned short)(rtp->sequenceNumber - lastSeq - 1);
+        int i;
+
         Limelog("Received OOS audio data (expected %d, but got %d)\n", lastSeq + 1, rtp->sequenceNumber);
 
-        AudioCallbacks.decodeAndPlaySample(NULL, 0);
+        // The jitter buffer has given up on these, so let Opus conceal each one
+        if (missing <= MAX_CONCEALED_PACKETS) {
+            for (i = 0; i < missing; i++) {
+                AudioCallbacks.decodeAndPlaySample(NULL, 0);
+            }
+
+            PLT_ATOMIC_ADD(&jitterStats.packetsConcealed, missing);
+            PLT_ATOMIC_INCREMENT(&jitterStats.concealmentEvents);
+        }
     }
 
     lastSeq = rtp->sequenceNumber;
@@ -147,13 +357,104 @@ static void decodeInputData(PQUEUED_AUDIO_PACKET packet) {
     AudioCallbacks.decodeAndPlaySample((char*)(rtp + 1), packet->size - sizeof(*rtp));
 }
 
-static void ReceiveThreadProc(void* context) {
+// Hands a received datagram to the RTP reorder queue and submits anything
+// that is ready. *packetPtr is set to NULL if ownership was transferred.
+// Returns 0 if an exit signal was received.
+static int handleReceivedPacket(PQUEUED_AUDIO_PACKET* packetPtr, uint64_t receiveTimeMs) {
+    PQUEUED_AUDIO_PACKET packet = *packetPtr;
     PRTP_PACKET rtp;
-    PQUEUED_AUDIO_PACKET packet;
     int queueStatus;
+
+    if (packet->size < sizeof(RTP_PACKET)) {
+        // Runt packet
+        return 1;
+    }
+
+    rtp = (PRTP_PACKET)&packet->data[0];
+    if (rtp->packetType != 97) {
+        // Not audio
+        return 1;
+    }
+
+    // RTP sequence number must be in host order for the RTP queue
+    rtp->sequenceNumber = htons(rtp->sequenceNumber);
+
+    // A duplicate would look like a late packet to the reorder queue
+    if (isDuplicateArrival(rtp->sequenceNumber)) {
+        return 1;
+    }
+
+    PLT_ATOMIC_INCREMENT(&jitterStats.packetsReceived);
+    updateJitterEstimate(rtp->sequenceNumber, receiveTimeMs);
+    updateTargetDelay(receiveTimeMs);
+
+    queueStatus = RtpqAddPacket(&rtpReorderQueue, (PRTP_PACKET)packet, &packet->rentry);
+
+    PLT_ATOMIC_STORE(&jitterStats.bufferedPackets, rtpReorderQueue.queueSize);
+    if (rtpReorderQueue.queueSize > (int)PLT_ATOMIC_LOAD(&jitterStats.maxBufferedPackets)) {
+        PLT_ATOMIC_STORE(&jitterStats.maxBufferedPackets, rtpReorderQueue.queueSize);
+    }
+
+    if (queueStatus == 0) {
+        // This is behind the stream, so its place has already been concealed
+        handleLatePacket(receiveTimeMs);
+    }
+    else if (RTPQ_HANDLE_NOW(queueStatus)) {
+        if ((AudioCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
+            if (!queuePacketToRing(packetPtr)) {
+                // An exit signal was received
+                return 0;
+            }
+        }
+        else {
+            decodeInputData(packet);
+        }
+    }
+    else {
+        if (RTPQ_PACKET_CONSUMED(queueStatus)) {
+            // The queue consumed our packet, so we must allocate a new one
+            *packetPtr = NULL;
+        }
+
+        if (RTPQ_PACKET_READY(queueStatus)) {
+            // If packets are ready, pull them and send them to the decoder
+            while ((packet = (PQUEUED_AUDIO_PACKET)RtpqGetQueuedPacket(&rtpReorderQueue)) != NULL) {
+                if ((AudioCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
+                    if (!queuePacketToRing(&packet)) {
+                        // An exit signal was received
+                        freeAudioPacket(packet);
+                        return 0;
+                    }
+                    else if (packet != NULL) {
+                        // The ring overflowed and didn't take this packet
+                        freeAudioPacket(packet);
+                    }
+                }
+                else {
+                    decodeInputData(packet);
+                    freeAudioPacket(packet);
+                }
+            }
+        }
+    }
+
+    return 1;
+}
+
+static void ReceiveThreadProc(void* context) {
+    PQUEUED_AUDIO_PACKET packets[AUDIO_RECV_BATCH_SIZE];
+    UDP_RECV_BATCH_ENTRY batch[AUDIO_RECV_BATCH_SIZE];
     int useSelect;
+    int spinUs;
+    int batchSize;
+    int received;
+    int i;
 
-    packet = NULL;
+    memset(packets, 0, sizeof(packets));
+    memset(batch, 0, sizeof(batch));
+    batchSize = getUdpRecvBatchSize(AUDIO_RECV_BATCH_SIZE);
+
+    configureReceiveThread("Audio Receive", 0);
 
     if (setNonFatalRecvTimeoutMs(rtpSocket, UDP_RECV_POLL_TIMEOUT_MS) < 0) {
         // SO_RCVTIMEO failed, so use select() to wait
@@ -164,85 +465,55 @@ static void ReceiveThreadProc(void* context) {
         useSelect = 0;
     }
 
+    spinUs = configureLowLatencyReceive(rtpSocket);
+
     while (!PltIsThreadInterrupted(&receiveThread)) {
-        if (packet == NULL) {
-            packet = (PQUEUED_AUDIO_PACKET)malloc(sizeof(*packet));
-            if (packet == NULL) {
-                Limelog("Audio Receive: malloc() failed\n");
-                ListenerCallbacks.connectionTerminated(-1);
-                break;
+        for (i = 0; i < batchSize; i++) {
+            if (packets[i] == NULL) {
+                packets[i] = (PQUEUED_AUDIO_PACKET)PpAllocatePacket(&packetPool);
+                if (packets[i] == NULL) {
+                    Limelog("Audio Receive: PpAllocatePacket() failed\n");
+                    ListenerCallbacks.connectionTerminated(-1);
+                    goto Exit;
+                }
             }
+
+            batch[i].buffer = &packets[i]->data[0];
+            batch[i].size = MAX_PACKET_SIZE;
         }
 
-        packet->size = recvUdpSocket(rtpSocket, &packet->data[0], MAX_PACKET_SIZE, useSelect);
-        if (packet->size < 0) {
-            Limelog("Audio Receive: recvUdpSocket() failed: %d\n", (int)LastSocketError());
+        if (spinUs != 0) {
+            // Catch the next datagram without sleeping if it arrives soon
+            spinUntilUdpSocketReadable(rtpSocket, spinUs);
+        }
+
+        received = recvUdpSocketBatch(rtpSocket, batch, batchSize, useSelect);
+        if (received < 0) {
+            Limelog("Audio Receive: recvUdpSocketBatch() failed: %d\n", (int)LastSocketError());
             ListenerCallbacks.connectionTerminated(LastSocketError());
             break;
         }
-        else if (packet->size == 0) {
+        else if (received == 0) {
             // Receive timed out; try again
             continue;
         }
 
-        if (packet->size < sizeof(RTP_PACKET)) {
-            // Runt packet
-            continue;
-        }
+        for (i = 0; i < received; i++) {
+            packets[i]->size = batch[i].length;
 
-        rtp = (PRTP_PACKET)&packet->data[0];
-        if (rtp->packetType != 97) {
-            // Not audio
-            continue;
-        }
-
-        // RTP sequence number must be in host order for the RTP queue
-        rtp->sequenceNumber = htons(rtp->sequenceNumber);
-
-        queueStatus = RtpqAddPacket(&rtpReorderQueue, (PRTP_PACKET)packet, &packet->q.rentry);
-        if (RTPQ_HANDLE_NOW(queueStatus)) {
-            if ((AudioCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
-                if (!queuePacketToLbq(&packet)) {
-                    // An exit signal was received
-                    break;
-                }
-            }
-            else {
-                decodeInputData(packet);
+            if (!handleReceivedPacket(&packets[i], batch[i].receiveTimeMs)) {
+                // An exit signal was received
+                goto Exit;
             }
         }
-        else {
-            if (RTPQ_PACKET_CONSUMED(queueStatus)) {
-                // The queue consumed our packet, so we must allocate a new one
-                packet = NULL;
-            }
+    }
 
-            if (RTPQ_PACKET_READY(queueStatus)) {
-                // If packets are ready, pull them and send them to the decoder
-                while ((packet = (PQUEUED_AUDIO_PACKET)RtpqGetQueuedPacket(&rtpReorderQueue)) != NULL) {
-                    if ((AudioCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
-                        if (!queuePacketToLbq(&packet)) {
-                            // An exit signal was received
-                            break;
-                        }
-                    }
-                    else {
-                        decodeInputData(packet);
-                        free(packet);
-                    }
-                }
-                
-                // Break on exit
-                if (packet != NULL) {
-                    break;
-                }
-            }
+Exit:
+    for (i = 0; i < batchSize; i++) {
+        if (packets[i] != NULL) {
+            freeAudioPacket(packets[i]);
         }
     }
-    
-    if (packet != NULL) {
-        free(packet);
-    }
 }
 
 static void DecoderThreadProc(void* context) {
@@ -250,15 +521,15 @@ static void DecoderThreadProc(void* context) {
     PQUEUED_AUDIO_PACKET packet;
 
     while (!PltIsThreadInterrupted(&decoderThread)) {
-        err = LbqWaitForQueueElement(&packetQueue, (void**)&packet);
-        if (err != LBQ_SUCCESS) {
+        err = SrqWaitForQueueElement(&packetQueue, (void**)&packet);
+        if (err != SRQ_SUCCESS) {
             // An exit signal was received
             return;
         }
 
         decodeInputData(packet);
 
-        free(packet);
+        freeAudioPacket(packet);
     }
 }
 
@@ -268,8 +539,8 @@ void stopAudioStream(void) {
     PltInterruptThread(&udpPingThread);
     PltInterruptThread(&receiveThread);
     if ((AudioCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {        
-        // Signal threads waiting on the LBQ
-        LbqSignalQueueShutdown(&packetQueue);
+        // Signal threads waiting on the ring
+        SrqSignalQueueShutdown(&packetQueue);
         PltInterruptThread(&decoderThread);
     }
     
@@ -318,7 +589,7 @@ int startAudioStream(void* audioContext, int arFlags) {
         return err;
     }
 
-    rtpSocket = bindUdpSocket(RemoteAddr.ss_family, RTP_RECV_BUFFER);
+    rtpSocket = bindUdpSocket(RemoteAddr.ss_family, getReceiveBufferSize(RTP_RECV_BUFFER));
     if (rtpSocket == INVALID_SOCKET) {
         err = LastSocketFail();
         AudioCallbacks.cleanup();
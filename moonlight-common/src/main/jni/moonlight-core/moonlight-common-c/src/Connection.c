@@ -6,6 +6,14 @@ static ConnListenerConnectionTerminated originalTerminationCallback;
 static int alreadyTerminated;
 static PLT_THREAD terminationCallbackThread;
 static long terminationCallbackErrorCode;
+static uint64_t stageStartUs;
+
+static PLT_THREAD audioStartThread;
+static int audioStartPending;
+static void* audioStartContext;
+static int audioStartFlags;
+static int audioStartError;
+static uint64_t audioStartElapsedUs;
 
 // Common globals
 char* RemoteAddrString;
@@ -162,11 +170,48 @@ static void ClInternalConnectionTerminated(long errorCode)
     PltCloseThread(&terminationCallbackThread);
 }
 
+static void audioStartThreadFunc(void* context)
+{
+    uint64_t startUs = PltGetMicroseconds();
+
+    audioStartError = startAudioStream(audioStartContext, audioStartFlags);
+    audioStartElapsedUs = PltGetMicroseconds() - startUs;
+}
+
+// The audio stream doesn't depend on the control or video streams, so it is
+// brought up on its own thread while those are established. If that thread
+// can't be created, the audio stream is started right here instead.
+static void beginAudioStreamStart(void* audioContext, int arFlags)
+{
+    audioStartContext = audioContext;
+    audioStartFlags = arFlags;
+
+    audioStartPending = PltCreateThread(audioStartThreadFunc, NULL, &audioStartThread) == 0;
+    if (!audioStartPending) {
+        audioStartThreadFunc(NULL);
+    }
+}
+
+// Waits for the audio stream started by beginAudioStreamStart() and returns its result
+static int finishAudioStreamStart(void)
+{
+    if (audioStartPending) {
+        PltInterruptThread(&audioStartThread);
+        PltJoinThread(&audioStartThread);
+        PltCloseThread(&audioStartThread);
+        audioStartPending = 0;
+    }
+
+    return audioStartError;
+}
+
 // Starts the connection to the streaming machine
 int LiStartConnection(PSERVER_INFORMATION serverInfo, PSTREAM_CONFIGURATION streamConfig, PCONNECTION_LISTENER_CALLBACKS clCallbacks,
     PDECODER_RENDERER_CALLBACKS drCallbacks, PAUDIO_RENDERER_CALLBACKS arCallbacks, void* renderContext, int drFlags,
     void* audioContext, int arFlags) {
     int err;
+    int audioStartOutstanding = 0;
+    uint64_t connectionStartUs = PltGetMicroseconds();
 
     NegotiatedVideoFormat = 0;
     memcpy(&StreamConfig, streamConfig, sizeof(StreamConfig));
@@ -207,6 +252,7 @@ int LiStartConnection(PSERVER_INFORMATION serverInfo, PSTREAM_CONFIGURATION stre
 
     Limelog("Initializing platform...");
     ListenerCallbacks.stageStarting(STAGE_PLATFORM_INIT);
+    stageStartUs = PltGetMicroseconds();
     err = initializePlatform();
     if (err != 0) {
         Limelog("failed: %d\n", err);
@@ -215,11 +261,13 @@ int LiStartConnection(PSERVER_INFORMATION serverInfo, PSTREAM_CONFIGURATION stre
     }
     stage++;
     LC_ASSERT(stage == STAGE_PLATFORM_INIT);
+    ListenerCallbacks.stageTiming(STAGE_PLATFORM_INIT, PltGetMicroseconds() - stageStartUs);
     ListenerCallbacks.stageComplete(STAGE_PLATFORM_INIT);
     Limelog("done\n");
 
     Limelog("Resolving host name...");
     ListenerCallbacks.stageStarting(STAGE_NAME_RESOLUTION);
+    stageStartUs = PltGetMicroseconds();
     err = resolveHostName(serverInfo->address, AF_UNSPEC, 47984, &RemoteAddr, &RemoteAddrLen);
     if (err != 0) {
         Limelog("failed: %d\n", err);
@@ -228,6 +276,7 @@ int LiStartConnection(PSERVER_INFORMATION serverInfo, PSTREAM_CONFIGURATION stre
     }
     stage++;
     LC_ASSERT(stage == STAGE_NAME_RESOLUTION);
+    ListenerCallbacks.stageTiming(STAGE_NAME_RESOLUTION, PltGetMicroseconds() - stageStartUs);
     ListenerCallbacks.stageComplete(STAGE_NAME_RESOLUTION);
     Limelog("done\n");
 
@@ -252,6 +301,7 @@ int LiStartConnection(PSERVER_INFORMATION serverInfo, PSTREAM_CONFIGURATION stre
 
     Limelog("Starting RTSP handshake...");
     ListenerCallbacks.stageStarting(STAGE_RTSP_HANDSHAKE);
+    stageStartUs = PltGetMicroseconds();
     err = performRtspHandshake();
     if (err != 0) {
         Limelog("failed: %d\n", err);
@@ -260,11 +310,13 @@ int LiStartConnection(PSERVER_INFORMATION serverInfo, PSTREAM_CONFIGURATION stre
     }
     stage++;
     LC_ASSERT(stage == STAGE_RTSP_HANDSHAKE);
+    ListenerCallbacks.stageTiming(STAGE_RTSP_HANDSHAKE, PltGetMicroseconds() - stageStartUs);
     ListenerCallbacks.stageComplete(STAGE_RTSP_HANDSHAKE);
     Limelog("done\n");
 
     Limelog("Initializing control stream...");
     ListenerCallbacks.stageStarting(STAGE_CONTROL_STREAM_INIT);
+    stageStartUs = PltGetMicroseconds();
     err = initializeControlStream();
     if (err != 0) {
         Limelog("failed: %d\n", err);
@@ -273,35 +325,61 @@ int LiStartConnection(PSERVER_INFORMATION serverInfo, PSTREAM_CONFIGURATION stre
     }
     stage++;
     LC_ASSERT(stage == STAGE_CONTROL_STREAM_INIT);
+    ListenerCallbacks.stageTiming(STAGE_CONTROL_STREAM_INIT, PltGetMicroseconds() - stageStartUs);
     ListenerCallbacks.stageComplete(STAGE_CONTROL_STREAM_INIT);
     Limelog("done\n");
 
     Limelog("Initializing video stream...");
     ListenerCallbacks.stageStarting(STAGE_VIDEO_STREAM_INIT);
-    initializeVideoStream();
+    stageStartUs = PltGetMicroseconds();
+    err = initializeVideoStream();
+    if (err != 0) {
+        Limelog("failed: %d\n", err);
+        ListenerCallbacks.stageFailed(STAGE_VIDEO_STREAM_INIT, err);
+        goto Cleanup;
+    }
     stage++;
     LC_ASSERT(stage == STAGE_VIDEO_STREAM_INIT);
+    ListenerCallbacks.stageTiming(STAGE_VIDEO_STREAM_INIT, PltGetMicroseconds() - stageStartUs);
     ListenerCallbacks.stageComplete(STAGE_VIDEO_STREAM_INIT);
     Limelog("done\n");
 
     Limelog("Initializing audio stream...");
     ListenerCallbacks.stageStarting(STAGE_AUDIO_STREAM_INIT);
-    initializeAudioStream();
+    stageStartUs = PltGetMicroseconds();
+    err = initializeAudioStream();
+    if (err != 0) {
+        Limelog("failed: %d\n", err);
+        ListenerCallbacks.stageFailed(STAGE_AUDIO_STREAM_INIT, err);
+        goto Cleanup;
+    }
     stage++;
     LC_ASSERT(stage == STAGE_AUDIO_STREAM_INIT);
+    ListenerCallbacks.stageTiming(STAGE_AUDIO_STREAM_INIT, PltGetMicroseconds() - stageStartUs);
     ListenerCallbacks.stageComplete(STAGE_AUDIO_STREAM_INIT);
     Limelog("done\n");
 
     Limelog("Initializing input stream...");
     ListenerCallbacks.stageStarting(STAGE_INPUT_STREAM_INIT);
-    initializeInputStream();
+    stageStartUs = PltGetMicroseconds();
+    err = initializeInputStream();
+    if (err != 0) {
+        Limelog("failed: %d\n", err);
+        ListenerCallbacks.stageFailed(STAGE_INPUT_STREAM_INIT, err);
+        goto Cleanup;
+    }
     stage++;
     LC_ASSERT(stage == STAGE_INPUT_STREAM_INIT);
+    ListenerCallbacks.stageTiming(STAGE_INPUT_STREAM_INIT, PltGetMicroseconds() - stageStartUs);
     ListenerCallbacks.stageComplete(STAGE_INPUT_STREAM_INIT);
     Limelog("done\n");
 
+    beginAudioStreamStart(audioContext, arFlags);
+    audioStartOutstanding = 1;
+
     Limelog("Starting control stream...");
     ListenerCallbacks.stageStarting(STAGE_CONTROL_STREAM_START);
+    stageStartUs = PltGetMicroseconds();
     err = startControlStream();
     if (err != 0) {
         Limelog("failed: %d\n", err);
@@ -310,11 +388,13 @@ int LiStartConnection(PSERVER_INFORMATION serverInfo, PSTREAM_CONFIGURATION stre
     }
     stage++;
     LC_ASSERT(stage == STAGE_CONTROL_STREAM_START);
+    ListenerCallbacks.stageTiming(STAGE_CONTROL_STREAM_START, PltGetMicroseconds() - stageStartUs);
     ListenerCallbacks.stageComplete(STAGE_CONTROL_STREAM_START);
     Limelog("done\n");
 
     Limelog("Starting video stream...");
     ListenerCallbacks.stageStarting(STAGE_VIDEO_STREAM_START);
+    stageStartUs = PltGetMicroseconds();
     err = startVideoStream(renderContext, drFlags);
     if (err != 0) {
         Limelog("Video stream start failed: %d\n", err);
@@ -323,12 +403,14 @@ int LiStartConnection(PSERVER_INFORMATION serverInfo, PSTREAM_CONFIGURATION stre
     }
     stage++;
     LC_ASSERT(stage == STAGE_VIDEO_STREAM_START);
+    ListenerCallbacks.stageTiming(STAGE_VIDEO_STREAM_START, PltGetMicroseconds() - stageStartUs);
     ListenerCallbacks.stageComplete(STAGE_VIDEO_STREAM_START);
     Limelog("done\n");
 
     Limelog("Starting audio stream...");
     ListenerCallbacks.stageStarting(STAGE_AUDIO_STREAM_START);
-    err = startAudioStream(audioContext, arFlags);
+    err = finishAudioStreamStart();
+    audioStartOutstanding = 0;
     if (err != 0) {
         Limelog("Audio stream start failed: %d\n", err);
         ListenerCallbacks.stageFailed(STAGE_AUDIO_STREAM_START, err);
@@ -336,11 +418,13 @@ int LiStartConnection(PSERVER_INFORMATION serverInfo, PSTREAM_CONFIGURATION stre
     }
     stage++;
     LC_ASSERT(stage == STAGE_AUDIO_STREAM_START);
+    ListenerCallbacks.stageTiming(STAGE_AUDIO_STREAM_START, audioStartElapsedUs);
     ListenerCallbacks.stageComplete(STAGE_AUDIO_STREAM_START);
     Limelog("done\n");
 
     Limelog("Starting input stream...");
     ListenerCallbacks.stageStarting(STAGE_INPUT_STREAM_START);
+    stageStartUs = PltGetMicroseconds();
     err = startInputStream();
     if (err != 0) {
         Limelog("Input stream start failed: %d\n", err);
@@ -349,6 +433,7 @@ int LiStartConnection(PSERVER_INFORMATION serverInfo, PSTREAM_CONFIGURATION stre
     }
     stage++;
     LC_ASSERT(stage == STAGE_INPUT_STREAM_START);
+    ListenerCallbacks.stageTiming(STAGE_INPUT_STREAM_START, PltGetMicroseconds() - stageStartUs);
     ListenerCallbacks.stageComplete(STAGE_INPUT_STREAM_START);
     Limelog("done\n");
     
@@ -358,10 +443,17 @@ int LiStartConnection(PSERVER_INFORMATION serverInfo, PSTREAM_CONFIGURATION stre
     LiSendMouseMoveEvent(-1, -1);
     PltSleepMs(10);
 
+    Limelog("Connection started in %d ms\n", (int)((PltGetMicroseconds() - connectionStartUs) / 1000));
     ListenerCallbacks.connectionStarted();
 
 Cleanup:
     if (err != 0) {
+        // A stage that ran alongside the audio stream start failed, so we must
+        // stop the audio stream ourselves if it came up
+        if (audioStartOutstanding && finishAudioStreamStart() == 0) {
+            stopAudioStream();
+        }
+
         // Undo any work we've done here before failing
         LiStopConnection();
     }
@@ -1,6 +1,7 @@
 #include "Limelight-internal.h"
 #include "PlatformSockets.h"
 #include "PlatformThreads.h"
+#include "SpscRingQueue.h"
 
 #include "ByteBuffer.h"
 
@@ -19,7 +20,6 @@ typedef struct _NVCTL_ENET_PACKET_HEADER {
 typedef struct _QUEUED_FRAME_INVALIDATION_TUPLE {
     int startFrame;
     int endFrame;
-    LINKED_BLOCKING_QUEUE_ENTRY entry;
 } QUEUED_FRAME_INVALIDATION_TUPLE, *PQUEUED_FRAME_INVALIDATION_TUPLE;
 
 static SOCKET ctlSock = INVALID_SOCKET;
@@ -36,7 +36,7 @@ static long lastSeenFrame;
 static int stopping;
 
 static int idrFrameRequired;
-static LINKED_BLOCKING_QUEUE invalidReferenceFrameTuples;
+static SPSC_RING_QUEUE invalidReferenceFrameTuples;
 
 #define IDX_START_A 0
 #define IDX_REQUEST_IDR_FRAME 0
@@ -147,9 +147,15 @@ static char**preconstructedPayloads;
 
 // Initializes the control stream
 int initializeControlStream(void) {
+    int err;
+
     stopping = 0;
     PltCreateEvent(&invalidateRefFramesEvent);
-    LbqInitializeLinkedBlockingQueue(&invalidReferenceFrameTuples, 20);
+    err = SrqInitializeRingQueue(&invalidReferenceFrameTuples, 20);
+    if (err != 0) {
+        PltCloseEvent(&invalidateRefFramesEvent);
+        return err;
+    }
     PltCreateMutex(&enetMutex);
 
     if (AppVersionQuad[0] == 3) {
@@ -181,27 +187,17 @@ int initializeControlStream(void) {
     return 0;
 }
 
-void freeFrameInvalidationList(PLINKED_BLOCKING_QUEUE_ENTRY entry) {
-    PLINKED_BLOCKING_QUEUE_ENTRY nextEntry;
-
-    while (entry != NULL) {
-        nextEntry = entry->flink;
-        free(entry->data);
-        entry = nextEntry;
-    }
-}
-
 // Cleans up control stream
 void destroyControlStream(void) {
     LC_ASSERT(stopping);
     PltCloseEvent(&invalidateRefFramesEvent);
-    freeFrameInvalidationList(LbqDestroyLinkedBlockingQueue(&invalidReferenceFrameTuples));
+    SrqDestroyRingQueue(&invalidReferenceFrameTuples, free);
     PltDeleteMutex(&enetMutex);
 }
 
 int getNextFrameInvalidationTuple(PQUEUED_FRAME_INVALIDATION_TUPLE* qfit) {
-    int err = LbqPollQueueElement(&invalidReferenceFrameTuples, (void**)qfit);
-    return (err == LBQ_SUCCESS);
+    int err = SrqPollQueueElement(&invalidReferenceFrameTuples, (void**)qfit);
+    return (err == SRQ_SUCCESS);
 }
 
 void queueFrameInvalidationTuple(int startFrame, int endFrame) {
@@ -213,8 +209,8 @@ void queueFrameInvalidationTuple(int startFrame, int endFrame) {
         if (qfit != NULL) {
             qfit->startFrame = startFrame;
             qfit->endFrame = endFrame;
-            if (LbqOfferQueueItem(&invalidReferenceFrameTuples, qfit, &qfit->entry) == LBQ_BOUND_EXCEEDED) {
-                // Too many invalidation tuples, so we need an IDR frame now
+            if (SrqOfferQueueItem(&invalidReferenceFrameTuples, qfit) != SRQ_SUCCESS) {
+                // Too many invalidation tuples (or we're stopping), so we need an IDR frame now
                 free(qfit);
                 idrFrameRequired = 1;
             }
@@ -283,15 +279,12 @@ static PNVCTL_TCP_PACKET_HEADER readNvctlPacketTcp(void) {
     return fullPacket;
 }
 
-static int sendMessageEnet(short ptype, short paylen, const void* payload) {
-    PNVCTL_ENET_PACKET_HEADER packet;
-    ENetPacket* enetPacket;
+// Handles events that arrived since the last send. Returns 0 if the
+// connection is gone.
+static int serviceEnetEvents(void) {
     ENetEvent event;
     int err;
 
-    LC_ASSERT(AppVersionQuad[0] >= 5);
-
-    // Gen 5+ servers do control protocol over ENet instead of TCP
     while ((err = serviceEnetHost(client, &event, 0)) > 0) {
         if (event.type == ENET_EVENT_TYPE_RECEIVE) {
             enet_packet_destroy(event.packet);
@@ -307,31 +300,43 @@ static int sendMessageEnet(short ptype, short paylen, const void* payload) {
         return 0;
     }
 
-    packet = malloc(sizeof(*packet) + paylen);
-    if (packet == NULL) {
-        return 0;
-    }
+    return 1;
+}
 
-    packet->type = ptype;
-    memcpy(&packet[1], payload, paylen);
+// Queues a message on the peer without flushing it to the network
+static int queueMessageEnet(short ptype, short paylen, const void* payload) {
+    PNVCTL_ENET_PACKET_HEADER packet;
+    ENetPacket* enetPacket;
 
-    enetPacket = enet_packet_create(packet, sizeof(*packet) + paylen, ENET_PACKET_FLAG_RELIABLE);
+    // Build the message in place rather than copying it into the ENet packet
+    enetPacket = enet_packet_create(NULL, sizeof(*packet) + paylen, ENET_PACKET_FLAG_RELIABLE);
     if (enetPacket == NULL) {
-        free(packet);
         return 0;
     }
 
+    packet = (PNVCTL_ENET_PACKET_HEADER)enetPacket->data;
+    packet->type = ptype;
+    memcpy(&packet[1], payload, paylen);
+
     if (enet_peer_send(peer, 0, enetPacket) < 0) {
         Limelog("Failed to send ENet control packet\n");
         enet_packet_destroy(enetPacket);
-        free(packet);
+        return 0;
+    }
+
+    return 1;
+}
+
+static int sendMessageEnet(short ptype, short paylen, const void* payload) {
+    LC_ASSERT(AppVersionQuad[0] >= 5);
+
+    // Gen 5+ servers do control protocol over ENet instead of TCP
+    if (!serviceEnetEvents() || !queueMessageEnet(ptype, paylen, payload)) {
         return 0;
     }
     
     enet_host_flush(client);
 
-    free(packet);
-
     return 1;
 }
 
@@ -533,10 +538,7 @@ static void invalidateRefFramesFunc(void* context) {
         // Sometimes we absolutely need an IDR frame
         if (idrFrameRequired) {
             // Empty invalidate reference frames tuples
-            PQUEUED_FRAME_INVALIDATION_TUPLE qfit;
-            while (getNextFrameInvalidationTuple(&qfit)) {
-                free(qfit);
-            }
+            SrqFlushQueueItems(&invalidReferenceFrameTuples, free);
 
             // Send an IDR frame request
             idrFrameRequired = 0;
@@ -549,11 +551,16 @@ static void invalidateRefFramesFunc(void* context) {
     }
 }
 
-// Stops the control stream
-int stopControlStream(void) {
+// Marks the control stream as stopping and wakes anything waiting on it
+void interruptControlStream(void) {
     stopping = 1;
-    LbqSignalQueueShutdown(&invalidReferenceFrameTuples);
+    SrqSignalQueueShutdown(&invalidReferenceFrameTuples);
     PltSetEvent(&invalidateRefFramesEvent);
+}
+
+// Stops the control stream
+int stopControlStream(void) {
+    interruptControlStream();
 
     // This must be set to stop in a timely manner
     LC_ASSERT(ConnectionInterrupted);
@@ -590,16 +597,29 @@ int stopControlStream(void) {
     return 0;
 }
 
-// Called by the input stream to send a packet for Gen 5+ servers
-int sendInputPacketOnControlStream(unsigned char* data, int length) {
+// Sends several input messages laid out back to back in data. They are queued
+// as separate control messages but flushed together, so ENet can bundle them
+// into a single datagram.
+int sendInputPacketBatchOnControlStream(unsigned char* data, int* lengths, int count) {
+    int i;
+    int ret;
+
     LC_ASSERT(AppVersionQuad[0] >= 5);
 
-    // Send the input data (no reply expected)
-    if (sendMessageAndForget(packetTypes[IDX_INPUT_DATA], length, data) == 0) {
-        return -1;
+    PltLockMutex(&enetMutex);
+
+    ret = serviceEnetEvents();
+    for (i = 0; i < count && ret; i++) {
+        ret = queueMessageEnet(packetTypes[IDX_INPUT_DATA], lengths[i], data);
+        data += lengths[i];
     }
 
-    return 0;
+    // Flush even on failure so anything already queued goes out
+    enet_host_flush(client);
+
+    PltUnlockMutex(&enetMutex);
+
+    return ret ? 0 : -1;
 }
 
 // Starts the control stream
@@ -36,6 +36,7 @@ static void fakeClConnectionTerminated(long errorCode) {}
 static void fakeClDisplayMessage(const char* message) {}
 static void fakeClDisplayTransientMessage(const char* message) {}
 static void fakeClLogMessage(const char* format, ...) {}
+static void fakeClStageTiming(int stage, uint64_t elapsedUs) {}
 
 static CONNECTION_LISTENER_CALLBACKS fakeClCallbacks = {
     .stageStarting = fakeClStageStarting,
@@ -46,6 +47,7 @@ static CONNECTION_LISTENER_CALLBACKS fakeClCallbacks = {
     .displayMessage = fakeClDisplayMessage,
     .displayTransientMessage = fakeClDisplayTransientMessage,
     .logMessage = fakeClLogMessage,
+    .stageTiming = fakeClStageTiming,
 };
 
 void fixupMissingCallbacks(PDECODER_RENDERER_CALLBACKS* drCallbacks, PAUDIO_RENDERER_CALLBACKS* arCallbacks,
@@ -121,5 +123,8 @@ void fixupMissingCallbacks(PDECODER_RENDERER_CALLBACKS* drCallbacks, PAUDIO_REND
         if ((*clCallbacks)->logMessage == NULL) {
             (*clCallbacks)->logMessage = fakeClLogMessage;
         }
+        if ((*clCallbacks)->stageTiming == NULL) {
+            (*clCallbacks)->stageTiming = fakeClStageTiming;
+        }
     }
 }
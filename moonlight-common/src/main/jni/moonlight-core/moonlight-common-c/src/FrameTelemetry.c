@@ -0,0 +1,205 @@
+#include "Limelight-internal.h"
+#include "FrameTelemetry.h"
+#include "PlatformAtomics.h"
+
+#include <stdio.h>
+
+// Roughly 17 seconds of history at 60 FPS
+#define FRAME_TELEMETRY_RING_SIZE 1024
+
+// Each slot is guarded by a sequence number that is odd while the slot is
+// being written, so readers can detect and skip torn copies without locking
+typedef struct _FRAME_TIMING_SLOT {
+    unsigned int sequence;
+    FRAME_TIMING timing;
+} FRAME_TIMING_SLOT;
+
+static FRAME_TIMING_SLOT timingRing[FRAME_TELEMETRY_RING_SIZE];
+static unsigned int timingWriteIndex;
+
+// FEC recovery for a frame is recorded as its first packet is handed to the
+// depacketizer, on the thread doing the handing, so one pending value is enough
+static int fecRecoveryFrameNumber;
+static uint32_t fecRecoveryUs;
+
+void initializeFrameTelemetry(void) {
+    int i;
+
+    PLT_ATOMIC_STORE(&timingWriteIndex, 0);
+    for (i = 0; i < FRAME_TELEMETRY_RING_SIZE; i++) {
+        PLT_ATOMIC_STORE(&timingRing[i].sequence, 0);
+    }
+
+    fecRecoveryFrameNumber = -1;
+    fecRecoveryUs = 0;
+}
+
+void recordFrameFecRecovery(int frameNumber, uint32_t durationUs) {
+    fecRecoveryFrameNumber = frameNumber;
+    fecRecoveryUs = durationUs;
+}
+
+uint32_t takeFrameFecRecovery(int frameNumber) {
+    if (fecRecoveryFrameNumber != frameNumber) {
+        return 0;
+    }
+
+    fecRecoveryFrameNumber = -1;
+    return fecRecoveryUs;
+}
+
+// Only the thread submitting decode units calls this
+void commitFrameTiming(PFRAME_TIMING timing) {
+    unsigned int index = timingWriteIndex;
+    FRAME_TIMING_SLOT* slot = &timingRing[index % FRAME_TELEMETRY_RING_SIZE];
+    unsigned int sequence = slot->sequence;
+
+    PLT_ATOMIC_STORE(&slot->sequence, sequence + 1);
+    PLT_ATOMIC_FENCE();
+    memcpy(&slot->timing, timing, sizeof(*timing));
+    PLT_ATOMIC_STORE(&slot->sequence, sequence + 2);
+
+    PLT_ATOMIC_STORE(&timingWriteIndex, index + 1);
+}
+
+// Copies out the recorded frames from oldest to newest. Returns the number copied.
+static int copyFrameTimings(PFRAME_TIMING timings) {
+    unsigned int writeIndex = PLT_ATOMIC_LOAD(&timingWriteIndex);
+    unsigned int index, sequence;
+    int count = 0;
+
+    index = writeIndex > FRAME_TELEMETRY_RING_SIZE ? writeIndex - FRAME_TELEMETRY_RING_SIZE : 0;
+    for (; index != writeIndex; index++) {
+        FRAME_TIMING_SLOT* slot = &timingRing[index % FRAME_TELEMETRY_RING_SIZE];
+
+        sequence = PLT_ATOMIC_LOAD(&slot->sequence);
+        if (sequence == 0 || (sequence & 1) != 0) {
+            continue;
+        }
+
+        memcpy(&timings[count], &slot->timing, sizeof(timings[count]));
+        PLT_ATOMIC_FENCE();
+
+        // Discard the copy if the writer lapped us while we were reading
+        if (PLT_ATOMIC_LOAD(&slot->sequence) == sequence) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+static uint32_t elapsedUs(uint64_t start, uint64_t end) {
+    return end > start ? (uint32_t)(end - start) : 0;
+}
+
+static int compareUint32(const void* a, const void* b) {
+    uint32_t x = *(const uint32_t*)a;
+    uint32_t y = *(const uint32_t*)b;
+
+    return (x > y) - (x < y);
+}
+
+static void computePercentiles(uint32_t* values, int count, PLATENCY_PERCENTILES percentiles) {
+    qsort(values, count, sizeof(*values), compareUint32);
+
+    percentiles->p50 = values[(count - 1) * 50 / 100];
+    percentiles->p95 = values[(count - 1) * 95 / 100];
+    percentiles->p99 = values[(count - 1) * 99 / 100];
+    percentiles->max = values[count - 1];
+}
+
+int LiGetFrameLatencySnapshot(PFRAME_LATENCY_SNAPSHOT snapshot) {
+    PFRAME_TIMING timings;
+    uint32_t* values;
+    int count, i;
+
+    memset(snapshot, 0, sizeof(*snapshot));
+
+    timings = malloc(FRAME_TELEMETRY_RING_SIZE * sizeof(*timings));
+    values = malloc(FRAME_TELEMETRY_RING_SIZE * sizeof(*values));
+    if (timings == NULL || values == NULL) {
+        free(timings);
+        free(values);
+        return -1;
+    }
+
+    count = copyFrameTimings(timings);
+    snapshot->frameCount = count;
+
+    if (count != 0) {
+        for (i = 0; i < count; i++) {
+            values[i] = elapsedUs(timings[i].firstPacketUs, timings[i].lastPacketUs);
+        }
+        computePercentiles(values, count, &snapshot->receive);
+
+        for (i = 0; i < count; i++) {
+            values[i] = timings[i].fecRecoveryUs;
+        }
+        computePercentiles(values, count, &snapshot->fecRecovery);
+
+        for (i = 0; i < count; i++) {
+            values[i] = elapsedUs(timings[i].lastPacketUs, timings[i].depacketizedUs);
+        }
+        computePercentiles(values, count, &snapshot->depacketize);
+
+        for (i = 0; i < count; i++) {
+            values[i] = elapsedUs(timings[i].depacketizedUs, timings[i].dequeuedUs);
+        }
+        computePercentiles(values, count, &snapshot->queueDwell);
+
+        for (i = 0; i < count; i++) {
+            values[i] = elapsedUs(timings[i].dequeuedUs, timings[i].submitReturnedUs);
+        }
+        computePercentiles(values, count, &snapshot->decoderSubmit);
+
+        for (i = 0; i < count; i++) {
+            values[i] = elapsedUs(timings[i].firstPacketUs, timings[i].submitReturnedUs);
+        }
+        computePercentiles(values, count, &snapshot->total);
+    }
+
+    free(timings);
+    free(values);
+    return 0;
+}
+
+int LiWriteFrameLatencyCsv(const char* path) {
+    PFRAME_TIMING timings;
+    FILE* file;
+    int count, i;
+
+    timings = malloc(FRAME_TELEMETRY_RING_SIZE * sizeof(*timings));
+    if (timings == NULL) {
+        return -1;
+    }
+
+    file = fopen(path, "w");
+    if (file == NULL) {
+        free(timings);
+        return -1;
+    }
+
+    count = copyFrameTimings(timings);
+
+    fprintf(file, "frame,type,first_packet_us,last_packet_us,fec_recovery_us,depacketized_us,dequeued_us,submit_returned_us\n");
+    for (i = 0; i < count; i++) {
+        fprintf(file, "%d,%d,%llu,%llu,%u,%llu,%llu,%llu\n",
+                timings[i].frameNumber,
+                timings[i].frameType,
+                (unsigned long long)timings[i].firstPacketUs,
+                (unsigned long long)timings[i].lastPacketUs,
+                (unsigned int)timings[i].fecRecoveryUs,
+                (unsigned long long)timings[i].depacketizedUs,
+                (unsigned long long)timings[i].dequeuedUs,
+                (unsigned long long)timings[i].submitReturnedUs);
+    }
+
+    free(timings);
+
+    if (fclose(file) != 0) {
+        return -1;
+    }
+
+    return 0;
+}
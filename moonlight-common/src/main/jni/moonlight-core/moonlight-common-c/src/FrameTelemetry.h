@@ -0,0 +1,21 @@
+#pragma once
+
+#include "Platform.h"
+
+// Timestamps (in microseconds) collected for each video frame as it moves
+// from the socket to the decoder
+typedef struct _FRAME_TIMING {
+    int frameNumber;
+    int frameType;
+    uint64_t firstPacketUs;
+    uint64_t lastPacketUs;
+    uint32_t fecRecoveryUs;
+    uint64_t depacketizedUs;
+    uint64_t dequeuedUs;
+    uint64_t submitReturnedUs;
+} FRAME_TIMING, *PFRAME_TIMING;
+
+void initializeFrameTelemetry(void);
+void recordFrameFecRecovery(int frameNumber, uint32_t durationUs);
+uint32_t takeFrameFecRecovery(int frameNumber);
+void commitFrameTiming(PFRAME_TIMING timing);
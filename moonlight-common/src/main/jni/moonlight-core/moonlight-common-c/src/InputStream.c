@@ -2,6 +2,7 @@
 #include "PlatformSockets.h"
 #include "PlatformThreads.h"
 #include "LinkedBlockingQueue.h"
+#include "PacketPool.h"
 #include "Input.h"
 
 #include <openssl/evp.h>
@@ -13,11 +14,18 @@ static EVP_CIPHER_CTX* cipherContext;
 static int cipherInitialized;
 
 static LINKED_BLOCKING_QUEUE packetQueue;
+static PACKET_POOL holderPool;
 static PLT_THREAD inputSendThread;
+static int coalescingWindowMs;
 
 #define MAX_INPUT_PACKET_SIZE 128
 #define INPUT_STREAM_TIMEOUT_SEC 10
 
+#define INPUT_QUEUE_BOUND 30
+
+// Most input messages encrypted and sent in one flush
+#define INPUT_BATCH_MAX_PACKETS 16
+
 #define ROUND_TO_PKCS7_PADDED_LEN(x) ((((x) + 15) / 16) * 16)
 
 // Contains input stream packets
@@ -34,18 +42,53 @@ typedef struct _PACKET_HOLDER {
     LINKED_BLOCKING_QUEUE_ENTRY entry;
 } PACKET_HOLDER, *PPACKET_HOLDER;
 
-#if OPENSSL_VERSION_NUMBER < 0x10100000L
-#define EVP_CIPHER_CTX_reset(x) EVP_CIPHER_CTX_cleanup(x); EVP_CIPHER_CTX_init(x)
-#endif
+// Creates and keys the cipher context for this connection
+static int initializeCipher(void) {
+    if ((cipherContext = EVP_CIPHER_CTX_new()) == NULL) {
+        return -1;
+    }
+
+    if (AppVersionQuad[0] >= 7) {
+        // Gen 7 servers use 128-bit AES GCM with 16 byte IVs. The key never
+        // changes, so the context is keyed once and each packet only sets the IV.
+        if (EVP_EncryptInit_ex(cipherContext, EVP_aes_128_gcm(), NULL, NULL, NULL) != 1 ||
+            EVP_CIPHER_CTX_ctrl(cipherContext, EVP_CTRL_GCM_SET_IVLEN, 16, NULL) != 1 ||
+            EVP_EncryptInit_ex(cipherContext, NULL, NULL,
+                               (const unsigned char*)StreamConfig.remoteInputAesKey, NULL) != 1) {
+            EVP_CIPHER_CTX_free(cipherContext);
+            return -1;
+        }
+    }
+    else {
+        // Prior to Gen 7, 128-bit AES CBC is used for encryption
+        if (EVP_EncryptInit_ex(cipherContext, EVP_aes_128_cbc(), NULL,
+                               (const unsigned char*)StreamConfig.remoteInputAesKey, currentAesIv) != 1) {
+            EVP_CIPHER_CTX_free(cipherContext);
+            return -1;
+        }
+    }
+
+    cipherInitialized = 1;
+    return 0;
+}
 
 // Initializes the input stream
 int initializeInputStream(void) {
+    int err;
+
+    err = PpInitializePacketPool(&holderPool, sizeof(PACKET_HOLDER), INPUT_QUEUE_BOUND + INPUT_BATCH_MAX_PACKETS);
+    if (err != 0) {
+        return err;
+    }
+
     memcpy(currentAesIv, StreamConfig.remoteInputAesIv, sizeof(currentAesIv));
     
-    // Initialized on first packet
+    // Key the cipher now so the first input event doesn't pay for it. If this
+    // fails, we'll try again when the first packet is encrypted.
     cipherInitialized = 0;
+    initializeCipher();
     
-    LbqInitializeLinkedBlockingQueue(&packetQueue, 30);
+    LbqInitializeLinkedBlockingQueue(&packetQueue, INPUT_QUEUE_BOUND);
 
     initialized = 1;
     return 0;
@@ -66,11 +109,13 @@ void destroyInputStream(void) {
         nextEntry = entry->flink;
 
         // The entry is stored in the data buffer
-        free(entry->data);
+        PpFreePacket(&holderPool, entry->data);
 
         entry = nextEntry;
     }
 
+    PpCleanupPacketPool(&holderPool);
+
     initialized = 0;
 }
 
@@ -88,80 +133,45 @@ static int addPkcs7PaddingInPlace(unsigned char* plaintext, int plaintextLen) {
 
 static int encryptData(const unsigned char* plaintext, int plaintextLen,
                        unsigned char* ciphertext, int* ciphertextLen) {
-    int ret;
     int len;
     
     if (AppVersionQuad[0] >= 7) {
-        if (!cipherInitialized) {
-            if ((cipherContext = EVP_CIPHER_CTX_new()) == NULL) {
-                return -1;
-            }
-            cipherInitialized = 1;
+        if (!cipherInitialized && initializeCipher() != 0) {
+            return -1;
         }
 
-        // Gen 7 servers use 128-bit AES GCM
-        if (EVP_EncryptInit_ex(cipherContext, EVP_aes_128_gcm(), NULL, NULL, NULL) != 1) {
-            ret = -1;
-            goto gcm_cleanup;
-        }
-        
-        // Gen 7 servers uses 16 byte IVs
-        if (EVP_CIPHER_CTX_ctrl(cipherContext, EVP_CTRL_GCM_SET_IVLEN, 16, NULL) != 1) {
-            ret = -1;
-            goto gcm_cleanup;
-        }
-        
-        // Initialize again but now provide our key and current IV
-        if (EVP_EncryptInit_ex(cipherContext, NULL, NULL,
-                               (const unsigned char*)StreamConfig.remoteInputAesKey, currentAesIv) != 1) {
-            ret = -1;
-            goto gcm_cleanup;
+        // Start a new message with our current IV
+        if (EVP_EncryptInit_ex(cipherContext, NULL, NULL, NULL, currentAesIv) != 1) {
+            return -1;
         }
         
         // Encrypt into the caller's buffer, leaving room for the auth tag to be prepended
         if (EVP_EncryptUpdate(cipherContext, &ciphertext[16], ciphertextLen, plaintext, plaintextLen) != 1) {
-            ret = -1;
-            goto gcm_cleanup;
+            return -1;
         }
         
         // GCM encryption won't ever fill ciphertext here but we have to call it anyway
         if (EVP_EncryptFinal_ex(cipherContext, ciphertext, &len) != 1) {
-            ret = -1;
-            goto gcm_cleanup;
+            return -1;
         }
         LC_ASSERT(len == 0);
         
         // Read the tag into the caller's buffer
         if (EVP_CIPHER_CTX_ctrl(cipherContext, EVP_CTRL_GCM_GET_TAG, 16, ciphertext) != 1) {
-            ret = -1;
-            goto gcm_cleanup;
+            return -1;
         }
         
         // Increment the ciphertextLen to account for the tag
         *ciphertextLen += 16;
         
-        ret = 0;
-        
-    gcm_cleanup:
-        EVP_CIPHER_CTX_reset(cipherContext);
+        return 0;
     }
     else {
         unsigned char paddedData[MAX_INPUT_PACKET_SIZE];
         int paddedLength;
         
-        if (!cipherInitialized) {
-            if ((cipherContext = EVP_CIPHER_CTX_new()) == NULL) {
-                ret = -1;
-                goto cbc_cleanup;
-            }
-            cipherInitialized = 1;
-
-            // Prior to Gen 7, 128-bit AES CBC is used for encryption
-            if (EVP_EncryptInit_ex(cipherContext, EVP_aes_128_cbc(), NULL,
-                                   (const unsigned char*)StreamConfig.remoteInputAesKey, currentAesIv) != 1) {
-                ret = -1;
-                goto cbc_cleanup;
-            }
+        if (!cipherInitialized && initializeCipher() != 0) {
+            return -1;
         }
         
         // Pad the data to the required block length
@@ -169,152 +179,174 @@ static int encryptData(const unsigned char* plaintext, int plaintextLen,
         paddedLength = addPkcs7PaddingInPlace(paddedData, plaintextLen);
         
         if (EVP_EncryptUpdate(cipherContext, ciphertext, ciphertextLen, paddedData, paddedLength) != 1) {
-            ret = -1;
-            goto cbc_cleanup;
+            return -1;
         }
         
-        ret = 0;
+        return 0;
+    }
+}
 
-    cbc_cleanup:
-        // Nothing to do
-        ;
+// Folds next into prev when the server would end up in the same state either
+// way. Returns 1 if next was absorbed.
+static int coalesceInputPacket(PPACKET_HOLDER prev, PPACKET_HOLDER next) {
+    if (prev->packet.multiController.header.packetType != next->packet.multiController.header.packetType) {
+        return 0;
     }
-    
-    return ret;
+
+    // Analog state of the same controller can be merged
+    if (prev->packet.multiController.header.packetType == htonl(PACKET_TYPE_MULTI_CONTROLLER)) {
+        PNV_MULTI_CONTROLLER_PACKET origPkt = &prev->packet.multiController;
+        PNV_MULTI_CONTROLLER_PACKET newPkt = &next->packet.multiController;
+
+        // Check if it's able to be batched
+        // NB: GFE does some discarding of gamepad packets received very soon after another.
+        // Thus, this batching is needed for correctness in some cases, as GFE will inexplicably
+        // drop *newer* packets in that scenario. The brokenness can be tested with consecutive
+        // calls to LiSendMultiControllerEvent() with different values for analog sticks (max -> zero).
+        if (newPkt->buttonFlags != origPkt->buttonFlags ||
+            newPkt->controllerNumber != origPkt->controllerNumber ||
+            newPkt->activeGamepadMask != origPkt->activeGamepadMask) {
+            // Batching not allowed
+            return 0;
+        }
+
+        // Update the original packet
+        origPkt->leftTrigger = newPkt->leftTrigger;
+        origPkt->rightTrigger = newPkt->rightTrigger;
+        origPkt->leftStickX = newPkt->leftStickX;
+        origPkt->leftStickY = newPkt->leftStickY;
+        origPkt->rightStickX = newPkt->rightStickX;
+        origPkt->rightStickY = newPkt->rightStickY;
+        return 1;
+    }
+    // Relative mouse motion can be summed
+    else if (prev->packet.mouseMove.header.packetType == htonl(PACKET_TYPE_MOUSE_MOVE)) {
+        int totalDeltaX = (short)htons(prev->packet.mouseMove.deltaX) + (short)htons(next->packet.mouseMove.deltaX);
+        int totalDeltaY = (short)htons(prev->packet.mouseMove.deltaY) + (short)htons(next->packet.mouseMove.deltaY);
+
+        // Check for overflow
+        if (totalDeltaX > INT16_MAX || totalDeltaX < INT16_MIN ||
+            totalDeltaY > INT16_MAX || totalDeltaY < INT16_MIN) {
+            // Total delta would overflow our 16-bit short
+            return 0;
+        }
+
+        prev->packet.mouseMove.deltaX = htons((short)totalDeltaX);
+        prev->packet.mouseMove.deltaY = htons((short)totalDeltaY);
+        return 1;
+    }
+
+    return 0;
+}
+
+// Gathers the packets that follow batch[0] into the batch, merging what can be
+// merged. Packets that are already queued are always taken. If a coalescing window
+// is set, we also wait that long after the first packet for more to arrive.
+static int collectInputBatch(PPACKET_HOLDER* batch) {
+    uint64_t deadlineMs = PltGetMillis() + coalescingWindowMs;
+    PPACKET_HOLDER holder;
+    int batchSize = 1;
+    int err;
+
+    for (;;) {
+        // Peek at the next packet
+        err = LbqPeekQueueElement(&packetQueue, (void**)&holder);
+        if (err == LBQ_NO_ELEMENT && PltGetMillis() < deadlineMs) {
+            PltSleepMs(1);
+            continue;
+        }
+        else if (err != LBQ_SUCCESS) {
+            break;
+        }
+
+        if (coalesceInputPacket(batch[batchSize - 1], holder)) {
+            // Remove the merged packet. We're the only consumer, so this is the packet we peeked at.
+            if (LbqPollQueueElement(&packetQueue, (void**)&holder) != LBQ_SUCCESS) {
+                break;
+            }
+
+            PpFreePacket(&holderPool, holder);
+        }
+        else if (batchSize < INPUT_BATCH_MAX_PACKETS) {
+            if (LbqPollQueueElement(&packetQueue, (void**)&holder) != LBQ_SUCCESS) {
+                break;
+            }
+
+            batch[batchSize++] = holder;
+        }
+        else {
+            // This one will start the next batch
+            break;
+        }
+    }
+
+    return batchSize;
 }
 
 // Input thread proc
 static void inputSendThreadProc(void* context) {
     SOCK_RET err;
-    PPACKET_HOLDER holder;
-    char encryptedBuffer[MAX_INPUT_PACKET_SIZE];
-    int encryptedSize;
+    PPACKET_HOLDER batch[INPUT_BATCH_MAX_PACKETS];
+    int encryptedLengths[INPUT_BATCH_MAX_PACKETS];
+    char encryptedBuffer[INPUT_BATCH_MAX_PACKETS * MAX_INPUT_PACKET_SIZE];
+    int batchSize;
+    int totalLength;
+    int i;
 
     while (!PltIsThreadInterrupted(&inputSendThread)) {
-        int encryptedLengthPrefix;
-
-        err = LbqWaitForQueueElement(&packetQueue, (void**)&holder);
+        err = LbqWaitForQueueElement(&packetQueue, (void**)&batch[0]);
         if (err != LBQ_SUCCESS) {
             return;
         }
 
-        // If it's a multi-controller packet we can do batching
-        if (holder->packet.multiController.header.packetType == htonl(PACKET_TYPE_MULTI_CONTROLLER)) {
-            PPACKET_HOLDER controllerBatchHolder;
-            PNV_MULTI_CONTROLLER_PACKET origPkt;
-
-            origPkt = &holder->packet.multiController;
-            for (;;) {
-                PNV_MULTI_CONTROLLER_PACKET newPkt;
-
-                // Peek at the next packet
-                if (LbqPeekQueueElement(&packetQueue, (void**)&controllerBatchHolder) != LBQ_SUCCESS) {
-                    break;
-                }
-
-                // If it's not a controller packet, we're done
-                if (controllerBatchHolder->packet.multiController.header.packetType != htonl(PACKET_TYPE_MULTI_CONTROLLER)) {
-                    break;
-                }
-
-                // Check if it's able to be batched
-                // NB: GFE does some discarding of gamepad packets received very soon after another.
-                // Thus, this batching is needed for correctness in some cases, as GFE will inexplicably
-                // drop *newer* packets in that scenario. The brokenness can be tested with consecutive
-                // calls to LiSendMultiControllerEvent() with different values for analog sticks (max -> zero).
-                newPkt = &controllerBatchHolder->packet.multiController;
-                if (newPkt->buttonFlags != origPkt->buttonFlags ||
-                    newPkt->controllerNumber != origPkt->controllerNumber ||
-                    newPkt->activeGamepadMask != origPkt->activeGamepadMask) {
-                    // Batching not allowed
-                    break;
-                }
-
-                // Remove the batchable controller packet
-                if (LbqPollQueueElement(&packetQueue, (void**)&controllerBatchHolder) != LBQ_SUCCESS) {
-                    break;
-                }
-
-                // Update the original packet
-                origPkt->leftTrigger = newPkt->leftTrigger;
-                origPkt->rightTrigger = newPkt->rightTrigger;
-                origPkt->leftStickX = newPkt->leftStickX;
-                origPkt->leftStickY = newPkt->leftStickY;
-                origPkt->rightStickX = newPkt->rightStickX;
-                origPkt->rightStickY = newPkt->rightStickY;
-
-                // Free the batched packet holder
-                free(controllerBatchHolder);
+        batchSize = collectInputBatch(batch);
+
+        // Encrypt each message back to back in the output buffer. They must be encrypted
+        // in order because each message may supply the IV for the next one.
+        totalLength = 0;
+        err = 0;
+        for (i = 0; i < batchSize; i++) {
+            char* message = &encryptedBuffer[totalLength];
+            int encryptedLengthPrefix;
+            int encryptedSize;
+
+            if (err == 0) {
+                // Encrypt the message while leaving room for the length
+                encryptedSize = MAX_INPUT_PACKET_SIZE - 4;
+                err = encryptData((const unsigned char*)&batch[i]->packet, batch[i]->packetLength,
+                    (unsigned char*)&message[4], &encryptedSize);
             }
-        }
-        // If it's a mouse move packet, we can also do batching
-        else if (holder->packet.mouseMove.header.packetType == htonl(PACKET_TYPE_MOUSE_MOVE)) {
-            PPACKET_HOLDER mouseBatchHolder;
-            int totalDeltaX = (short)htons(holder->packet.mouseMove.deltaX);
-            int totalDeltaY = (short)htons(holder->packet.mouseMove.deltaY);
-
-            for (;;) {
-                int partialDeltaX;
-                int partialDeltaY;
-
-                // Peek at the next packet
-                if (LbqPeekQueueElement(&packetQueue, (void**)&mouseBatchHolder) != LBQ_SUCCESS) {
-                    break;
-                }
-
-                // If it's not a mouse move packet, we're done
-                if (mouseBatchHolder->packet.mouseMove.header.packetType != htonl(PACKET_TYPE_MOUSE_MOVE)) {
-                    break;
-                }
-
-                partialDeltaX = (short)htons(mouseBatchHolder->packet.mouseMove.deltaX);
-                partialDeltaY = (short)htons(mouseBatchHolder->packet.mouseMove.deltaY);
-
-                // Check for overflow
-                if (partialDeltaX + totalDeltaX > INT16_MAX ||
-                    partialDeltaX + totalDeltaX < INT16_MIN ||
-                    partialDeltaY + totalDeltaY > INT16_MAX ||
-                    partialDeltaY + totalDeltaY < INT16_MIN) {
-                    // Total delta would overflow our 16-bit short
-                    break;
-                }
-
-                // Remove the batchable mouse move packet
-                if (LbqPollQueueElement(&packetQueue, (void**)&mouseBatchHolder) != LBQ_SUCCESS) {
-                    break;
-                }
-
-                totalDeltaX += partialDeltaX;
-                totalDeltaY += partialDeltaY;
-
-                // Free the batched packet holder
-                free(mouseBatchHolder);
+            PpFreePacket(&holderPool, batch[i]);
+            if (err != 0) {
+                continue;
             }
 
-            // Update the original packet
-            holder->packet.mouseMove.deltaX = htons((short)totalDeltaX);
-            holder->packet.mouseMove.deltaY = htons((short)totalDeltaY);
-        }
+            // Prepend the length to the message
+            encryptedLengthPrefix = htonl((unsigned long)encryptedSize);
+            memcpy(&message[0], &encryptedLengthPrefix, 4);
 
-        // Encrypt the message into the output buffer while leaving room for the length
-        encryptedSize = sizeof(encryptedBuffer) - 4;
-        err = encryptData((const unsigned char*)&holder->packet, holder->packetLength,
-            (unsigned char*)&encryptedBuffer[4], &encryptedSize);
-        free(holder);
+            // For reasons that I can't understand, NVIDIA decides to use the last 16
+            // bytes of ciphertext in the most recent game controller packet as the IV for
+            // future encryption. I think it may be a buffer overrun on their end but we'll have
+            // to mimic it to work correctly.
+            if (AppVersionQuad[0] >= 7 && encryptedSize >= 16 + sizeof(currentAesIv)) {
+                memcpy(currentAesIv,
+                       &message[4 + encryptedSize - sizeof(currentAesIv)],
+                       sizeof(currentAesIv));
+            }
+
+            encryptedLengths[i] = encryptedSize + sizeof(encryptedLengthPrefix);
+            totalLength += encryptedLengths[i];
+        }
         if (err != 0) {
             Limelog("Input: Encryption failed: %d\n", (int)err);
             ListenerCallbacks.connectionTerminated(err);
             return;
         }
 
-        // Prepend the length to the message
-        encryptedLengthPrefix = htonl((unsigned long)encryptedSize);
-        memcpy(&encryptedBuffer[0], &encryptedLengthPrefix, 4);
-
         if (AppVersionQuad[0] < 5) {
-            // Send the encrypted payload
-            err = send(inputSock, (const char*) encryptedBuffer,
-                (int) (encryptedSize + sizeof(encryptedLengthPrefix)), 0);
+            // Send the encrypted payloads
+            err = send(inputSock, (const char*) encryptedBuffer, totalLength, 0);
             if (err <= 0) {
                 Limelog("Input: send() failed: %d\n", (int) LastSocketError());
                 ListenerCallbacks.connectionTerminated(LastSocketError());
@@ -322,20 +354,10 @@ static void inputSendThreadProc(void* context) {
             }
         }
         else {
-            // For reasons that I can't understand, NVIDIA decides to use the last 16
-            // bytes of ciphertext in the most recent game controller packet as the IV for
-            // future encryption. I think it may be a buffer overrun on their end but we'll have
-            // to mimic it to work correctly.
-            if (AppVersionQuad[0] >= 7 && encryptedSize >= 16 + sizeof(currentAesIv)) {
-                memcpy(currentAesIv,
-                       &encryptedBuffer[4 + encryptedSize - sizeof(currentAesIv)],
-                       sizeof(currentAesIv));
-            }
-            
-            err = (SOCK_RET)sendInputPacketOnControlStream((unsigned char*) encryptedBuffer,
-                (int) (encryptedSize + sizeof(encryptedLengthPrefix)));
+            err = (SOCK_RET)sendInputPacketBatchOnControlStream((unsigned char*) encryptedBuffer,
+                encryptedLengths, batchSize);
             if (err < 0) {
-                Limelog("Input: sendInputPacketOnControlStream() failed: %d\n", (int) err);
+                Limelog("Input: sendInputPacketBatchOnControlStream() failed: %d\n", (int) err);
                 ListenerCallbacks.connectionTerminated(LastSocketError());
                 return;
             }
@@ -391,6 +413,10 @@ int stopInputStream(void) {
     return 0;
 }
 
+void LiSetInputCoalescingWindow(int windowMs) {
+    coalescingWindowMs = windowMs > 0 ? windowMs : 0;
+}
+
 // Send a mouse move event to the streaming machine
 int LiSendMouseMoveEvent(short deltaX, short deltaY) {
     PPACKET_HOLDER holder;
@@ -400,7 +426,7 @@ int LiSendMouseMoveEvent(short deltaX, short deltaY) {
         return -2;
     }
 
-    holder = malloc(sizeof(*holder));
+    holder = PpAllocatePacket(&holderPool);
     if (holder == NULL) {
         return -1;
     }
@@ -417,7 +443,7 @@ int LiSendMouseMoveEvent(short deltaX, short deltaY) {
 
     err = LbqOfferQueueItem(&packetQueue, holder, &holder->entry);
     if (err != LBQ_SUCCESS) {
-        free(holder);
+        PpFreePacket(&holderPool, holder);
     }
 
     return err;
@@ -432,7 +458,7 @@ int LiSendMouseButtonEvent(char action, int button) {
         return -2;
     }
 
-    holder = malloc(sizeof(*holder));
+    holder = PpAllocatePacket(&holderPool);
     if (holder == NULL) {
         return -1;
     }
@@ -447,7 +473,7 @@ int LiSendMouseButtonEvent(char action, int button) {
 
     err = LbqOfferQueueItem(&packetQueue, holder, &holder->entry);
     if (err != LBQ_SUCCESS) {
-        free(holder);
+        PpFreePacket(&holderPool, holder);
     }
 
     return err;
@@ -462,7 +488,7 @@ int LiSendKeyboardEvent(short keyCode, char keyAction, char modifiers) {
         return -2;
     }
 
-    holder = malloc(sizeof(*holder));
+    holder = PpAllocatePacket(&holderPool);
     if (holder == NULL) {
         return -1;
     }
@@ -477,7 +503,7 @@ int LiSendKeyboardEvent(short keyCode, char keyAction, char modifiers) {
 
     err = LbqOfferQueueItem(&packetQueue, holder, &holder->entry);
     if (err != LBQ_SUCCESS) {
-        free(holder);
+        PpFreePacket(&holderPool, holder);
     }
 
     return err;
@@ -494,7 +520,7 @@ static int sendControllerEventInternal(short controllerNumber, short activeGamep
         return -2;
     }
 
-    holder = malloc(sizeof(*holder));
+    holder = PpAllocatePacket(&holderPool);
     if (holder == NULL) {
         return -1;
     }
@@ -542,7 +568,7 @@ static int sendControllerEventInternal(short controllerNumber, short activeGamep
 
     err = LbqOfferQueueItem(&packetQueue, holder, &holder->entry);
     if (err != LBQ_SUCCESS) {
-        free(holder);
+        PpFreePacket(&holderPool, holder);
     }
 
     return err;
@@ -575,7 +601,7 @@ int LiSendScrollEvent(signed char scrollClicks) {
         return -2;
     }
 
-    holder = malloc(sizeof(*holder));
+    holder = PpAllocatePacket(&holderPool);
     if (holder == NULL) {
         return -1;
     }
@@ -595,7 +621,7 @@ int LiSendScrollEvent(signed char scrollClicks) {
 
     err = LbqOfferQueueItem(&packetQueue, holder, &holder->entry);
     if (err != LBQ_SUCCESS) {
-        free(holder);
+        PpFreePacket(&holderPool, holder);
     }
 
     return err;
@@ -40,6 +40,16 @@ extern int OriginalVideoBitrate;
 int serviceEnetHost(ENetHost* client, ENetEvent* event, enet_uint32 timeoutMs);
 int extractVersionQuadFromString(const char* string, int* quad);
 int isReferenceFrameInvalidationEnabled(void);
+void configureReceiveThread(const char* name, int isVideo);
+int getReceiveBufferSize(int bufferSize);
+int configureLowLatencyReceive(SOCKET s);
+
+// Lets the LiGet*Stats() functions read a stream's state while another thread
+// tears it down. statsGuardClose() waits for readers that got in to leave.
+void statsGuardOpen(int* guard);
+void statsGuardClose(int* guard);
+int statsGuardEnter(int* guard);
+void statsGuardLeave(int* guard);
 
 void fixupMissingCallbacks(PDECODER_RENDERER_CALLBACKS* drCallbacks, PAUDIO_RENDERER_CALLBACKS* arCallbacks,
     PCONNECTION_LISTENER_CALLBACKS* clCallbacks);
@@ -49,32 +59,39 @@ char* getSdpPayloadForStreamConfig(int rtspClientVersion, int* length);
 int initializeControlStream(void);
 int startControlStream(void);
 int stopControlStream(void);
+void interruptControlStream(void);
 void destroyControlStream(void);
 void requestIdrOnDemand(void);
 void connectionDetectedFrameLoss(int startFrame, int endFrame);
 void connectionReceivedCompleteFrame(int frameIndex);
 void connectionSawFrame(int frameIndex);
 void connectionLostPackets(int lastReceivedPacket, int nextReceivedPacket);
-int sendInputPacketOnControlStream(unsigned char* data, int length);
+int sendInputPacketBatchOnControlStream(unsigned char* data, int* lengths, int count);
 
 int performRtspHandshake(void);
 
-void initializeVideoDepacketizer(int pktSize);
+int initializeVideoDepacketizer(int pktSize);
 void destroyVideoDepacketizer(void);
+void getVideoDepacketizerPoolStats(PPACKET_POOL_STATS stats);
 void processRtpPayload(PNV_VIDEO_PACKET videoPacket, int length, unsigned long long receiveTimeMs);
 void queueRtpPacket(PRTPFEC_QUEUE_ENTRY queueEntry);
 void stopVideoDepacketizer(void);
 void requestDecoderRefresh(void);
 
-void initializeVideoStream(void);
+int getVideoPacketsPerFrame(void);
+int initializeVideoStream(void);
 void destroyVideoStream(void);
 int startVideoStream(void* rendererContext, int drFlags);
 void stopVideoStream(void);
+int submitReplayedVideoDatagram(char* data, int length, unsigned long long receiveTimeMs);
+int startVideoFecRecovery(void);
+void stopVideoFecRecovery(void);
 
-void initializeAudioStream(void);
+int initializeAudioStream(void);
 void destroyAudioStream(void);
 int startAudioStream(void* audioContext, int arFlags);
 void stopAudioStream(void);
+int getAudioPacketPoolStats(PPACKET_POOL_STATS stats);
 
 int initializeInputStream(void);
 void destroyInputStream(void);
@@ -127,6 +127,19 @@ typedef struct _DECODE_UNIT {
 
     // Head of the buffer chain (never NULL)
     PLENTRY bufferList;
+
+    // If the renderer specified CAPABILITY_CONTIGUOUS_FRAME, this points to the entire
+    // frame (fullLength bytes) in a single buffer and each buffer chain entry points
+    // into it. It is NULL if the frame had to be assembled as a regular buffer chain.
+    // The frame buffer is owned by the depacketizer and is only valid until the decode
+    // unit is returned.
+    char* frameBuffer;
+
+    // Number of buffer chain entries and the offset of each one within frameBuffer.
+    // Picture data is coalesced, so each codec configuration NALU has its own entry
+    // and the picture data that follows them is described by one entry.
+    int nalCount;
+    int* nalOffsets;
 } DECODE_UNIT, *PDECODE_UNIT;
 
 // Specifies that the audio stream should be encoded in stereo (default)
@@ -166,6 +179,18 @@ typedef struct _DECODE_UNIT {
 // supports reference frame invalidation for HEVC/H.265 streams. This flag is only valid on video renderers.
 #define CAPABILITY_REFERENCE_FRAME_INVALIDATION_HEVC 0x4
 
+// If set in the video renderer capabilities field, this flag specifies that the renderer
+// wants each frame assembled into one contiguous buffer. See DECODE_UNIT.frameBuffer.
+// This flag is only valid on video renderers.
+#define CAPABILITY_CONTIGUOUS_FRAME 0x8
+
+// If set in the video renderer capabilities field, this flag moves FEC recovery of lossy
+// frames off the receive thread onto a dedicated thread, so the socket keeps being drained
+// while Reed-Solomon decoding runs. Frames are still delivered in order. With
+// CAPABILITY_DIRECT_SUBMIT, decode units may then be submitted from either thread (never
+// concurrently). This flag is only valid on video renderers.
+#define CAPABILITY_ASYNC_FEC_RECOVERY 0x10
+
 // If set in the video renderer capabilities field, this macro specifies that the renderer
 // supports slicing to increase decoding performance. The parameter specifies the desired
 // number of slices per frame. This capability is only valid on video renderers.
@@ -241,6 +266,8 @@ typedef void(*AudioRendererStop)(void);
 typedef void(*AudioRendererCleanup)(void);
 
 // This callback provides Opus audio data to be decoded and played. sampleLength is in bytes.
+// A NULL sampleData with a sampleLength of 0 stands for one lost packet, which the decoder
+// should conceal (as opus_decode() does when passed a NULL buffer) and play in its place.
 typedef void(*AudioRendererDecodeAndPlaySample)(char* sampleData, int sampleLength);
 
 typedef struct _AUDIO_RENDERER_CALLBACKS {
@@ -280,6 +307,12 @@ typedef void(*ConnListenerStageComplete)(int stage);
 // This callback is invoked to indicate that a stage of initialization has failed
 typedef void(*ConnListenerStageFailed)(int stage, long errorCode);
 
+// This callback is invoked when a stage of initialization completes with the
+// time in microseconds that the stage spent working. Stages that run alongside
+// others report their own duration, so the values may add up to more than the
+// total time taken by LiStartConnection().
+typedef void(*ConnListenerStageTiming)(int stage, uint64_t elapsedUs);
+
 // This callback is invoked after initialization has finished
 typedef void(*ConnListenerConnectionStarted)(void);
 
@@ -306,6 +339,7 @@ typedef struct _CONNECTION_LISTENER_CALLBACKS {
     ConnListenerDisplayMessage displayMessage;
     ConnListenerDisplayTransientMessage displayTransientMessage;
     ConnListenerLogMessage logMessage;
+    ConnListenerStageTiming stageTiming;
 } CONNECTION_LISTENER_CALLBACKS, *PCONNECTION_LISTENER_CALLBACKS;
 
 // Use this function to zero the connection callbacks when allocated on the stack or heap
@@ -403,11 +437,253 @@ int LiSendMultiControllerEvent(short controllerNumber, short activeGamepadMask,
 // This function queues a vertical scroll event to the remote server.
 int LiSendScrollEvent(signed char scrollClicks);
 
+// This function sets how long the input thread waits after an input event for more
+// events to send along with it. Events already queued are always sent together
+// and consecutive mouse motion or controller state is merged. The default of 0
+// adds no delay.
+void LiSetInputCoalescingWindow(int windowMs);
+
 // This function returns a time in milliseconds with an implementation-defined epoch.
 // NOTE: This will be populated from gettimeofday() if !HAVE_CLOCK_GETTIME and
 // populated from clock_gettime(CLOCK_MONOTONIC) if HAVE_CLOCK_GETTIME.
 uint64_t LiGetMillis(void);
 
+// Identifies the packet pools for LiGetPacketPoolStats()
+#define PACKET_POOL_VIDEO_RTP      0
+#define PACKET_POOL_VIDEO_FRAGMENT 1
+#define PACKET_POOL_AUDIO          2
+
+typedef struct _PACKET_POOL_STATS {
+    // Size in bytes of each pooled buffer
+    int bufferSize;
+
+    // Number of buffers preallocated for the pool
+    int capacity;
+
+    // Number of pooled buffers currently handed out and the peak value
+    int inUse;
+    int highWaterMark;
+
+    // Total buffer requests and the number that had to fall back to the heap
+    // because the pool was exhausted
+    uint64_t allocations;
+    uint64_t exhaustions;
+} PACKET_POOL_STATS, *PPACKET_POOL_STATS;
+
+// This function retrieves occupancy and exhaustion counters for one of the
+// packet pools. It is only valid while a connection is active. Returns 0 on success.
+int LiGetPacketPoolStats(int pool, PPACKET_POOL_STATS stats);
+
+typedef struct _FEC_STATS {
+    // Frames recovered with a reused Reed-Solomon context vs. a newly created one
+    uint64_t contextCacheHits;
+    uint64_t contextCacheMisses;
+
+    // Recoveries that reused an inverted decode matrix for the same loss pattern
+    // vs. ones that had to invert a new matrix
+    uint64_t matrixCacheHits;
+    uint64_t matrixCacheMisses;
+
+    // Frames handed to the recovery thread with CAPABILITY_ASYNC_FEC_RECOVERY, and the
+    // datagrams the receive thread read while one was in progress. With inline recovery
+    // those datagrams would have waited in the socket buffer instead.
+    uint64_t asyncRecoveries;
+    uint64_t packetsReceivedDuringRecovery;
+
+    // Datagrams the OS dropped because the video socket's receive buffer was full.
+    // This is 0 on platforms that don't report it.
+    uint64_t socketBufferDrops;
+} FEC_STATS, *PFEC_STATS;
+
+// This function retrieves the FEC recovery counters for the video stream.
+// It is only valid while a connection is active. Returns 0 on success.
+int LiGetFecStats(PFEC_STATS stats);
+
+// Decode unit queue policies for LiSetDecodeQueuePolicy(). These only apply to renderers
+// without CAPABILITY_DIRECT_SUBMIT.
+//
+// Flush the whole queue and request an IDR frame when it overflows. This is the default.
+#define DECODE_QUEUE_POLICY_FLUSH_AND_IDR 0
+// On overflow, hold a few completed frames back on the receive thread and queue them
+// as the decoder makes room, falling back to a flush once the oldest of them is
+// maxFrameAgeMs old. The receive thread never waits for the decoder. The decoder
+// thread also skips frames older than maxFrameAgeMs while newer ones are queued
+// behind them, and requests an IDR frame to recover from the skip.
+#define DECODE_QUEUE_POLICY_BOUNDED_LATENCY 1
+// Like DECODE_QUEUE_POLICY_BOUNDED_LATENCY, but skipped frames (and a new frame that
+// still finds the queue full) are invalidated with reference frame invalidation
+// instead of requesting an IDR frame. This falls back to
+// DECODE_QUEUE_POLICY_BOUNDED_LATENCY if the stream doesn't support reference frame
+// invalidation.
+#define DECODE_QUEUE_POLICY_INVALIDATE_REFS 2
+
+// Frame age limit used by the bounded latency policies when maxFrameAgeMs is 0 or less
+#define DECODE_QUEUE_DEFAULT_MAX_FRAME_AGE_MS 100
+
+// This function selects how the decode unit queue handles a decoder that falls behind.
+// It takes effect on the next call to LiStartConnection().
+void LiSetDecodeQueuePolicy(int policy, int maxFrameAgeMs);
+
+// Receive thread priority classes for LiSetReceiveThreadScheduling()
+#define RECEIVE_THREAD_PRIORITY_DEFAULT 0
+// Above normal priority (a negative nice value on Linux and Android)
+#define RECEIVE_THREAD_PRIORITY_HIGH 1
+// Real-time scheduling (SCHED_FIFO) where the process is permitted to use it. Otherwise
+// this uses the lowest (most favorable) nice value the process is allowed.
+#define RECEIVE_THREAD_PRIORITY_REALTIME 2
+
+// This function sets the scheduling of the video and audio receive threads. Each CPU mask
+// has bit N set for each CPU N that thread may run on, or 0 to leave it unrestricted.
+// It takes effect on the next call to LiStartConnection().
+void LiSetReceiveThreadScheduling(int priority, uint64_t videoCpuMask, uint64_t audioCpuMask);
+
+// This function enables a low latency receive mode for the video and audio streams. The
+// receive threads poll their sockets for up to spinUs before sleeping, using SO_BUSY_POLL
+// where the OS permits and a userspace spin otherwise (except on single CPU systems), and the
+// sockets get larger receive buffers. This trades CPU time for lower wakeup latency. Passing 0
+// disables it (the default).
+// It takes effect on the next call to LiStartConnection().
+void LiSetLowLatencyReceive(int spinUs);
+
+typedef struct _DECODE_QUEUE_STATS {
+    // Times a completed frame found the decode unit queue full (or frames
+    // already held back in front of it)
+    uint64_t overflows;
+
+    // Frames discarded by a queue flush or overflow, or skipped for being too old
+    uint64_t framesDropped;
+
+    // IDR frames requested by the queue policy
+    uint64_t idrRequests;
+
+    // Overflows that cleared in time, frame drops and skips that were invalidated with
+    // reference frame invalidation, which would otherwise have needed an IDR frame
+    uint64_t idrsAvoided;
+} DECODE_QUEUE_STATS, *PDECODE_QUEUE_STATS;
+
+// This function retrieves the decode unit queue counters for the current or last
+// connection. Returns 0 on success.
+int LiGetDecodeQueueStats(PDECODE_QUEUE_STATS stats);
+
+typedef struct _AUDIO_JITTER_STATS {
+    // How long a missing audio packet is waited for before it is concealed, in
+    // milliseconds. This adapts to the measured jitter.
+    int targetDelayMs;
+
+    // Smoothed inter-arrival jitter of audio packets in microseconds
+    uint32_t jitterUs;
+
+    // Packets held in the jitter buffer behind a missing packet, now and at peak
+    int bufferedPackets;
+    int maxBufferedPackets;
+
+    uint64_t packetsReceived;
+
+    // Missing packets replaced by Opus packet loss concealment, and the number
+    // of gaps they filled
+    uint64_t packetsConcealed;
+    uint64_t concealmentEvents;
+
+    // Packets that arrived after their place in the stream had been concealed,
+    // not counting duplicates
+    uint64_t latePackets;
+} AUDIO_JITTER_STATS, *PAUDIO_JITTER_STATS;
+
+// This function retrieves audio jitter buffer statistics. It is only valid while
+// a connection is active. Returns 0 on success.
+int LiGetAudioJitterStats(PAUDIO_JITTER_STATS stats);
+
+typedef struct _LATENCY_PERCENTILES {
+    // All values are in microseconds
+    uint32_t p50;
+    uint32_t p95;
+    uint32_t p99;
+    uint32_t max;
+} LATENCY_PERCENTILES, *PLATENCY_PERCENTILES;
+
+typedef struct _FRAME_LATENCY_SNAPSHOT {
+    // Number of recent frames that the percentiles describe
+    int frameCount;
+
+    // From the first to the last packet of the frame arriving (millisecond resolution)
+    LATENCY_PERCENTILES receive;
+
+    // Time spent in FEC recovery (0 for frames that needed none)
+    LATENCY_PERCENTILES fecRecovery;
+
+    // From the last packet arriving to the frame being reassembled
+    LATENCY_PERCENTILES depacketize;
+
+    // From the frame being reassembled to the decoder thread picking it up
+    LATENCY_PERCENTILES queueDwell;
+
+    // Time spent in the submitDecodeUnit callback
+    LATENCY_PERCENTILES decoderSubmit;
+
+    // From the first packet arriving to submitDecodeUnit returning
+    LATENCY_PERCENTILES total;
+} FRAME_LATENCY_SNAPSHOT, *PFRAME_LATENCY_SNAPSHOT;
+
+// This function computes latency percentiles over the most recently submitted video frames.
+// It may be called from any thread, including after the connection has been stopped.
+// Returns 0 on success.
+int LiGetFrameLatencySnapshot(PFRAME_LATENCY_SNAPSHOT snapshot);
+
+// This function writes the per-frame timestamps of the most recently submitted video frames
+// to a CSV file at the specified path. Timestamps are in microseconds using the same epoch
+// as LiGetMillis(). Returns 0 on success.
+int LiWriteFrameLatencyCsv(const char* path);
+
+// This function enables capture of received video datagrams to a file at the specified path
+// for use with LiReplayVideoCapture(). It takes effect on the next call to LiStartConnection().
+// Passing NULL disables capture.
+void LiSetVideoCapturePath(const char* path);
+
+typedef struct _VIDEO_REPLAY_OPTIONS {
+    // Seed for the impairment generator. Replays with the same seed and
+    // percentages make identical impairment decisions.
+    unsigned int seed;
+
+    // Percentage of datagrams to drop
+    int lossPercent;
+
+    // Percentage of datagrams to hold back and deliver after up to
+    // reorderDistance later datagrams
+    int reorderPercent;
+    int reorderDistance;
+
+    // Percentage of datagrams to deliver twice
+    int duplicatePercent;
+} VIDEO_REPLAY_OPTIONS, *PVIDEO_REPLAY_OPTIONS;
+
+typedef struct _VIDEO_REPLAY_STATS {
+    // Datagrams read from the capture and what the impairments did to them
+    uint64_t datagramsRead;
+    uint64_t datagramsDropped;
+    uint64_t datagramsReordered;
+    uint64_t datagramsDuplicated;
+
+    // Decode units submitted to the decoder callback
+    uint64_t decodeUnits;
+    uint64_t idrFrames;
+    uint64_t decodeUnitBytes;
+
+    // FNV-1a hash over the frame numbers and contents of all decode units, which
+    // stays the same across changes to the receive path that don't alter output
+    uint64_t decodeUnitHash;
+
+    // Wall clock time spent feeding the capture through the receive path
+    uint64_t elapsedUs;
+} VIDEO_REPLAY_STATS, *PVIDEO_REPLAY_STATS;
+
+// This function feeds a capture written by LiSetVideoCapturePath() through the RTP FEC queue
+// and depacketizer as fast as possible, submitting the resulting decode units to drCallbacks
+// on the calling thread. No network connection is used. It must not be called while a
+// connection is active. options may be NULL to replay without impairments.
+// Returns 0 on success.
+int LiReplayVideoCapture(const char* path, PVIDEO_REPLAY_OPTIONS options, PDECODER_RENDERER_CALLBACKS drCallbacks,
+    PCONNECTION_LISTENER_CALLBACKS clCallbacks, PVIDEO_REPLAY_STATS stats);
+
 // This is a simplistic STUN function that can assist clients in getting the WAN address
 // for machines they find using mDNS over IPv4. This can be used to pre-populate the external
 // address for streaming after GFE stopped sending it a while back. wanAddr is returned in
@@ -1,7 +1,18 @@
 #include "Limelight-internal.h"
+#include "PlatformAtomics.h"
 
 #define ENET_INTERNAL_TIMEOUT_MS 100
 
+// A stats guard holds this bit while the stream is up and counts readers above it
+#define STATS_GUARD_OPEN 1
+#define STATS_GUARD_READER 2
+
+// Set by LiSetReceiveThreadScheduling() and LiSetLowLatencyReceive()
+static int receiveThreadPriority;
+static uint64_t videoReceiveCpuMask;
+static uint64_t audioReceiveCpuMask;
+static int lowLatencyReceiveUs;
+
 // This function wraps enet_host_service() and hides the fact that it must be called
 // multiple times for retransmissions to work correctly. It is meant to be a drop-in
 // replacement for enet_host_service(). It also handles cancellation of the connection
@@ -69,6 +80,65 @@ int isReferenceFrameInvalidationEnabled(void) {
            ((NegotiatedVideoFormat & VIDEO_FORMAT_MASK_H265) && (VideoCallbacks.capabilities & CAPABILITY_REFERENCE_FRAME_INVALIDATION_HEVC));
 }
 
+// Names the calling receive thread and applies LiSetReceiveThreadScheduling()
+void configureReceiveThread(const char* name, int isVideo) {
+    uint64_t cpuMask = isVideo ? videoReceiveCpuMask : audioReceiveCpuMask;
+
+    PltSetCurrentThreadName(name);
+
+    if (receiveThreadPriority != RECEIVE_THREAD_PRIORITY_DEFAULT) {
+        int priority = PltSetCurrentThreadPriority(receiveThreadPriority);
+        if (priority != receiveThreadPriority) {
+            Limelog("%s: requested priority class %d but got %d\n", name, receiveThreadPriority, priority);
+        }
+    }
+
+    if (cpuMask != 0 && PltSetCurrentThreadAffinity(cpuMask) != 0) {
+        Limelog("%s: unable to set CPU affinity mask %llx\n", name, (unsigned long long)cpuMask);
+    }
+}
+
+// Returns the receive buffer size to request for a stream socket
+int getReceiveBufferSize(int bufferSize) {
+    // Bursts are drained as they arrive in low latency mode, but leave more
+    // headroom for the times the receive thread is descheduled anyway.
+    return lowLatencyReceiveUs != 0 ? bufferSize * 2 : bufferSize;
+}
+
+// Sets up low latency receive on a stream socket. Returns how long the receive
+// loop should spin on the socket before blocking, or 0 if it shouldn't.
+int configureLowLatencyReceive(SOCKET s) {
+    if (lowLatencyReceiveUs == 0) {
+        return 0;
+    }
+
+    if (enableUdpBusyPoll(s, lowLatencyReceiveUs) == 0) {
+        // The kernel spins for us inside the blocking receive
+        return 0;
+    }
+
+    // On a single CPU, spinning only takes time away from the threads that
+    // consume what we receive, so just block as usual there.
+    if (PltGetCpuCount() < 2) {
+        Limelog("Low latency receive: not spinning on a single CPU system\n");
+        return 0;
+    }
+
+    Limelog("Low latency receive: using userspace spinning instead of SO_BUSY_POLL\n");
+    return lowLatencyReceiveUs;
+}
+
+void LiSetReceiveThreadScheduling(int priority, uint64_t videoCpuMask, uint64_t audioCpuMask) {
+    // The public priority classes match the platform ones
+    receiveThreadPriority = priority;
+    videoReceiveCpuMask = videoCpuMask;
+    audioReceiveCpuMask = audioCpuMask;
+}
+
+void LiSetLowLatencyReceive(int spinUs) {
+    lowLatencyReceiveUs = spinUs > 0 ? spinUs : 0;
+}
+
 void LiInitializeStreamConfiguration(PSTREAM_CONFIGURATION streamConfig) {
     memset(streamConfig, 0, sizeof(*streamConfig));
 }
@@ -92,3 +162,45 @@ void LiInitializeServerInformation(PSERVER_INFORMATION serverInfo) {
 uint64_t LiGetMillis(void) {
     return PltGetMillis();
 }
+
+void statsGuardOpen(int* guard) {
+    LC_ASSERT(PLT_ATOMIC_LOAD(guard) == 0);
+    PLT_ATOMIC_STORE(guard, STATS_GUARD_OPEN);
+}
+
+void statsGuardClose(int* guard) {
+    int state;
+
+    do {
+        state = PLT_ATOMIC_LOAD(guard);
+    } while (!PLT_ATOMIC_CAS(guard, state, state & ~STATS_GUARD_OPEN));
+
+    // Readers only copy a few counters, so this wait is short
+    while (PLT_ATOMIC_LOAD(guard) != 0) {
+        PltSleepMs(1);
+    }
+}
+
+// Returns 0 if the stream is down. Otherwise, the caller must call
+// statsGuardLeave() once it's done reading.
+int statsGuardEnter(int* guard) {
+    int state;
+
+    do {
+        state = PLT_ATOMIC_LOAD(guard);
+        if ((state & STATS_GUARD_OPEN) == 0) {
+            return 0;
+        }
+    } while (!PLT_ATOMIC_CAS(guard, state, state + STATS_GUARD_READER));
+
+    return 1;
+}
+
+void statsGuardLeave(int* guard) {
+    int state;
+
+    do {
+        state = PLT_ATOMIC_LOAD(guard);
+        LC_ASSERT(state >= STATS_GUARD_READER);
+    } while (!PLT_ATOMIC_CAS(guard, state, state - STATS_GUARD_READER));
+}
@@ -0,0 +1,101 @@
+#include "NalScanner.h"
+
+// Candidates are found 16 bytes at a time by looking for a pair of zero bytes,
+// which compressed NAL data only contains ahead of emulation prevention bytes.
+// Define NS_NO_SIMD to force the scalar scan.
+#if !defined(NS_NO_SIMD) && defined(__GNUC__) && defined(__SSE2__)
+#define NS_SIMD_SSE2
+#include <emmintrin.h>
+#elif !defined(NS_NO_SIMD) && defined(__GNUC__) && (defined(__aarch64__) || defined(__ARM_NEON) || defined(__ARM_NEON__))
+#define NS_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+// Returns 1 if a special sequence starts at data[pos]. This mirrors getSpecialSeq()
+// in the depacketizer, including needing 3 bytes before the end of the buffer.
+static int isSpecialSeqAt(const unsigned char* data, unsigned int pos, unsigned int end, int includePadding) {
+    if (end - pos < 3 || data[pos] != 0 || data[pos + 1] != 0) {
+        return 0;
+    }
+
+    if (data[pos + 2] == 1) {
+        // NAL start
+        return 1;
+    }
+    else if (data[pos + 2] == 0) {
+        // Frame start or padding
+        return includePadding || (end - pos >= 4 && data[pos + 3] == 1);
+    }
+
+    return 0;
+}
+
+static unsigned int findSpecialSeqScalar(const unsigned char* data, unsigned int pos, unsigned int end, int includePadding) {
+    while (end - pos >= 3) {
+        // If the third byte isn't 0 or 1, no sequence can start at any of
+        // the first three positions
+        if (data[pos + 2] > 1) {
+            pos += 3;
+            continue;
+        }
+
+        if (isSpecialSeqAt(data, pos, end, includePadding)) {
+            return pos;
+        }
+
+        pos++;
+    }
+
+    return end;
+}
+
+unsigned int NsFindSpecialSeq(const char* data, unsigned int offset, unsigned int length, int includePadding) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    unsigned int end = offset + length;
+    unsigned int pos = offset;
+
+#if defined(NS_SIMD_SSE2)
+    const __m128i zero = _mm_setzero_si128();
+
+    // Each block also reads the byte after it
+    while (end - pos >= 17) {
+        __m128i first = _mm_loadu_si128((const __m128i*)&bytes[pos]);
+        __m128i second = _mm_loadu_si128((const __m128i*)&bytes[pos + 1]);
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_or_si128(first, second), zero));
+
+        while (mask != 0) {
+            unsigned int candidate = pos + __builtin_ctz(mask);
+
+            if (isSpecialSeqAt(bytes, candidate, end, includePadding)) {
+                return candidate;
+            }
+
+            mask &= mask - 1;
+        }
+
+        pos += 16;
+    }
+#elif defined(NS_SIMD_NEON)
+    // Each block also reads the byte after it
+    while (end - pos >= 17) {
+        uint8x16_t first = vld1q_u8(&bytes[pos]);
+        uint8x16_t second = vld1q_u8(&bytes[pos + 1]);
+        uint8x16_t pairs = vceqq_u8(vorrq_u8(first, second), vdupq_n_u8(0));
+        uint8x8_t folded = vorr_u8(vget_low_u8(pairs), vget_high_u8(pairs));
+
+        if (vget_lane_u64(vreinterpret_u64_u8(folded), 0) != 0) {
+            unsigned int candidate;
+
+            for (candidate = pos; candidate < pos + 16; candidate++) {
+                if (isSpecialSeqAt(bytes, candidate, end, includePadding)) {
+                    return candidate;
+                }
+            }
+        }
+
+        pos += 16;
+    }
+#endif
+
+    return findSpecialSeqScalar(bytes, pos, end, includePadding);
+}
@@ -0,0 +1,6 @@
+#pragma once
+
+// Returns the offset of the first Annex B special sequence (00 00 01,
+// 00 00 00 01, or 00 00 00 padding if includePadding is set) that starts in
+// data[offset, offset + length), or offset + length if there isn't one
+unsigned int NsFindSpecialSeq(const char* data, unsigned int offset, unsigned int length, int includePadding);
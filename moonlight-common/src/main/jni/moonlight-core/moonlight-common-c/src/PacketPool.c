@@ -0,0 +1,125 @@
+#include "Limelight-internal.h"
+#include "PacketPool.h"
+
+// Buffers are carved out of the slab at this alignment
+#define PACKET_POOL_ALIGNMENT 16
+
+int PpInitializePacketPool(PPACKET_POOL pool, int bufferSize, int capacity) {
+    int err;
+    int i;
+
+    memset(pool, 0, sizeof(*pool));
+
+    err = PltCreateMutex(&pool->mutex);
+    if (err != 0) {
+        return err;
+    }
+
+    // Round the buffer size up so each entry stays aligned within the slab
+    bufferSize = (bufferSize + PACKET_POOL_ALIGNMENT - 1) & ~(PACKET_POOL_ALIGNMENT - 1);
+    if (bufferSize < (int)sizeof(PACKET_POOL_ENTRY)) {
+        bufferSize = sizeof(PACKET_POOL_ENTRY);
+    }
+
+    pool->bufferSize = bufferSize;
+    pool->slab = (char*)malloc((size_t)bufferSize * capacity);
+    if (pool->slab == NULL) {
+        // The pool will still hand out buffers from the heap
+        Limelog("Packet pool: unable to allocate %d buffers of %d bytes\n", capacity, bufferSize);
+        return 0;
+    }
+
+    pool->capacity = capacity;
+    pool->slabEnd = pool->slab + ((size_t)bufferSize * capacity);
+
+    // Build the free list so buffers are handed out in address order
+    for (i = capacity - 1; i >= 0; i--) {
+        PPACKET_POOL_ENTRY entry = (PPACKET_POOL_ENTRY)&pool->slab[(size_t)i * bufferSize];
+        entry->next = pool->freeList;
+        pool->freeList = entry;
+    }
+
+    return 0;
+}
+
+// All pooled buffers must have been returned before this is called
+void PpCleanupPacketPool(PPACKET_POOL pool) {
+    LC_ASSERT(pool->inUse == 0);
+
+    if (pool->slab != NULL) {
+        free(pool->slab);
+        pool->slab = NULL;
+        pool->slabEnd = NULL;
+    }
+
+    pool->freeList = NULL;
+    PltDeleteMutex(&pool->mutex);
+}
+
+// Returns a buffer of at least bufferSize bytes or NULL if the heap fallback fails
+void* PpAllocatePacket(PPACKET_POOL pool) {
+    PPACKET_POOL_ENTRY entry;
+
+    PltLockMutex(&pool->mutex);
+
+    pool->allocations++;
+
+    entry = pool->freeList;
+    if (entry != NULL) {
+        pool->freeList = entry->next;
+        pool->inUse++;
+        if (pool->inUse > pool->highWaterMark) {
+            pool->highWaterMark = pool->inUse;
+        }
+    }
+    else {
+        pool->exhaustions++;
+    }
+
+    PltUnlockMutex(&pool->mutex);
+
+    if (entry == NULL) {
+        // The pool is exhausted, so fall back to the heap
+        return malloc(pool->bufferSize);
+    }
+
+    return entry;
+}
+
+// Accepts both pooled buffers and heap buffers handed out after exhaustion
+void PpFreePacket(PPACKET_POOL pool, void* buffer) {
+    PPACKET_POOL_ENTRY entry;
+
+    if (buffer == NULL) {
+        return;
+    }
+
+    if ((char*)buffer < pool->slab || (char*)buffer >= pool->slabEnd) {
+        free(buffer);
+        return;
+    }
+
+    entry = (PPACKET_POOL_ENTRY)buffer;
+
+    PltLockMutex(&pool->mutex);
+
+    LC_ASSERT(pool->inUse > 0);
+    entry->next = pool->freeList;
+    pool->freeList = entry;
+    pool->inUse--;
+
+    PltUnlockMutex(&pool->mutex);
+}
+
+void PpGetPacketPoolStats(PPACKET_POOL pool, PPACKET_POOL_STATS stats) {
+    PltLockMutex(&pool->mutex);
+
+    stats->bufferSize = pool->bufferSize;
+    stats->capacity = pool->capacity;
+    stats->inUse = pool->inUse;
+    stats->highWaterMark = pool->highWaterMark;
+    stats->allocations = pool->allocations;
+    stats->exhaustions = pool->exhaustions;
+
+    PltUnlockMutex(&pool->mutex);
+}
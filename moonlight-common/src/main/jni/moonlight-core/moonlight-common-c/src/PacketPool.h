@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Platform.h"
+#include "PlatformThreads.h"
+
+typedef struct _PACKET_POOL_ENTRY {
+    struct _PACKET_POOL_ENTRY* next;
+} PACKET_POOL_ENTRY, *PPACKET_POOL_ENTRY;
+
+typedef struct _PACKET_POOL {
+    PLT_MUTEX mutex;
+
+    // Single allocation backing every pooled buffer
+    char* slab;
+    char* slabEnd;
+
+    PPACKET_POOL_ENTRY freeList;
+    int bufferSize;
+    int capacity;
+
+    int inUse;
+    int highWaterMark;
+    uint64_t allocations;
+    uint64_t exhaustions;
+} PACKET_POOL, *PPACKET_POOL;
+
+int PpInitializePacketPool(PPACKET_POOL pool, int bufferSize, int capacity);
+void PpCleanupPacketPool(PPACKET_POOL pool);
+void* PpAllocatePacket(PPACKET_POOL pool);
+void PpFreePacket(PPACKET_POOL pool, void* buffer);
+void PpGetPacketPoolStats(PPACKET_POOL pool, PPACKET_POOL_STATS stats);
@@ -1,8 +1,23 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "PlatformThreads.h"
 #include "Platform.h"
 
 #include <enet/enet.h>
 
+#if defined(__linux__) && !defined(__vita__)
+#include <sched.h>
+#include <sys/prctl.h>
+#include <sys/resource.h>
+
+// Nice values used where SCHED_FIFO isn't available. These match Android's
+// THREAD_PRIORITY_URGENT_DISPLAY and THREAD_PRIORITY_URGENT_AUDIO levels.
+#define NICE_PRIORITY_HIGH -8
+#define NICE_PRIORITY_REALTIME -19
+#endif
+
 int initializePlatformSockets(void);
 void cleanupPlatformSockets(void);
 
@@ -185,6 +200,110 @@ int PltCreateThread(ThreadEntry entry, void* context, PLT_THREAD* thread) {
     return 0;
 }
 
+// Thread names are limited to 15 characters on Linux
+void PltSetCurrentThreadName(const char* name) {
+#if defined(__linux__) && !defined(__vita__)
+    prctl(PR_SET_NAME, name, 0, 0, 0);
+#elif defined(LC_DARWIN)
+    pthread_setname_np(name);
+#else
+    (void)name;
+#endif
+}
+
+// Returns the priority class that was applied, which may be lower than
+// the one requested if the process isn't allowed to use it.
+int PltSetCurrentThreadPriority(int priority) {
+#if defined(LC_WINDOWS)
+    switch (priority) {
+    case PLT_THREAD_PRIORITY_REALTIME:
+        if (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL)) {
+            return PLT_THREAD_PRIORITY_REALTIME;
+        }
+        // Fall through
+    case PLT_THREAD_PRIORITY_HIGH:
+        if (SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_HIGHEST)) {
+            return PLT_THREAD_PRIORITY_HIGH;
+        }
+        // Fall through
+    default:
+        SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_NORMAL);
+        return PLT_THREAD_PRIORITY_NORMAL;
+    }
+#elif defined(__vita__)
+    (void)priority;
+    return PLT_THREAD_PRIORITY_NORMAL;
+#else
+    if (priority == PLT_THREAD_PRIORITY_REALTIME) {
+        struct sched_param param;
+
+        // Use the lowest real-time priority so we still yield to the
+        // system's own real-time threads
+        memset(&param, 0, sizeof(param));
+        param.sched_priority = sched_get_priority_min(SCHED_FIFO);
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) == 0) {
+            return PLT_THREAD_PRIORITY_REALTIME;
+        }
+    }
+
+#if defined(__linux__)
+    // Linux applies nice values per thread, and a who of 0 means the calling
+    // thread. Unprivileged processes (other than Android apps) usually can't
+    // go below 0, so step down through the levels until one is accepted.
+    if (priority == PLT_THREAD_PRIORITY_REALTIME &&
+            setpriority(PRIO_PROCESS, 0, NICE_PRIORITY_REALTIME) == 0) {
+        // This is as close to real-time as we can get
+        return PLT_THREAD_PRIORITY_HIGH;
+    }
+    if (priority != PLT_THREAD_PRIORITY_NORMAL &&
+            setpriority(PRIO_PROCESS, 0, NICE_PRIORITY_HIGH) == 0) {
+        return PLT_THREAD_PRIORITY_HIGH;
+    }
+#endif
+
+    return PLT_THREAD_PRIORITY_NORMAL;
+#endif
+}
+
+// Bit N of cpuMask allows the thread to run on CPU N. Returns 0 on success.
+int PltSetCurrentThreadAffinity(uint64_t cpuMask) {
+#if defined(LC_WINDOWS)
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)cpuMask) != 0 ? 0 : -1;
+#elif defined(__linux__) && !defined(__vita__)
+    cpu_set_t cpuSet;
+    int i;
+
+    CPU_ZERO(&cpuSet);
+    for (i = 0; i < 64 && i < CPU_SETSIZE; i++) {
+        if (cpuMask & (1ULL << i)) {
+            CPU_SET(i, &cpuSet);
+        }
+    }
+
+    // A pid of 0 means the calling thread
+    return sched_setaffinity(0, sizeof(cpuSet), &cpuSet);
+#else
+    (void)cpuMask;
+    return -1;
+#endif
+}
+
+// Returns the number of online CPUs, or 1 if it can't be determined
+int PltGetCpuCount(void) {
+#if defined(LC_WINDOWS)
+    SYSTEM_INFO info;
+
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+#elif defined(__vita__)
+    return 1;
+#else
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+
+    return count > 0 ? (int)count : 1;
+#endif
+}
+
 int PltCreateEvent(PLT_EVENT* event) {
 #if defined(LC_WINDOWS)
     *event = CreateEventEx(NULL, NULL, CREATE_EVENT_MANUAL_RESET, EVENT_ALL_ACCESS);
@@ -282,7 +401,7 @@ int PltWaitForEvent(PLT_EVENT* event) {
 
 uint64_t PltGetMillis(void) {
 #if defined(LC_WINDOWS)
-    return GetTickCount64();
+    return PltGetMicroseconds() / 1000;
 #elif HAVE_CLOCK_GETTIME
     struct timespec tv;
     
@@ -298,6 +417,34 @@ uint64_t PltGetMillis(void) {
 #endif
 }
 
+// This shares the epoch of PltGetMillis() so the two can be compared
+uint64_t PltGetMicroseconds(void) {
+#if defined(LC_WINDOWS)
+    // GetTickCount64() only advances every 10-16 ms. The counter frequency is
+    // fixed at boot, and the split avoids overflowing the multiplication.
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+
+    return ((uint64_t)(counter.QuadPart / frequency.QuadPart) * 1000000) +
+        ((uint64_t)(counter.QuadPart % frequency.QuadPart) * 1000000 / frequency.QuadPart);
+#elif HAVE_CLOCK_GETTIME
+    struct timespec tv;
+
+    clock_gettime(CLOCK_MONOTONIC, &tv);
+
+    return ((uint64_t)tv.tv_sec * 1000000) + (tv.tv_nsec / 1000);
+#else
+    struct timeval tv;
+
+    gettimeofday(&tv, NULL);
+
+    return ((uint64_t)tv.tv_sec * 1000000) + tv.tv_usec;
+#endif
+}
+
 int initializePlatform(void) {
     int err;
 
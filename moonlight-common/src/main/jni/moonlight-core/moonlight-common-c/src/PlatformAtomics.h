@@ -0,0 +1,27 @@
+#pragma once
+
+#include "Platform.h"
+
+// Minimal atomic operations on int-sized values and pointers. Loads have
+// acquire semantics and stores have release semantics unless noted.
+#if defined(LC_WINDOWS)
+#define PLT_ATOMIC_LOAD(p) ((unsigned int)InterlockedCompareExchange((volatile LONG*)(p), 0, 0))
+#define PLT_ATOMIC_STORE(p, v) InterlockedExchange((volatile LONG*)(p), (LONG)(v))
+#define PLT_ATOMIC_CAS(p, expected, desired) \
+    (InterlockedCompareExchange((volatile LONG*)(p), (LONG)(desired), (LONG)(expected)) == (LONG)(expected))
+#define PLT_ATOMIC_INCREMENT(p) InterlockedIncrement((volatile LONG*)(p))
+#define PLT_ATOMIC_ADD(p, v) InterlockedExchangeAdd((volatile LONG*)(p), (LONG)(v))
+#define PLT_ATOMIC_LOAD_PTR(p) InterlockedCompareExchangePointer((PVOID volatile*)(p), NULL, NULL)
+#define PLT_ATOMIC_STORE_PTR(p, v) InterlockedExchangePointer((PVOID volatile*)(p), (v))
+#define PLT_ATOMIC_FENCE() MemoryBarrier()
+#else
+#define PLT_ATOMIC_LOAD(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define PLT_ATOMIC_STORE(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define PLT_ATOMIC_CAS(p, expected, desired) __sync_bool_compare_and_swap((p), (expected), (desired))
+#define PLT_ATOMIC_INCREMENT(p) __sync_add_and_fetch((p), 1)
+#define PLT_ATOMIC_ADD(p, v) __sync_add_and_fetch((p), (v))
+// Pointer slots are ordered by the index that publishes them, so these are relaxed
+#define PLT_ATOMIC_LOAD_PTR(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define PLT_ATOMIC_STORE_PTR(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define PLT_ATOMIC_FENCE() __atomic_thread_fence(__ATOMIC_SEQ_CST)
+#endif
@@ -1,6 +1,15 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include "PlatformSockets.h"
 #include "Limelight-internal.h"
 
+#if defined(__linux__) && !defined(__vita__)
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
 #define TEST_PORT_TIMEOUT_SEC 3
 
 #define RCV_BUFFER_SIZE_MIN  32767
@@ -101,6 +110,258 @@ int recvUdpSocket(SOCKET s, char* buffer, int size, int useSelect) {
     }
 }
 
+#if defined(__linux__) && !defined(__vita__) && defined(__NR_recvmmsg)
+// We invoke recvmmsg() through syscall() because older Android platform
+// levels don't export it from libc even though the kernel supports it.
+#define LC_RECVMMSG
+
+#ifndef MSG_WAITFORONE
+#define MSG_WAITFORONE 0x10000
+#endif
+
+// Matches the kernel's struct mmsghdr
+typedef struct _LC_MMSGHDR {
+    struct msghdr msg_hdr;
+    unsigned int msg_len;
+} LC_MMSGHDR;
+
+#ifdef SO_TIMESTAMPNS
+#define UDP_RECV_TIMESTAMP_CONTROL_SIZE CMSG_SPACE(sizeof(struct timespec))
+#else
+#define UDP_RECV_TIMESTAMP_CONTROL_SIZE 0
+#endif
+
+#ifdef SO_RXQ_OVFL
+#define UDP_RECV_DROPS_CONTROL_SIZE CMSG_SPACE(sizeof(uint32_t))
+#else
+#define UDP_RECV_DROPS_CONTROL_SIZE 0
+#endif
+
+#define UDP_RECV_CONTROL_SIZE (UDP_RECV_TIMESTAMP_CONTROL_SIZE + UDP_RECV_DROPS_CONTROL_SIZE + 1)
+
+// Set if the kernel rejects recvmmsg() so we stop trying it
+static int recvmmsgUnsupported;
+
+#ifdef SO_TIMESTAMPNS
+// Converts a kernel SO_TIMESTAMPNS value (CLOCK_REALTIME) into the PltGetMillis() epoch
+static uint64_t kernelTimestampToMillis(struct timespec* ts, struct timespec* realNow, uint64_t nowMs) {
+    int64_t ageMs = ((int64_t)realNow->tv_sec - ts->tv_sec) * 1000 +
+                    ((int64_t)realNow->tv_nsec - ts->tv_nsec) / 1000000;
+
+    // Ignore timestamps from the future or ones that are implausibly old
+    // (such as after a wall clock adjustment).
+    if (ageMs < 0 || (uint64_t)ageMs > nowMs || ageMs > 1000) {
+        return nowMs;
+    }
+
+    return nowMs - ageMs;
+}
+#endif
+#endif
+
+// Returns the number of buffers that should be passed to recvUdpSocketBatch()
+int getUdpRecvBatchSize(int requested) {
+#ifdef LC_RECVMMSG
+    if (!recvmmsgUnsupported) {
+        return requested < UDP_RECV_BATCH_MAX ? requested : UDP_RECV_BATCH_MAX;
+    }
+#endif
+
+    return 1;
+}
+
+// Ask the kernel to timestamp each datagram as it is received. This is
+// best effort and recvUdpSocketBatch() falls back to PltGetMillis().
+void enableUdpRecvTimestamps(SOCKET s) {
+#if defined(LC_RECVMMSG) && defined(SO_TIMESTAMPNS)
+    int val = 1;
+
+    if (setsockopt(s, SOL_SOCKET, SO_TIMESTAMPNS, (char*)&val, sizeof(val)) < 0) {
+        Limelog("setsockopt(SO_TIMESTAMPNS) failed: %d\n", (int)LastSocketError());
+    }
+#endif
+}
+
+// Ask the kernel to report how many datagrams it has dropped on this socket
+// because the receive buffer was full. This is also best effort.
+void enableUdpRecvDropCounter(SOCKET s) {
+#if defined(LC_RECVMMSG) && defined(SO_RXQ_OVFL)
+    int val = 1;
+
+    if (setsockopt(s, SOL_SOCKET, SO_RXQ_OVFL, (char*)&val, sizeof(val)) < 0) {
+        Limelog("setsockopt(SO_RXQ_OVFL) failed: %d\n", (int)LastSocketError());
+    }
+#endif
+}
+
+// Ask the kernel to busy poll the device queue for up to busyPollUs when a
+// receive on this socket would block. Raising this above the system default
+// usually requires CAP_NET_ADMIN. Returns 0 if it was accepted.
+int enableUdpBusyPoll(SOCKET s, int busyPollUs) {
+#if defined(__linux__) && !defined(__vita__) && defined(SO_BUSY_POLL)
+    if (setsockopt(s, SOL_SOCKET, SO_BUSY_POLL, (char*)&busyPollUs, sizeof(busyPollUs)) < 0) {
+        Limelog("setsockopt(SO_BUSY_POLL) failed: %d\n", (int)LastSocketError());
+        return -1;
+    }
+
+    return 0;
+#else
+    (void)s;
+    (void)busyPollUs;
+    return -1;
+#endif
+}
+
+// Polls the socket without sleeping for up to spinUs. Returns 1 if it became
+// readable, 0 if the time ran out, or a negative value on error. This lets a
+// receive thread pick up back-to-back datagrams without paying for a wakeup.
+int spinUntilUdpSocketReadable(SOCKET s, int spinUs) {
+    uint64_t deadline = PltGetMicroseconds() + spinUs;
+    fd_set readfds;
+    struct timeval tv;
+    int err;
+
+    do {
+        FD_ZERO(&readfds);
+        FD_SET(s, &readfds);
+
+        tv.tv_sec = 0;
+        tv.tv_usec = 0;
+
+        err = select((int)(s) + 1, &readfds, NULL, NULL, &tv);
+        if (err != 0) {
+            return err;
+        }
+    } while (PltGetMicroseconds() < deadline);
+
+    return 0;
+}
+
+// Receives up to count datagrams with a single syscall where supported. Returns
+// the number of datagrams received, 0 on timeout, or a negative value on error.
+int recvUdpSocketBatch(SOCKET s, PUDP_RECV_BATCH_ENTRY entries, int count, int useSelect) {
+    int err;
+
+#ifdef LC_RECVMMSG
+    if (!recvmmsgUnsupported) {
+        LC_MMSGHDR msgs[UDP_RECV_BATCH_MAX];
+        struct iovec iovs[UDP_RECV_BATCH_MAX];
+        char control[UDP_RECV_BATCH_MAX][UDP_RECV_CONTROL_SIZE];
+        int flags;
+        int i;
+
+        if (count > UDP_RECV_BATCH_MAX) {
+            count = UDP_RECV_BATCH_MAX;
+        }
+
+        if (useSelect) {
+            fd_set readfds;
+            struct timeval tv;
+
+            FD_ZERO(&readfds);
+            FD_SET(s, &readfds);
+
+            // Wait up to 100 ms for the socket to be readable
+            tv.tv_sec = 0;
+            tv.tv_usec = UDP_RECV_POLL_TIMEOUT_MS * 1000;
+
+            err = select((int)(s) + 1, &readfds, NULL, NULL, &tv);
+            if (err <= 0) {
+                // Return if an error or timeout occurs
+                return err;
+            }
+
+            // Take whatever is queued without blocking
+            flags = MSG_DONTWAIT;
+        }
+        else {
+            // Block (up to SO_RCVTIMEO) for the first datagram only
+            flags = MSG_WAITFORONE;
+        }
+
+        memset(msgs, 0, sizeof(*msgs) * count);
+        for (i = 0; i < count; i++) {
+            iovs[i].iov_base = entries[i].buffer;
+            iovs[i].iov_len = entries[i].size;
+            msgs[i].msg_hdr.msg_iov = &iovs[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_control = control[i];
+            msgs[i].msg_hdr.msg_controllen = sizeof(control[i]);
+        }
+
+        err = (int)syscall(__NR_recvmmsg, s, msgs, count, flags, NULL);
+        if (err < 0) {
+            if (LastSocketError() == ENOSYS) {
+                Limelog("recvmmsg() is unsupported; falling back to recv()\n");
+                recvmmsgUnsupported = 1;
+                count = 1;
+            }
+            else if (LastSocketError() == EWOULDBLOCK ||
+                     LastSocketError() == EINTR ||
+                     LastSocketError() == EAGAIN) {
+                // Return 0 for timeout
+                return 0;
+            }
+            else {
+                return err;
+            }
+        }
+        else {
+            uint64_t nowMs = PltGetMillis();
+#ifdef SO_TIMESTAMPNS
+            struct timespec realNow;
+
+            clock_gettime(CLOCK_REALTIME, &realNow);
+#endif
+
+            for (i = 0; i < err; i++) {
+#if defined(SO_TIMESTAMPNS) || defined(SO_RXQ_OVFL)
+                struct cmsghdr* cmsg;
+#endif
+
+                entries[i].length = (int)msgs[i].msg_len;
+                entries[i].receiveTimeMs = nowMs;
+                entries[i].socketDropCount = 0;
+
+#if defined(SO_TIMESTAMPNS) || defined(SO_RXQ_OVFL)
+                for (cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg)) {
+                    if (cmsg->cmsg_level != SOL_SOCKET) {
+                        continue;
+                    }
+#ifdef SO_TIMESTAMPNS
+                    if (cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+                        struct timespec ts;
+
+                        memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+                        entries[i].receiveTimeMs = kernelTimestampToMillis(&ts, &realNow, nowMs);
+                    }
+#endif
+#ifdef SO_RXQ_OVFL
+                    // Only attached once the kernel has dropped something
+                    if (cmsg->cmsg_type == SO_RXQ_OVFL) {
+                        memcpy(&entries[i].socketDropCount, CMSG_DATA(cmsg), sizeof(entries[i].socketDropCount));
+                    }
+#endif
+                }
+#endif
+            }
+
+            return err;
+        }
+    }
+#endif
+
+    err = recvUdpSocket(s, entries[0].buffer, entries[0].size, useSelect);
+    if (err > 0) {
+        entries[0].length = err;
+        entries[0].receiveTimeMs = PltGetMillis();
+        entries[0].socketDropCount = 0;
+        return 1;
+    }
+
+    return err;
+}
+
 void closeSocket(SOCKET s) {
 #if defined(LC_WINDOWS)
     closesocket(s);
@@ -77,6 +77,31 @@ SOCKET connectTcpSocket(struct sockaddr_storage* dstaddr, SOCKADDR_LEN addrlen,
 SOCKET bindUdpSocket(int addrfamily, int bufferSize);
 int enableNoDelay(SOCKET s);
 int recvUdpSocket(SOCKET s, char* buffer, int size, int useSelect);
+
+// Maximum number of datagrams returned by a single recvUdpSocketBatch() call
+#define UDP_RECV_BATCH_MAX 32
+
+typedef struct _UDP_RECV_BATCH_ENTRY {
+    // Supplied by the caller
+    char* buffer;
+    int size;
+
+    // Filled in for each datagram received. The receive time shares
+    // the epoch of PltGetMillis().
+    int length;
+    uint64_t receiveTimeMs;
+
+    // Running count of datagrams the OS dropped on this socket for lack of
+    // receive buffer space, as of this datagram. 0 if it isn't reported.
+    uint32_t socketDropCount;
+} UDP_RECV_BATCH_ENTRY, *PUDP_RECV_BATCH_ENTRY;
+
+int getUdpRecvBatchSize(int requested);
+void enableUdpRecvTimestamps(SOCKET s);
+void enableUdpRecvDropCounter(SOCKET s);
+int recvUdpSocketBatch(SOCKET s, PUDP_RECV_BATCH_ENTRY entries, int count, int useSelect);
+int enableUdpBusyPoll(SOCKET s, int busyPollUs);
+int spinUntilUdpSocketReadable(SOCKET s, int spinUs);
 void shutdownTcpSocket(SOCKET s);
 int setNonFatalRecvTimeoutMs(SOCKET s, int timeoutMs);
 void setRecvTimeout(SOCKET s, int timeoutSec);
@@ -51,6 +51,17 @@ void PltInterruptThread(PLT_THREAD*thread);
 int PltIsThreadInterrupted(PLT_THREAD*thread);
 void PltJoinThread(PLT_THREAD*thread);
 
+// Priority classes for PltSetCurrentThreadPriority()
+#define PLT_THREAD_PRIORITY_NORMAL 0
+#define PLT_THREAD_PRIORITY_HIGH 1
+#define PLT_THREAD_PRIORITY_REALTIME 2
+
+// These apply to the calling thread and are best effort
+void PltSetCurrentThreadName(const char* name);
+int PltSetCurrentThreadPriority(int priority);
+int PltSetCurrentThreadAffinity(uint64_t cpuMask);
+int PltGetCpuCount(void);
+
 int PltCreateEvent(PLT_EVENT* event);
 void PltCloseEvent(PLT_EVENT* event);
 void PltSetEvent(PLT_EVENT* event);
@@ -0,0 +1,200 @@
+#include "RtpCapture.h"
+
+// Capture files are written from the receive thread, so give stdio a
+// large buffer to keep disk writes off the packet path as much as possible
+#define RTP_CAPTURE_WRITE_BUFFER (256 * 1024)
+
+#define HEADER_FIELD_COUNT 10
+
+static void headerToFields(PRTP_CAPTURE_HEADER header, int* fields) {
+    fields[0] = header->packetSize;
+    fields[1] = header->width;
+    fields[2] = header->height;
+    fields[3] = header->fps;
+    fields[4] = header->bitrate;
+    fields[5] = header->videoFormat;
+    memcpy(&fields[6], header->appVersionQuad, sizeof(header->appVersionQuad));
+}
+
+static void fieldsToHeader(int* fields, PRTP_CAPTURE_HEADER header) {
+    header->packetSize = fields[0];
+    header->width = fields[1];
+    header->height = fields[2];
+    header->fps = fields[3];
+    header->bitrate = fields[4];
+    header->videoFormat = fields[5];
+    memcpy(header->appVersionQuad, &fields[6], sizeof(header->appVersionQuad));
+}
+
+static int writeUint32(FILE* file, unsigned int value) {
+    unsigned char bytes[4];
+
+    bytes[0] = (unsigned char)value;
+    bytes[1] = (unsigned char)(value >> 8);
+    bytes[2] = (unsigned char)(value >> 16);
+    bytes[3] = (unsigned char)(value >> 24);
+
+    return fwrite(bytes, sizeof(bytes), 1, file) == 1 ? 0 : -1;
+}
+
+static int readUint32(FILE* file, unsigned int* value) {
+    unsigned char bytes[4];
+
+    if (fread(bytes, sizeof(bytes), 1, file) != 1) {
+        return -1;
+    }
+
+    *value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((unsigned int)bytes[3] << 24);
+    return 0;
+}
+
+static int writeVarint(FILE* file, unsigned long long value) {
+    unsigned char bytes[10];
+    int length = 0;
+
+    do {
+        bytes[length] = value & 0x7F;
+        value >>= 7;
+        if (value != 0) {
+            bytes[length] |= 0x80;
+        }
+        length++;
+    } while (value != 0);
+
+    return fwrite(bytes, length, 1, file) == 1 ? 0 : -1;
+}
+
+// Returns 1 on success, 0 at a clean end of file, and -1 on a truncated or corrupt value
+static int readVarint(FILE* file, unsigned long long* value, int atRecordStart) {
+    int shift = 0;
+    int c;
+
+    *value = 0;
+    for (;;) {
+        c = fgetc(file);
+        if (c == EOF) {
+            return (atRecordStart && shift == 0) ? 0 : -1;
+        }
+
+        *value |= (unsigned long long)(c & 0x7F) << shift;
+        if ((c & 0x80) == 0) {
+            return 1;
+        }
+
+        shift += 7;
+        if (shift >= 64) {
+            return -1;
+        }
+    }
+}
+
+int RtpcCreateCaptureFile(PRTP_CAPTURE_FILE capture, const char* path, PRTP_CAPTURE_HEADER header) {
+    int fields[HEADER_FIELD_COUNT];
+    int i;
+
+    capture->lastReceiveTimeMs = 0;
+    capture->file = fopen(path, "wb");
+    if (capture->file == NULL) {
+        return -1;
+    }
+
+    setvbuf(capture->file, NULL, _IOFBF, RTP_CAPTURE_WRITE_BUFFER);
+
+    if (fwrite(RTP_CAPTURE_MAGIC, RTP_CAPTURE_MAGIC_LENGTH, 1, capture->file) != 1 ||
+        writeUint32(capture->file, RTP_CAPTURE_VERSION) != 0) {
+        RtpcCloseCaptureFile(capture);
+        return -1;
+    }
+
+    headerToFields(header, fields);
+    for (i = 0; i < HEADER_FIELD_COUNT; i++) {
+        if (writeUint32(capture->file, (unsigned int)fields[i]) != 0) {
+            RtpcCloseCaptureFile(capture);
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int RtpcOpenCaptureFile(PRTP_CAPTURE_FILE capture, const char* path, PRTP_CAPTURE_HEADER header) {
+    char magic[RTP_CAPTURE_MAGIC_LENGTH];
+    int fields[HEADER_FIELD_COUNT];
+    unsigned int value;
+    int i;
+
+    capture->lastReceiveTimeMs = 0;
+    capture->file = fopen(path, "rb");
+    if (capture->file == NULL) {
+        return -1;
+    }
+
+    if (fread(magic, sizeof(magic), 1, capture->file) != 1 ||
+        memcmp(magic, RTP_CAPTURE_MAGIC, sizeof(magic)) != 0 ||
+        readUint32(capture->file, &value) != 0 || value != RTP_CAPTURE_VERSION) {
+        RtpcCloseCaptureFile(capture);
+        return -1;
+    }
+
+    for (i = 0; i < HEADER_FIELD_COUNT; i++) {
+        if (readUint32(capture->file, &value) != 0) {
+            RtpcCloseCaptureFile(capture);
+            return -1;
+        }
+        fields[i] = (int)value;
+    }
+
+    fieldsToHeader(fields, header);
+    return 0;
+}
+
+int RtpcWriteDatagram(PRTP_CAPTURE_FILE capture, char* data, int length, unsigned long long receiveTimeMs) {
+    unsigned long long delta;
+
+    // Receive times are monotonic but kernel timestamps may arrive slightly out of order
+    delta = receiveTimeMs > capture->lastReceiveTimeMs ? receiveTimeMs - capture->lastReceiveTimeMs : 0;
+    if (capture->lastReceiveTimeMs == 0) {
+        delta = receiveTimeMs;
+    }
+    capture->lastReceiveTimeMs += delta;
+
+    if (writeVarint(capture->file, delta) != 0 ||
+        writeVarint(capture->file, (unsigned long long)length) != 0 ||
+        fwrite(data, length, 1, capture->file) != 1) {
+        return -1;
+    }
+
+    return 0;
+}
+
+// Returns 1 if a datagram was read, 0 at the end of the capture, and -1 on error
+int RtpcReadDatagram(PRTP_CAPTURE_FILE capture, char* buffer, int bufferSize, int* length, unsigned long long* receiveTimeMs) {
+    unsigned long long delta, datagramLength;
+    int err;
+
+    err = readVarint(capture->file, &delta, 1);
+    if (err <= 0) {
+        return err;
+    }
+
+    if (readVarint(capture->file, &datagramLength, 0) != 1 ||
+        datagramLength == 0 || datagramLength > (unsigned long long)bufferSize) {
+        return -1;
+    }
+
+    if (fread(buffer, (size_t)datagramLength, 1, capture->file) != 1) {
+        return -1;
+    }
+
+    capture->lastReceiveTimeMs += delta;
+    *receiveTimeMs = capture->lastReceiveTimeMs;
+    *length = (int)datagramLength;
+    return 1;
+}
+
+void RtpcCloseCaptureFile(PRTP_CAPTURE_FILE capture) {
+    if (capture->file != NULL) {
+        fclose(capture->file);
+        capture->file = NULL;
+    }
+}
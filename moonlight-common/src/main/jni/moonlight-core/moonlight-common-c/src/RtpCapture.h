@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Platform.h"
+
+#include <stdio.h>
+
+// Capture files start with the magic and version followed by the stream
+// parameters needed to replay them. All header integers are little-endian.
+// Each record that follows is the receive time delta from the previous
+// record in milliseconds and the datagram length (both as LEB128 varints),
+// then the datagram exactly as it was received from the socket.
+#define RTP_CAPTURE_MAGIC "MLRTPCAP"
+#define RTP_CAPTURE_MAGIC_LENGTH 8
+#define RTP_CAPTURE_VERSION 1
+
+typedef struct _RTP_CAPTURE_HEADER {
+    int packetSize;
+    int width;
+    int height;
+    int fps;
+    int bitrate;
+    int videoFormat;
+    int appVersionQuad[4];
+} RTP_CAPTURE_HEADER, *PRTP_CAPTURE_HEADER;
+
+typedef struct _RTP_CAPTURE_FILE {
+    FILE* file;
+    unsigned long long lastReceiveTimeMs;
+} RTP_CAPTURE_FILE, *PRTP_CAPTURE_FILE;
+
+int RtpcCreateCaptureFile(PRTP_CAPTURE_FILE capture, const char* path, PRTP_CAPTURE_HEADER header);
+int RtpcOpenCaptureFile(PRTP_CAPTURE_FILE capture, const char* path, PRTP_CAPTURE_HEADER header);
+int RtpcWriteDatagram(PRTP_CAPTURE_FILE capture, char* data, int length, unsigned long long receiveTimeMs);
+int RtpcReadDatagram(PRTP_CAPTURE_FILE capture, char* buffer, int bufferSize, int* length, unsigned long long* receiveTimeMs);
+void RtpcCloseCaptureFile(PRTP_CAPTURE_FILE capture);
@@ -1,72 +1,212 @@
 #include "Limelight-internal.h"
 #include "RtpFecQueue.h"
+#include "FrameTelemetry.h"
+#include "PlatformAtomics.h"
 #include "rs.h"
 
-void RtpfInitializeQueue(PRTP_FEC_QUEUE queue) {
+void RtpfInitializeQueue(PRTP_FEC_QUEUE queue, PPACKET_POOL packetPool) {
     reed_solomon_init();
     memset(queue, 0, sizeof(*queue));
-    
+
+    queue->packetPool = packetPool;
+
     queue->currentFrameNumber = UINT16_MAX;
 }
 
+static int isShardReceived(PRTPFEC_BLOCK block, int index) {
+    return (block->receivedBitmap[index / 32] >> (index % 32)) & 1;
+}
+
+static int getBlockTotalPackets(PRTPFEC_BLOCK block) {
+    return U16(block->highestSequenceNumber - block->lowestSequenceNumber) + 1;
+}
+
+// Returns the packets of the block to the pool
+static void discardBlockPackets(PRTP_FEC_QUEUE queue, PRTPFEC_BLOCK block) {
+    int totalPackets, i;
+
+    if (block->size == 0) {
+        return;
+    }
+
+    totalPackets = getBlockTotalPackets(block);
+    for (i = 0; i < totalPackets; i++) {
+        if (isShardReceived(block, i)) {
+            PpFreePacket(queue->packetPool, block->slots[i]->packet);
+        }
+    }
+
+    memset(block->receivedBitmap, 0, ((totalPackets + 31) / 32) * sizeof(uint32_t));
+    block->size = 0;
+}
+
+static void freeBlockArrays(PRTPFEC_BLOCK block) {
+    free(block->slots);
+    free(block->receivedBitmap);
+    free(block->fecShards);
+    free(block->fecMarks);
+    block->slots = NULL;
+    block->receivedBitmap = NULL;
+    block->fecShards = NULL;
+    block->fecMarks = NULL;
+    block->slotCapacity = 0;
+}
+
+// Makes room for a block of this many shards. The arrays only ever grow, so
+// this only allocates for the first frame and the odd larger one after it.
+static int ensureBlockCapacity(PRTPFEC_BLOCK block, int totalPackets) {
+    int capacity;
+
+    LC_ASSERT(block->size == 0);
+
+    if (totalPackets <= block->slotCapacity) {
+        return 0;
+    }
+
+    capacity = block->slotCapacity != 0 ? block->slotCapacity : 64;
+    while (capacity < totalPackets) {
+        capacity *= 2;
+    }
+
+    freeBlockArrays(block);
+
+    block->slots = malloc(capacity * sizeof(*block->slots));
+    block->receivedBitmap = calloc((capacity + 31) / 32, sizeof(uint32_t));
+    block->fecShards = malloc(capacity * sizeof(*block->fecShards));
+    block->fecMarks = malloc(capacity * sizeof(*block->fecMarks));
+    if (block->slots == NULL || block->receivedBitmap == NULL ||
+        block->fecShards == NULL || block->fecMarks == NULL) {
+        freeBlockArrays(block);
+        return -1;
+    }
+
+    block->slotCapacity = capacity;
+    return 0;
+}
+
+static void freeBlockList(PRTP_FEC_QUEUE queue, PRTPFEC_BLOCK block) {
+    while (block != NULL) {
+        PRTPFEC_BLOCK next = block->next;
+
+        discardBlockPackets(queue, block);
+        freeBlockArrays(block);
+        free(block);
+        block = next;
+    }
+}
+
+// Blocks in the recovery ring are also on the pending list, which owns them
+static void releaseQueuedBlock(void* block) {
+    (void)block;
+}
+
 void RtpfCleanupQueue(PRTP_FEC_QUEUE queue) {
-    while (queue->bufferHead != NULL) {
-        PRTPFEC_QUEUE_ENTRY entry = queue->bufferHead;
-        queue->bufferHead = entry->next;
-        free(entry->packet);
+    int i;
+
+    for (i = 0; i < RTPF_RS_CACHE_SIZE; i++) {
+        reed_solomon_release(queue->rsCache[i].rs);
+        queue->rsCache[i].rs = NULL;
     }
-    
+
+    if (queue->asyncRecovery) {
+        // The recovery thread is gone by now, so anything still pending
+        // was never recovered
+        SrqDestroyRingQueue(&queue->recoveryQueue, releaseQueuedBlock);
+        PltCloseEvent(&queue->blockReleasedEvent);
+        PltDeleteMutex(&queue->lock);
+        queue->asyncRecovery = 0;
+    }
+
+    freeBlockList(queue, queue->buffer);
+    freeBlockList(queue, queue->pendingHead);
+    freeBlockList(queue, queue->freeBlocks);
+    queue->buffer = NULL;
+    queue->pendingHead = queue->pendingTail = NULL;
+    queue->freeBlocks = NULL;
+    queue->pendingBlocks = 0;
+
     while (queue->queueHead != NULL) {
         PRTPFEC_QUEUE_ENTRY entry = queue->queueHead;
         queue->queueHead = entry->next;
-        free(entry->packet);
+        PpFreePacket(queue->packetPool, entry->packet);
     }
+    queue->queueTail = NULL;
+    queue->queueSize = 0;
 }
 
-// newEntry is contained within the packet buffer so we free the whole entry by freeing entry->packet
-static int queuePacket(PRTP_FEC_QUEUE queue, PRTPFEC_QUEUE_ENTRY newEntry, int head, PRTP_PACKET packet, int length, int isParity) {
-    PRTPFEC_QUEUE_ENTRY entry;
-    
-    LC_ASSERT(!isBefore16(packet->sequenceNumber, queue->bufferLowestSequenceNumber));
+// Returns a cached Reed-Solomon context for these shard counts, creating one
+// in place of the least recently used entry if necessary
+static reed_solomon* getReedSolomonContext(PRTP_FEC_QUEUE queue, int dataShards, int parityShards) {
+    PRTPFEC_RS_CACHE_ENTRY victim = &queue->rsCache[0];
+    int i;
 
-    // Don't queue duplicates either
-    entry = queue->bufferHead;
-    while (entry != NULL) {
-        if (entry->packet->sequenceNumber == packet->sequenceNumber) {
-            return 0;
+    for (i = 0; i < RTPF_RS_CACHE_SIZE; i++) {
+        PRTPFEC_RS_CACHE_ENTRY cacheEntry = &queue->rsCache[i];
+
+        if (cacheEntry->rs != NULL &&
+            cacheEntry->dataShards == dataShards &&
+            cacheEntry->parityShards == parityShards) {
+            cacheEntry->lastUsed = ++queue->rsCacheClock;
+            PLT_ATOMIC_INCREMENT(&queue->rsContextHits);
+            return cacheEntry->rs;
         }
 
-        entry = entry->next;
+        if (victim->rs != NULL && (cacheEntry->rs == NULL || cacheEntry->lastUsed < victim->lastUsed)) {
+            victim = cacheEntry;
+        }
+    }
+
+    PLT_ATOMIC_INCREMENT(&queue->rsContextMisses);
+
+    reed_solomon* rs = reed_solomon_new(dataShards, parityShards);
+    if (rs == NULL) {
+        return NULL;
+    }
+
+    reed_solomon_release(victim->rs);
+
+    victim->rs = rs;
+    victim->dataShards = dataShards;
+    victim->parityShards = parityShards;
+    victim->lastUsed = ++queue->rsCacheClock;
+
+    return rs;
+}
+
+// Only counters owned by the queue are read here so this never touches a
+// context that the recovering thread may be releasing
+void RtpfGetFecStats(PRTP_FEC_QUEUE queue, PFEC_STATS stats) {
+    memset(stats, 0, sizeof(*stats));
+    stats->contextCacheHits = PLT_ATOMIC_LOAD(&queue->rsContextHits);
+    stats->contextCacheMisses = PLT_ATOMIC_LOAD(&queue->rsContextMisses);
+    stats->matrixCacheHits = PLT_ATOMIC_LOAD(&queue->rsMatrixHits);
+    stats->matrixCacheMisses = PLT_ATOMIC_LOAD(&queue->rsMatrixMisses);
+    stats->asyncRecoveries = PLT_ATOMIC_LOAD(&queue->asyncRecoveries);
+    stats->packetsReceivedDuringRecovery = PLT_ATOMIC_LOAD(&queue->packetsReceivedDuringRecovery);
+}
+
+// newEntry is contained within the packet buffer so we return the whole entry to the pool by freeing entry->packet
+static int queuePacket(PRTPFEC_BLOCK block, PRTPFEC_QUEUE_ENTRY newEntry, PRTP_PACKET packet, int length, int isParity, unsigned long long receiveTimeMs) {
+    int index = U16(packet->sequenceNumber - block->lowestSequenceNumber);
+
+    LC_ASSERT(!isBefore16(packet->sequenceNumber, block->lowestSequenceNumber));
+    LC_ASSERT(index < getBlockTotalPackets(block));
+
+    // Don't queue duplicates either
+    if (isShardReceived(block, index)) {
+        return 0;
     }
 
     newEntry->packet = packet;
     newEntry->length = length;
     newEntry->isParity = isParity;
-    newEntry->receiveTimeMs = PltGetMillis();
-    newEntry->prev = NULL;
+    newEntry->receiveTimeMs = receiveTimeMs;
+    newEntry->fecRecoveryUs = 0;
     newEntry->next = NULL;
 
-    if (queue->bufferHead == NULL) {
-        LC_ASSERT(queue->bufferSize == 0);
-        queue->bufferHead = queue->bufferTail = newEntry;
-    }
-    else if (head) {
-        LC_ASSERT(queue->bufferSize > 0);
-        PRTPFEC_QUEUE_ENTRY oldHead = queue->bufferHead;
-        newEntry->next = oldHead;
-        LC_ASSERT(oldHead->prev == NULL);
-        oldHead->prev = newEntry;
-        queue->bufferHead = newEntry;
-    }
-    else {
-        LC_ASSERT(queue->bufferSize > 0);
-        PRTPFEC_QUEUE_ENTRY oldTail = queue->bufferTail;
-        newEntry->prev = oldTail;
-        LC_ASSERT(oldTail->next == NULL);
-        oldTail->next = newEntry;
-        queue->bufferTail = newEntry;
-    }
-    queue->bufferSize++;
+    block->slots[index] = newEntry;
+    block->receivedBitmap[index / 32] |= 1U << (index % 32);
+    block->size++;
 
     return 1;
 }
@@ -75,34 +215,31 @@ static int queuePacket(PRTP_FEC_QUEUE queue, PRTPFEC_QUEUE_ENTRY newEntry, int h
     ret = -1;                                         \
     Limelog("FEC recovery returned corrupt packet %d" \
             " (frame %d)", rtpPacket->sequenceNumber, \
-            queue->currentFrameNumber);               \
-    free(packets[i]);                                 \
+            block->frameNumber);                      \
+    PpFreePacket(queue->packetPool, packets[i]);      \
     continue
 
 // Returns 0 if the frame is completely constructed
-static int reconstructFrame(PRTP_FEC_QUEUE queue) {
-    int totalPackets = U16(queue->bufferHighestSequenceNumber - queue->bufferLowestSequenceNumber) + 1;
+static int reconstructFrame(PRTP_FEC_QUEUE queue, PRTPFEC_BLOCK block) {
+    int totalPackets = getBlockTotalPackets(block);
     int ret;
     
-    if (queue->bufferSize < queue->bufferDataPackets) {
+    if (block->size < block->dataPackets) {
         // Not enough data to recover yet
         return -1;
     }
     
-    if (queue->receivedBufferDataPackets == queue->bufferDataPackets) {
+    if (block->receivedDataPackets == block->dataPackets) {
         // We've received a full frame with no need for FEC.
         return 0;
     }
 
+    uint64_t recoveryStartUs = PltGetMicroseconds();
     reed_solomon* rs = NULL;
-    unsigned char** packets = malloc(totalPackets * sizeof(unsigned char*));
-    unsigned char* marks = malloc(totalPackets * sizeof(unsigned char));
-    if (packets == NULL || marks == NULL) {
-        ret = -2;
-        goto cleanup;
-    }
+    unsigned char** packets = block->fecShards;
+    unsigned char* marks = block->fecMarks;
     
-    rs = reed_solomon_new(queue->bufferDataPackets, queue->bufferParityPackets);
+    rs = getReedSolomonContext(queue, block->dataPackets, block->parityPackets);
     
     // This could happen in an OOM condition, but it could also mean the FEC data
     // that we fed to reed_solomon_new() is bogus, so we'll assert to get a better look.
@@ -112,29 +249,36 @@ static int reconstructFrame(PRTP_FEC_QUEUE queue) {
         goto cleanup;
     }
     
-    memset(marks, 1, sizeof(char) * (totalPackets));
-    
     int receiveSize = StreamConfig.packetSize + MAX_RTP_HEADER_SIZE;
-    int packetBufferSize = receiveSize + sizeof(RTPFEC_QUEUE_ENTRY);
 
-    PRTPFEC_QUEUE_ENTRY entry = queue->bufferHead;
-    while (entry != NULL) {
-        int index = U16(entry->packet->sequenceNumber - queue->bufferLowestSequenceNumber);
-        packets[index] = (unsigned char*) entry->packet;
-        marks[index] = 0;
-        
-        //Set padding to zero
-        if (entry->length < receiveSize) {
-            memset(&packets[index][entry->length], 0, receiveSize - entry->length);
-        }
+    LC_ASSERT(queue->packetPool->bufferSize >= receiveSize + (int)sizeof(RTPFEC_QUEUE_ENTRY));
 
-        entry = entry->next;
-    }
+    // Any received shard will do for the RTP header of the recovered ones
+    char rtpHeader = 0;
 
     int i;
+    for (i = 0; i < totalPackets; i++) {
+        if (isShardReceived(block, i)) {
+            PRTPFEC_QUEUE_ENTRY entry = block->slots[i];
+
+            packets[i] = (unsigned char*) entry->packet;
+            marks[i] = 0;
+            rtpHeader = entry->packet->header;
+
+            //Set padding to zero
+            if (entry->length < receiveSize) {
+                memset(&packets[i][entry->length], 0, receiveSize - entry->length);
+            }
+        }
+        else {
+            packets[i] = NULL;
+            marks[i] = 1;
+        }
+    }
+
     for (i = 0; i < totalPackets; i++) {
         if (marks[i]) {
-            packets[i] = malloc(packetBufferSize);
+            packets[i] = PpAllocatePacket(queue->packetPool);
             if (packets[i] == NULL) {
                 ret = -4;
                 goto cleanup_packets;
@@ -142,7 +286,13 @@ static int reconstructFrame(PRTP_FEC_QUEUE queue) {
         }
     }
     
+    unsigned int matrixHits = rs->decode_cache_hits;
+    unsigned int matrixMisses = rs->decode_cache_misses;
+
     ret = reed_solomon_reconstruct(rs, packets, marks, totalPackets, receiveSize);
+
+    PLT_ATOMIC_ADD(&queue->rsMatrixHits, rs->decode_cache_hits - matrixHits);
+    PLT_ATOMIC_ADD(&queue->rsMatrixMisses, rs->decode_cache_misses - matrixMisses);
     
     // We should always provide enough parity to recover the missing data successfully.
     // If this fails, something is probably wrong with our FEC state.
@@ -152,11 +302,11 @@ cleanup_packets:
     for (i = 0; i < totalPackets; i++) {
         if (marks[i]) {
             // Only submit frame data, not FEC packets
-            if (ret == 0 && i < queue->bufferDataPackets) {
+            if (ret == 0 && i < block->dataPackets) {
                 PRTPFEC_QUEUE_ENTRY queueEntry = (PRTPFEC_QUEUE_ENTRY)&packets[i][receiveSize];
                 PRTP_PACKET rtpPacket = (PRTP_PACKET) packets[i];
-                rtpPacket->sequenceNumber = U16(i + queue->bufferLowestSequenceNumber);
-                rtpPacket->header = queue->bufferHead->packet->header;
+                rtpPacket->sequenceNumber = U16(i + block->lowestSequenceNumber);
+                rtpPacket->header = rtpHeader;
                 
                 int dataOffset = sizeof(*rtpPacket);
                 if (rtpPacket->header & FLAG_EXTENSION) {
@@ -164,7 +314,7 @@ cleanup_packets:
                 }
 
                 PNV_VIDEO_PACKET nvPacket = (PNV_VIDEO_PACKET)(((char*)rtpPacket) + dataOffset);
-                nvPacket->frameIndex = queue->currentFrameNumber;
+                nvPacket->frameIndex = block->frameNumber;
 
                 // Do some rudamentary checks to see that the recovered packet is sane.
                 // In some cases (4K 30 FPS 80 Mbps), we seem to get some odd failures
@@ -174,10 +324,10 @@ cleanup_packets:
                 if (i == 0 && !(nvPacket->flags & FLAG_SOF)) {
                     PACKET_RECOVERY_FAILURE();
                 }
-                if (i == queue->bufferDataPackets - 1 && !(nvPacket->flags & FLAG_EOF)) {
+                if (i == block->dataPackets - 1 && !(nvPacket->flags & FLAG_EOF)) {
                     PACKET_RECOVERY_FAILURE();
                 }
-                if (i > 0 && i < queue->bufferDataPackets - 1 && !(nvPacket->flags & FLAG_CONTAINS_PIC_DATA)) {
+                if (i > 0 && i < block->dataPackets - 1 && !(nvPacket->flags & FLAG_CONTAINS_PIC_DATA)) {
                     PACKET_RECOVERY_FAILURE();
                 }
                 if (nvPacket->flags & ~(FLAG_SOF | FLAG_EOF | FLAG_CONTAINS_PIC_DATA)) {
@@ -189,49 +339,171 @@ cleanup_packets:
                 // discarded by decoders. It's not safe to strip all zero padding because
                 // it may be a legitimate part of the H.264 bytestream.
 
-                LC_ASSERT(isBefore16(rtpPacket->sequenceNumber, queue->bufferFirstParitySequenceNumber));
-                queuePacket(queue, queueEntry, 0, rtpPacket, StreamConfig.packetSize + dataOffset, 0);
+                LC_ASSERT(isBefore16(rtpPacket->sequenceNumber, block->firstParitySequenceNumber));
+                queuePacket(block, queueEntry, rtpPacket, StreamConfig.packetSize + dataOffset, 0, PltGetMillis());
             } else if (packets[i] != NULL) {
-                free(packets[i]);
+                PpFreePacket(queue->packetPool, packets[i]);
             }
         }
     }
 
 cleanup:
-    reed_solomon_release(rs);
-
-    if (packets != NULL)
-        free(packets);
+    if (ret == 0) {
+        // The depacketizer picks this up with the first packet of the frame.
+        // A zero duration would read as no recovery at all.
+        uint32_t recoveryUs = (uint32_t)(PltGetMicroseconds() - recoveryStartUs);
 
-    if (marks != NULL)
-        free(marks);
+        block->slots[0]->fecRecoveryUs = recoveryUs != 0 ? recoveryUs : 1;
+    }
     
     return ret;
 }
 
-static void removeEntry(PRTP_FEC_QUEUE queue, PRTPFEC_QUEUE_ENTRY entry) {
-    LC_ASSERT(entry != NULL);
-    LC_ASSERT(queue->queueSize > 0);
-    LC_ASSERT(queue->queueHead != NULL);
-    LC_ASSERT(queue->queueTail != NULL);
+// Moves the data shards of the completed block onto the tail of the ready queue
+// in sequence order and returns the parity shards to the pool
+static void queueCompletedFrame(PRTP_FEC_QUEUE queue, PRTPFEC_BLOCK block) {
+    int totalPackets = getBlockTotalPackets(block);
+    int i;
 
-    if (queue->queueHead == entry) {
-        queue->queueHead = entry->next;
+    for (i = 0; i < totalPackets; i++) {
+        PRTPFEC_QUEUE_ENTRY entry;
+
+        if (!isShardReceived(block, i)) {
+            continue;
+        }
+
+        entry = block->slots[i];
+        if (entry->isParity) {
+            PpFreePacket(queue->packetPool, entry->packet);
+            continue;
+        }
+
+        entry->next = NULL;
+        if (queue->queueTail == NULL) {
+            queue->queueHead = entry;
+        }
+        else {
+            queue->queueTail->next = entry;
+        }
+        queue->queueTail = entry;
+        queue->queueSize++;
+    }
+
+    memset(block->receivedBitmap, 0, ((totalPackets + 31) / 32) * sizeof(uint32_t));
+    block->size = 0;
+}
+
+// Moves finished blocks from the head of the pending list to the ready queue.
+// The lock must be held.
+static void releaseCompletedBlocks(PRTP_FEC_QUEUE queue) {
+    while (queue->pendingHead != NULL && queue->pendingHead->state != RTPF_BLOCK_RECOVERING) {
+        PRTPFEC_BLOCK block = queue->pendingHead;
+
+        queue->pendingHead = block->next;
+        if (queue->pendingHead == NULL) {
+            queue->pendingTail = NULL;
+        }
+        queue->pendingBlocks--;
+
+        // Failed blocks already gave their packets back
+        if (block->state == RTPF_BLOCK_COMPLETE) {
+            queueCompletedFrame(queue, block);
+        }
+
+        block->state = RTPF_BLOCK_ASSEMBLING;
+        block->next = queue->freeBlocks;
+        queue->freeBlocks = block;
+    }
+}
+
+// Gives the receive thread an empty block to assemble the next frame in
+static int ensureAssemblyBlock(PRTP_FEC_QUEUE queue) {
+    if (queue->buffer != NULL) {
+        return 0;
+    }
+
+    if (queue->asyncRecovery) {
+        PltLockMutex(&queue->lock);
+        queue->buffer = queue->freeBlocks;
+        if (queue->buffer != NULL) {
+            queue->freeBlocks = queue->buffer->next;
+            queue->buffer->next = NULL;
+        }
+        PltUnlockMutex(&queue->lock);
+
+        if (queue->buffer != NULL) {
+            return 0;
+        }
+    }
+
+    queue->buffer = calloc(1, sizeof(*queue->buffer));
+    return queue->buffer != NULL ? 0 : -1;
+}
+
+// Takes the finished block away from the receive thread. Lossless blocks go
+// straight to the ready queue unless they would jump ahead of a recovery.
+static void submitCompletedBlock(PRTP_FEC_QUEUE queue) {
+    PRTPFEC_BLOCK block = queue->buffer;
+    int needsRecovery = block->receivedDataPackets != block->dataPackets;
+
+    PltLockMutex(&queue->lock);
+
+    // If the recovery thread is this far behind, wait for it. That is no
+    // worse than recovering inline, and it keeps every frame.
+    while (queue->pendingBlocks >= RTPF_MAX_PENDING_BLOCKS) {
+        PltClearEvent(&queue->blockReleasedEvent);
+        PltUnlockMutex(&queue->lock);
+
+        if (PltWaitForEvent(&queue->blockReleasedEvent) != PLT_WAIT_SUCCESS) {
+            discardBlockPackets(queue, block);
+            return;
+        }
+
+        PltLockMutex(&queue->lock);
     }
-    if (queue->queueTail == entry) {
-        queue->queueTail = entry->prev;
+
+    if (!needsRecovery && queue->pendingHead == NULL) {
+        queueCompletedFrame(queue, block);
+        PltUnlockMutex(&queue->lock);
+        return;
     }
 
-    if (entry->prev != NULL) {
-        entry->prev->next = entry->next;
+    block->state = needsRecovery ? RTPF_BLOCK_RECOVERING : RTPF_BLOCK_COMPLETE;
+    block->next = NULL;
+    if (queue->pendingTail == NULL) {
+        queue->pendingHead = block;
+    }
+    else {
+        queue->pendingTail->next = block;
     }
-    if (entry->next != NULL) {
-        entry->next->prev = entry->prev;
+    queue->pendingTail = block;
+    queue->pendingBlocks++;
+    if (needsRecovery) {
+        // Only changed under the lock, but read without it
+        PLT_ATOMIC_STORE(&queue->recoveriesInFlight, queue->recoveriesInFlight + 1);
+    }
+
+    PltUnlockMutex(&queue->lock);
+
+    queue->buffer = NULL;
+
+    if (needsRecovery) {
+        // There are never more recoveries in flight than the ring holds
+        int err = SrqOfferQueueItem(&queue->recoveryQueue, block);
+        LC_ASSERT(err == SRQ_SUCCESS);
+        (void)err;
     }
-    queue->queueSize--;
 }
 
-int RtpfAddPacket(PRTP_FEC_QUEUE queue, PRTP_PACKET packet, int length, PRTPFEC_QUEUE_ENTRY packetEntry) {
+int RtpfAddPacket(PRTP_FEC_QUEUE queue, PRTP_PACKET packet, int length, PRTPFEC_QUEUE_ENTRY packetEntry, unsigned long long receiveTimeMs) {
+    PRTPFEC_BLOCK block;
+    int ready;
+
+    if (queue->asyncRecovery && PLT_ATOMIC_LOAD(&queue->recoveriesInFlight) != 0) {
+        // This packet would have waited in the socket buffer with inline recovery
+        PLT_ATOMIC_INCREMENT(&queue->packetsReceivedDuringRecovery);
+    }
+
     if (isBefore16(packet->sequenceNumber, queue->bufferLowestSequenceNumber)) {
         // Reject packets behind our current buffer window
         return RTPF_RET_REJECTED;
@@ -250,119 +522,195 @@ int RtpfAddPacket(PRTP_FEC_QUEUE queue, PRTP_PACKET packet, int length, PRTPFEC_
     }
 
     int fecIndex = (nvPacket->fecInfo & 0x3FF000) >> 12;
+
+    if (ensureAssemblyBlock(queue) != 0) {
+        return RTPF_RET_REJECTED;
+    }
+    block = queue->buffer;
     
     // Reinitialize the queue if it's empty after a frame delivery or
     // if we can't finish a frame before receiving the next one.
-    if (queue->bufferSize == 0 || queue->currentFrameNumber != nvPacket->frameIndex) {
-        if (queue->currentFrameNumber != nvPacket->frameIndex && queue->bufferSize != 0) {
+    if (block->size == 0 || queue->currentFrameNumber != nvPacket->frameIndex) {
+        if (queue->currentFrameNumber != nvPacket->frameIndex && block->size != 0) {
             Limelog("Unrecoverable frame %d: %d+%d=%d received < %d needed\n",
-                    queue->currentFrameNumber, queue->receivedBufferDataPackets,
-                    queue->bufferSize - queue->receivedBufferDataPackets,
-                    queue->bufferSize,
-                    queue->bufferDataPackets);
+                    queue->currentFrameNumber, block->receivedDataPackets,
+                    block->size - block->receivedDataPackets,
+                    block->size,
+                    block->dataPackets);
         }
         
         queue->currentFrameNumber = nvPacket->frameIndex;
         
         // Discard any unsubmitted buffers from the previous frame
-        while (queue->bufferHead != NULL) {
-            PRTPFEC_QUEUE_ENTRY entry = queue->bufferHead;
-            queue->bufferHead = entry->next;
-            free(entry->packet);
-        }
+        discardBlockPackets(queue, block);
         
-        queue->bufferTail = NULL;
-        queue->bufferSize = 0;
-        
-        queue->bufferLowestSequenceNumber = U16(packet->sequenceNumber - fecIndex);
-        queue->receivedBufferDataPackets = 0;
-        queue->bufferDataPackets = (nvPacket->fecInfo & 0xFFC00000) >> 22;
-        queue->fecPercentage = (nvPacket->fecInfo & 0xFF0) >> 4;
-        queue->bufferParityPackets = (queue->bufferDataPackets * queue->fecPercentage + 99) / 100;
-        queue->bufferFirstParitySequenceNumber = U16(queue->bufferLowestSequenceNumber + queue->bufferDataPackets);
-        queue->bufferHighestSequenceNumber = U16(queue->bufferFirstParitySequenceNumber + queue->bufferParityPackets - 1);
-    } else if (isBefore16(queue->bufferHighestSequenceNumber, packet->sequenceNumber)) {
+        block->frameNumber = queue->currentFrameNumber;
+        block->lowestSequenceNumber = U16(packet->sequenceNumber - fecIndex);
+        queue->bufferLowestSequenceNumber = block->lowestSequenceNumber;
+        block->receivedDataPackets = 0;
+        block->dataPackets = (nvPacket->fecInfo & 0xFFC00000) >> 22;
+        block->fecPercentage = (nvPacket->fecInfo & 0xFF0) >> 4;
+        block->parityPackets = (block->dataPackets * block->fecPercentage + 99) / 100;
+        block->firstParitySequenceNumber = U16(block->lowestSequenceNumber + block->dataPackets);
+        block->highestSequenceNumber = U16(block->firstParitySequenceNumber + block->parityPackets - 1);
+
+        if (ensureBlockCapacity(block, getBlockTotalPackets(block)) != 0) {
+            return RTPF_RET_REJECTED;
+        }
+    } else if (isBefore16(block->highestSequenceNumber, packet->sequenceNumber)) {
         // In rare cases, we get extra parity packets. It's rare enough that it's probably
         // not worth handling, so we'll just drop them.
         return RTPF_RET_REJECTED;
     }
 
-    LC_ASSERT(!queue->fecPercentage || U16(packet->sequenceNumber - fecIndex) == queue->bufferLowestSequenceNumber);
-    LC_ASSERT((nvPacket->fecInfo & 0xFF0) >> 4 == queue->fecPercentage);
-    LC_ASSERT((nvPacket->fecInfo & 0xFFC00000) >> 22 == queue->bufferDataPackets);
+    LC_ASSERT(!block->fecPercentage || U16(packet->sequenceNumber - fecIndex) == block->lowestSequenceNumber);
+    LC_ASSERT((nvPacket->fecInfo & 0xFF0) >> 4 == block->fecPercentage);
+    LC_ASSERT((nvPacket->fecInfo & 0xFFC00000) >> 22 == block->dataPackets);
 
-    if (!queuePacket(queue, packetEntry, 0, packet, length, !isBefore16(packet->sequenceNumber, queue->bufferFirstParitySequenceNumber))) {
+    if (!queuePacket(block, packetEntry, packet, length, !isBefore16(packet->sequenceNumber, block->firstParitySequenceNumber), receiveTimeMs)) {
         return RTPF_RET_REJECTED;
     }
-    else {
-        if (isBefore16(packet->sequenceNumber, queue->bufferFirstParitySequenceNumber)) {
-            queue->receivedBufferDataPackets++;
+    
+    if (isBefore16(packet->sequenceNumber, block->firstParitySequenceNumber)) {
+        block->receivedDataPackets++;
+    }
+
+    if (queue->asyncRecovery) {
+        // Recovery happens on the other thread once we have enough shards
+        if (block->size >= block->dataPackets) {
+            submitCompletedBlock(queue);
+            
+            // Ignore any more packets for this frame
+            queue->currentFrameNumber++;
         }
-        
+
+        PltLockMutex(&queue->lock);
+        ready = queue->queueHead != NULL;
+        PltUnlockMutex(&queue->lock);
+    }
+    else {
         // Try to submit this frame. If we haven't received enough packets,
         // this will fail and we'll keep waiting.
-        if (reconstructFrame(queue) == 0) {
+        if (reconstructFrame(queue, block) == 0) {
             // Queue the pending frame data
-            if (queue->queueTail == NULL) {
-                queue->queueHead = queue->bufferHead;
-                queue->queueTail = queue->bufferTail;
-            } else {
-                queue->queueTail->next = queue->bufferHead;
-                queue->queueTail = queue->bufferTail;
-            }
-            queue->queueSize += queue->bufferSize;
-            
-            // Clear the buffer list
-            queue->bufferHead = NULL;
-            queue->bufferTail = NULL;
-            queue->bufferSize = 0;
+            queueCompletedFrame(queue, block);
             
             // Ignore any more packets for this frame
             queue->currentFrameNumber++;
         }
 
-        return (queue->queueHead != NULL) ? RTPF_RET_QUEUED_PACKETS_READY : RTPF_RET_QUEUED_NOTHING_READY;
+        ready = queue->queueHead != NULL;
     }
+
+    return ready ? RTPF_RET_QUEUED_PACKETS_READY : RTPF_RET_QUEUED_NOTHING_READY;
 }
 
 PRTPFEC_QUEUE_ENTRY RtpfGetQueuedPacket(PRTP_FEC_QUEUE queue) {
-    PRTPFEC_QUEUE_ENTRY queuedEntry, entry;
+    PRTPFEC_QUEUE_ENTRY queuedEntry;
 
-    // Find the next queued packet
-    queuedEntry = NULL;
-    entry = queue->queueHead;
-    unsigned int lowestRtpSequenceNumber = UINT16_MAX;
-    
-    while (entry != NULL) {
-        // Never return parity packets
-        if (entry->isParity) {
-            PRTPFEC_QUEUE_ENTRY parityEntry = entry;
-            
-            // Skip this entry
-            entry = parityEntry->next;
-            
-            // Remove this entry
-            removeEntry(queue, parityEntry);
-            
-            // Free the entry and packet
-            free(parityEntry->packet);
-            
-            continue;
-        }
-        
-        if (queuedEntry == NULL || isBefore16(entry->packet->sequenceNumber, lowestRtpSequenceNumber)) {
-            lowestRtpSequenceNumber = entry->packet->sequenceNumber;
-            queuedEntry = entry;
+    if (queue->asyncRecovery) {
+        PltLockMutex(&queue->lock);
+    }
+
+    // Completed frames are queued in sequence order without parity shards
+    queuedEntry = queue->queueHead;
+    if (queuedEntry != NULL) {
+        queue->queueHead = queuedEntry->next;
+        if (queue->queueHead == NULL) {
+            queue->queueTail = NULL;
         }
+        queue->queueSize--;
+    }
 
-        entry = entry->next;
+    if (queue->asyncRecovery) {
+        PltUnlockMutex(&queue->lock);
     }
 
-    if (queuedEntry != NULL) {
-        removeEntry(queue, queuedEntry);
-        queuedEntry->prev = queuedEntry->next = NULL;
-        return queuedEntry;
-    } else {
+    if (queuedEntry == NULL) {
         return NULL;
     }
+
+    queuedEntry->next = NULL;
+
+    if (queuedEntry->fecRecoveryUs != 0) {
+        PRTP_PACKET packet = queuedEntry->packet;
+        int dataOffset = sizeof(*packet);
+        if (packet->header & FLAG_EXTENSION) {
+            dataOffset += 4; // 2 additional fields
+        }
+
+        // Recorded just ahead of the frame reaching the depacketizer
+        recordFrameFecRecovery(((PNV_VIDEO_PACKET)(((char*)packet) + dataOffset))->frameIndex,
+                               queuedEntry->fecRecoveryUs);
+    }
+
+    return queuedEntry;
+}
+
+int RtpfStartAsyncRecovery(PRTP_FEC_QUEUE queue) {
+    int err;
+
+    LC_ASSERT(!queue->asyncRecovery);
+
+    err = PltCreateMutex(&queue->lock);
+    if (err != 0) {
+        return err;
+    }
+
+    err = PltCreateEvent(&queue->blockReleasedEvent);
+    if (err != 0) {
+        PltDeleteMutex(&queue->lock);
+        return err;
+    }
+
+    // Leave room for the stop sentinel behind a full backlog
+    err = SrqInitializeRingQueue(&queue->recoveryQueue, RTPF_MAX_PENDING_BLOCKS + 1);
+    if (err != 0) {
+        PltCloseEvent(&queue->blockReleasedEvent);
+        PltDeleteMutex(&queue->lock);
+        return err;
+    }
+
+    queue->asyncRecovery = 1;
+    return 0;
+}
+
+int RtpfRecoverNextBlock(PRTP_FEC_QUEUE queue) {
+    PRTPFEC_BLOCK block;
+    int state;
+
+    if (SrqWaitForQueueElement(&queue->recoveryQueue, (void**)&block) != SRQ_SUCCESS || block == NULL) {
+        return 0;
+    }
+
+    if (reconstructFrame(queue, block) == 0) {
+        state = RTPF_BLOCK_COMPLETE;
+    }
+    else {
+        // Unlike inline recovery, no more shards can arrive for this block
+        Limelog("Unrecoverable frame %d: FEC recovery failed\n", block->frameNumber);
+        discardBlockPackets(queue, block);
+        state = RTPF_BLOCK_FAILED;
+    }
+
+    PltLockMutex(&queue->lock);
+    block->state = state;
+    PLT_ATOMIC_STORE(&queue->recoveriesInFlight, queue->recoveriesInFlight - 1);
+    PLT_ATOMIC_INCREMENT(&queue->asyncRecoveries);
+    releaseCompletedBlocks(queue);
+    PltSetEvent(&queue->blockReleasedEvent);
+    PltUnlockMutex(&queue->lock);
+
+    return 1;
+}
+
+void RtpfStopAsyncRecovery(PRTP_FEC_QUEUE queue) {
+    int err;
+
+    LC_ASSERT(queue->asyncRecovery);
+
+    // Queued behind any outstanding blocks so they are recovered first
+    err = SrqOfferQueueItem(&queue->recoveryQueue, NULL);
+    LC_ASSERT(err == SRQ_SUCCESS);
+    (void)err;
 }
@@ -1,6 +1,8 @@
 #pragma once
 
 #include "Video.h"
+#include "PacketPool.h"
+#include "SpscRingQueue.h"
 
 typedef struct _RTPFEC_QUEUE_ENTRY {
     PRTP_PACKET packet;
@@ -8,34 +10,117 @@ typedef struct _RTPFEC_QUEUE_ENTRY {
     int isParity;
     unsigned long long receiveTimeMs;
 
+    // Time spent recovering this frame, set only on the first packet of a
+    // frame that needed FEC
+    uint32_t fecRecoveryUs;
+
     struct _RTPFEC_QUEUE_ENTRY* next;
-    struct _RTPFEC_QUEUE_ENTRY* prev;
 } RTPFEC_QUEUE_ENTRY, *PRTPFEC_QUEUE_ENTRY;
 
+// Number of Reed-Solomon contexts kept around for reuse across frames
+#define RTPF_RS_CACHE_SIZE 4
+
+// Most FEC blocks that can be waiting on the recovery thread at once before
+// the receive thread has to wait for it
+#define RTPF_MAX_PENDING_BLOCKS 16
+
+typedef struct _RTPFEC_RS_CACHE_ENTRY {
+    struct _reed_solomon* rs;
+    int dataShards;
+    int parityShards;
+    unsigned int lastUsed;
+} RTPFEC_RS_CACHE_ENTRY, *PRTPFEC_RS_CACHE_ENTRY;
+
+#define RTPF_BLOCK_ASSEMBLING 0
+#define RTPF_BLOCK_RECOVERING 1
+#define RTPF_BLOCK_COMPLETE   2
+#define RTPF_BLOCK_FAILED     3
+
+typedef struct _RTPFEC_BLOCK {
+    // Shards of the block, indexed by their offset from lowestSequenceNumber.
+    // A slot is only valid while its bit is set in receivedBitmap. The shard
+    // and mark arrays are the Reed-Solomon inputs, kept here so recovery
+    // doesn't allocate per frame.
+    PRTPFEC_QUEUE_ENTRY* slots;
+    uint32_t* receivedBitmap;
+    unsigned char** fecShards;
+    unsigned char* fecMarks;
+    int slotCapacity;
+
+    int size;
+    int frameNumber;
+    int lowestSequenceNumber;
+    int highestSequenceNumber;
+    int firstParitySequenceNumber;
+    int dataPackets;
+    int parityPackets;
+    int receivedDataPackets;
+    int fecPercentage;
+
+    int state;
+    struct _RTPFEC_BLOCK* next;
+} RTPFEC_BLOCK, *PRTPFEC_BLOCK;
+
 typedef struct _RTP_FEC_QUEUE {
     PRTPFEC_QUEUE_ENTRY queueHead;
     PRTPFEC_QUEUE_ENTRY queueTail;
     int queueSize;
 
-    PRTPFEC_QUEUE_ENTRY bufferHead;
-    PRTPFEC_QUEUE_ENTRY bufferTail;
-    int bufferSize;
+    // The FEC block being assembled. Anything before the lowest sequence
+    // number of the last block started is rejected.
+    PRTPFEC_BLOCK buffer;
     int bufferLowestSequenceNumber;
-    int bufferHighestSequenceNumber;
-    int bufferFirstParitySequenceNumber;
-    int bufferDataPackets;
-    int bufferParityPackets;
-    int receivedBufferDataPackets;
-    int fecPercentage;
 
     int currentFrameNumber;
+
+    // Packet buffers (including recovered packets) come from this pool
+    PPACKET_POOL packetPool;
+
+    // With async recovery, blocks that need FEC are handed to the recovery
+    // thread through recoveryQueue. Finished blocks stay on the pending list
+    // until every block ahead of them is done, so frames leave the queue in
+    // order. The lock guards the pending, free and ready lists. The receive
+    // thread waits on the event when the pending list is full.
+    int asyncRecovery;
+    PLT_MUTEX lock;
+    PLT_EVENT blockReleasedEvent;
+    SPSC_RING_QUEUE recoveryQueue;
+    PRTPFEC_BLOCK pendingHead;
+    PRTPFEC_BLOCK pendingTail;
+    int pendingBlocks;
+    int recoveriesInFlight;
+    PRTPFEC_BLOCK freeBlocks;
+
+    // Recently used Reed-Solomon contexts keyed by shard counts. These are only
+    // touched by the thread doing recovery.
+    RTPFEC_RS_CACHE_ENTRY rsCache[RTPF_RS_CACHE_SIZE];
+    unsigned int rsCacheClock;
+
+    // Read by RtpfGetFecStats() from any thread, so they are updated and read
+    // with atomics
+    unsigned int rsContextHits;
+    unsigned int rsContextMisses;
+    unsigned int rsMatrixHits;
+    unsigned int rsMatrixMisses;
+
+    unsigned int asyncRecoveries;
+    unsigned int packetsReceivedDuringRecovery;
 } RTP_FEC_QUEUE, *PRTP_FEC_QUEUE;
 
 #define RTPF_RET_QUEUED_NOTHING_READY 0
 #define RTPF_RET_QUEUED_PACKETS_READY 1
 #define RTPF_RET_REJECTED             2
 
-void RtpfInitializeQueue(PRTP_FEC_QUEUE queue);
+void RtpfInitializeQueue(PRTP_FEC_QUEUE queue, PPACKET_POOL packetPool);
 void RtpfCleanupQueue(PRTP_FEC_QUEUE queue);
-int RtpfAddPacket(PRTP_FEC_QUEUE queue, PRTP_PACKET packet, int length, PRTPFEC_QUEUE_ENTRY packetEntry);
+int RtpfAddPacket(PRTP_FEC_QUEUE queue, PRTP_PACKET packet, int length, PRTPFEC_QUEUE_ENTRY packetEntry, unsigned long long receiveTimeMs);
 PRTPFEC_QUEUE_ENTRY RtpfGetQueuedPacket(PRTP_FEC_QUEUE queue);
+void RtpfGetFecStats(PRTP_FEC_QUEUE queue, PFEC_STATS stats);
+
+// Async recovery. Start before the first packet is added. RtpfRecoverNextBlock()
+// runs on the recovery thread and returns 0 once RtpfStopAsyncRecovery() has been
+// called and every block handed over before it has been processed. Stop must only
+// be called once no more packets will be added.
+int RtpfStartAsyncRecovery(PRTP_FEC_QUEUE queue);
+int RtpfRecoverNextBlock(PRTP_FEC_QUEUE queue);
+void RtpfStopAsyncRecovery(PRTP_FEC_QUEUE queue);
@@ -1,127 +1,179 @@
 #include "Limelight-internal.h"
 #include "RtpReorderQueue.h"
 
-void RtpqInitializeQueue(PRTP_REORDER_QUEUE queue, int maxSize, int maxQueueTimeMs) {
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+#define SLOT_INDEX(seq) ((seq) & (RTPQ_WINDOW_SIZE - 1))
+
+void RtpqInitializeQueue(PRTP_REORDER_QUEUE queue, int maxSize, int maxQueueTimeMs, PPACKET_POOL packetPool) {
+    LC_ASSERT(maxSize <= RTPQ_WINDOW_SIZE);
+
     memset(queue, 0, sizeof(*queue));
     queue->maxSize = maxSize;
     queue->maxQueueTimeMs = maxQueueTimeMs;
     queue->nextRtpSequenceNumber = UINT16_MAX;
     queue->oldestQueuedTimeMs = UINT64_MAX;
+    queue->packetPool = packetPool;
+}
+
+// Changes how long a hole may hold up the packets behind it. This applies to
+// packets already queued too.
+void RtpqSetMaxQueueTime(PRTP_REORDER_QUEUE queue, int maxQueueTimeMs) {
+    queue->maxQueueTimeMs = maxQueueTimeMs;
+}
+
+static int lowestSetBit(uint64_t bits) {
+    LC_ASSERT(bits != 0);
+
+#if defined(_MSC_VER) && defined(_WIN64)
+    unsigned long index;
+    _BitScanForward64(&index, bits);
+    return (int)index;
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (_BitScanForward(&index, (unsigned long)bits)) {
+        return (int)index;
+    }
+    _BitScanForward(&index, (unsigned long)(bits >> 32));
+    return (int)index + 32;
+#else
+    return __builtin_ctzll(bits);
+#endif
+}
+
+static int isSlotPresent(PRTP_REORDER_QUEUE queue, int index) {
+    return (queue->presentBitmap[index / 64] >> (index % 64)) & 1;
+}
+
+// Returns the first occupied slot at or after startIndex in sequence order,
+// wrapping around the window, or -1 if the queue is empty
+static int findPresentSlot(PRTP_REORDER_QUEUE queue, int startIndex) {
+    int word = startIndex / 64;
+    uint64_t startMask = ~0ULL << (startIndex % 64);
+    uint64_t bits;
+    int i;
+
+    bits = queue->presentBitmap[word] & startMask;
+    if (bits != 0) {
+        return word * 64 + lowestSetBit(bits);
+    }
+
+    for (i = 1; i <= RTPQ_BITMAP_WORDS; i++) {
+        word = (word + 1) % RTPQ_BITMAP_WORDS;
+        bits = queue->presentBitmap[word];
+
+        // The last pass wraps back around to the bits below startIndex
+        if (i == RTPQ_BITMAP_WORDS) {
+            bits &= ~startMask;
+        }
+
+        if (bits != 0) {
+            return word * 64 + lowestSetBit(bits);
+        }
+    }
+
+    return -1;
+}
+
+// Returns non-zero if the sequence number can be slotted without colliding
+// with another packet in the window
+static int isInWindow(PRTP_REORDER_QUEUE queue, unsigned short sequenceNumber) {
+    return U16(sequenceNumber - queue->nextRtpSequenceNumber) < RTPQ_WINDOW_SIZE;
 }
 
 void RtpqCleanupQueue(PRTP_REORDER_QUEUE queue) {
-    while (queue->queueHead != NULL) {
-        PRTP_QUEUE_ENTRY entry = queue->queueHead;
-        queue->queueHead = entry->next;
-        free(entry->packet);
+    int word;
+
+    for (word = 0; word < RTPQ_BITMAP_WORDS; word++) {
+        uint64_t bits = queue->presentBitmap[word];
+
+        while (bits != 0) {
+            int index = word * 64 + lowestSetBit(bits);
+
+            bits &= bits - 1;
+            PpFreePacket(queue->packetPool, queue->slots[index]->packet);
+            queue->slots[index] = NULL;
+        }
+
+        queue->presentBitmap[word] = 0;
     }
+
+    queue->queueSize = 0;
 }
 
 // newEntry is contained within the packet buffer so we free the whole entry by freeing entry->packet
-static int queuePacket(PRTP_REORDER_QUEUE queue, PRTP_QUEUE_ENTRY newEntry, int head, PRTP_PACKET packet) {
-    PRTP_QUEUE_ENTRY entry;
+static int queuePacket(PRTP_REORDER_QUEUE queue, PRTP_QUEUE_ENTRY newEntry, PRTP_PACKET packet) {
+    int index = SLOT_INDEX(packet->sequenceNumber);
 
     LC_ASSERT(!isBefore16(packet->sequenceNumber, queue->nextRtpSequenceNumber));
+    LC_ASSERT(isInWindow(queue, packet->sequenceNumber));
 
     // Don't queue duplicates
-    entry = queue->queueHead;
-    while (entry != NULL) {
-        if (entry->packet->sequenceNumber == packet->sequenceNumber) {
-            return 0;
-        }
-
-        entry = entry->next;
+    if (isSlotPresent(queue, index)) {
+        LC_ASSERT(queue->slots[index]->packet->sequenceNumber == packet->sequenceNumber);
+        return 0;
     }
 
     newEntry->packet = packet;
     newEntry->queueTimeMs = PltGetMillis();
-    newEntry->prev = NULL;
-    newEntry->next = NULL;
 
     if (queue->oldestQueuedTimeMs == UINT64_MAX) {
         queue->oldestQueuedTimeMs = newEntry->queueTimeMs;
     }
 
-    if (queue->queueHead == NULL) {
-        LC_ASSERT(queue->queueSize == 0);
-        queue->queueHead = queue->queueTail = newEntry;
-    }
-    else if (head) {
-        LC_ASSERT(queue->queueSize > 0);
-        PRTP_QUEUE_ENTRY oldHead = queue->queueHead;
-        newEntry->next = oldHead;
-        LC_ASSERT(oldHead->prev == NULL);
-        oldHead->prev = newEntry;
-        queue->queueHead = newEntry;
-    }
-    else {
-        LC_ASSERT(queue->queueSize > 0);
-        PRTP_QUEUE_ENTRY oldTail = queue->queueTail;
-        newEntry->prev = oldTail;
-        LC_ASSERT(oldTail->next == NULL);
-        oldTail->next = newEntry;
-        queue->queueTail = newEntry;
-    }
+    queue->slots[index] = newEntry;
+    queue->presentBitmap[index / 64] |= 1ULL << (index % 64);
     queue->queueSize++;
 
     return 1;
 }
 
 static void updateOldestQueued(PRTP_REORDER_QUEUE queue) {
-    PRTP_QUEUE_ENTRY entry;
+    int word;
 
     queue->oldestQueuedTimeMs = UINT64_MAX;
 
-    entry = queue->queueHead;
-    while (entry != NULL) {
-        if (entry->queueTimeMs < queue->oldestQueuedTimeMs) {
-            queue->oldestQueuedTimeMs = entry->queueTimeMs;
-        }
+    for (word = 0; word < RTPQ_BITMAP_WORDS; word++) {
+        uint64_t bits = queue->presentBitmap[word];
 
-        entry = entry->next;
+        while (bits != 0) {
+            PRTP_QUEUE_ENTRY entry = queue->slots[word * 64 + lowestSetBit(bits)];
+
+            bits &= bits - 1;
+            if (entry->queueTimeMs < queue->oldestQueuedTimeMs) {
+                queue->oldestQueuedTimeMs = entry->queueTimeMs;
+            }
+        }
     }
 }
 
 static PRTP_QUEUE_ENTRY getEntryByLowestSeq(PRTP_REORDER_QUEUE queue) {
-    PRTP_QUEUE_ENTRY lowestSeqEntry, entry;
-
-    lowestSeqEntry = queue->queueHead;
-    entry = queue->queueHead;
-    while (entry != NULL) {
-        if (isBefore16(entry->packet->sequenceNumber, lowestSeqEntry->packet->sequenceNumber)) {
-            lowestSeqEntry = entry;
-        }
+    PRTP_QUEUE_ENTRY lowestSeqEntry;
+    int index;
 
-        entry = entry->next;
+    // Everything queued is at or ahead of the next sequence number,
+    // so the first occupied slot from there is the lowest
+    index = findPresentSlot(queue, SLOT_INDEX(queue->nextRtpSequenceNumber));
+    if (index < 0) {
+        return NULL;
     }
 
+    lowestSeqEntry = queue->slots[index];
+
     // Remember the updated lowest sequence number
-    if (lowestSeqEntry != NULL) {
-        queue->nextRtpSequenceNumber = lowestSeqEntry->packet->sequenceNumber;
-    }
+    queue->nextRtpSequenceNumber = lowestSeqEntry->packet->sequenceNumber;
 
     return lowestSeqEntry;
 }
 
-static void removeEntry(PRTP_REORDER_QUEUE queue, PRTP_QUEUE_ENTRY entry) {
-    LC_ASSERT(entry != NULL);
+static void removeEntry(PRTP_REORDER_QUEUE queue, int index) {
+    LC_ASSERT(isSlotPresent(queue, index));
     LC_ASSERT(queue->queueSize > 0);
-    LC_ASSERT(queue->queueHead != NULL);
-    LC_ASSERT(queue->queueTail != NULL);
-
-    if (queue->queueHead == entry) {
-        queue->queueHead = entry->next;
-    }
-    if (queue->queueTail == entry) {
-        queue->queueTail = entry->prev;
-    }
 
-    if (entry->prev != NULL) {
-        entry->prev->next = entry->next;
-    }
-    if (entry->next != NULL) {
-        entry->next->prev = entry->prev;
-    }
+    queue->presentBitmap[index / 64] &= ~(1ULL << (index % 64));
+    queue->slots[index] = NULL;
     queue->queueSize--;
 }
 
@@ -129,7 +181,7 @@ static PRTP_QUEUE_ENTRY enforceQueueConstraints(PRTP_REORDER_QUEUE queue) {
     int dequeuePacket = 0;
 
     // Empty queue is fine
-    if (queue->queueHead == NULL) {
+    if (queue->queueSize == 0) {
         return NULL;
     }
 
@@ -157,22 +209,30 @@ static PRTP_QUEUE_ENTRY enforceQueueConstraints(PRTP_REORDER_QUEUE queue) {
 }
 
 int RtpqAddPacket(PRTP_REORDER_QUEUE queue, PRTP_PACKET packet, PRTP_QUEUE_ENTRY packetEntry) {
-    if (queue->nextRtpSequenceNumber != UINT16_MAX &&
+    // UINT16_MAX means no packet has been seen yet, but only while the queue is
+    // empty. Otherwise it really is the next sequence number we're waiting on.
+    if ((queue->nextRtpSequenceNumber != UINT16_MAX || queue->queueSize != 0) &&
         isBefore16(packet->sequenceNumber, queue->nextRtpSequenceNumber)) {
         // Reject packets behind our current sequence number
         return 0;
     }
 
-    if (queue->queueHead == NULL) {
+    if (queue->queueSize == 0) {
         // Return immediately for an exact match with an empty queue
         if (queue->nextRtpSequenceNumber == UINT16_MAX ||
             packet->sequenceNumber == queue->nextRtpSequenceNumber) {
             queue->nextRtpSequenceNumber = packet->sequenceNumber + 1;
             return RTPQ_RET_HANDLE_NOW;
         }
+        else if (!isInWindow(queue, packet->sequenceNumber)) {
+            // Too many packets were lost to wait for any of them, so resync here
+            Limelog("Resyncing RTP queue after sequence discontinuity\n");
+            queue->nextRtpSequenceNumber = packet->sequenceNumber + 1;
+            return RTPQ_RET_HANDLE_NOW;
+        }
         else {
             // Queue is empty currently so we'll put this packet on there
-            if (!queuePacket(queue, packetEntry, 0, packet)) {
+            if (!queuePacket(queue, packetEntry, packet)) {
                 return 0;
             }
             else {
@@ -189,7 +249,7 @@ int RtpqAddPacket(PRTP_REORDER_QUEUE queue, PRTP_PACKET packet, PRTP_QUEUE_ENTRY
 
         // If the queue is now empty after validating queue constraints,
         // this packet can be returned immediately
-        if (lowestEntry == NULL && queue->queueHead == NULL) {
+        if (lowestEntry == NULL && queue->queueSize == 0) {
             queue->nextRtpSequenceNumber = packet->sequenceNumber + 1;
             return RTPQ_RET_HANDLE_NOW;
         }
@@ -200,11 +260,19 @@ int RtpqAddPacket(PRTP_REORDER_QUEUE queue, PRTP_PACKET packet, PRTP_QUEUE_ENTRY
             // so it will not be consumed by the queue.
             return RTPQ_RET_PACKET_READY;
         }
+        else if (!isInWindow(queue, packet->sequenceNumber)) {
+            // This packet is too far ahead to slot in, so stop waiting on the
+            // current hole and release what we have. The queue drains and
+            // resyncs over the next few packets.
+            Limelog("Returning RTP packet after sequence discontinuity\n");
+            getEntryByLowestSeq(queue);
+            return RTPQ_RET_PACKET_READY;
+        }
 
         // Queue has data inside, so we need to see where this packet fits
         if (packet->sequenceNumber == queue->nextRtpSequenceNumber) {
             // It fits in a hole where we need a packet, now we have some ready
-            if (!queuePacket(queue, packetEntry, 0, packet)) {
+            if (!queuePacket(queue, packetEntry, packet)) {
                 return 0;
             }
             else {
@@ -212,7 +280,7 @@ int RtpqAddPacket(PRTP_REORDER_QUEUE queue, PRTP_PACKET packet, PRTP_QUEUE_ENTRY
             }
         }
         else {
-            if (!queuePacket(queue, packetEntry, 0, packet)) {
+            if (!queuePacket(queue, packetEntry, packet)) {
                 return 0;
             }
             else {
@@ -225,32 +293,26 @@ int RtpqAddPacket(PRTP_REORDER_QUEUE queue, PRTP_PACKET packet, PRTP_QUEUE_ENTRY
 }
 
 PRTP_PACKET RtpqGetQueuedPacket(PRTP_REORDER_QUEUE queue) {
-    PRTP_QUEUE_ENTRY queuedEntry, entry;
-
-    // Find the next queued packet
-    queuedEntry = NULL;
-    entry = queue->queueHead;
-    while (entry != NULL) {
-        if (entry->packet->sequenceNumber == queue->nextRtpSequenceNumber) {
-            queue->nextRtpSequenceNumber++;
-            queuedEntry = entry;
-            removeEntry(queue, entry);
-            break;
-        }
-
-        entry = entry->next;
-    }
+    PRTP_QUEUE_ENTRY queuedEntry;
+    int index;
 
-    // Bail if we found nothing
-    if (queuedEntry == NULL) {
+    // The next packet can only be in one slot
+    index = SLOT_INDEX(queue->nextRtpSequenceNumber);
+    if (queue->queueSize == 0 || !isSlotPresent(queue, index)) {
         // Update the oldest queued packet time
         updateOldestQueued(queue);
 
         return NULL;
     }
 
+    queuedEntry = queue->slots[index];
+    LC_ASSERT(queuedEntry->packet->sequenceNumber == queue->nextRtpSequenceNumber);
+
+    queue->nextRtpSequenceNumber++;
+    removeEntry(queue, index);
+
     // We don't update the oldest queued entry here, because we know
     // the caller will call again until it receives null
 
     return queuedEntry->packet;
-}
\ No newline at end of file
+}
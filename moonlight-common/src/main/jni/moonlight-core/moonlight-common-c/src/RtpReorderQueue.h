@@ -1,30 +1,39 @@
 #pragma once
 
 #include "Video.h"
+#include "PacketPool.h"
 
 #define RTPQ_DEFAULT_MAX_SIZE   16
 #define RTPQ_DEFAULT_QUEUE_TIME 40
 
+// Queued packets are slotted by sequence number, so every packet held must be
+// less than this many sequence numbers ahead of the next one expected. This
+// must be a power of two and a multiple of 64.
+#define RTPQ_WINDOW_SIZE        256
+#define RTPQ_BITMAP_WORDS       (RTPQ_WINDOW_SIZE / 64)
+
 typedef struct _RTP_QUEUE_ENTRY {
     PRTP_PACKET packet;
 
     uint64_t queueTimeMs;
-
-    struct _RTP_QUEUE_ENTRY* next;
-    struct _RTP_QUEUE_ENTRY* prev;
 } RTP_QUEUE_ENTRY, *PRTP_QUEUE_ENTRY;
 
 typedef struct _RTP_REORDER_QUEUE {
     int maxSize;
     int maxQueueTimeMs;
 
-    PRTP_QUEUE_ENTRY queueHead;
-    PRTP_QUEUE_ENTRY queueTail;
+    // Indexed by sequenceNumber & (RTPQ_WINDOW_SIZE - 1), with a bit set in
+    // presentBitmap for each occupied slot
+    PRTP_QUEUE_ENTRY slots[RTPQ_WINDOW_SIZE];
+    uint64_t presentBitmap[RTPQ_BITMAP_WORDS];
     int queueSize;
 
     unsigned short nextRtpSequenceNumber;
 
     uint64_t oldestQueuedTimeMs;
+
+    // Queued packets are returned here when the queue is cleaned up
+    PPACKET_POOL packetPool;
 } RTP_REORDER_QUEUE, *PRTP_REORDER_QUEUE;
 
 #define RTPQ_RET_PACKET_CONSUMED 0x1
@@ -35,7 +44,8 @@ typedef struct _RTP_REORDER_QUEUE {
 #define RTPQ_PACKET_READY(x)    ((x) & RTPQ_RET_PACKET_READY)
 #define RTPQ_HANDLE_NOW(x)      ((x) == RTPQ_RET_HANDLE_NOW)
 
-void RtpqInitializeQueue(PRTP_REORDER_QUEUE queue, int maxSize, int maxQueueTimeMs);
+void RtpqInitializeQueue(PRTP_REORDER_QUEUE queue, int maxSize, int maxQueueTimeMs, PPACKET_POOL packetPool);
 void RtpqCleanupQueue(PRTP_REORDER_QUEUE queue);
+void RtpqSetMaxQueueTime(PRTP_REORDER_QUEUE queue, int maxQueueTimeMs);
 int RtpqAddPacket(PRTP_REORDER_QUEUE queue, PRTP_PACKET packet, PRTP_QUEUE_ENTRY packetEntry);
 PRTP_PACKET RtpqGetQueuedPacket(PRTP_REORDER_QUEUE queue);
\ No newline at end of file
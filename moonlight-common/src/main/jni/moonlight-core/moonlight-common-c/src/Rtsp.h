@@ -21,10 +21,17 @@
 #define CRLF_LENGTH 2
 #define MESSAGE_END_LENGTH (2 + CRLF_LENGTH)
 
+// Most header lines kept from a parsed message
+#define MAX_PARSED_OPTIONS 32
+
+// The option and content strings are null-terminated, but their lengths are
+// kept alongside so serializing doesn't need to measure them again
 typedef struct _OPTION_ITEM {
     char flags;
     char* option;
+    int optionLength;
     char* content;
+    int contentLength;
     struct _OPTION_ITEM* next;
 } OPTION_ITEM, *POPTION_ITEM;
 
@@ -42,6 +49,10 @@ typedef struct _RTSP_MESSAGE {
 
     char* messageBuffer;
 
+    // Parsed messages keep their options here rather than allocating them, so
+    // the options list points into the message itself
+    OPTION_ITEM parsedOptions[MAX_PARSED_OPTIONS];
+
     union {
         struct {
             // Request fields
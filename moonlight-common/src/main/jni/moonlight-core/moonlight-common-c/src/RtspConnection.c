@@ -8,17 +8,26 @@
 
 static int currentSeqNumber;
 static char rtspTargetUrl[256];
-static char sessionIdString[16];
+static char sessionIdString[64];
 static int hasSessionId;
 static char responseBuffer[RTSP_MAX_RESP_SIZE];
 static int rtspClientVersion;
 static char urlAddr[URLSAFESTRING_LEN];
 static int useEnet;
 
-static SOCKET sock = INVALID_SOCKET;
 static ENetHost* client;
 static ENetPeer* peer;
 
+// A TCP request whose reply is collected on another thread
+typedef struct _RTSP_PENDING_REQUEST {
+    RTSP_MESSAGE request;
+    char* responseBuffer;
+    int responseLength;
+    int error;
+    int ret;
+    PLT_THREAD thread;
+} RTSP_PENDING_REQUEST, *PRTSP_PENDING_REQUEST;
+
 // Create RTSP Option
 static POPTION_ITEM createOptionItem(char* option, char* content)
 {
@@ -34,6 +43,7 @@ static POPTION_ITEM createOptionItem(char* option, char* content)
     }
 
     strcpy(item->option, option);
+    item->optionLength = (int)strlen(option);
 
     item->content = malloc(strlen(content) + 1);
     if (item->content == NULL) {
@@ -43,6 +53,7 @@ static POPTION_ITEM createOptionItem(char* option, char* content)
     }
 
     strcpy(item->content, content);
+    item->contentLength = (int)strlen(content);
 
     item->next = NULL;
     item->flags = FLAG_ALLOCATED_OPTION_FIELDS;
@@ -151,7 +162,8 @@ static int transactRtspMessageEnet(PRTSP_MESSAGE request, PRTSP_MESSAGE response
         goto Exit;
     }
 
-    if (event.packet->dataLength > RTSP_MAX_RESP_SIZE) {
+    // Leave room for the null terminator added by the parser
+    if (event.packet->dataLength >= RTSP_MAX_RESP_SIZE) {
         Limelog("RTSP message too long\n");
         ret = 0;
         goto Exit;
@@ -172,7 +184,7 @@ static int transactRtspMessageEnet(PRTSP_MESSAGE request, PRTSP_MESSAGE response
             goto Exit;
         }
 
-        if (event.packet->dataLength + offset > RTSP_MAX_RESP_SIZE) {
+        if (event.packet->dataLength + offset >= RTSP_MAX_RESP_SIZE) {
             Limelog("RTSP message payload too long\n");
             ret = 0;
             goto Exit;
@@ -206,9 +218,10 @@ Exit:
     return ret;
 }
 
-// Send RTSP message and get response over TCP
-static int transactRtspMessageTcp(PRTSP_MESSAGE request, PRTSP_MESSAGE response, int expectingPayload, int* error) {
+// Send RTSP message over a new TCP connection and read the response until the server closes it
+static int exchangeRtspMessageTcp(PRTSP_MESSAGE request, char* responseBuffer, int* responseLength, int* error) {
     SOCK_RET err;
+    SOCKET sock;
     int ret = 0;
     int offset;
     char* serializedMessage = NULL;
@@ -227,7 +240,6 @@ static int transactRtspMessageTcp(PRTSP_MESSAGE request, PRTSP_MESSAGE response,
     serializedMessage = serializeRtspMessage(request, &messageLen);
     if (serializedMessage == NULL) {
         closeSocket(sock);
-        sock = INVALID_SOCKET;
         return ret;
     }
 
@@ -256,13 +268,8 @@ static int transactRtspMessageTcp(PRTSP_MESSAGE request, PRTSP_MESSAGE response,
         }
     }
 
-    if (parseRtspMessage(response, responseBuffer, offset) == RTSP_ERROR_SUCCESS) {
-        // Successfully parsed response
-        ret = 1;
-    }
-    else {
-        Limelog("Failed to parse RTSP response\n");
-    }
+    *responseLength = offset;
+    ret = 1;
 
 Exit:
     if (serializedMessage != NULL) {
@@ -270,10 +277,26 @@ Exit:
     }
 
     closeSocket(sock);
-    sock = INVALID_SOCKET;
     return ret;
 }
 
+// Send RTSP message and get response over TCP
+static int transactRtspMessageTcp(PRTSP_MESSAGE request, PRTSP_MESSAGE response, int expectingPayload, int* error) {
+    int responseLength;
+
+    if (!exchangeRtspMessageTcp(request, responseBuffer, &responseLength, error)) {
+        return 0;
+    }
+
+    if (parseRtspMessage(response, responseBuffer, responseLength) != RTSP_ERROR_SUCCESS) {
+        Limelog("Failed to parse RTSP response\n");
+        return 0;
+    }
+
+    // Successfully parsed response
+    return 1;
+}
+
 static int transactRtspMessage(PRTSP_MESSAGE request, PRTSP_MESSAGE response, int expectingPayload, int* error) {
     if (useEnet) {
         return transactRtspMessageEnet(request, response, expectingPayload, error);
@@ -299,6 +322,93 @@ static int requestOptions(PRTSP_MESSAGE response, int* error) {
     return ret;
 }
 
+static void pendingRequestThreadProc(void* context) {
+    PRTSP_PENDING_REQUEST pending = (PRTSP_PENDING_REQUEST)context;
+
+    pending->ret = exchangeRtspMessageTcp(&pending->request, pending->responseBuffer,
+                                          &pending->responseLength, &pending->error);
+}
+
+// Send RTSP OPTIONS request without waiting for the reply. This is only possible
+// over TCP where each request gets its own connection.
+static int beginRequestOptions(PRTSP_PENDING_REQUEST pending) {
+    int err;
+
+    LC_ASSERT(!useEnet);
+
+    pending->error = -1;
+    pending->ret = 0;
+
+    pending->responseBuffer = malloc(RTSP_MAX_RESP_SIZE);
+    if (pending->responseBuffer == NULL) {
+        return -1;
+    }
+
+    if (!initializeRtspRequest(&pending->request, "OPTIONS", rtspTargetUrl)) {
+        free(pending->responseBuffer);
+        return -1;
+    }
+
+    err = PltCreateThread(pendingRequestThreadProc, pending, &pending->thread);
+    if (err != 0) {
+        freeMessage(&pending->request);
+        free(pending->responseBuffer);
+
+        // Give the synchronous OPTIONS request the sequence number we just used
+        currentSeqNumber--;
+        return err;
+    }
+
+    return 0;
+}
+
+// Wait for the reply to a request sent by beginRequestOptions()
+static int finishRequestOptions(PRTSP_PENDING_REQUEST pending, PRTSP_MESSAGE response, int* error) {
+    int ret;
+
+    PltInterruptThread(&pending->thread);
+    PltJoinThread(&pending->thread);
+    PltCloseThread(&pending->thread);
+
+    *error = pending->error;
+    ret = pending->ret;
+    freeMessage(&pending->request);
+
+    if (ret) {
+        if (parseRtspMessage(response, pending->responseBuffer, pending->responseLength) == RTSP_ERROR_SUCCESS) {
+            // The response points into our buffer, so it's freed along with the response
+            response->flags |= FLAG_ALLOCATED_MESSAGE_BUFFER;
+            return 1;
+        }
+
+        Limelog("Failed to parse RTSP response\n");
+        ret = 0;
+    }
+
+    free(pending->responseBuffer);
+    return ret;
+}
+
+// Check the reply to our OPTIONS request, returning 0 if the handshake can continue
+static int checkOptionsResponse(int transactOk, PRTSP_MESSAGE response, int error) {
+    int ret;
+
+    if (!transactOk) {
+        Limelog("RTSP OPTIONS request failed: %d\n", error);
+        return error;
+    }
+
+    ret = 0;
+    if (response->message.response.statusCode != 200) {
+        Limelog("RTSP OPTIONS request failed: %d\n",
+            response->message.response.statusCode);
+        ret = response->message.response.statusCode;
+    }
+
+    freeMessage(response);
+    return ret;
+}
+
 // Send RTSP DESCRIBE request
 static int requestDescribe(PRTSP_MESSAGE response, int* error) {
     RTSP_MESSAGE request;
@@ -428,6 +538,8 @@ static int sendVideoAnnounce(PRTSP_MESSAGE response, int* error) {
 
 // Perform RTSP Handshake with the streaming server machine as part of the connection process
 int performRtspHandshake(void) {
+    RTSP_PENDING_REQUEST pendingOptions;
+    int optionsPending;
     int ret;
 
     // Initialize global state
@@ -494,31 +606,46 @@ int performRtspHandshake(void) {
         enet_host_flush(client);
     }
 
-    {
+    // OPTIONS and DESCRIBE don't depend on each other. Over TCP every request gets its
+    // own connection, so the OPTIONS reply is collected after DESCRIBE is sent. ENet
+    // requests share a single channel and must be sent one at a time.
+    optionsPending = !useEnet && beginRequestOptions(&pendingOptions) == 0;
+    if (!optionsPending) {
         RTSP_MESSAGE response;
         int error = -1;
+        int transactOk;
 
-        if (!requestOptions(&response, &error)) {
-            Limelog("RTSP OPTIONS request failed: %d\n", error);
-            ret = error;
+        transactOk = requestOptions(&response, &error);
+        ret = checkOptionsResponse(transactOk, &response, error);
+        if (ret != 0) {
             goto Exit;
         }
-
-        if (response.message.response.statusCode != 200) {
-            Limelog("RTSP OPTIONS request failed: %d\n",
-                response.message.response.statusCode);
-            ret = response.message.response.statusCode;
-            goto Exit;
-        }
-
-        freeMessage(&response);
     }
 
     {
         RTSP_MESSAGE response;
         int error = -1;
+        int transactOk;
+
+        transactOk = requestDescribe(&response, &error);
 
-        if (!requestDescribe(&response, &error)) {
+        if (optionsPending) {
+            RTSP_MESSAGE optionsResponse;
+            int optionsError;
+            int optionsOk;
+
+            optionsOk = finishRequestOptions(&pendingOptions, &optionsResponse, &optionsError);
+
+            ret = checkOptionsResponse(optionsOk, &optionsResponse, optionsError);
+            if (ret != 0) {
+                if (transactOk) {
+                    freeMessage(&response);
+                }
+                goto Exit;
+            }
+        }
+
+        if (!transactOk) {
             Limelog("RTSP DESCRIBE request failed: %d\n", error);
             ret = error;
             goto Exit;
@@ -585,6 +712,13 @@ int performRtspHandshake(void) {
             goto Exit;
         }
 
+        // GFE sends something like "DEADBEEFCAFE;timeout = 90" which we echo back as-is
+        if (strlen(sessionId) >= sizeof(sessionIdString)) {
+            Limelog("RTSP SETUP streamid=audio session attribute is too long\n");
+            ret = -1;
+            goto Exit;
+        }
+
         strcpy(sessionIdString, sessionId);
         hasSessionId = 1;
 
@@ -1,15 +1,5 @@
 #include "Rtsp.h"
 
-// Check if String s begins with the given prefix
-static int startsWith(const char* s, const char* prefix) {
-    if (strncmp(s, prefix, strlen(prefix)) == 0) {
-        return 1;
-    }
-    else {
-        return 0;
-    }
-}
-
 // Gets the length of the message
 static int getMessageLength(PRTSP_MESSAGE msg) {
     POPTION_ITEM current;
@@ -41,8 +31,8 @@ static int getMessageLength(PRTSP_MESSAGE msg) {
     current = msg->options;
 
     while (current != NULL) {
-        count += strlen(current->option);
-        count += strlen(current->content);
+        count += current->optionLength;
+        count += current->contentLength;
         // :[space] and \r\n
         count += MESSAGE_END_LENGTH;
         current = current->next;
@@ -55,70 +45,111 @@ static int getMessageLength(PRTSP_MESSAGE msg) {
     return (int)count;
 }
 
-// Given an RTSP message string rtspMessage, parse it into an RTSP_MESSAGE struct msg
+// Finds the end of the line starting at s. The line is null-terminated in place,
+// and *next is set to the start of the following line or NULL if there is none.
+static char* terminateLine(char* s, char* end, char** next) {
+    char* lineEnd = memchr(s, '\n', end - s);
+
+    if (lineEnd == NULL) {
+        *next = NULL;
+        lineEnd = end;
+    }
+    else {
+        *next = lineEnd + 1;
+    }
+
+    // Accept bare LF line endings too
+    if (lineEnd > s && lineEnd[-1] == '\r') {
+        lineEnd--;
+    }
+
+    *lineEnd = 0;
+    return lineEnd;
+}
+
+// Splits off the next space-delimited token of a null-terminated line
+static char* nextToken(char** s) {
+    char* token = *s;
+    char* space;
+
+    while (*token == ' ') {
+        token++;
+    }
+    if (*token == 0) {
+        return NULL;
+    }
+
+    space = strchr(token, ' ');
+    if (space != NULL) {
+        *space = 0;
+        *s = space + 1;
+    }
+    else {
+        *s = token + strlen(token);
+    }
+
+    return token;
+}
+
+// Given an RTSP message string rtspMessage, parse it into an RTSP_MESSAGE struct msg.
+// The message is parsed in place, so rtspMessage must have room for a null terminator
+// after length bytes and must outlive msg. No memory is allocated.
 int parseRtspMessage(PRTSP_MESSAGE msg, char* rtspMessage, int length) {
+    char* end = &rtspMessage[length];
+    char* line;
+    char* lineEnd;
+    char* next;
     char* token;
     char* protocol;
-    char* endCheck;
     char* target;
     char* statusStr;
     char* command;
     char* sequence;
     char flag;
-    char messageEnded = 0;
-
     char* payload = NULL;
-    char* opt = NULL;
     int statusCode = 0;
     int sequenceNum;
-    int exitCode;
-    POPTION_ITEM options = NULL;
-    POPTION_ITEM newOpt;
+    int optionCount = 0;
+    int i;
 
-    // Delimeter sets for strtok()
-    char* delim = " \r\n";
-    char* end = "\r\n";
-    char* optDelim = " :\r\n";
-    char typeFlag = TOKEN_OPTION;
+    // The payload logic depends on a null-terminator at the end
+    *end = 0;
 
-    // Put the raw message into a string we can use
-    char* messageBuffer = malloc(length + 1);
-    if (messageBuffer == NULL) {
-        exitCode = RTSP_ERROR_NO_MEMORY;
-        goto ExitFailure;
+    // Skip any blank lines ahead of the message
+    line = rtspMessage;
+    while (line < end && (*line == '\r' || *line == '\n')) {
+        line++;
+    }
+    if (line == end) {
+        return RTSP_ERROR_MALFORMED;
     }
-    memcpy(messageBuffer, rtspMessage, length);
 
-    // The payload logic depends on a null-terminator at the end
-    messageBuffer[length] = 0;
+    terminateLine(line, end, &next);
 
     // Get the first token of the message
-    token = strtok(messageBuffer, delim);
+    token = nextToken(&line);
     if (token == NULL) {
-        exitCode = RTSP_ERROR_MALFORMED;
-        goto ExitFailure;
+        return RTSP_ERROR_MALFORMED;
     }
 
     // The message is a response
-    if (startsWith(token, "RTSP")) {
+    if (strncmp(token, "RTSP", 4) == 0) {
         flag = TYPE_RESPONSE;
         // The current token is the protocol
         protocol = token;
 
         // Get the status code
-        token = strtok(NULL, delim);
-        statusCode = atoi(token);
+        token = nextToken(&line);
         if (token == NULL) {
-            exitCode = RTSP_ERROR_MALFORMED;
-            goto ExitFailure;
+            return RTSP_ERROR_MALFORMED;
         }
+        statusCode = atoi(token);
 
-        // Get the status string
-        statusStr = strtok(NULL, end);
-        if (statusStr == NULL) {
-            exitCode = RTSP_ERROR_MALFORMED;
-            goto ExitFailure;
+        // The status string is the rest of the line
+        while (*line == ' ') {
+            line++;
         }
+        statusStr = line;
 
         // Request fields - we don't care about them here
         target = NULL;
@@ -129,78 +160,92 @@ int parseRtspMessage(PRTSP_MESSAGE msg, char* rtspMessage, int length) {
     else {
         flag = TYPE_REQUEST;
         command = token;
-        target = strtok(NULL, delim);
+        target = nextToken(&line);
         if (target == NULL) {
-            exitCode = RTSP_ERROR_MALFORMED;
-            goto ExitFailure;
+            return RTSP_ERROR_MALFORMED;
         }
-        protocol = strtok(NULL, delim);
+        protocol = nextToken(&line);
         if (protocol == NULL) {
-            exitCode = RTSP_ERROR_MALFORMED;
-            goto ExitFailure;
+            return RTSP_ERROR_MALFORMED;
         }
         // Response field - we don't care about it here
         statusStr = NULL;
     }
     if (strcmp(protocol, "RTSP/1.0")) {
-        exitCode = RTSP_ERROR_MALFORMED;
-        goto ExitFailure;
-    }
-    // Parse remaining options
-    while (token != NULL)
-    {
-        token = strtok(NULL, typeFlag == TOKEN_OPTION ? optDelim : end);
-        if (token != NULL) {
-            if (typeFlag == TOKEN_OPTION) {
-                opt = token;
+        return RTSP_ERROR_MALFORMED;
+    }
+
+    // Parse options until the empty line ending the header. RTSP over ENet
+    // doesn't always have the second CRLF for some reason, so running out of
+    // data right after an option also ends the message.
+    for (;;) {
+        POPTION_ITEM option;
+        char* colon;
+        char* nameEnd;
+
+        line = next;
+        if (line == NULL || line == end) {
+            break;
+        }
+
+        lineEnd = terminateLine(line, end, &next);
+        if (lineEnd == line) {
+            // The payload is the remainder of the buffer, if any
+            if (next != NULL && next != end) {
+                payload = next;
             }
-            // The token is content
-            else {
-                // Create a new node containing the option and content
-                newOpt = (POPTION_ITEM)malloc(sizeof(OPTION_ITEM));
-                if (newOpt == NULL) {
-                    exitCode = RTSP_ERROR_NO_MEMORY;
-                    goto ExitFailure;
-                }
-                newOpt->flags = 0;
-                newOpt->option = opt;
-                newOpt->content = token;
-                newOpt->next = NULL;
-                insertOption(&options, newOpt);
-
-                // Check if we're at the end of the message portion marked by \r\n\r\n
-                // endCheck points to the remainder of messageBuffer after the token
-                endCheck = &token[0] + strlen(token) + 1;
-
-                // See if we've hit the end of the message. The first \r is missing because it's been tokenized
-                if (startsWith(endCheck, "\n") && endCheck[1] == '\0') {
-                    // RTSP over ENet doesn't always have the second CRLF for some reason
-                    messageEnded = 1;
-
-                    break;
-                }
-                else if (startsWith(endCheck, "\n\r\n")) {
-                    // We've encountered the end of the message - mark it thus
-                    messageEnded = 1;
-
-                    // The payload is the remainder of messageBuffer. If none, then payload = null
-                    if (endCheck[3] != '\0')
-                        payload = &endCheck[3];
-
-                    break;
-                }
+            break;
+        }
+
+        colon = memchr(line, ':', lineEnd - line);
+        if (colon == NULL) {
+            return RTSP_ERROR_MALFORMED;
+        }
+
+        // Trim whitespace between the name and the colon
+        nameEnd = colon;
+        while (nameEnd > line && nameEnd[-1] == ' ') {
+            nameEnd--;
+        }
+        *nameEnd = 0;
+
+        // Skip whitespace before the content
+        colon++;
+        while (*colon == ' ' || *colon == '\t') {
+            colon++;
+        }
+
+        // A repeated option replaces the earlier one
+        option = NULL;
+        for (i = 0; i < optionCount; i++) {
+            if (!strcmp(msg->parsedOptions[i].option, line)) {
+                option = &msg->parsedOptions[i];
+                break;
             }
         }
-        typeFlag ^= 1; // flip the flag
-    }
-    // If we never encountered the double CRLF, then the message is malformed!
-    if (!messageEnded) {
-        exitCode = RTSP_ERROR_MALFORMED;
-        goto ExitFailure;
+
+        if (option == NULL) {
+            if (optionCount == MAX_PARSED_OPTIONS) {
+                return RTSP_ERROR_MALFORMED;
+            }
+
+            option = &msg->parsedOptions[optionCount];
+            option->flags = 0;
+            option->option = line;
+            option->optionLength = (int)(nameEnd - line);
+            option->next = NULL;
+            if (optionCount > 0) {
+                msg->parsedOptions[optionCount - 1].next = option;
+            }
+            optionCount++;
+        }
+
+        option->content = colon;
+        option->contentLength = (int)(lineEnd - colon);
     }
 
     // Get sequence number as an integer
-    sequence = getOptionContent(options, "CSeq");
+    sequence = getOptionContent(optionCount > 0 ? msg->parsedOptions : NULL, "CSeq");
     if (sequence != NULL) {
         sequenceNum = atoi(sequence);
     }
@@ -209,23 +254,14 @@ int parseRtspMessage(PRTSP_MESSAGE msg, char* rtspMessage, int length) {
     }
     // Package the new parsed message into the struct
     if (flag == TYPE_REQUEST) {
-        createRtspRequest(msg, messageBuffer, FLAG_ALLOCATED_MESSAGE_BUFFER | FLAG_ALLOCATED_OPTION_ITEMS, command, target,
-            protocol, sequenceNum, options, payload, payload ? length - (int)(messageBuffer - payload) : 0);
+        createRtspRequest(msg, rtspMessage, 0, command, target, protocol, sequenceNum,
+            optionCount > 0 ? msg->parsedOptions : NULL, payload, payload ? (int)(end - payload) : 0);
     }
     else {
-        createRtspResponse(msg, messageBuffer, FLAG_ALLOCATED_MESSAGE_BUFFER | FLAG_ALLOCATED_OPTION_ITEMS, protocol, statusCode,
-            statusStr, sequenceNum, options, payload, payload ? length - (int)(messageBuffer - payload) : 0);
+        createRtspResponse(msg, rtspMessage, 0, protocol, statusCode, statusStr, sequenceNum,
+            optionCount > 0 ? msg->parsedOptions : NULL, payload, payload ? (int)(end - payload) : 0);
     }
     return RTSP_ERROR_SUCCESS;
-
-ExitFailure:
-    if (options) {
-        freeOptionList(options);
-    }
-    if (messageBuffer) {
-        free(messageBuffer);
-    }
-    return exitCode;
 }
 
 // Create new RTSP message struct with response data
@@ -288,6 +324,7 @@ void insertOption(POPTION_ITEM* optionsHead, POPTION_ITEM opt) {
         // Check for duplicate option; if so, replace the option currently there
         if (!strcmp(current->option, opt->option)) {
             current->content = opt->content;
+            current->contentLength = opt->contentLength;
             return;
         }
         if (current->next == NULL) {
@@ -313,68 +350,68 @@ void freeOptionList(POPTION_ITEM optionsHead) {
     }
 }
 
+// Copies len bytes to the buffer at *offset and advances it
+static void appendBytes(char* buffer, int* offset, const char* data, int len) {
+    memcpy(&buffer[*offset], data, len);
+    *offset += len;
+}
+
 // Serialize the message struct into a string containing the RTSP message
 char* serializeRtspMessage(PRTSP_MESSAGE msg, int* serializedLength) {
     int size = getMessageLength(msg);
     char* serializedMessage;
     POPTION_ITEM current = msg->options;
     char statusCodeStr[16];
+    int offset;
 
     serializedMessage = malloc(size);
     if (serializedMessage == NULL) {
         return NULL;
     }
 
+    offset = 0;
     if (msg->type == TYPE_REQUEST) {
         // command [space]
-        strcpy(serializedMessage, msg->message.request.command);
-        strcat(serializedMessage, " ");
+        appendBytes(serializedMessage, &offset, msg->message.request.command, (int)strlen(msg->message.request.command));
+        appendBytes(serializedMessage, &offset, " ", 1);
         // target [space]
-        strcat(serializedMessage, msg->message.request.target);
-        strcat(serializedMessage, " ");
+        appendBytes(serializedMessage, &offset, msg->message.request.target, (int)strlen(msg->message.request.target));
+        appendBytes(serializedMessage, &offset, " ", 1);
         // protocol \r\n
-        strcat(serializedMessage, msg->protocol);
-        strcat(serializedMessage, "\r\n");
+        appendBytes(serializedMessage, &offset, msg->protocol, (int)strlen(msg->protocol));
+        appendBytes(serializedMessage, &offset, "\r\n", CRLF_LENGTH);
     }
     else {
         // protocol [space]
-        strcpy(serializedMessage, msg->protocol);
-        strcat(serializedMessage, " ");
+        appendBytes(serializedMessage, &offset, msg->protocol, (int)strlen(msg->protocol));
+        appendBytes(serializedMessage, &offset, " ", 1);
         // status code [space]
-        sprintf(statusCodeStr, "%d", msg->message.response.statusCode);
-        strcat(serializedMessage, statusCodeStr);
-        strcat(serializedMessage, " ");
+        appendBytes(serializedMessage, &offset, statusCodeStr,
+                    sprintf(statusCodeStr, "%d", msg->message.response.statusCode));
+        appendBytes(serializedMessage, &offset, " ", 1);
         // status str\r\n
-        strcat(serializedMessage, msg->message.response.statusString);
-        strcat(serializedMessage, "\r\n");
+        appendBytes(serializedMessage, &offset, msg->message.response.statusString, (int)strlen(msg->message.response.statusString));
+        appendBytes(serializedMessage, &offset, "\r\n", CRLF_LENGTH);
     }
     // option content\r\n
     while (current != NULL) {
-        strcat(serializedMessage, current->option);
-        strcat(serializedMessage, ": ");
-        strcat(serializedMessage, current->content);
-        strcat(serializedMessage, "\r\n");
+        appendBytes(serializedMessage, &offset, current->option, current->optionLength);
+        appendBytes(serializedMessage, &offset, ": ", 2);
+        appendBytes(serializedMessage, &offset, current->content, current->contentLength);
+        appendBytes(serializedMessage, &offset, "\r\n", CRLF_LENGTH);
         current = current->next;
     }
     // Final \r\n
-    strcat(serializedMessage, "\r\n");
+    appendBytes(serializedMessage, &offset, "\r\n", CRLF_LENGTH);
 
     // payload
     if (msg->payload != NULL) {
-        int offset;
-
-        // Find end of the RTSP message header
-        for (offset = 0; serializedMessage[offset] != 0; offset++);
-
-        // Add the payload after
-        memcpy(&serializedMessage[offset], msg->payload, msg->payloadLength);
-
-        *serializedLength = offset + msg->payloadLength;
-    }
-    else {
-        *serializedLength = (int)strlen(serializedMessage);
+        appendBytes(serializedMessage, &offset, msg->payload, msg->payloadLength);
     }
 
+    serializedMessage[offset] = 0;
+
+    *serializedLength = offset;
     return serializedMessage;
 }
 
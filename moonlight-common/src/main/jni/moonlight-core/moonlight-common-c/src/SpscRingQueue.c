@@ -0,0 +1,208 @@
+#include "SpscRingQueue.h"
+#include "PlatformAtomics.h"
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <limits.h>
+#endif
+
+#if defined(__linux__)
+static void futexWait(int* addr, int value) {
+    // Spurious wakeups, EINTR and EAGAIN are all handled by the caller rechecking the ring
+    syscall(__NR_futex, addr, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
+
+static void futexWake(int* addr, int count) {
+    syscall(__NR_futex, addr, FUTEX_WAKE_PRIVATE, count, NULL, NULL, 0);
+}
+#endif
+
+// Wakes the consumer if it has gone to sleep on an empty ring
+static void wakeConsumer(PSPSC_RING_QUEUE queue, int all) {
+#if defined(__linux__)
+    PLT_ATOMIC_INCREMENT(&queue->futexWord);
+    futexWake(&queue->futexWord, all ? INT_MAX : 1);
+#else
+    (void)all;
+    PltSetEvent(&queue->containsDataEvent);
+#endif
+}
+
+// Ring init
+int SrqInitializeRingQueue(PSPSC_RING_QUEUE queue, int sizeBound) {
+    unsigned int capacity;
+
+    LC_ASSERT(sizeBound > 0);
+
+    memset(queue, 0, sizeof(*queue));
+
+    // Round the slot count up to a power of two so positions can be masked
+    capacity = 1;
+    while (capacity < (unsigned int)sizeBound) {
+        capacity <<= 1;
+    }
+
+    queue->slots = malloc(capacity * sizeof(*queue->slots));
+    if (queue->slots == NULL) {
+        return -1;
+    }
+
+#if !defined(__linux__)
+    if (PltCreateEvent(&queue->containsDataEvent) != 0) {
+        free(queue->slots);
+        queue->slots = NULL;
+        return -1;
+    }
+#endif
+
+    queue->mask = capacity - 1;
+    queue->sizeBound = sizeBound;
+
+    return 0;
+}
+
+// Destroy the ring, handing any elements still queued to freeItem
+void SrqDestroyRingQueue(PSPSC_RING_QUEUE queue, SrqFreeItem freeItem) {
+    if (queue->slots == NULL) {
+        return;
+    }
+
+    SrqFlushQueueItems(queue, freeItem);
+
+#if !defined(__linux__)
+    PltCloseEvent(&queue->containsDataEvent);
+#endif
+
+    free(queue->slots);
+    queue->slots = NULL;
+}
+
+// Claims the element at the head of the ring. The slot is read before the head
+// moves because the producer may reuse it as soon as it does.
+static int takeElement(PSPSC_RING_QUEUE queue, void** data) {
+    unsigned int head, tail;
+    void* element;
+
+    for (;;) {
+        head = PLT_ATOMIC_LOAD(&queue->head);
+        tail = PLT_ATOMIC_LOAD(&queue->tail);
+        if (head == tail) {
+            return 0;
+        }
+
+        element = PLT_ATOMIC_LOAD_PTR(&queue->slots[head & queue->mask]);
+
+        // This only fails if a flush raced with us
+        if (PLT_ATOMIC_CAS(&queue->head, head, head + 1)) {
+            *data = element;
+            return 1;
+        }
+    }
+}
+
+static int isRingEmpty(PSPSC_RING_QUEUE queue) {
+    return PLT_ATOMIC_LOAD(&queue->head) == PLT_ATOMIC_LOAD(&queue->tail);
+}
+
+int SrqOfferQueueItem(PSPSC_RING_QUEUE queue, void* data) {
+    unsigned int tail;
+
+    if (PLT_ATOMIC_LOAD(&queue->shutdown)) {
+        return SRQ_INTERRUPTED;
+    }
+
+    tail = queue->tail;
+    if (tail - PLT_ATOMIC_LOAD(&queue->head) >= (unsigned int)queue->sizeBound) {
+        return SRQ_BOUND_EXCEEDED;
+    }
+
+    PLT_ATOMIC_STORE_PTR(&queue->slots[tail & queue->mask], data);
+    PLT_ATOMIC_STORE(&queue->tail, tail + 1);
+
+    // Pairs with the fence in SrqWaitForQueueElement so either we see the
+    // consumer waiting or it sees the element we just published
+    PLT_ATOMIC_FENCE();
+    if (PLT_ATOMIC_LOAD(&queue->consumerWaiting)) {
+        wakeConsumer(queue, 0);
+    }
+
+    return SRQ_SUCCESS;
+}
+
+int SrqPollQueueElement(PSPSC_RING_QUEUE queue, void** data) {
+    if (PLT_ATOMIC_LOAD(&queue->shutdown)) {
+        return SRQ_INTERRUPTED;
+    }
+
+    return takeElement(queue, data) ? SRQ_SUCCESS : SRQ_NO_ELEMENT;
+}
+
+int SrqWaitForQueueElement(PSPSC_RING_QUEUE queue, void** data) {
+    for (;;) {
+        if (PLT_ATOMIC_LOAD(&queue->shutdown)) {
+            return SRQ_INTERRUPTED;
+        }
+
+        if (takeElement(queue, data)) {
+            return SRQ_SUCCESS;
+        }
+
+#if defined(__linux__)
+        int futexValue = PLT_ATOMIC_LOAD(&queue->futexWord);
+#else
+        PltClearEvent(&queue->containsDataEvent);
+#endif
+
+        PLT_ATOMIC_STORE(&queue->consumerWaiting, 1);
+        PLT_ATOMIC_FENCE();
+
+        // Only sleep if nothing arrived after we announced that we're waiting
+        if (!PLT_ATOMIC_LOAD(&queue->shutdown) && isRingEmpty(queue)) {
+#if defined(__linux__)
+            futexWait(&queue->futexWord, futexValue);
+#else
+            if (PltWaitForEvent(&queue->containsDataEvent) != PLT_WAIT_SUCCESS) {
+                PLT_ATOMIC_STORE(&queue->consumerWaiting, 0);
+                return SRQ_INTERRUPTED;
+            }
+#endif
+        }
+
+        PLT_ATOMIC_STORE(&queue->consumerWaiting, 0);
+    }
+}
+
+// The answer is only a snapshot, since the other side may change it right away
+int SrqIsQueueEmpty(PSPSC_RING_QUEUE queue) {
+    return isRingEmpty(queue);
+}
+
+// Discards the elements queued at the time of the call, returning the number freed
+int SrqFlushQueueItems(PSPSC_RING_QUEUE queue, SrqFreeItem freeItem) {
+    unsigned int tail = PLT_ATOMIC_LOAD(&queue->tail);
+    unsigned int head;
+    void* element;
+    int count = 0;
+
+    for (;;) {
+        head = PLT_ATOMIC_LOAD(&queue->head);
+        if ((int)(tail - head) <= 0) {
+            break;
+        }
+
+        element = PLT_ATOMIC_LOAD_PTR(&queue->slots[head & queue->mask]);
+        if (PLT_ATOMIC_CAS(&queue->head, head, head + 1)) {
+            freeItem(element);
+            count++;
+        }
+    }
+
+    return count;
+}
+
+void SrqSignalQueueShutdown(PSPSC_RING_QUEUE queue) {
+    PLT_ATOMIC_STORE(&queue->shutdown, 1);
+    PLT_ATOMIC_FENCE();
+    wakeConsumer(queue, 1);
+}
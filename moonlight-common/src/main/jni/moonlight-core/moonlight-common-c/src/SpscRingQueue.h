@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Platform.h"
+#include "PlatformThreads.h"
+
+#define SRQ_SUCCESS 0
+#define SRQ_INTERRUPTED 1
+#define SRQ_BOUND_EXCEEDED 2
+#define SRQ_NO_ELEMENT 3
+
+typedef void(*SrqFreeItem)(void* data);
+
+// Bounded single-producer/single-consumer ring. Offer must only be called from
+// the producer thread and Wait/Poll only from the consumer thread. Flush may be
+// called from any thread; it claims elements the same way the consumer does.
+typedef struct _SPSC_RING_QUEUE {
+    void** slots;
+    unsigned int mask;
+    int sizeBound;
+
+    // Producer and consumer positions are kept on separate cache lines
+    unsigned int tail;
+    char pad1[64 - sizeof(unsigned int)];
+    unsigned int head;
+    char pad2[64 - sizeof(unsigned int)];
+
+    // Blocking state used only when the consumer finds the ring empty
+    int consumerWaiting;
+    int shutdown;
+#if defined(__linux__)
+    int futexWord;
+#else
+    PLT_EVENT containsDataEvent;
+#endif
+} SPSC_RING_QUEUE, *PSPSC_RING_QUEUE;
+
+int SrqInitializeRingQueue(PSPSC_RING_QUEUE queue, int sizeBound);
+void SrqDestroyRingQueue(PSPSC_RING_QUEUE queue, SrqFreeItem freeItem);
+int SrqOfferQueueItem(PSPSC_RING_QUEUE queue, void* data);
+int SrqWaitForQueueElement(PSPSC_RING_QUEUE queue, void** data);
+int SrqPollQueueElement(PSPSC_RING_QUEUE queue, void** data);
+int SrqFlushQueueItems(PSPSC_RING_QUEUE queue, SrqFreeItem freeItem);
+int SrqIsQueueEmpty(PSPSC_RING_QUEUE queue);
+void SrqSignalQueueShutdown(PSPSC_RING_QUEUE queue);
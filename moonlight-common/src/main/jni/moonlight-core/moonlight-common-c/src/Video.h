@@ -1,10 +1,12 @@
 #pragma once
 
-#include "LinkedBlockingQueue.h"
+#include "Platform.h"
+#include "PlatformThreads.h"
+#include "FrameTelemetry.h"
 
 typedef struct _QUEUED_DECODE_UNIT {
     DECODE_UNIT decodeUnit;
-    LINKED_BLOCKING_QUEUE_ENTRY entry;
+    FRAME_TIMING timing;
 } QUEUED_DECODE_UNIT, *PQUEUED_DECODE_UNIT;
 
 void freeQueuedDecodeUnit(PQUEUED_DECODE_UNIT qdu);
@@ -1,7 +1,10 @@
 #include "Platform.h"
 #include "Limelight-internal.h"
-#include "LinkedBlockingQueue.h"
+#include "PlatformAtomics.h"
+#include "SpscRingQueue.h"
 #include "Video.h"
+#include "PacketPool.h"
+#include "NalScanner.h"
 
 static PLENTRY nalChainHead;
 static int nalChainDataLength;
@@ -14,12 +17,75 @@ static unsigned int lastPacketInStream;
 static int decodingFrame;
 static int strictIdrFrameWait;
 static unsigned long long firstPacketReceiveTime;
+static unsigned long long lastPacketReceiveTime;
 static int dropStatePending;
 
 #define CONSECUTIVE_DROP_LIMIT 120
 static unsigned int consecutiveFrameDrops;
 
-static LINKED_BLOCKING_QUEUE decodeUnitQueue;
+#define DECODE_UNIT_QUEUE_BOUND 15
+static SPSC_RING_QUEUE decodeUnitQueue;
+
+// Completed decode units that found the queue full under a bounded latency
+// policy. The receive thread offers them again as packets arrive rather than
+// waiting for the decoder thread to make room.
+#define DECODE_UNIT_BACKLOG_BOUND 4
+static PQUEUED_DECODE_UNIT decodeUnitBacklog[DECODE_UNIT_BACKLOG_BOUND];
+static int decodeUnitBacklogHead;
+static int decodeUnitBacklogCount;
+
+// Set by LiSetDecodeQueuePolicy() and applied when the depacketizer starts
+static int configuredQueuePolicy = DECODE_QUEUE_POLICY_FLUSH_AND_IDR;
+static int configuredMaxFrameAgeMs = DECODE_QUEUE_DEFAULT_MAX_FRAME_AGE_MS;
+static int decodeQueuePolicy;
+static unsigned long long maxFrameAgeMs;
+
+// Counters for LiGetDecodeQueueStats(). Both the receive thread and the
+// decoder thread update them, so they're only accessed atomically.
+static struct {
+    unsigned int overflows;
+    unsigned int framesDropped;
+    unsigned int idrRequests;
+    unsigned int idrsAvoided;
+} decodeQueueStats;
+
+// Frames skipped by the decoder thread that the receive thread still has to
+// invalidate. Only the receive thread may queue invalidation tuples.
+static PLT_MUTEX skippedFramesMutex;
+static int skippedFramesPending;
+static int skippedFrameStart;
+static int skippedFrameEnd;
+
+// Bounds on the number of preallocated fragment buffers
+#define FRAGMENT_POOL_MIN 64
+#define FRAGMENT_POOL_MAX 4096
+static PACKET_POOL fragmentPool;
+
+// Contiguous frame buffers used with CAPABILITY_CONTIGUOUS_FRAME
+typedef struct _FRAME_BUFFER {
+    // qdu must remain at the front
+    QUEUED_DECODE_UNIT qdu;
+
+    char* data;
+    int capacity;
+
+    // Buffer chain entries are located by offset until the frame is complete
+    // because data may be reallocated as the frame grows
+    PLENTRY entries;
+    int* offsets;
+    int entryCount;
+    int entryCapacity;
+
+    int inUse;
+} FRAME_BUFFER, *PFRAME_BUFFER;
+
+#define FRAME_BUFFER_MIN_SIZE (64 * 1024)
+static PFRAME_BUFFER frameBuffers;
+static int frameBufferCount;
+static int nextFrameBuffer;
+static int initialFrameBufferSize;
+static PLT_MUTEX frameBufferMutex;
+static PFRAME_BUFFER currentFrameBuffer;
 
 typedef struct _BUFFER_DESC {
     char* data;
@@ -27,10 +93,143 @@ typedef struct _BUFFER_DESC {
     unsigned int length;
 } BUFFER_DESC, *PBUFFER_DESC;
 
+// Fragments live until the decoder consumes their frame, so the pool
+// must cover every frame that can be waiting in the decode unit queue.
+static int getFragmentPoolCapacity(void) {
+    int capacity = getVideoPacketsPerFrame();
+
+    if ((VideoCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
+        capacity *= DECODE_UNIT_QUEUE_BOUND + 2;
+    }
+    else {
+        capacity *= 4;
+    }
+
+    if (capacity < FRAGMENT_POOL_MIN) {
+        capacity = FRAGMENT_POOL_MIN;
+    }
+    else if (capacity > FRAGMENT_POOL_MAX) {
+        capacity = FRAGMENT_POOL_MAX;
+    }
+
+    return capacity;
+}
+
+// Every frame that can be queued for, held back from, or held by the decoder
+// needs a frame buffer, plus the one that is being assembled
+static void initializeFrameBuffers(int pktSize) {
+    if ((VideoCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
+        frameBufferCount = DECODE_UNIT_QUEUE_BOUND + DECODE_UNIT_BACKLOG_BOUND + 2;
+    }
+    else {
+        frameBufferCount = 2;
+    }
+
+    frameBuffers = calloc(frameBufferCount, sizeof(*frameBuffers));
+    if (frameBuffers == NULL) {
+        frameBufferCount = 0;
+    }
+
+    // Buffers are allocated on first use and grow to fit larger frames (like IDR frames)
+    initialFrameBufferSize = getVideoPacketsPerFrame() * pktSize * 2;
+    if (initialFrameBufferSize < FRAME_BUFFER_MIN_SIZE) {
+        initialFrameBufferSize = FRAME_BUFFER_MIN_SIZE;
+    }
+
+    nextFrameBuffer = 0;
+    currentFrameBuffer = NULL;
+    PltCreateMutex(&frameBufferMutex);
+}
+
+static void destroyFrameBuffers(void) {
+    int i;
+
+    for (i = 0; i < frameBufferCount; i++) {
+        LC_ASSERT(!frameBuffers[i].inUse);
+        free(frameBuffers[i].data);
+        free(frameBuffers[i].entries);
+        free(frameBuffers[i].offsets);
+    }
+
+    free(frameBuffers);
+    frameBuffers = NULL;
+    frameBufferCount = 0;
+
+    PltDeleteMutex(&frameBufferMutex);
+}
+
+// Returns NULL if all frame buffers are in use
+static PFRAME_BUFFER acquireFrameBuffer(void) {
+    PFRAME_BUFFER frameBuffer = NULL;
+    int i;
+
+    PltLockMutex(&frameBufferMutex);
+    for (i = 0; i < frameBufferCount; i++) {
+        PFRAME_BUFFER candidate = &frameBuffers[(nextFrameBuffer + i) % frameBufferCount];
+        if (!candidate->inUse) {
+            candidate->inUse = 1;
+            nextFrameBuffer = (nextFrameBuffer + i + 1) % frameBufferCount;
+            frameBuffer = candidate;
+            break;
+        }
+    }
+    PltUnlockMutex(&frameBufferMutex);
+
+    if (frameBuffer != NULL) {
+        frameBuffer->entryCount = 0;
+    }
+
+    return frameBuffer;
+}
+
+// This may be called by the decoder thread
+static void releaseFrameBuffer(PFRAME_BUFFER frameBuffer) {
+    PltLockMutex(&frameBufferMutex);
+    frameBuffer->inUse = 0;
+    PltUnlockMutex(&frameBufferMutex);
+}
+
 // Init
-void initializeVideoDepacketizer(int pktSize) {
+int initializeVideoDepacketizer(int pktSize) {
+    int err;
+
+    if (VideoCallbacks.capabilities & CAPABILITY_CONTIGUOUS_FRAME) {
+        // Fragments are only needed if we run out of frame buffers
+        err = PpInitializePacketPool(&fragmentPool, sizeof(LENTRY) + pktSize, FRAGMENT_POOL_MIN);
+    }
+    else {
+        // A single packet's payload always fits in a pooled fragment
+        err = PpInitializePacketPool(&fragmentPool, sizeof(LENTRY) + pktSize, getFragmentPoolCapacity());
+    }
+    if (err != 0) {
+        return err;
+    }
+
     if ((VideoCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
-        LbqInitializeLinkedBlockingQueue(&decodeUnitQueue, 15);
+        err = SrqInitializeRingQueue(&decodeUnitQueue, DECODE_UNIT_QUEUE_BOUND);
+        if (err != 0) {
+            PpCleanupPacketPool(&fragmentPool);
+            return err;
+        }
+        PltCreateMutex(&skippedFramesMutex);
+    }
+
+    decodeQueuePolicy = configuredQueuePolicy;
+    maxFrameAgeMs = configuredMaxFrameAgeMs;
+    if (decodeQueuePolicy == DECODE_QUEUE_POLICY_INVALIDATE_REFS && !isReferenceFrameInvalidationEnabled()) {
+        Limelog("Reference frame invalidation is unavailable; skipped frames will need an IDR frame\n");
+        decodeQueuePolicy = DECODE_QUEUE_POLICY_BOUNDED_LATENCY;
+    }
+    PLT_ATOMIC_STORE(&decodeQueueStats.overflows, 0);
+    PLT_ATOMIC_STORE(&decodeQueueStats.framesDropped, 0);
+    PLT_ATOMIC_STORE(&decodeQueueStats.idrRequests, 0);
+    PLT_ATOMIC_STORE(&decodeQueueStats.idrsAvoided, 0);
+    skippedFramesPending = 0;
+    decodeUnitBacklogHead = 0;
+    decodeUnitBacklogCount = 0;
+
+    if (VideoCallbacks.capabilities & CAPABILITY_CONTIGUOUS_FRAME) {
+        initializeFrameBuffers(pktSize);
     }
 
     nextFrameNumber = 1;
@@ -42,6 +241,7 @@ void initializeVideoDepacketizer(int pktSize) {
     firstPacketReceiveTime = 0;
     dropStatePending = 0;
     strictIdrFrameWait = !isReferenceFrameInvalidationEnabled();
+    return 0;
 }
 
 // Free the NAL chain
@@ -51,7 +251,12 @@ static void cleanupFrameState(void) {
     while (nalChainHead != NULL) {
         lastEntry = nalChainHead;
         nalChainHead = lastEntry->next;
-        free(lastEntry);
+        PpFreePacket(&fragmentPool, lastEntry);
+    }
+
+    if (currentFrameBuffer != NULL) {
+        releaseFrameBuffer(currentFrameBuffer);
+        currentFrameBuffer = NULL;
     }
 
     nalChainDataLength = 0;
@@ -88,32 +293,49 @@ static void dropFrameState(void) {
     cleanupFrameState();
 }
 
-// Cleanup the list of decode units
-static void freeDecodeUnitList(PLINKED_BLOCKING_QUEUE_ENTRY entry) {
-    PLINKED_BLOCKING_QUEUE_ENTRY nextEntry;
-
-    while (entry != NULL) {
-        nextEntry = entry->flink;
+// Cleanup a decode unit flushed from the decode unit queue
+static void freeFlushedDecodeUnit(void* data) {
+    freeQueuedDecodeUnit((PQUEUED_DECODE_UNIT)data);
+}
 
-        freeQueuedDecodeUnit((PQUEUED_DECODE_UNIT)entry->data);
+// Returns the number of decode units freed
+static int freeDecodeUnitBacklog(void) {
+    int count = decodeUnitBacklogCount;
 
-        entry = nextEntry;
+    while (decodeUnitBacklogCount > 0) {
+        freeQueuedDecodeUnit(decodeUnitBacklog[decodeUnitBacklogHead]);
+        decodeUnitBacklogHead = (decodeUnitBacklogHead + 1) % DECODE_UNIT_BACKLOG_BOUND;
+        decodeUnitBacklogCount--;
     }
+
+    return count;
 }
 
 void stopVideoDepacketizer(void) {
     if ((VideoCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
-        LbqSignalQueueShutdown(&decodeUnitQueue);
+        SrqSignalQueueShutdown(&decodeUnitQueue);
     }
 }
 
 // Cleanup video depacketizer and free malloced memory
 void destroyVideoDepacketizer(void) {
     if ((VideoCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
-        freeDecodeUnitList(LbqDestroyLinkedBlockingQueue(&decodeUnitQueue));
+        SrqDestroyRingQueue(&decodeUnitQueue, freeFlushedDecodeUnit);
+        freeDecodeUnitBacklog();
+        PltDeleteMutex(&skippedFramesMutex);
     }
 
     cleanupFrameState();
+
+    if (VideoCallbacks.capabilities & CAPABILITY_CONTIGUOUS_FRAME) {
+        destroyFrameBuffers();
+    }
+
+    PpCleanupPacketPool(&fragmentPool);
+}
+
+void getVideoDepacketizerPoolStats(PPACKET_POOL_STATS stats) {
+    PpGetPacketPoolStats(&fragmentPool, stats);
 }
 
 // Returns 1 if candidate is a frame start and 0 otherwise
@@ -126,11 +348,6 @@ static int isSeqAnnexBStart(PBUFFER_DESC candidate) {
     return (candidate->data[candidate->offset + candidate->length - 1] == 1);
 }
 
-// Returns 1 if candidate is padding and 0 otherwise
-static int isSeqPadding(PBUFFER_DESC candidate) {
-    return (candidate->data[candidate->offset + candidate->length - 1] == 0);
-}
-
 // Returns 1 on success, 0 otherwise
 static int getSpecialSeq(PBUFFER_DESC current, PBUFFER_DESC candidate) {
     if (current->length < 3) {
@@ -168,25 +385,153 @@ static int getSpecialSeq(PBUFFER_DESC current, PBUFFER_DESC candidate) {
     return 0;
 }
 
+void LiSetDecodeQueuePolicy(int policy, int maxFrameAgeMs) {
+    configuredQueuePolicy = policy;
+    configuredMaxFrameAgeMs = maxFrameAgeMs > 0 ? maxFrameAgeMs : DECODE_QUEUE_DEFAULT_MAX_FRAME_AGE_MS;
+}
+
+int LiGetDecodeQueueStats(PDECODE_QUEUE_STATS stats) {
+    stats->overflows = PLT_ATOMIC_LOAD(&decodeQueueStats.overflows);
+    stats->framesDropped = PLT_ATOMIC_LOAD(&decodeQueueStats.framesDropped);
+    stats->idrRequests = PLT_ATOMIC_LOAD(&decodeQueueStats.idrRequests);
+    stats->idrsAvoided = PLT_ATOMIC_LOAD(&decodeQueueStats.idrsAvoided);
+    return 0;
+}
+
+static int isDecodeUnitStale(PQUEUED_DECODE_UNIT qdu) {
+    return PltGetMillis() - qdu->decodeUnit.receiveTimeMs > maxFrameAgeMs;
+}
+
+// Drops a decode unit that the decoder thread got to too late
+static void skipStaleDecodeUnit(PQUEUED_DECODE_UNIT qdu) {
+    int frameNumber = qdu->decodeUnit.frameNumber;
+
+    freeQueuedDecodeUnit(qdu);
+    PLT_ATOMIC_INCREMENT(&decodeQueueStats.framesDropped);
+
+    if (decodeQueuePolicy == DECODE_QUEUE_POLICY_INVALIDATE_REFS) {
+        // Skipped frames are consecutive until the receive thread picks them up
+        PltLockMutex(&skippedFramesMutex);
+        if (!skippedFramesPending) {
+            skippedFrameStart = frameNumber;
+        }
+        skippedFrameEnd = frameNumber;
+        skippedFramesPending = 1;
+        PltUnlockMutex(&skippedFramesMutex);
+    }
+    else {
+        Limelog("Skipping decode units queued for more than %llu ms\n", maxFrameAgeMs);
+
+        // Everything still queued depends on the skipped frame
+        PLT_ATOMIC_ADD(&decodeQueueStats.framesDropped, SrqFlushQueueItems(&decodeUnitQueue, freeFlushedDecodeUnit));
+        PLT_ATOMIC_INCREMENT(&decodeQueueStats.idrRequests);
+        requestDecoderRefresh();
+    }
+}
+
+// Called on the receive thread to invalidate frames the decoder thread skipped
+static void invalidateSkippedFrames(void) {
+    int startFrame, endFrame;
+
+    if (decodeQueuePolicy != DECODE_QUEUE_POLICY_INVALIDATE_REFS) {
+        return;
+    }
+
+    PltLockMutex(&skippedFramesMutex);
+    if (!skippedFramesPending) {
+        PltUnlockMutex(&skippedFramesMutex);
+        return;
+    }
+    startFrame = skippedFrameStart;
+    endFrame = skippedFrameEnd;
+    skippedFramesPending = 0;
+    PltUnlockMutex(&skippedFramesMutex);
+
+    connectionDetectedFrameLoss(startFrame, endFrame);
+    PLT_ATOMIC_INCREMENT(&decodeQueueStats.idrsAvoided);
+}
+
 // Get the first decode unit available
 int getNextQueuedDecodeUnit(PQUEUED_DECODE_UNIT* qdu) {
-    int err = LbqWaitForQueueElement(&decodeUnitQueue, (void**)qdu);
-    if (err == LBQ_SUCCESS) {
-        return 1;
+    for (;;) {
+        int err = SrqWaitForQueueElement(&decodeUnitQueue, (void**)qdu);
+        if (err != SRQ_SUCCESS) {
+            return 0;
+        }
+
+        // The newest frame is always decoded, however late it is
+        if (decodeQueuePolicy == DECODE_QUEUE_POLICY_FLUSH_AND_IDR ||
+            SrqIsQueueEmpty(&decodeUnitQueue) || !isDecodeUnitStale(*qdu)) {
+            return 1;
+        }
+
+        skipStaleDecodeUnit(*qdu);
     }
-    else {
-        return 0;
+}
+
+// Moves backlogged decode units into the queue as far as the decoder thread
+// has made room. Returns SRQ_SUCCESS once the backlog is empty.
+static int offerDecodeUnitBacklog(void) {
+    while (decodeUnitBacklogCount > 0) {
+        int err = SrqOfferQueueItem(&decodeUnitQueue, decodeUnitBacklog[decodeUnitBacklogHead]);
+        if (err != SRQ_SUCCESS) {
+            return err;
+        }
+
+        decodeUnitBacklogHead = (decodeUnitBacklogHead + 1) % DECODE_UNIT_BACKLOG_BOUND;
+        decodeUnitBacklogCount--;
+        if (decodeUnitBacklogCount == 0) {
+            // The decoder caught up without a flush
+            PLT_ATOMIC_INCREMENT(&decodeQueueStats.idrsAvoided);
+        }
     }
+
+    return SRQ_SUCCESS;
+}
+
+// Queues a completed decode unit behind any backlogged ones. Under the bounded
+// latency policies, a decode unit that finds the queue full joins the backlog
+// so a short decoder stall doesn't cost an IDR frame. SRQ_BOUND_EXCEEDED means
+// qdu wasn't taken because the queue is full and the backlog is full, stale or
+// not in use.
+static int queueDecodeUnit(PQUEUED_DECODE_UNIT qdu) {
+    int err;
+
+    err = offerDecodeUnitBacklog();
+    if (err == SRQ_SUCCESS) {
+        err = SrqOfferQueueItem(&decodeUnitQueue, qdu);
+    }
+    if (err != SRQ_BOUND_EXCEEDED) {
+        return err;
+    }
+
+    PLT_ATOMIC_INCREMENT(&decodeQueueStats.overflows);
+
+    if (decodeQueuePolicy == DECODE_QUEUE_POLICY_FLUSH_AND_IDR ||
+        decodeUnitBacklogCount == DECODE_UNIT_BACKLOG_BOUND ||
+        (decodeUnitBacklogCount > 0 && isDecodeUnitStale(decodeUnitBacklog[decodeUnitBacklogHead]))) {
+        return SRQ_BOUND_EXCEEDED;
+    }
+
+    decodeUnitBacklog[(decodeUnitBacklogHead + decodeUnitBacklogCount) % DECODE_UNIT_BACKLOG_BOUND] = qdu;
+    decodeUnitBacklogCount++;
+    return SRQ_SUCCESS;
 }
 
 // Cleanup a decode unit by freeing the buffer chain and the holder
 void freeQueuedDecodeUnit(PQUEUED_DECODE_UNIT qdu) {
     PLENTRY lastEntry;
 
+    if (qdu->decodeUnit.frameBuffer != NULL) {
+        // The decode unit lives inside its frame buffer
+        releaseFrameBuffer((PFRAME_BUFFER)qdu);
+        return;
+    }
+
     while (qdu->decodeUnit.bufferList != NULL) {
         lastEntry = qdu->decodeUnit.bufferList;
         qdu->decodeUnit.bufferList = lastEntry->next;
-        free(lastEntry);
+        PpFreePacket(&fragmentPool, lastEntry);
     }
 
     free(qdu);
@@ -223,50 +568,115 @@ static int isIdrFrameStart(PBUFFER_DESC buffer) {
          specialSeq.data[specialSeq.offset + specialSeq.length] == 0x40); // H265 VPS
 }
 
+// Builds the decode unit for a completed contiguous frame
+static PQUEUED_DECODE_UNIT completeFrameBuffer(PFRAME_BUFFER frameBuffer) {
+    PQUEUED_DECODE_UNIT qdu = &frameBuffer->qdu;
+    int i;
+
+    for (i = 0; i < frameBuffer->entryCount; i++) {
+        frameBuffer->entries[i].data = &frameBuffer->data[frameBuffer->offsets[i]];
+        frameBuffer->entries[i].next = (i + 1 < frameBuffer->entryCount) ? &frameBuffer->entries[i + 1] : NULL;
+    }
+
+    qdu->decodeUnit.bufferList = frameBuffer->entries;
+    qdu->decodeUnit.frameBuffer = frameBuffer->data;
+    qdu->decodeUnit.nalCount = frameBuffer->entryCount;
+    qdu->decodeUnit.nalOffsets = frameBuffer->offsets;
+
+    return qdu;
+}
+
 // Reassemble the frame with the given frame number
 static void reassembleFrame(int frameNumber) {
-    if (nalChainHead != NULL) {
-        PQUEUED_DECODE_UNIT qdu = (PQUEUED_DECODE_UNIT)malloc(sizeof(*qdu));
+    if (nalChainHead != NULL || (currentFrameBuffer != NULL && currentFrameBuffer->entryCount != 0)) {
+        PQUEUED_DECODE_UNIT qdu;
+
+        if (currentFrameBuffer != NULL) {
+            qdu = completeFrameBuffer(currentFrameBuffer);
+        }
+        else {
+            qdu = (PQUEUED_DECODE_UNIT)malloc(sizeof(*qdu));
+            if (qdu != NULL) {
+                qdu->decodeUnit.bufferList = nalChainHead;
+                qdu->decodeUnit.frameBuffer = NULL;
+                qdu->decodeUnit.nalCount = 0;
+                qdu->decodeUnit.nalOffsets = NULL;
+            }
+        }
+
         if (qdu != NULL) {
-            qdu->decodeUnit.bufferList = nalChainHead;
             qdu->decodeUnit.fullLength = nalChainDataLength;
             qdu->decodeUnit.frameNumber = frameNumber;
             qdu->decodeUnit.receiveTimeMs = firstPacketReceiveTime;
 
             // IDR frames will have leading CSD buffers
-            if (nalChainHead->bufferType != BUFFER_TYPE_PICDATA) {
+            if (qdu->decodeUnit.bufferList->bufferType != BUFFER_TYPE_PICDATA) {
                 qdu->decodeUnit.frameType = FRAME_TYPE_IDR;
             }
             else {
                 qdu->decodeUnit.frameType = FRAME_TYPE_PFRAME;
             }
 
+            qdu->timing.frameNumber = frameNumber;
+            qdu->timing.frameType = qdu->decodeUnit.frameType;
+            qdu->timing.firstPacketUs = firstPacketReceiveTime * 1000;
+            qdu->timing.lastPacketUs = lastPacketReceiveTime * 1000;
+            qdu->timing.fecRecoveryUs = takeFrameFecRecovery(frameNumber);
+            qdu->timing.depacketizedUs = PltGetMicroseconds();
+
             nalChainHead = NULL;
+            currentFrameBuffer = NULL;
             nalChainDataLength = 0;
 
             if ((VideoCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
-                if (LbqOfferQueueItem(&decodeUnitQueue, qdu, &qdu->entry) == LBQ_BOUND_EXCEEDED) {
-                    Limelog("Video decode unit queue overflow\n");
+                int err = queueDecodeUnit(qdu);
+                if (err == SRQ_INTERRUPTED) {
+                    // We're stopping, so nobody will consume this DU
+                    freeQueuedDecodeUnit(qdu);
+                    return;
+                }
+                else if (err == SRQ_BOUND_EXCEEDED && decodeQueuePolicy == DECODE_QUEUE_POLICY_INVALIDATE_REFS) {
+                    int startFrame = decodeUnitBacklogCount > 0 ?
+                        decodeUnitBacklog[decodeUnitBacklogHead]->decodeUnit.frameNumber : frameNumber;
+
+                    Limelog("Video decode unit queue overflow; invalidating frames %d-%d\n", startFrame, frameNumber);
 
-                    // Clear frame state and wait for an IDR
-                    nalChainHead = qdu->decodeUnit.bufferList;
-                    nalChainDataLength = qdu->decodeUnit.fullLength;
+                    // Drop the frames held back with this one and have the server stop referencing them
+                    freeQueuedDecodeUnit(qdu);
+                    PLT_ATOMIC_ADD(&decodeQueueStats.framesDropped, 1 + freeDecodeUnitBacklog());
                     dropFrameState();
+                    invalidateSkippedFrames();
+                    connectionDetectedFrameLoss(startFrame, frameNumber);
+                    PLT_ATOMIC_INCREMENT(&decodeQueueStats.idrsAvoided);
+                    return;
+                }
+                else if (err == SRQ_BOUND_EXCEEDED) {
+                    Limelog("Video decode unit queue overflow\n");
 
-                    // Free the DU
-                    free(qdu);
+                    // Free the DU and any held back with it, then clear frame state and wait for an IDR
+                    freeQueuedDecodeUnit(qdu);
+                    PLT_ATOMIC_ADD(&decodeQueueStats.framesDropped, 1 + freeDecodeUnitBacklog());
+                    dropFrameState();
 
                     // Flush the decode unit queue
-                    freeDecodeUnitList(LbqFlushQueueItems(&decodeUnitQueue));
+                    PLT_ATOMIC_ADD(&decodeQueueStats.framesDropped, SrqFlushQueueItems(&decodeUnitQueue, freeFlushedDecodeUnit));
+                    PLT_ATOMIC_INCREMENT(&decodeQueueStats.idrRequests);
 
                     // FIXME: Get proper bounds to use reference frame invalidation
                     requestIdrOnDemand();
                     return;
                 }
+
+                invalidateSkippedFrames();
             }
             else {
+                qdu->timing.dequeuedUs = qdu->timing.depacketizedUs;
+
                 int ret = VideoCallbacks.submitDecodeUnit(&qdu->decodeUnit);
 
+                qdu->timing.submitReturnedUs = PltGetMicroseconds();
+                commitFrameTiming(&qdu->timing);
+
                 freeQueuedDecodeUnit(qdu);
 
                 if (ret == DR_NEED_IDR) {
@@ -320,8 +730,97 @@ static int getBufferFlags(char* data, int length) {
     }
 }
 
+// Grows the frame buffer to hold at least size bytes. Returns 0 on failure.
+static int reserveFrameBuffer(PFRAME_BUFFER frameBuffer, int size) {
+    int capacity;
+    char* data;
+
+    if (size <= frameBuffer->capacity) {
+        return 1;
+    }
+
+    capacity = frameBuffer->capacity != 0 ? frameBuffer->capacity : initialFrameBufferSize;
+    while (capacity < size) {
+        capacity *= 2;
+    }
+
+    data = realloc(frameBuffer->data, capacity);
+    if (data == NULL) {
+        return 0;
+    }
+
+    frameBuffer->data = data;
+    frameBuffer->capacity = capacity;
+    return 1;
+}
+
+// Appends a fragment to the frame buffer, extending the previous entry if both are picture data
+static void appendToFrameBuffer(PFRAME_BUFFER frameBuffer, char* data, int offset, int length) {
+    int bufferType;
+
+    if (!reserveFrameBuffer(frameBuffer, nalChainDataLength + length)) {
+        return;
+    }
+
+    memcpy(&frameBuffer->data[nalChainDataLength], &data[offset], length);
+    bufferType = getBufferFlags(&frameBuffer->data[nalChainDataLength], length);
+
+    if (bufferType == BUFFER_TYPE_PICDATA && frameBuffer->entryCount != 0 &&
+        frameBuffer->entries[frameBuffer->entryCount - 1].bufferType == BUFFER_TYPE_PICDATA) {
+        frameBuffer->entries[frameBuffer->entryCount - 1].length += length;
+    }
+    else {
+        if (frameBuffer->entryCount == frameBuffer->entryCapacity) {
+            int entryCapacity = frameBuffer->entryCapacity != 0 ? frameBuffer->entryCapacity * 2 : 8;
+            PLENTRY entries = realloc(frameBuffer->entries, entryCapacity * sizeof(*entries));
+            int* offsets;
+
+            if (entries == NULL) {
+                return;
+            }
+            frameBuffer->entries = entries;
+
+            offsets = realloc(frameBuffer->offsets, entryCapacity * sizeof(*offsets));
+            if (offsets == NULL) {
+                return;
+            }
+            frameBuffer->offsets = offsets;
+
+            frameBuffer->entryCapacity = entryCapacity;
+        }
+
+        frameBuffer->entries[frameBuffer->entryCount].length = length;
+        frameBuffer->entries[frameBuffer->entryCount].bufferType = bufferType;
+        frameBuffer->offsets[frameBuffer->entryCount] = nalChainDataLength;
+        frameBuffer->entryCount++;
+    }
+
+    nalChainDataLength += length;
+}
+
 static void queueFragment(char* data, int offset, int length) {
-    PLENTRY entry = (PLENTRY)malloc(sizeof(*entry) + length);
+    PLENTRY entry;
+
+    if (VideoCallbacks.capabilities & CAPABILITY_CONTIGUOUS_FRAME) {
+        // A frame already started as a buffer chain stays one
+        if (currentFrameBuffer == NULL && nalChainHead == NULL) {
+            currentFrameBuffer = acquireFrameBuffer();
+        }
+
+        if (currentFrameBuffer != NULL) {
+            appendToFrameBuffer(currentFrameBuffer, data, offset, length);
+            return;
+        }
+    }
+
+    if (sizeof(*entry) + length <= (unsigned int)fragmentPool.bufferSize) {
+        entry = (PLENTRY)PpAllocatePacket(&fragmentPool);
+    }
+    else {
+        // Oversized fragments are handed back to the heap by PpFreePacket()
+        entry = (PLENTRY)malloc(sizeof(*entry) + length);
+    }
+
     if (entry != NULL) {
         entry->next = NULL;
         entry->length = length;
@@ -351,6 +850,7 @@ static void queueFragment(char* data, int offset, int length) {
 // Process an RTP Payload
 static void processRtpPayloadSlow(PNV_VIDEO_PACKET videoPacket, PBUFFER_DESC currentPos) {
     BUFFER_DESC specialSeq;
+    unsigned int end;
     int decodingVideo = 0;
 
     // We should not have any NALUs when processing the first packet in an IDR frame
@@ -391,19 +891,11 @@ static void processRtpPayloadSlow(PNV_VIDEO_PACKET videoPacket, PBUFFER_DESC cur
             }
         }
 
-        // Move to the next special sequence
-        while (currentPos->length != 0) {
-            // Check if this should end the current NAL
-            if (getSpecialSeq(currentPos, &specialSeq)) {
-                if (decodingVideo || !isSeqPadding(&specialSeq)) {
-                    break;
-                }
-            }
-
-            // This byte is part of the NAL data
-            currentPos->offset++;
-            currentPos->length--;
-        }
+        // Move to the next special sequence that should end the current NAL.
+        // Padding only ends it while we're decoding video.
+        end = NsFindSpecialSeq(currentPos->data, currentPos->offset, currentPos->length, decodingVideo);
+        currentPos->length -= end - currentPos->offset;
+        currentPos->offset = end;
 
         if (decodingVideo) {
             queueFragment(currentPos->data, start, currentPos->offset - start);
@@ -419,7 +911,7 @@ void requestDecoderRefresh(void) {
     
     // Flush the decode unit queue
     if ((VideoCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
-        freeDecodeUnitList(LbqFlushQueueItems(&decodeUnitQueue));
+        SrqFlushQueueItems(&decodeUnitQueue, freeFlushedDecodeUnit);
     }
     
     // Request the receive thread drop its state
@@ -470,6 +962,11 @@ void processRtpPayload(PNV_VIDEO_PACKET videoPacket, int length, unsigned long l
     LC_ASSERT((flags & ~(FLAG_SOF | FLAG_EOF | FLAG_CONTAINS_PIC_DATA)) == 0);
 
     streamPacketIndex = videoPacket->streamPacketIndex;
+
+    // Hand held back frames to the decoder thread as soon as it has room
+    if (decodeUnitBacklogCount > 0) {
+        offerDecodeUnitBacklog();
+    }
     
     // Drop packets from a previously corrupt frame
     if (isBefore32(frameIndex, nextFrameNumber)) {
@@ -517,6 +1014,7 @@ void processRtpPayload(PNV_VIDEO_PACKET videoPacket, int length, unsigned long l
     }
 
     lastPacketInStream = streamPacketIndex;
+    lastPacketReceiveTime = receiveTimeMs;
 
     // If this is the first packet, skip the frame header (if one exists)
     if (firstPacket){
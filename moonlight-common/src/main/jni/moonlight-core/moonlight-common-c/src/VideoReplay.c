@@ -0,0 +1,259 @@
+#include "Limelight-internal.h"
+#include "RtpCapture.h"
+
+// Upper bound on datagrams held back for reordering at once
+#define REPLAY_MAX_HELD 64
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+typedef struct _HELD_DATAGRAM {
+    char* data;
+    int length;
+    unsigned long long receiveTimeMs;
+
+    // Number of datagrams still to be delivered before this one
+    int remaining;
+} HELD_DATAGRAM;
+
+static DecoderRendererSubmitDecodeUnit replaySubmitDecodeUnit;
+static PVIDEO_REPLAY_STATS replayStats;
+static unsigned int replayRandomState;
+
+static uint64_t hashBytes(uint64_t hash, const void* data, int length) {
+    const unsigned char* bytes = (const unsigned char*)data;
+    int i;
+
+    for (i = 0; i < length; i++) {
+        hash ^= bytes[i];
+        hash *= FNV_PRIME;
+    }
+
+    return hash;
+}
+
+// Records each decode unit before handing it to the real decoder
+static int replaySubmitDecodeUnitHook(PDECODE_UNIT decodeUnit) {
+    PLENTRY entry;
+
+    replayStats->decodeUnits++;
+    if (decodeUnit->frameType == FRAME_TYPE_IDR) {
+        replayStats->idrFrames++;
+    }
+    replayStats->decodeUnitBytes += decodeUnit->fullLength;
+
+    replayStats->decodeUnitHash = hashBytes(replayStats->decodeUnitHash,
+                                            &decodeUnit->frameNumber, sizeof(decodeUnit->frameNumber));
+    for (entry = decodeUnit->bufferList; entry != NULL; entry = entry->next) {
+        replayStats->decodeUnitHash = hashBytes(replayStats->decodeUnitHash, entry->data, entry->length);
+    }
+
+    return replaySubmitDecodeUnit(decodeUnit);
+}
+
+// xorshift32, so impairments are reproducible on every platform for a given seed
+static unsigned int nextReplayRandom(void) {
+    unsigned int x = replayRandomState;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    replayRandomState = x;
+
+    return x;
+}
+
+static int rollPercent(int percent) {
+    return percent > 0 && (int)(nextReplayRandom() % 100) < percent;
+}
+
+static void deliverDatagram(char* data, int length, unsigned long long receiveTimeMs) {
+    if (submitReplayedVideoDatagram(data, length, receiveTimeMs) != 0) {
+        Limelog("Video Replay: dropped a datagram that could not be queued\n");
+    }
+}
+
+// Counts down the held datagrams and delivers the ones whose turn has come
+static void releaseHeldDatagrams(HELD_DATAGRAM* held, int* heldCount, int releaseAll) {
+    int i = 0;
+
+    while (i < *heldCount) {
+        if (releaseAll || --held[i].remaining <= 0) {
+            char* data = held[i].data;
+
+            deliverDatagram(data, held[i].length, held[i].receiveTimeMs);
+
+            // Keep the buffer with the slot it moves into
+            (*heldCount)--;
+            held[i].data = held[*heldCount].data;
+            held[i].length = held[*heldCount].length;
+            held[i].receiveTimeMs = held[*heldCount].receiveTimeMs;
+            held[i].remaining = held[*heldCount].remaining;
+            held[*heldCount].data = data;
+        }
+        else {
+            i++;
+        }
+    }
+}
+
+int LiReplayVideoCapture(const char* path, PVIDEO_REPLAY_OPTIONS options, PDECODER_RENDERER_CALLBACKS drCallbacks,
+    PCONNECTION_LISTENER_CALLBACKS clCallbacks, PVIDEO_REPLAY_STATS stats) {
+    PAUDIO_RENDERER_CALLBACKS arCallbacks = NULL;
+    VIDEO_REPLAY_OPTIONS noImpairments;
+    RTP_CAPTURE_FILE capture;
+    RTP_CAPTURE_HEADER header;
+    HELD_DATAGRAM held[REPLAY_MAX_HELD];
+    int heldCount;
+    char* buffer;
+    int bufferSize;
+    int length;
+    unsigned long long receiveTimeMs;
+    uint64_t startUs;
+    int err, i;
+
+    memset(stats, 0, sizeof(*stats));
+    stats->decodeUnitHash = FNV_OFFSET_BASIS;
+
+    if (options == NULL) {
+        memset(&noImpairments, 0, sizeof(noImpairments));
+        options = &noImpairments;
+    }
+
+    if (RtpcOpenCaptureFile(&capture, path, &header) != 0) {
+        return -1;
+    }
+
+    if (header.packetSize <= 0 || header.packetSize % 16 != 0) {
+        RtpcCloseCaptureFile(&capture);
+        return -1;
+    }
+
+    // Recreate the stream parameters the capture was taken with
+    memset(&StreamConfig, 0, sizeof(StreamConfig));
+    StreamConfig.packetSize = header.packetSize;
+    StreamConfig.width = header.width;
+    StreamConfig.height = header.height;
+    StreamConfig.fps = header.fps;
+    StreamConfig.bitrate = header.bitrate;
+    NegotiatedVideoFormat = header.videoFormat;
+    memcpy(AppVersionQuad, header.appVersionQuad, sizeof(AppVersionQuad));
+
+    fixupMissingCallbacks(&drCallbacks, &arCallbacks, &clCallbacks);
+    memcpy(&VideoCallbacks, drCallbacks, sizeof(VideoCallbacks));
+    memcpy(&ListenerCallbacks, clCallbacks, sizeof(ListenerCallbacks));
+
+    // Decode units are submitted from this thread as they are reassembled
+    VideoCallbacks.capabilities |= CAPABILITY_DIRECT_SUBMIT;
+    replaySubmitDecodeUnit = VideoCallbacks.submitDecodeUnit;
+    VideoCallbacks.submitDecodeUnit = replaySubmitDecodeUnitHook;
+    replayStats = stats;
+    replayRandomState = options->seed != 0 ? options->seed : 1;
+
+    bufferSize = StreamConfig.packetSize + MAX_RTP_HEADER_SIZE;
+    buffer = malloc(bufferSize * (REPLAY_MAX_HELD + 1));
+    if (buffer == NULL) {
+        RtpcCloseCaptureFile(&capture);
+        return -1;
+    }
+
+    for (i = 0; i < REPLAY_MAX_HELD; i++) {
+        held[i].data = &buffer[bufferSize * (i + 1)];
+    }
+    heldCount = 0;
+
+    err = VideoCallbacks.setup(NegotiatedVideoFormat, StreamConfig.width,
+                               StreamConfig.height, StreamConfig.fps, NULL, 0);
+    if (err != 0) {
+        free(buffer);
+        RtpcCloseCaptureFile(&capture);
+        return err;
+    }
+
+    ConnectionInterrupted = 0;
+    initializeControlStream();
+    err = initializeVideoStream();
+    if (err != 0) {
+        destroyControlStream();
+        VideoCallbacks.cleanup();
+        free(buffer);
+        RtpcCloseCaptureFile(&capture);
+        return err;
+    }
+    VideoCallbacks.start();
+
+    err = startVideoFecRecovery();
+    if (err != 0) {
+        VideoCallbacks.stop();
+        stopVideoDepacketizer();
+        interruptControlStream();
+        destroyVideoStream();
+        destroyControlStream();
+        VideoCallbacks.cleanup();
+        free(buffer);
+        RtpcCloseCaptureFile(&capture);
+        return err;
+    }
+
+    startUs = PltGetMicroseconds();
+
+    while ((err = RtpcReadDatagram(&capture, buffer, bufferSize, &length, &receiveTimeMs)) > 0) {
+        stats->datagramsRead++;
+
+        if (rollPercent(options->lossPercent)) {
+            stats->datagramsDropped++;
+            continue;
+        }
+
+        if (options->reorderDistance > 0 && heldCount < REPLAY_MAX_HELD &&
+                rollPercent(options->reorderPercent)) {
+            memcpy(held[heldCount].data, buffer, length);
+            held[heldCount].length = length;
+            held[heldCount].receiveTimeMs = receiveTimeMs;
+            held[heldCount].remaining = 1 + (int)(nextReplayRandom() % options->reorderDistance);
+            heldCount++;
+            stats->datagramsReordered++;
+            continue;
+        }
+
+        if (rollPercent(options->duplicatePercent)) {
+            deliverDatagram(buffer, length, receiveTimeMs);
+            stats->datagramsDuplicated++;
+        }
+        deliverDatagram(buffer, length, receiveTimeMs);
+
+        releaseHeldDatagrams(held, &heldCount, 0);
+    }
+
+    releaseHeldDatagrams(held, &heldCount, 1);
+
+    // Let the recovery thread finish so every frame is counted
+    stopVideoFecRecovery();
+
+    stats->elapsedUs = PltGetMicroseconds() - startUs;
+
+    if (err < 0) {
+        Limelog("Video Replay: capture is truncated or corrupt after %llu datagrams\n",
+                (unsigned long long)stats->datagramsRead);
+    }
+
+    VideoCallbacks.stop();
+    stopVideoDepacketizer();
+    interruptControlStream();
+    destroyVideoStream();
+    destroyControlStream();
+    VideoCallbacks.cleanup();
+
+    free(buffer);
+    RtpcCloseCaptureFile(&capture);
+
+    Limelog("Video Replay: %llu datagrams (%llu dropped, %llu reordered, %llu duplicated) produced %llu decode units in %llu us\n",
+            (unsigned long long)stats->datagramsRead,
+            (unsigned long long)stats->datagramsDropped,
+            (unsigned long long)stats->datagramsReordered,
+            (unsigned long long)stats->datagramsDuplicated,
+            (unsigned long long)stats->decodeUnits,
+            (unsigned long long)stats->elapsedUs);
+
+    return err < 0 ? -1 : 0;
+}
@@ -2,6 +2,8 @@
 #include "PlatformSockets.h"
 #include "PlatformThreads.h"
 #include "RtpFecQueue.h"
+#include "PacketPool.h"
+#include "RtpCapture.h"
 
 #define FIRST_FRAME_MAX 1500
 #define FIRST_FRAME_TIMEOUT_SEC 10
@@ -11,31 +13,155 @@
 
 #define RTP_RECV_BUFFER (512 * 1024)
 
+// Number of datagrams pulled from the socket per receive call when
+// the platform supports batched receive
+#define VIDEO_RECV_BATCH_SIZE 32
+
 static RTP_FEC_QUEUE rtpQueue;
+static PACKET_POOL rtpPacketPool;
+// Guards the pools and the FEC queue against LiGet*Stats() during teardown
+static int videoStatsGuard;
 
 static SOCKET rtpSocket = INVALID_SOCKET;
 static SOCKET firstFrameSocket = INVALID_SOCKET;
 
+// Received datagrams are written here when capture is enabled
+static char* videoCapturePath;
+static RTP_CAPTURE_FILE videoCapture;
+
 static PLT_THREAD udpPingThread;
 static PLT_THREAD receiveThread;
 static PLT_THREAD decoderThread;
 
+// With CAPABILITY_ASYNC_FEC_RECOVERY, lossy frames are recovered on their own
+// thread. Either thread may then hand completed frames to the depacketizer, so
+// the delivery mutex keeps them in order and one at a time.
+static PLT_THREAD fecRecoveryThread;
+static PLT_MUTEX deliveryMutex;
+static int asyncFecRecovery;
+
+// Highest drop count the kernel has reported for the RTP socket
+static uint32_t socketBufferDrops;
+
 // We can't request an IDR frame until the depacketizer knows
 // that a packet was lost. This timeout bounds the time that
 // the RTP queue will wait for missing/reordered packets.
 #define RTP_QUEUE_DELAY 10
 
+// Bounds on the number of preallocated RTP packet buffers. The pool
+// falls back to the heap if a frame needs more than this.
+#define RTP_PACKET_POOL_MIN 64
+#define RTP_PACKET_POOL_MAX 1024
+
+// Returns the number of video packets in an average frame at the configured bitrate
+int getVideoPacketsPerFrame(void) {
+    long long bytesPerFrame;
+
+    if (StreamConfig.fps <= 0 || StreamConfig.packetSize <= 0) {
+        return 0;
+    }
+
+    // Bitrate is in Kbps
+    bytesPerFrame = ((long long)StreamConfig.bitrate * 1000 / 8) / StreamConfig.fps;
+
+    return (int)(bytesPerFrame / StreamConfig.packetSize) + 1;
+}
+
+// The RTP pool holds the FEC block being assembled, the frame being
+// handed to the depacketizer, and the receive batch. IDR frames are
+// many times the average frame size, so we leave plenty of headroom.
+static int getRtpPacketPoolCapacity(void) {
+    int capacity = getVideoPacketsPerFrame() * 4 + VIDEO_RECV_BATCH_SIZE;
+
+    if (capacity < RTP_PACKET_POOL_MIN) {
+        capacity = RTP_PACKET_POOL_MIN;
+    }
+    else if (capacity > RTP_PACKET_POOL_MAX) {
+        capacity = RTP_PACKET_POOL_MAX;
+    }
+
+    return capacity;
+}
 
 // Initialize the video stream
-void initializeVideoStream(void) {
-    initializeVideoDepacketizer(StreamConfig.packetSize);
-    RtpfInitializeQueue(&rtpQueue); //TODO RTP_QUEUE_DELAY
+int initializeVideoStream(void) {
+    int err;
+
+    err = PpInitializePacketPool(&rtpPacketPool,
+                                 StreamConfig.packetSize + MAX_RTP_HEADER_SIZE + sizeof(RTPFEC_QUEUE_ENTRY),
+                                 getRtpPacketPoolCapacity());
+    if (err != 0) {
+        return err;
+    }
+
+    err = initializeVideoDepacketizer(StreamConfig.packetSize);
+    if (err != 0) {
+        PpCleanupPacketPool(&rtpPacketPool);
+        return err;
+    }
+
+    initializeFrameTelemetry();
+    RtpfInitializeQueue(&rtpQueue, &rtpPacketPool); //TODO RTP_QUEUE_DELAY
+    socketBufferDrops = 0;
+    statsGuardOpen(&videoStatsGuard);
+    return 0;
 }
 
 // Clean up the video stream
 void destroyVideoStream(void) {
+    FEC_STATS fecStats;
+
+    RtpfGetFecStats(&rtpQueue, &fecStats);
+    fecStats.socketBufferDrops = socketBufferDrops;
+    Limelog("Video FEC: %llu/%llu RS context cache hits, %llu/%llu decode matrix cache hits\n",
+            (unsigned long long)fecStats.contextCacheHits,
+            (unsigned long long)(fecStats.contextCacheHits + fecStats.contextCacheMisses),
+            (unsigned long long)fecStats.matrixCacheHits,
+            (unsigned long long)(fecStats.matrixCacheHits + fecStats.matrixCacheMisses));
+    Limelog("Video FEC: %llu async recoveries, %llu datagrams read during recovery, %llu socket buffer drops\n",
+            (unsigned long long)fecStats.asyncRecoveries,
+            (unsigned long long)fecStats.packetsReceivedDuringRecovery,
+            (unsigned long long)fecStats.socketBufferDrops);
+
+    statsGuardClose(&videoStatsGuard);
     destroyVideoDepacketizer();
     RtpfCleanupQueue(&rtpQueue);
+    PpCleanupPacketPool(&rtpPacketPool);
+}
+
+int LiGetPacketPoolStats(int pool, PPACKET_POOL_STATS stats) {
+    if (pool == PACKET_POOL_AUDIO) {
+        return getAudioPacketPoolStats(stats);
+    }
+
+    if (pool != PACKET_POOL_VIDEO_RTP && pool != PACKET_POOL_VIDEO_FRAGMENT) {
+        return -1;
+    }
+
+    if (!statsGuardEnter(&videoStatsGuard)) {
+        return -1;
+    }
+
+    if (pool == PACKET_POOL_VIDEO_RTP) {
+        PpGetPacketPoolStats(&rtpPacketPool, stats);
+    }
+    else {
+        getVideoDepacketizerPoolStats(stats);
+    }
+
+    statsGuardLeave(&videoStatsGuard);
+    return 0;
+}
+
+int LiGetFecStats(PFEC_STATS stats) {
+    if (!statsGuardEnter(&videoStatsGuard)) {
+        return -1;
+    }
+
+    RtpfGetFecStats(&rtpQueue, stats);
+    stats->socketBufferDrops = socketBufferDrops;
+    statsGuardLeave(&videoStatsGuard);
+    return 0;
 }
 
 // UDP Ping proc
@@ -59,18 +185,117 @@ static void UdpPingThreadProc(void* context) {
     }
 }
 
+// Passes completed frames from the RTP queue to the depacketizer
+static void deliverQueuedPackets(void) {
+    PRTPFEC_QUEUE_ENTRY queueEntry;
+
+    if (asyncFecRecovery) {
+        PltLockMutex(&deliveryMutex);
+    }
+
+    while ((queueEntry = RtpfGetQueuedPacket(&rtpQueue)) != NULL) {
+        queueRtpPacket(queueEntry);
+        PpFreePacket(&rtpPacketPool, queueEntry->packet);
+    }
+
+    if (asyncFecRecovery) {
+        PltUnlockMutex(&deliveryMutex);
+    }
+}
+
+// Hands a received datagram to the RTP queue. The buffer must come from the
+// RTP packet pool with room for a queue entry after the packet. Returns 1 if
+// the queue took ownership of the buffer.
+static int processVideoDatagram(char* buffer, int length, unsigned long long receiveTimeMs) {
+    int receiveSize = StreamConfig.packetSize + MAX_RTP_HEADER_SIZE;
+    PRTP_PACKET packet;
+    int queueStatus;
+
+    // RTP sequence number must be in host order for the RTP queue
+    packet = (PRTP_PACKET)&buffer[0];
+    packet->sequenceNumber = htons(packet->sequenceNumber);
+
+    queueStatus = RtpfAddPacket(&rtpQueue, packet, length,
+                                (PRTPFEC_QUEUE_ENTRY)&buffer[receiveSize],
+                                receiveTimeMs);
+    if (queueStatus == RTPF_RET_QUEUED_PACKETS_READY) {
+        // The packet queue now has packets ready
+        deliverQueuedPackets();
+        return 1;
+    }
+    else if (queueStatus == RTPF_RET_QUEUED_NOTHING_READY) {
+        return 1;
+    }
+
+    return 0;
+}
+
+// Feeds a datagram read from a capture file through the same path as the receive thread
+int submitReplayedVideoDatagram(char* data, int length, unsigned long long receiveTimeMs) {
+    char* buffer;
+
+    if (length <= 0 || length > StreamConfig.packetSize + MAX_RTP_HEADER_SIZE) {
+        return -1;
+    }
+
+    buffer = (char*)PpAllocatePacket(&rtpPacketPool);
+    if (buffer == NULL) {
+        return -1;
+    }
+
+    memcpy(buffer, data, length);
+    if (!processVideoDatagram(buffer, length, receiveTimeMs)) {
+        PpFreePacket(&rtpPacketPool, buffer);
+    }
+
+    return 0;
+}
+
+void LiSetVideoCapturePath(const char* path) {
+    free(videoCapturePath);
+    videoCapturePath = path != NULL ? strdup(path) : NULL;
+}
+
+static void openVideoCapture(void) {
+    RTP_CAPTURE_HEADER header;
+
+    if (videoCapturePath == NULL) {
+        return;
+    }
+
+    header.packetSize = StreamConfig.packetSize;
+    header.width = StreamConfig.width;
+    header.height = StreamConfig.height;
+    header.fps = StreamConfig.fps;
+    header.bitrate = StreamConfig.bitrate;
+    header.videoFormat = NegotiatedVideoFormat;
+    memcpy(header.appVersionQuad, AppVersionQuad, sizeof(header.appVersionQuad));
+
+    if (RtpcCreateCaptureFile(&videoCapture, videoCapturePath, &header) != 0) {
+        Limelog("Unable to create video capture file: %s\n", videoCapturePath);
+    }
+    else {
+        Limelog("Capturing video datagrams to %s\n", videoCapturePath);
+    }
+}
+
 // Receive thread proc
 static void ReceiveThreadProc(void* context) {
     int err;
-    int bufferSize, receiveSize;
-    char* buffer;
-    int queueStatus;
+    int receiveSize;
     int useSelect;
-    PRTPFEC_QUEUE_ENTRY queueEntry;
+    int spinUs;
+    int batchSize;
+    int i;
+    UDP_RECV_BATCH_ENTRY batch[VIDEO_RECV_BATCH_SIZE];
+    unsigned long long recvCalls, recvDatagrams;
 
     receiveSize = StreamConfig.packetSize + MAX_RTP_HEADER_SIZE;
-    bufferSize = receiveSize + sizeof(RTPFEC_QUEUE_ENTRY);
-    buffer = NULL;
+    batchSize = getUdpRecvBatchSize(VIDEO_RECV_BATCH_SIZE);
+    memset(batch, 0, sizeof(batch));
+    recvCalls = recvDatagrams = 0;
+
+    configureReceiveThread("Video Receive", 1);
 
     if (setNonFatalRecvTimeoutMs(rtpSocket, UDP_RECV_POLL_TIMEOUT_MS) < 0) {
         // SO_RCVTIMEO failed, so use select() to wait
@@ -81,21 +306,35 @@ static void ReceiveThreadProc(void* context) {
         useSelect = 0;
     }
 
+    spinUs = configureLowLatencyReceive(rtpSocket);
+
+    // Use kernel receive timestamps and drop counts if they're available
+    enableUdpRecvTimestamps(rtpSocket);
+    enableUdpRecvDropCounter(rtpSocket);
+
     while (!PltIsThreadInterrupted(&receiveThread)) {
-        PRTP_PACKET packet;
-
-        if (buffer == NULL) {
-            buffer = (char*)malloc(bufferSize);
-            if (buffer == NULL) {
-                Limelog("Video Receive: malloc() failed\n");
-                ListenerCallbacks.connectionTerminated(-1);
-                return;
+        // Replace any buffers that the RTP queue took ownership of
+        for (i = 0; i < batchSize; i++) {
+            if (batch[i].buffer == NULL) {
+                batch[i].buffer = (char*)PpAllocatePacket(&rtpPacketPool);
+                if (batch[i].buffer == NULL) {
+                    Limelog("Video Receive: PpAllocatePacket() failed\n");
+                    ListenerCallbacks.connectionTerminated(-1);
+                    goto Exit;
+                }
+
+                batch[i].size = receiveSize;
             }
         }
 
-        err = recvUdpSocket(rtpSocket, buffer, receiveSize, useSelect);
+        if (spinUs != 0) {
+            // Catch the next datagram without sleeping if it arrives soon
+            spinUntilUdpSocketReadable(rtpSocket, spinUs);
+        }
+
+        err = recvUdpSocketBatch(rtpSocket, batch, batchSize, useSelect);
         if (err < 0) {
-            Limelog("Video Receive: recvUdpSocket() failed: %d\n", (int)LastSocketError());
+            Limelog("Video Receive: recvUdpSocketBatch() failed: %d\n", (int)LastSocketError());
             ListenerCallbacks.connectionTerminated(LastSocketError());
             break;
         }
@@ -104,30 +343,95 @@ static void ReceiveThreadProc(void* context) {
             continue;
         }
 
-        // RTP sequence number must be in host order for the RTP queue
-        packet = (PRTP_PACKET)&buffer[0];
-        packet->sequenceNumber = htons(packet->sequenceNumber);
-
-        queueStatus = RtpfAddPacket(&rtpQueue, packet, err, (PRTPFEC_QUEUE_ENTRY)&buffer[receiveSize]);
-        if (queueStatus == RTPF_RET_QUEUED_PACKETS_READY) {
-            // The packet queue now has packets ready
-            buffer = NULL;
-            while ((queueEntry = RtpfGetQueuedPacket(&rtpQueue)) != NULL) {
-                queueRtpPacket(queueEntry);
-                free(queueEntry->packet);
+        recvCalls++;
+        recvDatagrams += err;
+
+        for (i = 0; i < err; i++) {
+            if (batch[i].socketDropCount > socketBufferDrops) {
+                socketBufferDrops = batch[i].socketDropCount;
+            }
+
+            if (videoCapture.file != NULL &&
+                RtpcWriteDatagram(&videoCapture, batch[i].buffer, batch[i].length, batch[i].receiveTimeMs) != 0) {
+                Limelog("Video Receive: capture write failed; capture stopped\n");
+                RtpcCloseCaptureFile(&videoCapture);
+            }
+
+            if (processVideoDatagram(batch[i].buffer, batch[i].length, batch[i].receiveTimeMs)) {
+                // The queue owns the buffer
+                batch[i].buffer = NULL;
             }
         }
-        else if (queueStatus == RTPF_RET_QUEUED_NOTHING_READY) {
-            // The queue owns the buffer
-            buffer = NULL;
+    }
+
+Exit:
+    Limelog("Video Receive: %llu datagrams in %llu receive calls\n", recvDatagrams, recvCalls);
+
+    for (i = 0; i < batchSize; i++) {
+        if (batch[i].buffer != NULL) {
+            PpFreePacket(&rtpPacketPool, batch[i].buffer);
         }
     }
+}
 
-    if (buffer != NULL) {
-        free(buffer);
+// FEC recovery thread proc
+static void FecRecoveryThreadProc(void* context) {
+    while (RtpfRecoverNextBlock(&rtpQueue)) {
+        deliverQueuedPackets();
     }
 }
 
+// Starts the FEC recovery thread if the renderer asked for it. This must be
+// called before any datagrams reach the RTP queue.
+int startVideoFecRecovery(void) {
+    int err;
+
+    if ((VideoCallbacks.capabilities & CAPABILITY_ASYNC_FEC_RECOVERY) == 0) {
+        return 0;
+    }
+
+    err = PltCreateMutex(&deliveryMutex);
+    if (err != 0) {
+        return err;
+    }
+
+    err = RtpfStartAsyncRecovery(&rtpQueue);
+    if (err != 0) {
+        PltDeleteMutex(&deliveryMutex);
+        return err;
+    }
+
+    asyncFecRecovery = 1;
+
+    err = PltCreateThread(FecRecoveryThreadProc, NULL, &fecRecoveryThread);
+    if (err != 0) {
+        // The queue tears down its async state in RtpfCleanupQueue()
+        asyncFecRecovery = 0;
+        PltDeleteMutex(&deliveryMutex);
+        return err;
+    }
+
+    return 0;
+}
+
+// Waits for the FEC recovery thread to finish the frames it was given. This
+// must only be called once nothing else is adding datagrams to the RTP queue.
+void stopVideoFecRecovery(void) {
+    if (!asyncFecRecovery) {
+        return;
+    }
+
+    // The thread exits once it reaches the stop marker, so it still
+    // finishes the frames queued ahead of it
+    RtpfStopAsyncRecovery(&rtpQueue);
+    PltInterruptThread(&fecRecoveryThread);
+    PltJoinThread(&fecRecoveryThread);
+    PltCloseThread(&fecRecoveryThread);
+
+    asyncFecRecovery = 0;
+    PltDeleteMutex(&deliveryMutex);
+}
+
 // Decoder thread proc
 static void DecoderThreadProc(void* context) {
     PQUEUED_DECODE_UNIT qdu;
@@ -136,8 +440,13 @@ static void DecoderThreadProc(void* context) {
             return;
         }
 
+        qdu->timing.dequeuedUs = PltGetMicroseconds();
+
         int ret = VideoCallbacks.submitDecodeUnit(&qdu->decodeUnit);
 
+        qdu->timing.submitReturnedUs = PltGetMicroseconds();
+        commitFrameTiming(&qdu->timing);
+
         freeQueuedDecodeUnit(qdu);
 
         if (ret == DR_NEED_IDR) {
@@ -186,6 +495,9 @@ void stopVideoStream(void) {
     if ((VideoCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
         PltCloseThread(&decoderThread);
     }
+
+    // Nothing is feeding the RTP queue now
+    stopVideoFecRecovery();
     
     if (firstFrameSocket != INVALID_SOCKET) {
         closeSocket(firstFrameSocket);
@@ -196,6 +508,9 @@ void stopVideoStream(void) {
         rtpSocket = INVALID_SOCKET;
     }
 
+    // The receive thread is gone so nothing else writes the capture
+    RtpcCloseCaptureFile(&videoCapture);
+
     VideoCallbacks.cleanup();
 }
 
@@ -214,7 +529,7 @@ int startVideoStream(void* rendererContext, int drFlags) {
         return err;
     }
 
-    rtpSocket = bindUdpSocket(RemoteAddr.ss_family, RTP_RECV_BUFFER);
+    rtpSocket = bindUdpSocket(RemoteAddr.ss_family, getReceiveBufferSize(RTP_RECV_BUFFER));
     if (rtpSocket == INVALID_SOCKET) {
         VideoCallbacks.cleanup();
         return LastSocketError();
@@ -222,9 +537,22 @@ int startVideoStream(void* rendererContext, int drFlags) {
 
     VideoCallbacks.start();
 
+    openVideoCapture();
+
+    err = startVideoFecRecovery();
+    if (err != 0) {
+        VideoCallbacks.stop();
+        RtpcCloseCaptureFile(&videoCapture);
+        closeSocket(rtpSocket);
+        VideoCallbacks.cleanup();
+        return err;
+    }
+
     err = PltCreateThread(ReceiveThreadProc, NULL, &receiveThread);
     if (err != 0) {
         VideoCallbacks.stop();
+        stopVideoFecRecovery();
+        RtpcCloseCaptureFile(&videoCapture);
         closeSocket(rtpSocket);
         VideoCallbacks.cleanup();
         return err;
@@ -237,6 +565,8 @@ int startVideoStream(void* rendererContext, int drFlags) {
             PltInterruptThread(&receiveThread);
             PltJoinThread(&receiveThread);
             PltCloseThread(&receiveThread);
+            stopVideoFecRecovery();
+            RtpcCloseCaptureFile(&videoCapture);
             closeSocket(rtpSocket);
             VideoCallbacks.cleanup();
             return err;
@@ -262,6 +592,8 @@ int startVideoStream(void* rendererContext, int drFlags) {
             if ((VideoCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
                 PltCloseThread(&decoderThread);
             }
+            stopVideoFecRecovery();
+            RtpcCloseCaptureFile(&videoCapture);
             closeSocket(rtpSocket);
             VideoCallbacks.cleanup();
             return LastSocketError();
@@ -286,6 +618,8 @@ int startVideoStream(void* rendererContext, int drFlags) {
         if ((VideoCallbacks.capabilities & CAPABILITY_DIRECT_SUBMIT) == 0) {
             PltCloseThread(&decoderThread);
         }
+        stopVideoFecRecovery();
+        RtpcCloseCaptureFile(&videoCapture);
         closeSocket(rtpSocket);
         if (firstFrameSocket != INVALID_SOCKET) {
             closeSocket(firstFrameSocket);